@@ -15,6 +15,15 @@ Mesh::~Mesh()
 }
 
 bool Mesh::loadOBJ(const std::string& filename)
+{
+    if (!readOBJ(filename))
+        return false;
+
+    initBuffer();
+    return true;
+}
+
+bool Mesh::readOBJ(const std::string& filename)
 {
     //temporary container when we are reading the file
     std::vector<unsigned int> vertexIndices, uvIndices;
@@ -95,8 +104,7 @@ bool Mesh::loadOBJ(const std::string& filename)
             mVertices.push_back(meshVertex);
         }
 
-        initBuffer();
-        return (mLoaded = true); 
+        return true;
     }
     
     //immediately return if the file is not OBJ
@@ -114,6 +122,8 @@ void Mesh::draw()
 
 void Mesh::initBuffer()
 {
+    if (mVertices.empty()) return;
+
     // Generate and bind Vertex Array Object (VAO)
     //A VAO is an OpenGL object that stores the configuration of vertex attributes.It simplifies the process of switching between different vertex configurations.Related to VBO
     glGenVertexArrays(1, &mVAO);
@@ -134,4 +144,5 @@ void Mesh::initBuffer()
     glEnableVertexAttribArray(1);
 
     glBindVertexArray(0); // Unbind the VAO. We are done
+    mLoaded = true;
 }
@@ -23,9 +23,12 @@ public:
     bool loadOBJ(const std::string& filename);
     void draw();
 
-private:
-
+    //The two halves of loadOBJ. readOBJ only fills mVertices and can run on another thread,
+    //initBuffer creates the GL objects and needs the thread that owns the context
+    bool readOBJ(const std::string& filename);
     void initBuffer();
+
+private:
     
     bool mLoaded;
     std::vector<Vertex> mVertices;// store collections elements(vertex structure) of the same data type
@@ -4,15 +4,26 @@
 #include "stb_image/stb_image.h"
 
 Texture2D::Texture2D()
-    :mTexture(0) // Constructor. Initialize mTexture to 0
+    :mTexture(0), // Constructor. Initialize mTexture to 0
+    mImageData(NULL),
+    mWidth(0),
+    mHeight(0)
 {
 }
 
 Texture2D::~Texture2D()
 {
+    //Only still set when readTexture ran without a createTexture after it
+    if (mImageData != NULL)
+        stbi_image_free(mImageData);
 }
 
 bool Texture2D::loadTexture(const string& filename, bool generateMipMaps)
+{
+    return readTexture(filename) && createTexture(generateMipMaps);
+}
+
+bool Texture2D::readTexture(const string& filename)
 {
     //Loading image using custom library
     int width, height, components;
@@ -45,6 +56,17 @@ bool Texture2D::loadTexture(const string& filename, bool generateMipMaps)
         }
     }
 
+    mImageData = imageData;
+    mWidth = width;
+    mHeight = height;
+    return true;
+}
+
+bool Texture2D::createTexture(bool generateMipMaps)
+{
+    if (mImageData == NULL)
+        return false;
+
     //Create OpenGL texture
     glGenTextures(1,&mTexture);
     glBindTexture(GL_TEXTURE_2D,mTexture); //We need to bind the texture we are using before setting parameters
@@ -54,7 +76,7 @@ bool Texture2D::loadTexture(const string& filename, bool generateMipMaps)
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR); //if texture is smaller than the mapping area
 
     //Mapping the loaded image data to the texture
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, imageData);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, mWidth, mHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, mImageData);
 
     //Setup mipmapping if requested
     if (generateMipMaps)
@@ -63,7 +85,8 @@ bool Texture2D::loadTexture(const string& filename, bool generateMipMaps)
     }
     
     //Free the image data and Unbind the texture after loaded into OpenGL
-    stbi_image_free(imageData);
+    stbi_image_free(mImageData);
+    mImageData = NULL;
     glBindTexture(GL_TEXTURE_2D, 0);
     
     return true;
@@ -12,12 +12,21 @@ public:
     virtual ~Texture2D();
 
     bool loadTexture(const string& filename, bool generateMipMaps = true);
+
+    //The two halves of loadTexture. readTexture only decodes the file and can run on another thread,
+    //createTexture uploads it and needs the thread that owns the context
+    bool readTexture(const string& filename);
+    bool createTexture(bool generateMipMaps = true);
     void bindTexture(GLuint textureUnit = 0);
     void unbindTexture(GLuint textureUnit = 0);
 
 private:
     //Create a handle
     GLuint mTexture;
+
+    //Decoded pixels between readTexture and createTexture
+    unsigned char* mImageData;
+    int mWidth, mHeight;
 };
 
 
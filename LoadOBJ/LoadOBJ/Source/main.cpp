@@ -1,7 +1,10 @@
 // This file contains the 'main' function. Program execution begins and ends there.
 
+#include <chrono>
+#include <future>
 #include <iostream>
 #include <sstream>
+#include <thread>
 
 #define GLEW_STATIC
 #include "GL/glew.h"
@@ -68,15 +71,45 @@ int main()
 	Mesh mesh[numModels];
 	Texture2D texture[numModels];
 
-	mesh[0].loadOBJ("RubberToy.obj");
-	mesh[1].loadOBJ("Suzan.obj");
-	mesh[2].loadOBJ("Teapot.obj");
-	mesh[3].loadOBJ("GroundPlane.obj");
-	
-	texture[0].loadTexture("Grass.jpg", true);
-	texture[1].loadTexture("Rusted.jpg", true);
-	texture[2].loadTexture("Brick.jpg", true);
-	texture[3].loadTexture("Concrete.jpg", true);
+	const char* meshFiles[numModels] = { "RubberToy.obj", "Suzan.obj", "Teapot.obj", "GroundPlane.obj" };
+	const char* textureFiles[numModels] = { "Grass.jpg", "Rusted.jpg", "Brick.jpg", "Concrete.jpg" };
+
+	//Reading and parsing the OBJ files and decoding the JPEGs all run at the same time on other threads.
+	//Only the GL uploads happen here, because this thread owns the OpenGL context
+	double loadStartTime = glfwGetTime();
+	std::future<bool> meshReads[numModels], textureReads[numModels];
+	for (int i = 0; i < numModels; i++)
+	{
+		meshReads[i] = std::async(std::launch::async, &Mesh::readOBJ, &mesh[i], std::string(meshFiles[i]));
+		textureReads[i] = std::async(std::launch::async, &Texture2D::readTexture, &texture[i], std::string(textureFiles[i]));
+	}
+	//Upload whichever read is done, in any order, so uploads overlap the reads still running. A future is no longer
+	//valid once its result was taken. When nothing is ready, sleep a moment instead of spinning against the readers
+	int pending = numModels * 2;
+	while (pending > 0)
+	{
+		bool uploaded = false;
+		for (int i = 0; i < numModels; i++)
+		{
+			if (meshReads[i].valid() && meshReads[i].wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+			{
+				if (meshReads[i].get())
+					mesh[i].initBuffer();
+				pending--;
+				uploaded = true;
+			}
+			if (textureReads[i].valid() && textureReads[i].wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+			{
+				if (textureReads[i].get())
+					texture[i].createTexture(true);
+				pending--;
+				uploaded = true;
+			}
+		}
+		if (!uploaded)
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	std::cout << "Assets loaded in " << (glfwGetTime() - loadStartTime) * 1000.0 << " ms" << std::endl;
 	
 	double lastFrameTime = glfwGetTime();
 	
@@ -0,0 +1,181 @@
+//MeshTests [directory of the OBJ files]
+//Checks the CPU mesh pipeline on every OBJ file shipped with SpotLight, no GL context needed. Every triangle order pass
+//(MeshOptimizer.h) has to keep all triangles with their winding and must not make the vertex cache do worse than the
+//export order. Every LOD level (MeshSimplifier.h) has to stay within the error it records, and building the chain again
+//has to give the same bytes. Prints what failed and exits with 1 if anything did. The post-build step runs it on
+//SpotLight\bin, so a broken pass fails the build
+#include "MeshIndexer.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+#include "ObjParser.h"
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace
+{
+    //Every OBJ file shipped with the sample
+    const char* OBJ_FILES[] = { "RubberToy.obj", "Suzan.obj", "Teapot.obj", "GroundPlane.obj", "light.obj" };
+
+    //How far the measured error of a LOD level may go past MeshLod::error. Quadrics measure the distance to the planes of
+    //the original triangles, not to the triangles, and near corners of open borders the surface ends up slightly further
+    //(about 1% on GroundPlane's coarser levels). The part relative to the bounding box diagonal covers float noise on flat levels
+    const float LOD_ERROR_TOLERANCE = 0.1f;
+    const float LOD_ERROR_NOISE = 1e-5f;
+
+    int numFailures = 0;
+
+    void fail(const std::string& filename, const std::string& message)
+    {
+        std::cout << filename << ": FAILED " << message << std::endl;
+        numFailures++;
+    }
+
+    //A triangle by the values of its corners, so it compares across optimizeVertexFetch's renumbering. Rotated to start
+    //at its smallest corner, which keeps the winding: a flipped triangle never equals the original
+    typedef std::array<float, 8> Corner;
+    typedef std::array<Corner, 3> Triangle;
+
+    Corner corner(const Vertex& v)
+    {
+        Corner c = { v.position.x, v.position.y, v.position.z, v.normal.x, v.normal.y, v.normal.z, v.texCoords.x, v.texCoords.y };
+        return c;
+    }
+
+    Triangle triangle(const Corner& a, const Corner& b, const Corner& c)
+    {
+        Triangle t = { a, b, c };
+        Triangle second = { b, c, a }, third = { c, a, b };
+        return std::min(t, std::min(second, third));
+    }
+
+    //Sorted, so two meshes with the same triangles give equal lists
+    std::vector<Triangle> triangles(const std::vector<Vertex>& vertices, const std::vector<GLuint>& indices)
+    {
+        std::vector<Triangle> result;
+        result.reserve(indices.size() / 3);
+        for (size_t i = 0; i + 2 < indices.size(); i += 3)
+            result.push_back(triangle(corner(vertices[indices[i]]), corner(vertices[indices[i + 1]]), corner(vertices[indices[i + 2]])));
+        std::sort(result.begin(), result.end());
+        return result;
+    }
+
+    //Same triangles, windings and indices in range, and an ACMR no worse than the export order's
+    void checkPass(const std::string& filename, const char* pass, const std::vector<Triangle>& original, float originalAcmr,
+        const std::vector<Vertex>& vertices, const std::vector<GLuint>& indices)
+    {
+        for (GLuint index : indices)
+        {
+            if (index >= vertices.size())
+            {
+                fail(filename, std::string(pass) + ": index " + std::to_string(index) + " past the " +
+                    std::to_string(vertices.size()) + " vertices");
+                return;
+            }
+        }
+
+        std::vector<Triangle> reordered = triangles(vertices, indices);
+        if (reordered != original)
+        {
+            std::vector<Triangle> missing;
+            std::set_difference(original.begin(), original.end(), reordered.begin(), reordered.end(), std::back_inserter(missing));
+            size_t flipped = 0;
+            for (const Triangle& t : missing)
+            {
+                if (std::binary_search(reordered.begin(), reordered.end(), triangle(t[0], t[2], t[1])))
+                    flipped++;
+            }
+            fail(filename, std::string(pass) + ": " + std::to_string(original.size()) + " triangles in, " +
+                std::to_string(reordered.size()) + " out, " + std::to_string(missing.size() - flipped) + " lost, " +
+                std::to_string(flipped) + " with their winding flipped");
+        }
+
+        float acmr = analyzeVertexCache(indices, vertices.size()).acmr;
+        if (acmr > originalAcmr)
+        {
+            fail(filename, std::string(pass) + ": ACMR " + std::to_string(acmr) + " is worse than the export order's " +
+                std::to_string(originalAcmr));
+        }
+    }
+
+    //Each level against its recorded error, and a second build of the chain against the first
+    void checkLodChain(const std::string& filename, const std::vector<Vertex>& vertices, const std::vector<GLuint>& indices,
+        std::vector<MeshLod>& lods)
+    {
+        std::vector<GLuint> chain(indices), chainAgain(indices);
+        std::vector<MeshLod> lodsAgain;
+        buildLodChain(vertices, chain, lods);
+        buildLodChain(vertices, chainAgain, lodsAgain);
+        if (chain != chainAgain || lods.size() != lodsAgain.size() ||
+            memcmp(lods.data(), lodsAgain.data(), lods.size() * sizeof(MeshLod)) != 0)
+            fail(filename, "buildLodChain: building the chain again gave different indices or levels");
+
+        glm::vec3 boundsMin, boundsMax;
+        computeBounds(vertices, boundsMin, boundsMax);
+        float diagonal = glm::length(boundsMax - boundsMin);
+        for (size_t level = 1; level < lods.size(); level++)
+        {
+            float measured = measureLodError(vertices, chain, lods[level]);
+            if (measured > lods[level].error * (1.0f + LOD_ERROR_TOLERANCE) + diagonal * LOD_ERROR_NOISE)
+            {
+                fail(filename, "LOD " + std::to_string(level) + ": measured error " + std::to_string(measured) +
+                    " is past the recorded " + std::to_string(lods[level].error));
+            }
+        }
+    }
+
+    void testFile(const std::string& directory, const char* filename)
+    {
+        ObjData data;
+        if (!parseOBJ(directory + filename, data))
+        {
+            fail(filename, "cannot open " + directory + filename);
+            return;
+        }
+
+        std::vector<Vertex> vertices;
+        std::vector<GLuint> indices;
+        buildIndexedMesh(data, vertices, indices);
+        std::vector<Triangle> original = triangles(vertices, indices);
+        float originalAcmr = analyzeVertexCache(indices, vertices.size()).acmr;
+
+        //The passes in the order MeshBuilder runs them, each checked against the export order
+        std::vector<size_t> clusters;
+        optimizeVertexCache(indices, vertices.size(), VERTEX_CACHE_SIZE, &clusters);
+        checkPass(filename, "optimizeVertexCache", original, originalAcmr, vertices, indices);
+        optimizeOverdraw(indices, vertices, clusters);
+        checkPass(filename, "optimizeOverdraw", original, originalAcmr, vertices, indices);
+        optimizeVertexFetch(vertices, indices);
+        checkPass(filename, "optimizeVertexFetch", original, originalAcmr, vertices, indices);
+
+        //The chain is built from the ordered mesh, as in MeshBuilder
+        std::vector<MeshLod> lods;
+        checkLodChain(filename, vertices, indices, lods);
+
+        std::cout << std::left << std::setw(18) << filename << std::right << std::setw(7) << original.size() << " triangles, ACMR "
+            << std::fixed << std::setprecision(3) << originalAcmr << " -> " << analyzeVertexCache(indices, vertices.size()).acmr
+            << std::defaultfloat << ", " << lods.size() << " LOD levels" << std::endl;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    std::string directory = argc > 1 ? argv[1] : "";
+    if (!directory.empty() && directory.back() != '/' && directory.back() != '\\')
+        directory += '/';
+
+    for (const char* filename : OBJ_FILES)
+        testFile(directory, filename);
+
+    if (numFailures > 0)
+    {
+        std::cout << numFailures << " checks failed" << std::endl;
+        return 1;
+    }
+    std::cout << "All checks passed" << std::endl;
+    return 0;
+}
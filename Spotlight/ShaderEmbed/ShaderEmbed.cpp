@@ -0,0 +1,217 @@
+//ShaderEmbed <shader directory> <output header>
+//Writes the header ShaderLibrary.h includes: every .vert and .frag file of the directory with its #includes resolved
+//(ShaderSource::load, as ShaderProgram loads files) and a constexpr UniformName per uniform they declare. SpotLight's
+//pre-build step runs it. The header is only written when its text changes, so the sources including it are only
+//compiled again after a shader edit
+#include "Hash.h"
+#include "ShaderSource.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+    //MSVC takes string literals of up to 64KB, joined adjacent ones included
+    const size_t MAX_SOURCE_BYTES = 65000;
+
+    struct Shader
+    {
+        std::string name;
+        uint32_t hash;
+        std::string source;
+        std::vector<std::string> files;
+    };
+
+    //Lighting.frag -> Lighting_frag
+    std::string identifier(const std::string& name)
+    {
+        std::string result = name;
+        for (char& c : result)
+        {
+            if (!isalnum((unsigned char)c))
+                c = '_';
+        }
+        return result;
+    }
+
+    //One literal per line, the compiler joins them. Each is well below MSVC's 16K limit for a single literal
+    void writeLiteral(std::ostream& out, const std::string& text, const char* indent)
+    {
+        out << indent << "\"";
+        for (size_t i = 0; i < text.size(); i++)
+        {
+            unsigned char c = (unsigned char)text[i];
+            if (c == '\n')
+            {
+                out << "\\n\"";
+                if (i + 1 < text.size())
+                    out << "\n" << indent << "\"";
+                continue;
+            }
+            if (c == '\\' || c == '"')
+                out << '\\' << c;
+            else if (c == '\t')
+                out << "\\t";
+            else if (c < 32 || c > 126)
+            {
+                char octal[8];
+                snprintf(octal, sizeof(octal), "\\%03o", c); // always three digits, a following digit can't join in
+                out << octal;
+            }
+            else
+                out << c;
+        }
+        if (text.empty() || text.back() != '\n')
+            out << "\"";
+    }
+
+    //"uniform type name;", "uniform type name[N];" and "uniform type name = value;" at the start of a line. Block
+    //members don't start with uniform, and "uniform Frame" of a block has no name after the type
+    void findUniforms(const std::string& source, std::set<std::string>& uniforms)
+    {
+        std::istringstream lines(source);
+        std::string line;
+        while (std::getline(lines, line))
+        {
+            std::istringstream words(line);
+            std::string keyword, type, name;
+            words >> keyword >> type >> name;
+            if (keyword != "uniform")
+                continue;
+            size_t end = 0;
+            while (end < name.size() && (isalnum((unsigned char)name[end]) || name[end] == '_'))
+                end++;
+            if (end > 0 && !isdigit((unsigned char)name[0]))
+                uniforms.insert(name.substr(0, end));
+        }
+    }
+
+    std::string readAll(const std::string& filename)
+    {
+        std::ifstream file(filename, std::ios::in | std::ios::binary);
+        std::stringstream ss;
+        ss << file.rdbuf();
+        return ss.str();
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc != 3)
+    {
+        std::cerr << "Usage: ShaderEmbed <shader directory> <output header>" << std::endl;
+        return 1;
+    }
+    std::string directory = argv[1];
+    std::string outputFilename = argv[2];
+
+    std::vector<std::string> names;
+    std::error_code error;
+    for (const auto& entry : std::filesystem::directory_iterator(directory, error))
+    {
+        std::string extension = entry.path().extension().string();
+        if (entry.is_regular_file() && (extension == ".vert" || extension == ".frag"))
+            names.push_back(entry.path().filename().string());
+    }
+    if (error || names.empty())
+    {
+        std::cerr << "ShaderEmbed: no .vert or .frag files in " << directory << std::endl;
+        return 1;
+    }
+
+    //Paths come back with the directory in front, the library lists them as loadShaders gets them
+    std::string prefix = directory + "/";
+    std::vector<Shader> shaders;
+    std::set<std::string> uniforms;
+    for (const std::string& name : names)
+    {
+        Shader shader;
+        shader.name = name;
+        shader.hash = hashString(name.c_str());
+        shader.source = ShaderSource::load(prefix + name, shader.files);
+        for (std::string& file : shader.files)
+        {
+            if (file.compare(0, prefix.size(), prefix) == 0)
+                file.erase(0, prefix.size());
+        }
+        if (shader.source.size() > MAX_SOURCE_BYTES)
+        {
+            std::cerr << "ShaderEmbed: " << name << " is " << shader.source.size() << " bytes with its includes, more than "
+                << MAX_SOURCE_BYTES << " don't fit in one string literal" << std::endl;
+            return 1;
+        }
+        findUniforms(shader.source, uniforms);
+        shaders.push_back(shader);
+    }
+
+    //Sorted by hash for ShaderLibrary::find's binary search. Two names of the same hash couldn't both be found
+    std::sort(shaders.begin(), shaders.end(), [](const Shader& a, const Shader& b) { return a.hash < b.hash; });
+    for (size_t i = 1; i < shaders.size(); i++)
+    {
+        if (shaders[i].hash == shaders[i - 1].hash)
+        {
+            std::cerr << "ShaderEmbed: " << shaders[i - 1].name << " and " << shaders[i].name << " share a hash, rename one" << std::endl;
+            return 1;
+        }
+    }
+
+    std::ostringstream out;
+    out << "//Generated by ShaderEmbed from the shaders in " << directory << ", before every build. Edit the shaders, not this file\n";
+    out << "#ifndef EMBEDDED_SHADERS_H\n#define EMBEDDED_SHADERS_H\n\n";
+    out << "namespace EmbeddedShaderData\n{\n";
+    size_t totalBytes = 0;
+    for (const Shader& shader : shaders)
+    {
+        std::string id = identifier(shader.name);
+        out << "    inline constexpr const char* " << id << "_files[] = {";
+        for (size_t i = 0; i < shader.files.size(); i++)
+            out << (i > 0 ? ", " : " ") << "\"" << shader.files[i] << "\"";
+        out << " };\n";
+        out << "    inline constexpr char " << id << "[] =\n";
+        writeLiteral(out, shader.source, "        ");
+        out << ";\n\n";
+        totalBytes += shader.source.size();
+    }
+    out << "}\n\n";
+
+    out << "inline constexpr EmbeddedShader EMBEDDED_SHADERS[] =\n{\n";
+    for (const Shader& shader : shaders)
+    {
+        std::string id = identifier(shader.name);
+        char hash[16];
+        snprintf(hash, sizeof(hash), "0x%08xu", shader.hash);
+        out << "    { \"" << shader.name << "\", " << hash << ", EmbeddedShaderData::" << id << ", EmbeddedShaderData::" << id
+            << "_files, " << shader.files.size() << " },\n";
+    }
+    out << "};\n\n";
+
+    out << "namespace ShaderUniforms\n{\n";
+    for (const std::string& uniform : uniforms)
+        out << "    inline constexpr UniformName " << uniform << "(\"" << uniform << "\");\n";
+    out << "}\n\n#endif\n";
+
+    //Left alone when nothing changed, its time stamp decides what gets compiled again
+    std::string text = out.str();
+    if (readAll(outputFilename) == text)
+        return 0;
+    std::filesystem::path outputPath(outputFilename);
+    if (outputPath.has_parent_path())
+        std::filesystem::create_directories(outputPath.parent_path(), error);
+    std::ofstream file(outputFilename, std::ios::out | std::ios::binary | std::ios::trunc);
+    file << text;
+    if (!file)
+    {
+        std::cerr << "ShaderEmbed: cannot write " << outputFilename << std::endl;
+        return 1;
+    }
+    std::cout << "Embedded " << shaders.size() << " shaders (" << totalBytes << " bytes) and " << uniforms.size()
+        << " uniform names into " << outputFilename << std::endl;
+    return 0;
+}
@@ -0,0 +1,114 @@
+#include "AssetLoader.h"
+#include "MeshBuilder.h"
+#include "MipChain.h"
+#include "ThreadPool.h"
+
+AssetLoader::AssetLoader(ThreadPool& pool)
+    :mPool(pool),
+    mRunning(0),
+    mPending(0)
+{
+}
+
+AssetLoader::~AssetLoader()
+{
+    //The tasks point at this loader
+    std::unique_lock<std::mutex> lock(mMutex);
+    mCpuDone.wait(lock, [this]() { return mRunning == 0; });
+}
+
+std::shared_future<bool> AssetLoader::start(const std::function<void(Load&)>& cpuWork)
+{
+    std::shared_ptr<Load> load = std::make_shared<Load>();
+    std::shared_future<bool> future = load->result.get_future().share();
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mRunning++;
+        mPending++;
+    }
+
+    mPool.run([this, load, cpuWork]()
+    {
+        cpuWork(*load);
+
+        std::lock_guard<std::mutex> lock(mMutex);
+        mReady.push_back(load);
+        mRunning--;
+        mCpuDone.notify_all();
+    });
+    return future;
+}
+
+std::shared_future<bool> AssetLoader::loadMesh(Mesh& mesh, const std::string& filename, const VertexFormat& format,
+    MeshStreamer* streamer)
+{
+    ThreadPool* pool = &mPool;
+    return start([&mesh, filename, format, streamer, pool](Load& load)
+    {
+        //Mesh building splits big files across the same pool, parallelFor is safe inside a task
+        std::shared_ptr<MeshData> data = std::make_shared<MeshData>();
+        if (filename.find(".obj") == std::string::npos || !loadMeshData(filename, *data, pool, format))
+            return;
+        load.upload = [&mesh, data, format, streamer]() { return mesh.create(*data, format, streamer); };
+    });
+}
+
+std::shared_future<bool> AssetLoader::loadMesh(Mesh& mesh, const std::string& filename, GeometryArena& arena, MeshStreamer* streamer)
+{
+    ThreadPool* pool = &mPool;
+    return start([&mesh, filename, &arena, streamer, pool](Load& load)
+    {
+        std::shared_ptr<MeshData> data = std::make_shared<MeshData>();
+        if (filename.find(".obj") == std::string::npos || !loadMeshData(filename, *data, pool, arena.getFormat()))
+            return;
+        load.upload = [&mesh, data, &arena, streamer]() { return mesh.create(*data, arena, streamer); };
+    });
+}
+
+std::shared_future<bool> AssetLoader::loadTexture(Texture2D& texture, const std::string& filename, bool generateMipMaps)
+{
+    ThreadPool* pool = &mPool;
+    return start([&texture, filename, generateMipMaps, pool](Load& load)
+    {
+        //The mip levels are read from the cache or filtered here, the GL thread only uploads them
+        std::shared_ptr<MipChain> chain = std::make_shared<MipChain>(1);
+        bool loaded = generateMipMaps ? loadMipChain(filename, *chain, MipSettings(), pool) : Texture2D::decodeImage(filename, (*chain)[0]);
+        if (!loaded)
+            return;
+        load.upload = [&texture, chain]() { return texture.createTexture(*chain); };
+    });
+}
+
+size_t AssetLoader::update()
+{
+    std::deque<std::shared_ptr<Load> > ready;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        ready.swap(mReady);
+    }
+
+    for (std::shared_ptr<Load>& load : ready)
+        load->result.set_value(load->upload ? load->upload() : false);
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    mPending -= ready.size();
+    return ready.size();
+}
+
+void AssetLoader::waitAll()
+{
+    while (pending() > 0)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mCpuDone.wait(lock, [this]() { return !mReady.empty(); });
+        }
+        update();
+    }
+}
+
+size_t AssetLoader::pending() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mPending;
+}
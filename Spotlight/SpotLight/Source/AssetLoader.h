@@ -0,0 +1,64 @@
+#ifndef ASSET_LOADER_H
+#define ASSET_LOADER_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "Mesh.h"
+#include "Texture2D.h"
+
+class ThreadPool;
+
+//----------------------------------------------
+//Loads meshes and textures in the background. File reads, OBJ parsing and mesh building, and image decoding run as
+//ThreadPool tasks, so they overlap each other; only the buffer and texture uploads come back to the GL thread,
+//through update() or waitAll().
+//The returned future turns ready once the object is usable, with false if loading failed.
+//The Mesh and Texture2D objects must outlive their loads
+//----------------------------------------------
+class AssetLoader
+{
+public:
+    explicit AssetLoader(ThreadPool& pool);
+    ~AssetLoader(); // waits for CPU work still running, uploads nothing
+
+    std::shared_future<bool> loadMesh(Mesh& mesh, const std::string& filename, const VertexFormat& format = VertexFormat(),
+        MeshStreamer* streamer = NULL);
+    std::shared_future<bool> loadMesh(Mesh& mesh, const std::string& filename, GeometryArena& arena, MeshStreamer* streamer = NULL);
+    std::shared_future<bool> loadTexture(Texture2D& texture, const std::string& filename, bool generateMipMaps = true);
+
+    //GL thread: uploads everything whose CPU part has finished, never waits. Returns how many loads completed
+    size_t update();
+
+    //GL thread: update() until every load has completed
+    void waitAll();
+
+    //Loads not completed yet
+    size_t pending() const;
+
+private:
+    AssetLoader(const AssetLoader&);
+    AssetLoader& operator=(const AssetLoader&);
+
+    struct Load
+    {
+        std::promise<bool> result;
+        std::function<bool()> upload; // set by the worker, empty when the CPU part failed
+    };
+
+    std::shared_future<bool> start(const std::function<void(Load&)>& cpuWork);
+
+    ThreadPool& mPool;
+    mutable std::mutex mMutex;
+    std::condition_variable mCpuDone;
+    std::deque<std::shared_ptr<Load> > mReady; // CPU part done, waiting for the GL thread
+    size_t mRunning; // CPU parts queued or running
+    size_t mPending; // loads not completed
+};
+
+#endif
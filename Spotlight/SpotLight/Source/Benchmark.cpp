@@ -0,0 +1,2980 @@
+#define GLEW_STATIC // glewInit for the GL benchmarks, as in main.cpp
+#include "Benchmark.h"
+#include "AssetLoader.h"
+#include "Camera.h"
+#include "GeometryArena.h"
+#include "GLState.h"
+#include "Hash.h"
+#include "ImageKernels.h"
+#include "IndirectRenderer.h"
+#include "InstanceBuffer.h"
+#include "MappedFile.h"
+#include "MeshBuilder.h"
+#include "MeshCache.h"
+#include "MeshIndexer.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+#include "MeshStreamer.h"
+#include "MeshletBuilder.h"
+#include "MipCache.h"
+#include "MipChain.h"
+#include "NormalGenerator.h"
+#include "ObjParser.h"
+#include "ProgramCache.h"
+#include "RenderQueue.h"
+#include "ShaderLibrary.h"
+#include "ShaderProgram.h"
+#include "ShaderSource.h"
+#include "ShaderVariants.h"
+#include "StreamBuffer.h"
+#include "Texture2D.h"
+#include "ThreadPool.h"
+#include "UniformBlocks.h"
+#include "VertexFormat.h"
+#include <algorithm>
+#include <chrono>
+#include <cfloat>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <thread>
+#include "GLFW/glfw3.h"
+#include "glm/gtc/matrix_transform.hpp"
+#include "stb_image/stb_image.h"
+
+namespace
+{
+    typedef std::chrono::high_resolution_clock Clock;
+
+    //Every OBJ file shipped with the sample
+    const char* BENCH_OBJ_FILES[] = { "RubberToy.obj", "Suzan.obj", "Teapot.obj", "GroundPlane.obj", "light.obj" };
+    const int BENCH_RUNS = 10;
+
+    struct NamedVertexFormat
+    {
+        const char* name;
+        VertexFormat format;
+    };
+
+    const NamedVertexFormat BENCH_VERTEX_FORMATS[] =
+    {
+        { "float", VertexFormat() },
+        { "half/oct16/half", VertexFormat(POSITION_HALF, NORMAL_OCT16, TEXCOORD_HALF) },
+        { "unorm16/oct16/half", VertexFormat::compact() },
+        { "unorm16/oct8/half", VertexFormat(POSITION_UNORM16, NORMAL_OCT8, TEXCOORD_HALF) }
+    };
+
+    double elapsedMs(Clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+
+    template<typename T>
+    bool sameArray(const std::vector<T>& a, const std::vector<T>& b)
+    {
+        return a.size() == b.size() && (a.empty() || memcmp(&a[0], &b[0], a.size() * sizeof(T)) == 0);
+    }
+
+    bool sameData(const ObjData& a, const ObjData& b)
+    {
+        return sameArray(a.positions, b.positions) && sameArray(a.uvs, b.uvs) &&
+            sameArray(a.normals, b.normals) && sameArray(a.corners, b.corners);
+    }
+
+    std::vector<std::string> split(std::string& s, std::string t)
+    {
+        std::vector<std::string> result;
+        size_t pos = 0;
+        while ((pos = s.find(t)) != std::string::npos)
+        {
+            result.push_back(s.substr(0, pos));
+            s = s.substr(pos + t.length()); // Move past the delimiter
+        }
+        result.push_back(s); // Add the remaining string after the last delimiter
+        return result;
+    }
+
+    //OBJ indices are 1-based, negative values count back from the end
+    int resolveBaselineIndex(int index, size_t count)
+    {
+        long long resolved = index > 0 ? (long long)index - 1 : (index < 0 ? (long long)count + index : -1);
+        return (resolved >= 0 && resolved < (long long)count) ? (int)resolved : -1;
+    }
+
+    //The baseline for benchmarkOBJLoading, the parser the sample started with: std::getline + std::stringstream per
+    //line, sscanf for the face indices. Leaves triangleMaterials empty, which reads as all 0
+    bool parseOBJBaseline(const std::string& filename, ObjData& data)
+    {
+        //try open the file
+        std::ifstream fin(filename, std::ios::in);
+        if (!fin)
+            return false;
+
+        std::vector<int> vertexIndices, uvIndices, normalIndices;
+        data.positions.clear();
+        data.uvs.clear();
+        data.normals.clear();
+        data.corners.clear();
+        data.materialLibraries.clear();
+        data.materialNames.assign(1, std::string());
+        data.triangleMaterials.clear();
+
+        std::string lineBuffer; // temporary string to hold "each line" read from the file
+        while (std::getline(fin, lineBuffer)) // reading line by line in the file
+        {
+            std::stringstream ss(lineBuffer); //Each line will create a string stream to manipulate strings
+            std::string cmd;
+            ss >> cmd; // The "first word" (divided by empty space) in the lineBuffer will be extracted into the cmd variable
+
+            if (cmd == "v") //Vertex
+            {
+                glm::vec3 vertex(0.0f);
+                int dim = 0;
+                while (dim < 3 && ss >> vertex[dim])
+                    dim++;
+                data.positions.push_back(vertex);
+            }
+            else if (cmd == "vt") //UV
+            {
+                glm::vec2 uv(0.0f);
+                int dim = 0;
+                while (dim < 2 && ss >> uv[dim])
+                    dim++;
+                data.uvs.push_back(uv);
+            }
+            else if (cmd == "vn") //Normal
+            {
+                glm::vec3 normal(0.0f);
+                int dim = 0;
+                while (dim < 3 && ss >> normal[dim])
+                    dim++;
+                data.normals.push_back(glm::normalize(normal));
+            }
+            else if (cmd == "f") // Face
+            {
+                std::string faceData;
+                int vertexIndex, uvIndex, normalIndex; // v/vt/vn
+
+                while (ss >> faceData)
+                {
+                    std::vector<std::string> faceIndices = split(faceData, "/");
+
+                    //vertex index
+                    vertexIndex = 0;
+                    if (faceIndices[0].size() > 0)
+                        sscanf(faceIndices[0].c_str(), "%d", &vertexIndex);
+                    vertexIndices.push_back(vertexIndex);
+
+                    //if the face vertex has a texture coordinate index
+                    uvIndex = 0;
+                    if (faceIndices.size() > 1 && faceIndices[1].size() > 0)
+                        sscanf(faceIndices[1].c_str(), "%d", &uvIndex);
+                    uvIndices.push_back(uvIndex);
+
+                    //does the face vertex have normal index
+                    normalIndex = 0;
+                    if (faceIndices.size() > 2 && faceIndices[2].size() > 0)
+                        sscanf(faceIndices[2].c_str(), "%d", &normalIndex);
+                    normalIndices.push_back(normalIndex);
+                }
+            }
+        }
+
+        //Every face corner becomes one triangle corner, like the original loader (no polygon triangulation)
+        data.corners.resize(vertexIndices.size());
+        for (size_t i = 0; i < vertexIndices.size(); i++)
+        {
+            data.corners[i].position = resolveBaselineIndex(vertexIndices[i], data.positions.size());
+            data.corners[i].uv = resolveBaselineIndex(uvIndices[i], data.uvs.size());
+            data.corners[i].normal = resolveBaselineIndex(normalIndices[i], data.normals.size());
+        }
+        return true;
+    }
+
+    //A size x size grid of quads written as OBJ text, two triangles per quad
+    std::string makeGridOBJ(int size)
+    {
+        std::ostringstream obj;
+        obj << "o Grid\n";
+        for (int z = 0; z <= size; z++)
+            for (int x = 0; x <= size; x++)
+                obj << "v " << x << " " << (x * z) % 7 * 0.125f << " " << z << "\n";
+        for (int z = 0; z <= size; z++)
+            for (int x = 0; x <= size; x++)
+                obj << "vt " << (float)x / size << " " << (float)z / size << "\n";
+        obj << "vn 0 1 0\n";
+
+        for (int z = 0; z < size; z++)
+        {
+            for (int x = 0; x < size; x++)
+            {
+                int i0 = z * (size + 1) + x + 1, i1 = i0 + 1, i2 = i0 + size + 1, i3 = i2 + 1;
+                obj << "f " << i0 << "/" << i0 << "/1 " << i2 << "/" << i2 << "/1 " << i1 << "/" << i1 << "/1\n";
+                obj << "f " << i1 << "/" << i1 << "/1 " << i2 << "/" << i2 << "/1 " << i3 << "/" << i3 << "/1\n";
+            }
+        }
+        return obj.str();
+    }
+
+    //A size x size grid like makeGridOBJ cut into tiles x tiles squares, each with a usemtl. Neighbouring tiles get
+    //materials far apart, so the file order switches material at every tile. The MTL gives every material its own
+    //color and one of the bundled textures
+    void makeMaterialScene(int size, int tiles, int numMaterials, const std::string& objFilename, const std::string& mtlFilename)
+    {
+        const char* textures[] = { "Pattern1.jpg", "Pattern2.jpg", "Pattern3.jpg", "Brick.jpg" };
+        std::ofstream mtl(mtlFilename, std::ios::binary);
+        for (int m = 0; m < numMaterials; m++)
+        {
+            mtl << "newmtl Tile" << m << "\n";
+            mtl << "Kd " << 0.5f + 0.5f * (m % 3) / 2.0f << " " << 0.5f + 0.5f * (m % 5) / 4.0f << " " << 0.5f + 0.5f * (m % 7) / 6.0f << "\n";
+            mtl << "Ns 32\n";
+            mtl << "map_Kd " << textures[m % 4] << "\n\n";
+        }
+
+        std::ofstream obj(objFilename, std::ios::binary);
+        obj << "mtllib " << mtlFilename << "\n";
+        for (int z = 0; z <= size; z++)
+            for (int x = 0; x <= size; x++)
+                obj << "v " << x << " " << (x * z) % 7 * 0.125f << " " << z << "\n";
+        for (int z = 0; z <= size; z++)
+            for (int x = 0; x <= size; x++)
+                obj << "vt " << (float)x / size * tiles << " " << (float)z / size * tiles << "\n";
+        obj << "vn 0 1 0\n";
+
+        int tileSize = size / tiles;
+        for (int tile = 0; tile < tiles * tiles; tile++)
+        {
+            obj << "usemtl Tile" << tile * 7 % numMaterials << "\n";
+            for (int z = tile / tiles * tileSize; z < (tile / tiles + 1) * tileSize; z++)
+            {
+                for (int x = tile % tiles * tileSize; x < (tile % tiles + 1) * tileSize; x++)
+                {
+                    int i0 = z * (size + 1) + x + 1, i1 = i0 + 1, i2 = i0 + size + 1, i3 = i2 + 1;
+                    obj << "f " << i0 << "/" << i0 << "/1 " << i2 << "/" << i2 << "/1 " << i1 << "/" << i1 << "/1\n";
+                    obj << "f " << i1 << "/" << i1 << "/1 " << i2 << "/" << i2 << "/1 " << i3 << "/" << i3 << "/1\n";
+                }
+            }
+        }
+    }
+
+    //Best time of the parallel parser over a buffer, using numThreads threads in total
+    double timeParallelParse(const char* begin, const char* end, unsigned int numThreads, int runs, ObjData& data)
+    {
+        ThreadPool pool(numThreads - 1); // The calling thread is the last one
+        double bestMs = 1e30;
+        for (int run = 0; run < runs; run++)
+        {
+            Clock::time_point start = Clock::now();
+            parseOBJBuffer(begin, end, data, &pool);
+            bestMs = std::min(bestMs, elapsedMs(start));
+        }
+        return bestMs;
+    }
+
+    void reportThreadScaling(const std::string& name, const std::string& text, int runs)
+    {
+        const char* begin = text.data();
+        const char* end = begin + text.size();
+        unsigned int maxThreads = std::max(std::thread::hardware_concurrency(), 1u);
+
+        ObjData serial;
+        double serialMs = 1e30;
+        for (int run = 0; run < runs; run++)
+        {
+            Clock::time_point start = Clock::now();
+            parseOBJBuffer(begin, end, serial);
+            serialMs = std::min(serialMs, elapsedMs(start));
+        }
+
+        std::cout << name << " (" << serial.corners.size() / 3 << " triangles, " << text.size() / 1024 << " KB)" << std::endl;
+        std::cout << std::right << std::fixed << std::setprecision(2)
+            << "   serial" << std::setw(10) << serialMs << " ms" << std::endl;
+
+        for (unsigned int threads = 1; threads <= maxThreads; threads *= 2)
+        {
+            ObjData parallel;
+            double ms = timeParallelParse(begin, end, threads, runs, parallel);
+            std::cout << std::setw(9) << threads << std::setw(10) << ms << " ms" << std::setw(8) << serialMs / ms << "x  "
+                << (sameData(serial, parallel) ? "match" : "MISMATCH") << std::endl;
+
+            //Always finish with the real core count
+            if (threads < maxThreads && threads * 2 > maxThreads)
+                threads = maxThreads / 2;
+        }
+    }
+
+    //Drops every vn, like a scan or CAD export that only has positions
+    void stripNormals(ObjData& data)
+    {
+        data.normals.clear();
+        for (ObjCorner& corner : data.corners)
+            corner.normal = -1;
+    }
+
+    //Best time of generateNormals on copies of a stripped mesh, using numThreads threads in total (0 for no pool)
+    double timeNormals(const ObjData& stripped, unsigned int numThreads, const NormalOptions& options, int runs, ObjData& result)
+    {
+        ThreadPool pool(numThreads > 0 ? numThreads - 1 : 0);
+        double bestMs = 1e30;
+        for (int run = 0; run < runs; run++)
+        {
+            result = stripped;
+            Clock::time_point start = Clock::now();
+            generateNormals(result, options, numThreads > 0 ? &pool : NULL);
+            bestMs = std::min(bestMs, elapsedMs(start));
+        }
+        return bestMs;
+    }
+
+    //Mean and max angle in degrees between the generated normal of every corner and the vn it had in the file
+    void normalError(const ObjData& original, const ObjData& generated, double& meanDegrees, float& maxDegrees)
+    {
+        double sum = 0.0;
+        size_t count = 0;
+        maxDegrees = 0.0f;
+        for (size_t i = 0; i < original.corners.size(); i++)
+        {
+            int reference = original.corners[i].normal, result = generated.corners[i].normal;
+            if (reference < 0 || result < 0)
+                continue;
+            float cosine = glm::dot(glm::normalize(original.normals[reference]), generated.normals[result]);
+            float degrees = glm::degrees(acosf(glm::clamp(cosine, -1.0f, 1.0f)));
+            sum += degrees;
+            maxDegrees = std::max(maxDegrees, degrees);
+            count++;
+        }
+        meanDegrees = count > 0 ? sum / count : 0.0;
+    }
+
+    void reportNormalScaling(const std::string& name, const ObjData& stripped, int runs)
+    {
+        unsigned int maxThreads = std::max(std::thread::hardware_concurrency(), 1u);
+
+        ObjData serial;
+        double serialMs = timeNormals(stripped, 0, NormalOptions(), runs, serial);
+        std::cout << name << " (" << stripped.corners.size() / 3 << " triangles, " << stripped.positions.size() << " positions)" << std::endl;
+        std::cout << std::right << std::fixed << std::setprecision(2)
+            << "   serial" << std::setw(10) << serialMs << " ms" << std::endl;
+
+        for (unsigned int threads = 1; threads <= maxThreads; threads *= 2)
+        {
+            ObjData parallel;
+            double ms = timeNormals(stripped, threads, NormalOptions(), runs, parallel);
+            std::cout << std::setw(9) << threads << std::setw(10) << ms << " ms" << std::setw(8) << serialMs / ms << "x  "
+                << (sameData(serial, parallel) ? "match" : "MISMATCH") << std::endl;
+
+            //Always finish with the real core count
+            if (threads < maxThreads && threads * 2 > maxThreads)
+                threads = maxThreads / 2;
+        }
+    }
+
+    //Hidden window with the context the app asks for. With Mesa's llvmpipe (LIBGL_ALWAYS_SOFTWARE=1 on Linux, its
+    //opengl32.dll next to the exe on Windows) the GL benchmarks also run on machines without a GPU
+    GLFWwindow* createBenchContext(int width, int height)
+    {
+        if (!glfwInit())
+        {
+            std::cerr << "Failed to initialize GLFW" << std::endl;
+            return NULL;
+        }
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+        glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+        glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
+        GLFWwindow* window = glfwCreateWindow(width, height, "SpotLight benchmark", NULL, NULL);
+        if (window == NULL)
+        {
+            std::cerr << "Failed to create GLFW window" << std::endl;
+            glfwTerminate();
+            return NULL;
+        }
+        glfwMakeContextCurrent(window);
+
+        glewExperimental = GL_TRUE;
+        if (glewInit() != GLEW_OK)
+        {
+            std::cerr << "Failed to initialize GLEW" << std::endl;
+            glfwDestroyWindow(window);
+            glfwTerminate();
+            return NULL;
+        }
+        GLState::reset(); // a new context, nothing bound
+
+        std::cout << "GL: " << glGetString(GL_RENDERER) << ", " << glGetString(GL_VERSION) << std::endl;
+        glViewport(0, 0, width, height);
+        glEnable(GL_DEPTH_TEST);
+        return window;
+    }
+
+    //Camera and a directional light for every program, through the shared uniform blocks (UniformBlocks.h). The
+    //spotlight stays off
+    void setBenchUniforms(FrameUniforms& uniforms, const glm::mat4& view, const glm::mat4& projection,
+        const glm::vec3& cameraPosition, const glm::vec3& dirLightColor)
+    {
+        FrameBlock frame = {};
+        frame.view = view;
+        frame.projection = projection;
+        frame.viewPos = cameraPosition;
+
+        LightsBlock lights = {};
+        lights.dirLightDirection = glm::vec3(-0.3f, -1.0f, -0.4f);
+        lights.dirLightColor = dirLightColor;
+        uniforms.set(frame, lights);
+    }
+
+    void destroyBenchContext(GLFWwindow* window)
+    {
+        GLenum error = glGetError();
+        if (error != GL_NO_ERROR)
+            std::cout << "GL error 0x" << std::hex << error << std::dec << std::endl;
+        glfwDestroyWindow(window);
+        glfwTerminate();
+    }
+}
+
+bool runBenchmark(const std::string& name)
+{
+    if (name == "obj")
+    {
+        benchmarkOBJLoading();
+        return true;
+    }
+    if (name == "obj-threads")
+    {
+        benchmarkOBJThreads();
+        return true;
+    }
+    if (name == "indexing")
+    {
+        benchmarkIndexing();
+        return true;
+    }
+    if (name == "mesh-cache")
+    {
+        benchmarkMeshCache();
+        return true;
+    }
+    if (name == "optimize")
+    {
+        benchmarkMeshOptimizer();
+        return true;
+    }
+    if (name == "vertex-formats")
+    {
+        benchmarkVertexFormats();
+        return true;
+    }
+    if (name == "lod")
+    {
+        benchmarkLodChain();
+        return true;
+    }
+    if (name == "meshlets")
+    {
+        benchmarkMeshlets();
+        return true;
+    }
+    if (name == "normals")
+    {
+        benchmarkNormals();
+        return true;
+    }
+    if (name == "streaming")
+    {
+        benchmarkStreaming();
+        return true;
+    }
+    if (name == "asset-loading")
+    {
+        benchmarkAssetLoading();
+        return true;
+    }
+    if (name == "materials")
+    {
+        benchmarkMaterials();
+        return true;
+    }
+    if (name == "indirect")
+    {
+        benchmarkIndirect();
+        return true;
+    }
+    if (name == "instancing")
+    {
+        benchmarkInstancing();
+        return true;
+    }
+    if (name == "stream-buffer")
+    {
+        benchmarkStreamBuffer();
+        return true;
+    }
+    if (name == "uniforms")
+    {
+        benchmarkUniforms();
+        return true;
+    }
+    if (name == "state-cache")
+    {
+        benchmarkStateCache();
+        return true;
+    }
+    if (name == "shader-cache")
+    {
+        benchmarkShaderCache();
+        return true;
+    }
+    if (name == "shader-compile")
+    {
+        benchmarkShaderCompile();
+        return true;
+    }
+    if (name == "hot-reload")
+    {
+        benchmarkHotReload();
+        return true;
+    }
+    if (name == "shader-variants")
+    {
+        benchmarkShaderVariants();
+        return true;
+    }
+    if (name == "shader-library")
+    {
+        benchmarkShaderLibrary();
+        return true;
+    }
+    if (name == "image-kernels")
+    {
+        benchmarkImageKernels();
+        return true;
+    }
+    if (name == "mips")
+    {
+        benchmarkMips();
+        return true;
+    }
+
+    std::cerr << "Unknown benchmark: " << name << std::endl;
+    return false;
+}
+
+void benchmarkOBJLoading()
+{
+    std::cout << "OBJ parsing, best of " << BENCH_RUNS << " runs" << std::endl;
+    std::cout << std::left << std::setw(18) << "File" << std::right
+        << std::setw(12) << "stream (ms)" << std::setw(12) << "mapped (ms)"
+        << std::setw(10) << "speedup" << std::setw(12) << "MB/s" << "  result" << std::endl;
+
+    for (const char* filename : BENCH_OBJ_FILES)
+    {
+        ObjData streamData, mappedData;
+        double streamMs = 1e30, mappedMs = 1e30;
+        bool loaded = true;
+
+        for (int run = 0; run < BENCH_RUNS && loaded; run++)
+        {
+            Clock::time_point start = Clock::now();
+            loaded = parseOBJBaseline(filename, streamData);
+            streamMs = std::min(streamMs, elapsedMs(start));
+
+            start = Clock::now();
+            loaded = loaded && parseOBJ(filename, mappedData);
+            mappedMs = std::min(mappedMs, elapsedMs(start));
+        }
+
+        if (!loaded)
+        {
+            std::cout << std::left << std::setw(18) << filename << "cannot open" << std::endl;
+            continue;
+        }
+
+        //Throughput of the mapped parser
+        std::ifstream file(filename, std::ios::binary | std::ios::ate);
+        double megabytes = (double)file.tellg() / (1024.0 * 1024.0);
+
+        std::cout << std::left << std::setw(18) << filename << std::right << std::fixed << std::setprecision(2)
+            << std::setw(12) << streamMs << std::setw(12) << mappedMs
+            << std::setw(9) << streamMs / mappedMs << "x" << std::setw(12) << megabytes / (mappedMs / 1000.0)
+            << "  " << (sameData(streamData, mappedData) ? "match" : "MISMATCH") << std::endl;
+    }
+}
+
+void benchmarkOBJThreads()
+{
+    std::cout << "Chunked OBJ parsing, threads = workers + calling thread, best of " << BENCH_RUNS << " runs" << std::endl;
+
+    for (const char* filename : BENCH_OBJ_FILES)
+    {
+        std::ifstream file(filename, std::ios::binary);
+        if (!file)
+        {
+            std::cout << filename << ": cannot open" << std::endl;
+            continue;
+        }
+        std::ostringstream text;
+        text << file.rdbuf();
+        reportThreadScaling(filename, text.str(), BENCH_RUNS);
+    }
+
+    //About 2.1M triangles, ~100 MB of text
+    reportThreadScaling("Generated grid", makeGridOBJ(1024), 3);
+}
+
+void benchmarkIndexing()
+{
+    std::cout << "Indexed geometry: unique v/vt/vn vertices + 32-bit index buffer vs a vertex per corner" << std::endl;
+    std::cout << std::left << std::setw(18) << "File" << std::right << std::setw(10) << "corners" << std::setw(10) << "unique"
+        << std::setw(8) << "ratio" << std::setw(12) << "before KB" << std::setw(12) << "after KB" << std::setw(10) << "saved"
+        << std::setw(12) << "weld (ms)" << std::endl;
+
+    for (const char* filename : BENCH_OBJ_FILES)
+    {
+        ObjData data;
+        if (!parseOBJ(filename, data))
+        {
+            std::cout << std::left << std::setw(18) << filename << "cannot open" << std::endl;
+            continue;
+        }
+
+        std::vector<Vertex> vertices;
+        std::vector<GLuint> indices;
+        double weldMs = 1e30;
+        for (int run = 0; run < BENCH_RUNS; run++)
+        {
+            Clock::time_point start = Clock::now();
+            buildIndexedMesh(data, vertices, indices);
+            weldMs = std::min(weldMs, elapsedMs(start));
+        }
+
+        double beforeKB = data.corners.size() * sizeof(Vertex) / 1024.0;
+        double afterKB = (vertices.size() * sizeof(Vertex) + indices.size() * sizeof(GLuint)) / 1024.0;
+        std::cout << std::left << std::setw(18) << filename << std::right << std::fixed << std::setprecision(2)
+            << std::setw(10) << data.corners.size() << std::setw(10) << vertices.size()
+            << std::setw(7) << (double)data.corners.size() / vertices.size() << "x"
+            << std::setw(12) << beforeKB << std::setw(12) << afterKB
+            << std::setw(9) << 100.0 * (1.0 - afterKB / beforeKB) << "%" << std::setw(12) << weldMs << std::endl;
+    }
+}
+
+void benchmarkMeshCache()
+{
+    std::cout << "Mesh load (CPU side), best of " << BENCH_RUNS << " runs" << std::endl;
+    std::cout << std::left << std::setw(18) << "File" << std::right << std::setw(12) << "cold (ms)" << std::setw(12) << "warm (ms)"
+        << std::setw(10) << "speedup" << std::endl;
+
+    for (const char* filename : BENCH_OBJ_FILES)
+    {
+        std::string cacheFilename = std::string(filename) + ".bench.meshcache";
+        double coldMs = 1e30, warmMs = 1e30;
+        bool loaded = true;
+
+        for (int run = 0; run < BENCH_RUNS && loaded; run++)
+        {
+            //Cold: what Mesh::loadOBJ does when the cache is missing or stale (parse, weld, optimize)
+            Clock::time_point start = Clock::now();
+            MappedFile objFile;
+            loaded = objFile.open(filename);
+            if (!loaded)
+                break;
+            uint64_t sourceHash = hashBytes(objFile.data(), objFile.size());
+
+            MeshData mesh;
+            buildMeshData(objFile.data(), objFile.data() + objFile.size(), mesh, &ThreadPool::shared());
+            coldMs = std::min(coldMs, elapsedMs(start));
+            objFile.close();
+
+            loaded = MeshCache::write(cacheFilename, sourceHash, mesh, VertexFormat::compact());
+
+            //Warm: hash the source, map and validate the cache
+            start = Clock::now();
+            objFile.open(filename);
+            MeshCache cache;
+            loaded = loaded && cache.open(cacheFilename, hashBytes(objFile.data(), objFile.size()));
+            warmMs = std::min(warmMs, elapsedMs(start));
+        }
+        std::remove(cacheFilename.c_str());
+
+        if (!loaded)
+        {
+            std::cout << std::left << std::setw(18) << filename << "failed" << std::endl;
+            continue;
+        }
+        std::cout << std::left << std::setw(18) << filename << std::right << std::fixed << std::setprecision(2)
+            << std::setw(12) << coldMs << std::setw(12) << warmMs << std::setw(9) << coldMs / warmMs << "x" << std::endl;
+    }
+}
+
+void benchmarkMeshOptimizer()
+{
+    std::cout << "Vertex cache statistics, FIFO of " << VERTEX_CACHE_SIZE << " (ACMR: misses per triangle, ATVR: misses per vertex)" << std::endl;
+    std::cout << std::left << std::setw(18) << "File" << std::right << std::setw(16) << "export order" << std::setw(16) << "vertex cache"
+        << std::setw(16) << "+ overdraw" << std::setw(12) << "time (ms)" << std::endl;
+
+    for (const char* filename : BENCH_OBJ_FILES)
+    {
+        ObjData data;
+        if (!parseOBJ(filename, data))
+        {
+            std::cout << std::left << std::setw(18) << filename << "cannot open" << std::endl;
+            continue;
+        }
+
+        std::vector<Vertex> vertices;
+        std::vector<GLuint> indices;
+        buildIndexedMesh(data, vertices, indices);
+        VertexCacheStats before = analyzeVertexCache(indices, vertices.size());
+
+        Clock::time_point start = Clock::now();
+        std::vector<size_t> clusters;
+        optimizeVertexCache(indices, vertices.size(), VERTEX_CACHE_SIZE, &clusters);
+        VertexCacheStats tipsify = analyzeVertexCache(indices, vertices.size());
+        optimizeOverdraw(indices, vertices, clusters);
+        optimizeVertexFetch(vertices, indices);
+        double ms = elapsedMs(start);
+        VertexCacheStats after = analyzeVertexCache(indices, vertices.size());
+
+        std::cout << std::left << std::setw(18) << filename << std::right << std::fixed << std::setprecision(3)
+            << std::setw(8) << before.acmr << std::setw(8) << before.atvr
+            << std::setw(8) << tipsify.acmr << std::setw(8) << tipsify.atvr
+            << std::setw(8) << after.acmr << std::setw(8) << after.atvr
+            << std::setw(12) << std::setprecision(2) << ms << std::endl;
+    }
+}
+
+void benchmarkVertexFormats()
+{
+    std::cout << "Position error is relative to the bounding box diagonal, normal error is the angle in degrees" << std::endl;
+    std::cout << std::left << std::setw(18) << "File" << std::setw(20) << "Format" << std::right << std::setw(8) << "bytes"
+        << std::setw(10) << "KB" << std::setw(12) << "max pos" << std::setw(12) << "avg pos"
+        << std::setw(10) << "max nrm" << std::setw(10) << "avg nrm" << std::setw(10) << "max uv" << std::endl;
+
+    for (const char* filename : BENCH_OBJ_FILES)
+    {
+        MappedFile file;
+        MeshData mesh;
+        if (!file.open(filename) || !buildMeshData(file.data(), file.data() + file.size(), mesh, NULL))
+        {
+            std::cout << std::left << std::setw(18) << filename << "cannot open" << std::endl;
+            continue;
+        }
+
+        float diagonal = glm::length(mesh.boundsMax - mesh.boundsMin);
+        for (const NamedVertexFormat& named : BENCH_VERTEX_FORMATS)
+        {
+            std::vector<unsigned char> packed;
+            packVertices(mesh.vertices.data(), mesh.vertices.size(), named.format, mesh.boundsMin, mesh.boundsMax, packed);
+            GLsizei stride = getVertexLayout(named.format).stride;
+
+            double sumPosition = 0.0, sumNormal = 0.0;
+            float maxPosition = 0.0f, maxNormal = 0.0f, maxUV = 0.0f;
+            for (size_t i = 0; i < mesh.vertices.size(); i++)
+            {
+                const Vertex& original = mesh.vertices[i];
+                Vertex decoded = unpackVertex(&packed[i * stride], named.format, mesh.boundsMin, mesh.boundsMax);
+
+                float position = diagonal > 0.0f ? glm::length(decoded.position - original.position) / diagonal : 0.0f;
+                float cosine = glm::clamp(glm::dot(decoded.normal, original.normal), -1.0f, 1.0f);
+                float normal = glm::degrees(acosf(cosine));
+                glm::vec2 uv = glm::abs(decoded.texCoords - original.texCoords);
+
+                sumPosition += position;
+                sumNormal += normal;
+                maxPosition = std::max(maxPosition, position);
+                maxNormal = std::max(maxNormal, normal);
+                maxUV = std::max(maxUV, std::max(uv.x, uv.y));
+            }
+
+            double count = (double)std::max<size_t>(mesh.vertices.size(), 1);
+            std::cout << std::left << std::setw(18) << filename << std::setw(20) << named.name << std::right
+                << std::setw(8) << stride << std::fixed << std::setprecision(1) << std::setw(10) << packed.size() / 1024.0
+                << std::scientific << std::setprecision(2) << std::setw(12) << maxPosition << std::setw(12) << sumPosition / count
+                << std::fixed << std::setprecision(3) << std::setw(10) << maxNormal << std::setw(10) << sumNormal / count
+                << std::scientific << std::setprecision(2) << std::setw(10) << maxUV << std::defaultfloat << std::endl;
+        }
+    }
+}
+
+void benchmarkLodChain()
+{
+    std::cout << "Errors relative to the bounding box diagonal. measured: distance from the full mesh's vertices to the level's surface" << std::endl;
+    std::cout << std::left << std::setw(18) << "File" << std::setw(7) << "Level" << std::right << std::setw(11) << "triangles"
+        << std::setw(9) << "ratio" << std::setw(12) << "error" << std::setw(14) << "measured max" << std::setw(15) << "measured mean" << std::endl;
+
+    for (const char* filename : BENCH_OBJ_FILES)
+    {
+        MappedFile file;
+        MeshData mesh;
+        if (!file.open(filename) || !buildMeshData(file.data(), file.data() + file.size(), mesh, NULL))
+        {
+            std::cout << std::left << std::setw(18) << filename << "cannot open" << std::endl;
+            continue;
+        }
+
+        //Rebuild the chain from the full level twice, timed, and check both runs come out the same
+        std::vector<GLuint> indices(mesh.indices.begin(), mesh.indices.begin() + mesh.lods[0].numIndices);
+        std::vector<GLuint> indicesAgain(indices);
+        std::vector<MeshLod> lods, lodsAgain;
+        Clock::time_point start = Clock::now();
+        buildLodChain(mesh.vertices, indices, lods);
+        double ms = elapsedMs(start);
+        buildLodChain(mesh.vertices, indicesAgain, lodsAgain);
+        bool deterministic = indices == indicesAgain && lods.size() == lodsAgain.size() &&
+            memcmp(lods.data(), lodsAgain.data(), lods.size() * sizeof(MeshLod)) == 0;
+
+        float diagonal = glm::length(mesh.boundsMax - mesh.boundsMin);
+        for (size_t level = 0; level < lods.size(); level++)
+        {
+            const MeshLod& lod = lods[level];
+            float meanDistance = 0.0f;
+            float maxDistance = level > 0 ? measureLodError(mesh.vertices, indices, lod, &meanDistance) : 0.0f;
+
+            std::cout << std::left << std::setw(18) << filename << std::setw(7) << level << std::right
+                << std::setw(11) << lod.numIndices / 3 << std::fixed << std::setprecision(1) << std::setw(8) << 100.0 * lod.numIndices / lods[0].numIndices << "%"
+                << std::scientific << std::setprecision(2) << std::setw(12) << lod.error / diagonal << std::setw(14) << maxDistance / diagonal
+                << std::setw(15) << meanDistance / diagonal << std::defaultfloat << std::endl;
+        }
+        std::cout << std::left << std::setw(18) << filename << "chain built in " << std::fixed << std::setprecision(2) << ms << " ms, "
+            << (deterministic ? "deterministic" : "NOT DETERMINISTIC") << std::defaultfloat << std::endl;
+
+        //Walk straight away from the mesh and back, as main.cpp would draw it: 45 degree FOV, 600 pixels high
+        const float fovY = glm::radians(45.0f), viewportHeight = 600.0f, step = 0.05f;
+        int current = 0;
+        std::cout << std::left << std::setw(18) << filename << "switches (distance from the bounding sphere):";
+        for (int s = 0; s <= 4000; s++)
+        {
+            float distance = (s <= 2000 ? s : 4000 - s) * step;
+            float pixelsPerUnit = distance > 0.0f ? viewportHeight / (2.0f * distance * tanf(fovY * 0.5f)) : FLT_MAX;
+            int next = selectLod(lods, current, pixelsPerUnit);
+            if (next != current)
+                std::cout << " " << current << "->" << next << " at " << std::fixed << std::setprecision(2) << distance;
+            current = next;
+        }
+        std::cout << std::defaultfloat << std::endl;
+    }
+}
+
+void benchmarkMeshlets()
+{
+    //The models and where main.cpp puts them
+    const char* files[] = { "RubberToy.obj", "Suzan.obj", "Teapot.obj" };
+    const glm::vec3 positions[] = { glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(3.0f, 0.0f, 0.0f), glm::vec3(-3.0f, 0.0f, 0.0f) };
+    const int numModels = 3;
+
+    MeshData meshes[numModels];
+    std::cout << std::left << std::setw(18) << "File" << std::right << std::setw(10) << "meshlets" << std::setw(12) << "avg verts"
+        << std::setw(12) << "avg tris" << std::setw(12) << "with cone" << std::setw(12) << "build ms" << std::endl;
+    for (int m = 0; m < numModels; m++)
+    {
+        MappedFile file;
+        MeshData& mesh = meshes[m];
+        if (!file.open(files[m]) || !buildMeshData(file.data(), file.data() + file.size(), mesh, NULL))
+        {
+            std::cout << std::left << std::setw(18) << files[m] << "cannot open" << std::endl;
+            return;
+        }
+
+        Clock::time_point start = Clock::now();
+        buildMeshlets(mesh.vertices, mesh.indices, mesh.lods[0].firstIndex, mesh.lods[0].numIndices, mesh.meshlets);
+        double ms = elapsedMs(start);
+
+        size_t numVertices = 0, withCone = 0;
+        for (const Meshlet& meshlet : mesh.meshlets)
+        {
+            std::vector<GLuint> unique(mesh.indices.begin() + meshlet.firstIndex, mesh.indices.begin() + meshlet.firstIndex + meshlet.numIndices);
+            std::sort(unique.begin(), unique.end());
+            numVertices += std::unique(unique.begin(), unique.end()) - unique.begin();
+            withCone += meshlet.coneCutoff < 1.0f ? 1 : 0;
+        }
+
+        double count = (double)mesh.meshlets.size();
+        std::cout << std::left << std::setw(18) << files[m] << std::right << std::setw(10) << mesh.meshlets.size() << std::fixed << std::setprecision(1)
+            << std::setw(12) << numVertices / count << std::setw(12) << mesh.lods[0].numIndices / 3 / count
+            << std::setw(11) << 100.0 * withCone / count << "%" << std::setw(12) << std::setprecision(2) << ms << std::defaultfloat << std::endl;
+    }
+
+    //Strafe around the scene at radius 7 while turning to keep facing its center, looking slightly down. The side models
+    //leave the frustum and come back, and every model is seen from all sides
+    const int FRAMES = 1200;
+    const float radius = 7.0f, degreesPerFrame = 0.3f;
+    FPSCamera camera(glm::vec3(0.0f, 2.0f, radius));
+    camera.rotate(0.0f, -12.0f);
+    glm::mat4 projection = glm::perspective(glm::radians(45.0f), 1024.0f / 768.0f, 0.1f, 100.0f);
+
+    size_t totalMeshlets = 0, frustumCulled = 0, backfaceCulled = 0, totalTriangles = 0, visibleTriangles = 0, ranges = 0;
+    double cullMs = 0.0;
+    std::vector<GLsizei> counts;
+    std::vector<const GLvoid*> offsets;
+    for (int frame = 0; frame < FRAMES; frame++)
+    {
+        float angle = glm::radians(degreesPerFrame * (frame + 1));
+        camera.setPosition(glm::vec3(radius * sinf(angle), 2.0f, radius * cosf(angle)));
+        camera.rotate(degreesPerFrame, 0.0f);
+        glm::mat4 view = camera.getViewMatrix();
+
+        for (int m = 0; m < numModels; m++)
+        {
+            glm::mat4 model = glm::translate(glm::mat4(1.0f), positions[m]);
+
+            //Same work as Mesh::drawCulled, minus the draw call
+            Clock::time_point start = Clock::now();
+            Frustum frustum = extractFrustum(projection * view * model);
+            glm::vec3 localCamera = glm::vec3(glm::inverse(model) * glm::vec4(camera.getPosition(), 1.0f));
+            MeshletCullStats stats = cullMeshlets(meshes[m].meshlets, frustum, localCamera, counts, offsets);
+            cullMs += elapsedMs(start);
+
+            totalMeshlets += meshes[m].meshlets.size();
+            frustumCulled += stats.frustumCulled;
+            backfaceCulled += stats.backfaceCulled;
+            totalTriangles += meshes[m].lods[0].numIndices / 3;
+            visibleTriangles += stats.visibleTriangles;
+            ranges += stats.numRanges;
+        }
+    }
+
+    std::cout << FRAMES << " frames along the camera path, " << numModels << " models per frame" << std::endl;
+    std::cout << std::fixed << std::setprecision(1)
+        << "  meshlets outside the frustum:  " << 100.0 * frustumCulled / totalMeshlets << "%" << std::endl
+        << "  meshlets facing away:          " << 100.0 * backfaceCulled / totalMeshlets << "%" << std::endl
+        << "  triangles culled:              " << 100.0 * (totalTriangles - visibleTriangles) / totalTriangles << "% ("
+        << (totalTriangles - visibleTriangles) / FRAMES << " of " << totalTriangles / FRAMES << " per frame)" << std::endl
+        << "  glMultiDrawElements ranges:    " << (double)ranges / (FRAMES * numModels) << " per model" << std::endl
+        << std::setprecision(3)
+        << "  CPU culling time:              " << cullMs * 1000.0 / FRAMES << " us per frame" << std::defaultfloat << std::endl;
+}
+
+void benchmarkNormals()
+{
+    std::cout << "Generated smooth normals against the vn in the file, angle error in degrees" << std::endl;
+    std::cout << std::left << std::setw(18) << "File" << std::setw(16) << "Weights" << std::right << std::setw(10) << "ms"
+        << std::setw(10) << "normals" << std::setw(10) << "mean" << std::setw(10) << "max" << std::endl;
+
+    struct NamedOptions
+    {
+        const char* name;
+        NormalOptions options;
+    };
+    const NamedOptions weights[] = {
+        { "uniform", NormalOptions(180.0f, false, false) },
+        { "area", NormalOptions(180.0f, true, false) },
+        { "angle", NormalOptions(180.0f, false, true) },
+        { "area+angle", NormalOptions(180.0f, true, true) },
+        { "crease 60", NormalOptions(60.0f, true, true) },
+    };
+
+    ObjData rubberToy;
+    for (const char* filename : BENCH_OBJ_FILES)
+    {
+        MappedFile file;
+        ObjData original;
+        if (!file.open(filename))
+        {
+            std::cout << std::left << std::setw(18) << filename << "cannot open" << std::endl;
+            continue;
+        }
+        parseOBJBuffer(file.data(), file.data() + file.size(), original);
+        if (strcmp(filename, "RubberToy.obj") == 0)
+            rubberToy = original;
+
+        ObjData stripped = original;
+        stripNormals(stripped);
+        for (const NamedOptions& named : weights)
+        {
+            ObjData generated;
+            double ms = timeNormals(stripped, 0, named.options, BENCH_RUNS, generated);
+            double meanDegrees;
+            float maxDegrees;
+            normalError(original, generated, meanDegrees, maxDegrees);
+            std::cout << std::left << std::setw(18) << filename << std::setw(16) << named.name << std::right << std::fixed
+                << std::setprecision(2) << std::setw(10) << ms << std::setw(10) << generated.normals.size()
+                << std::setw(10) << meanDegrees << std::setw(10) << maxDegrees << std::defaultfloat << std::endl;
+        }
+    }
+
+    std::cout << std::endl << "Thread scaling, area+angle weights, threads = workers + calling thread, best of runs" << std::endl;
+    if (!rubberToy.corners.empty())
+    {
+        stripNormals(rubberToy);
+        reportNormalScaling("RubberToy.obj", rubberToy, BENCH_RUNS);
+    }
+
+    //About 2.1M triangles
+    std::string grid = makeGridOBJ(1024);
+    ObjData gridData;
+    parseOBJBuffer(grid.data(), grid.data() + grid.size(), gridData, &ThreadPool::shared());
+    stripNormals(gridData);
+    reportNormalScaling("Generated grid", gridData, 3);
+}
+
+void benchmarkStreaming()
+{
+    GLFWwindow* window = createBenchContext(320, 240);
+    if (window == NULL)
+        return;
+
+    ShaderProgram shader;
+    shader.loadShaders("Lighting.vert", "Lighting.frag");
+    FrameUniforms frameUniforms;
+    FrameUniforms::bindBlocks(shader);
+
+    //The scene's models plus a grid big enough to need many chunks. Its cache is built here once and removed at the end
+    const char* gridFilename = "StreamGrid.obj";
+    {
+        std::string grid = makeGridOBJ(256);
+        std::ofstream gridFile(gridFilename, std::ios::binary);
+        gridFile.write(grid.data(), grid.size());
+    }
+    const char* filenames[] = { "RubberToy.obj", "Suzan.obj", "Teapot.obj", gridFilename };
+    const int numMeshes = 4;
+    {
+        Clock::time_point start = Clock::now();
+        cookOBJ(gridFilename);
+        std::cout << "Grid cooked in " << std::fixed << std::setprecision(0) << elapsedMs(start) << " ms" << std::defaultfloat << std::endl;
+    }
+
+    glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 4.0f, 8.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    glm::mat4 projection = glm::perspective(glm::radians(45.0f), 320.0f / 240.0f, 0.1f, 100.0f);
+    setBenchUniforms(frameUniforms, view, projection, glm::vec3(0.0f, 4.0f, 8.0f), glm::vec3(0.0f));
+    glm::mat4 models[numMeshes] = {
+        glm::mat4(1.0f),
+        glm::translate(glm::mat4(1.0f), glm::vec3(3.0f, 0.0f, 0.0f)),
+        glm::translate(glm::mat4(1.0f), glm::vec3(-3.0f, 0.0f, 0.0f)),
+        glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(-8.0f, -1.0f, -20.0f)), glm::vec3(16.0f / 256.0f))
+    };
+
+    //One frame of the scene, finished so the frame time includes the GPU side of the copies
+    auto drawFrame = [&](std::vector<Mesh>& meshes)
+    {
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        shader.use();
+        for (int i = 0; i < numMeshes; i++)
+        {
+            shader.setUniform("model", models[i]);
+            meshes[i].drawLod(models[i], view, projection, glm::vec3(0.0f, 4.0f, 8.0f), 240.0f);
+        }
+        glFinish();
+    };
+
+    //Mesh::loadOBJ logs every file, so the table is printed at the end
+    std::ostringstream table;
+    table << "Warm cache, compact vertices. Frame = streamer update + draw + glFinish" << std::endl;
+    table << std::left << std::setw(22) << "Mode" << std::right << std::setw(10) << "load ms" << std::setw(8) << "frames"
+        << std::setw(10) << "chunks" << std::setw(12) << "max upload" << std::setw(11) << "max frame" << std::setw(11) << "max fence"
+        << std::setw(11) << "drawable" << std::setw(11) << "complete" << std::endl;
+
+    //Everything in the first frame
+    {
+        std::vector<Mesh> meshes(numMeshes);
+        Clock::time_point start = Clock::now();
+        for (int i = 0; i < numMeshes; i++)
+            meshes[i].loadOBJ(filenames[i], VertexFormat::compact());
+        double loadMs = elapsedMs(start);
+        start = Clock::now();
+        drawFrame(meshes);
+        double frameMs = elapsedMs(start);
+        table << std::left << std::setw(22) << "blocking" << std::right << std::fixed << std::setprecision(2)
+            << std::setw(10) << loadMs << std::setw(8) << 1 << std::setw(10) << "-" << std::setw(12) << "-"
+            << std::setw(11) << loadMs + frameMs << std::setw(11) << "-" << std::setw(11) << 0 << std::setw(11) << 0
+            << std::defaultfloat << std::endl;
+    }
+
+    //Streamed. "drawable" is the first frame every mesh shows something, "complete" the first one at full detail
+    //The last budget never runs out: the whole upload in one update, for comparison
+    const double budgets[] = { 0.1, 0.5, 2.0, 1e9 };
+    const size_t chunkSizes[] = { 64 * 1024, STREAM_CHUNK_BYTES };
+    for (size_t chunkBytes : chunkSizes)
+    {
+        for (double budget : budgets)
+        {
+            MeshStreamer streamer(budget, chunkBytes);
+            std::vector<Mesh> meshes(numMeshes);
+            Clock::time_point start = Clock::now();
+            for (int i = 0; i < numMeshes; i++)
+                meshes[i].loadOBJ(filenames[i], VertexFormat::compact(), &streamer);
+            double loadMs = elapsedMs(start);
+
+            int frame = 0, drawableFrame = -1, completeFrame = -1;
+            size_t chunks = 0;
+            double maxUploadMs = 0.0, maxFrameMs = 0.0, maxFenceMs = 0.0;
+            for (; frame < 100000 && completeFrame < 0; frame++)
+            {
+                start = Clock::now();
+                const MeshStreamStats& stats = streamer.update();
+                drawFrame(meshes);
+                maxFrameMs = std::max(maxFrameMs, elapsedMs(start));
+                maxUploadMs = std::max(maxUploadMs, stats.uploadMs);
+                maxFenceMs = std::max(maxFenceMs, stats.maxFenceMs);
+                chunks += stats.chunksUploaded;
+
+                bool drawable = true, complete = true;
+                for (const Mesh& mesh : meshes)
+                {
+                    drawable = drawable && mesh.isDrawable();
+                    complete = complete && mesh.getResidentLod() == 0;
+                }
+                if (drawable && drawableFrame < 0)
+                    drawableFrame = frame;
+                if (complete)
+                    completeFrame = frame;
+            }
+
+            std::ostringstream mode;
+            mode << "stream ";
+            if (budget < 1e9)
+                mode << budget << " ms ";
+            else
+                mode << "all ";
+            mode << chunkBytes / 1024 << " KB";
+            table << std::left << std::setw(22) << mode.str() << std::right << std::fixed << std::setprecision(2)
+                << std::setw(10) << loadMs << std::setw(8) << frame << std::setw(10) << chunks << std::setw(12) << maxUploadMs
+                << std::setw(11) << maxFrameMs << std::setw(11) << maxFenceMs << std::setw(11) << drawableFrame
+                << std::setw(11) << completeFrame << std::defaultfloat << std::endl;
+        }
+    }
+
+    std::cout << table.str();
+
+    std::remove(gridFilename);
+    std::remove(MeshCache::cacheFilename(gridFilename).c_str());
+    destroyBenchContext(window);
+}
+
+void benchmarkAssetLoading()
+{
+    GLFWwindow* window = createBenchContext(320, 240);
+    if (window == NULL)
+        return;
+
+    //The startup set of main.cpp
+    struct MeshAsset
+    {
+        const char* filename;
+        VertexFormat format;
+    };
+    const MeshAsset meshAssets[] = {
+        { "RubberToy.obj", VertexFormat::compact() },
+        { "Suzan.obj", VertexFormat::compact() },
+        { "Teapot.obj", VertexFormat::compact() },
+        { "GroundPlane.obj", VertexFormat() },
+        { "light.obj", VertexFormat() }
+    };
+    const char* textureAssets[] = { "Pattern1.jpg", "Pattern2.jpg", "Pattern3.jpg", "Brick.jpg" };
+    const int numMeshes = 5, numTextures = 4;
+
+    //Until every object is on the GPU and usable
+    auto loadSequential = [&]()
+    {
+        std::vector<Mesh> meshes(numMeshes);
+        std::vector<Texture2D> textures(numTextures);
+        Clock::time_point start = Clock::now();
+        for (int i = 0; i < numMeshes; i++)
+            meshes[i].loadOBJ(meshAssets[i].filename, meshAssets[i].format);
+        for (int i = 0; i < numTextures; i++)
+            textures[i].loadTexture(textureAssets[i], true);
+        glFinish();
+        return elapsedMs(start);
+    };
+    auto loadAsync = [&](ThreadPool& pool)
+    {
+        std::vector<Mesh> meshes(numMeshes);
+        std::vector<Texture2D> textures(numTextures);
+        Clock::time_point start = Clock::now();
+        AssetLoader loader(pool);
+        for (int i = 0; i < numMeshes; i++)
+            loader.loadMesh(meshes[i], meshAssets[i].filename, meshAssets[i].format);
+        for (int i = 0; i < numTextures; i++)
+            loader.loadTexture(textures[i], textureAssets[i], true);
+        loader.waitAll();
+        glFinish();
+        return elapsedMs(start);
+    };
+    auto removeCaches = [&]()
+    {
+        for (const MeshAsset& asset : meshAssets)
+            std::remove(MeshCache::cacheFilename(asset.filename).c_str());
+        for (const char* filename : textureAssets)
+            std::remove(MipCache::cacheFilename(filename).c_str());
+    };
+
+    //Mesh::loadOBJ and the loader log every file, so the table is printed at the end
+    std::ostringstream table;
+    unsigned int maxThreads = std::max(std::thread::hardware_concurrency(), 1u);
+    table << "Startup assets: 5 meshes, 4 textures. Until all are on the GPU, best of 3 (cold: single run, no mesh or mip caches)" << std::endl;
+    table << std::left << std::setw(26) << "Mode" << std::right << std::setw(12) << "cold ms" << std::setw(12) << "warm ms" << std::endl;
+
+    removeCaches();
+    double coldMs = loadSequential();
+    double warmMs = 1e30;
+    for (int run = 0; run < 3; run++)
+        warmMs = std::min(warmMs, loadSequential());
+    table << std::left << std::setw(26) << "sequential (before)" << std::right << std::fixed << std::setprecision(1)
+        << std::setw(12) << coldMs << std::setw(12) << warmMs << std::defaultfloat << std::endl;
+
+    for (unsigned int threads = 1; threads <= maxThreads; threads *= 2)
+    {
+        ThreadPool pool(threads);
+        removeCaches();
+        coldMs = loadAsync(pool);
+        warmMs = 1e30;
+        for (int run = 0; run < 3; run++)
+            warmMs = std::min(warmMs, loadAsync(pool));
+
+        std::ostringstream mode;
+        mode << "AssetLoader, " << threads << (threads == 1 ? " worker" : " workers");
+        table << std::left << std::setw(26) << mode.str() << std::right << std::fixed << std::setprecision(1)
+            << std::setw(12) << coldMs << std::setw(12) << warmMs << std::defaultfloat << std::endl;
+
+        //Always finish with the real core count
+        if (threads < maxThreads && threads * 2 > maxThreads)
+            threads = maxThreads / 2;
+    }
+
+    std::cout << table.str();
+    destroyBenchContext(window);
+}
+
+void benchmarkMaterials()
+{
+    GLFWwindow* window = createBenchContext(320, 240);
+    if (window == NULL)
+        return;
+
+    ShaderProgram shader;
+    shader.loadShaders("Lighting.vert", "Lighting.frag");
+
+    //64 x 64 quads in 8 x 8 tiles over 32 materials and 4 textures. Removed again at the end
+    const int numMaterials = 32;
+    const char* sceneFilename = "MaterialTiles.obj";
+    const char* libraryFilename = "MaterialTiles.mtl";
+    makeMaterialScene(64, 8, numMaterials, sceneFilename, libraryFilename);
+
+    //The parallel parser must agree with the serial one on every triangle's material. On a bigger version of the
+    //scene, the small one is a single chunk
+    std::ostringstream table;
+    {
+        const char* bigFilename = "MaterialTilesBig.obj";
+        makeMaterialScene(256, 32, numMaterials, bigFilename, libraryFilename);
+        MappedFile file;
+        file.open(bigFilename);
+        ThreadPool pool(3);
+        ObjData serial, parallel;
+        parseOBJBuffer(file.data(), file.data() + file.size(), serial);
+        parseOBJBuffer(file.data(), file.data() + file.size(), parallel, &pool);
+        bool match = sameData(serial, parallel) && serial.materialNames == parallel.materialNames &&
+            sameArray(serial.triangleMaterials, parallel.triangleMaterials);
+        table << bigFilename << ": " << serial.corners.size() / 3 << " triangles, " << serial.materialNames.size() - 1
+            << " materials, parallel parse " << (match ? "match" : "MISMATCH") << std::endl;
+        file.close();
+        std::remove(bigFilename);
+    }
+
+    Mesh tiles;
+    tiles.loadOBJ(sceneFilename, VertexFormat::compact());
+
+    //Every level is split into one range per material, and the ranges have to add up to the level
+    bool rangesMatch = tiles.getSubmeshes().size() == tiles.getLods().size() * tiles.getMaterials().size();
+    for (size_t level = 0; level < tiles.getLods().size() && rangesMatch; level++)
+    {
+        GLuint next = tiles.getLods()[level].firstIndex;
+        for (size_t m = 0; m < tiles.getMaterials().size(); m++)
+        {
+            const Submesh& submesh = tiles.getSubmeshes()[level * tiles.getMaterials().size() + m];
+            rangesMatch = rangesMatch && submesh.firstIndex == next && submesh.lod == level && submesh.material == m;
+            next += submesh.numIndices;
+        }
+        rangesMatch = rangesMatch && next == tiles.getLods()[level].firstIndex + tiles.getLods()[level].numIndices;
+    }
+    size_t withTexture = 0;
+    for (const Material& material : tiles.getMaterials())
+        withTexture += material.diffuseMap.empty() ? 0 : 1;
+    table << tiles.getMaterials().size() << " materials (" << withTexture << " with map_Kd), " << tiles.getLods().size() << " levels, "
+        << tiles.getSubmeshes().size() << " submeshes, ranges " << (rangesMatch ? "match" : "MISMATCH") << std::endl;
+
+    //A 4 x 4 field of tile objects in front of the camera, plus main.cpp's models with their own textures
+    const int numModels = 3;
+    const char* modelFilenames[numModels] = { "RubberToy.obj", "Suzan.obj", "Teapot.obj" };
+    const char* modelTextures[numModels] = { "Pattern1.jpg", "Pattern2.jpg", "Pattern3.jpg" };
+    Mesh models[numModels];
+    Texture2D modelTexture[numModels];
+    for (int i = 0; i < numModels; i++)
+    {
+        models[i].loadOBJ(modelFilenames[i], VertexFormat::compact());
+        modelTexture[i].loadTexture(modelTextures[i], true);
+    }
+
+    glm::vec3 cameraPosition(0.0f, 6.0f, 10.0f);
+    glm::mat4 view = glm::lookAt(cameraPosition, glm::vec3(0.0f, 0.0f, -6.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    glm::mat4 projection = glm::perspective(glm::radians(45.0f), 320.0f / 240.0f, 0.1f, 100.0f);
+    std::vector<glm::mat4> tileModels;
+    for (int z = 0; z < 4; z++)
+        for (int x = 0; x < 4; x++)
+            tileModels.push_back(glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(x * 4.0f - 8.0f, -1.0f, z * -4.0f)), glm::vec3(3.5f / 64.0f)));
+    glm::mat4 modelMatrices[numModels];
+    for (int i = 0; i < numModels; i++)
+        modelMatrices[i] = glm::translate(glm::mat4(1.0f), glm::vec3(i * 3.0f - 3.0f, 0.0f, 0.0f));
+
+    RenderQueue queue;
+    auto submitScene = [&]()
+    {
+        for (const glm::mat4& model : tileModels)
+            queue.submit(tiles, model);
+        for (int i = 0; i < numModels; i++)
+            queue.submit(models[i], modelMatrices[i], &modelTexture[i]);
+    };
+
+    FrameUniforms frameUniforms;
+    FrameUniforms::bindBlocks(shader);
+    setBenchUniforms(frameUniforms, view, projection, cameraPosition, glm::vec3(1.0f));
+    shader.use();
+
+    //Warm up, so the map_Kd textures are loaded before anything is timed
+    submitScene();
+    queue.flush(shader, view, projection, cameraPosition, 240.0f);
+    glFinish();
+
+    table << "Per frame, best of " << BENCH_RUNS << " frames (draw + glFinish). Without the queue every draw binds its texture and color" << std::endl;
+    table << std::left << std::setw(22) << "Order" << std::right << std::setw(8) << "draws" << std::setw(15) << "texture binds"
+        << std::setw(15) << "color changes" << std::setw(15) << "model changes" << std::setw(11) << "frame ms" << std::endl;
+
+    const RenderOrder orders[] = { RENDER_SUBMISSION_ORDER, RENDER_BY_MATERIAL };
+    const char* orderNames[] = { "submission order", "by material" };
+    for (int o = 0; o < 2; o++)
+    {
+        RenderStats stats = {};
+        double bestMs = 1e30;
+        for (int run = 0; run < BENCH_RUNS; run++)
+        {
+            Clock::time_point start = Clock::now();
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            submitScene();
+            stats = queue.flush(shader, view, projection, cameraPosition, 240.0f, orders[o]);
+            glFinish();
+            bestMs = std::min(bestMs, elapsedMs(start));
+        }
+        table << std::left << std::setw(22) << orderNames[o] << std::right << std::setw(8) << stats.draws << std::setw(15) << stats.textureBinds
+            << std::setw(15) << stats.colorChanges << std::setw(15) << stats.modelChanges << std::fixed << std::setprecision(2)
+            << std::setw(11) << bestMs << std::defaultfloat << std::endl;
+    }
+
+    //Reference: the same objects in one draw each, ignoring their materials
+    {
+        shader.setUniform("materialColor", glm::vec3(1.0f));
+        double bestMs = 1e30;
+        for (int run = 0; run < BENCH_RUNS; run++)
+        {
+            Clock::time_point start = Clock::now();
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            modelTexture[0].bindTexture(0);
+            for (const glm::mat4& model : tileModels)
+            {
+                shader.setUniform("model", model);
+                tiles.drawLod(model, view, projection, cameraPosition, 240.0f);
+            }
+            for (int i = 0; i < numModels; i++)
+            {
+                shader.setUniform("model", modelMatrices[i]);
+                models[i].drawLod(modelMatrices[i], view, projection, cameraPosition, 240.0f);
+            }
+            glFinish();
+            bestMs = std::min(bestMs, elapsedMs(start));
+        }
+        table << std::left << std::setw(22) << "one draw per object" << std::right << std::setw(8) << tileModels.size() + numModels
+            << std::setw(15) << 1 << std::setw(15) << 0 << std::setw(15) << tileModels.size() + numModels << std::fixed << std::setprecision(2)
+            << std::setw(11) << bestMs << std::defaultfloat << std::endl;
+    }
+    GLState::bindTexture(0, GL_TEXTURE_2D, 0);
+
+    std::cout << table.str();
+
+    std::remove(sceneFilename);
+    std::remove(libraryFilename);
+    std::remove(MeshCache::cacheFilename(sceneFilename).c_str());
+    destroyBenchContext(window);
+}
+
+void benchmarkIndirect()
+{
+    GLFWwindow* window = createBenchContext(320, 240);
+    if (window == NULL)
+        return;
+
+    ShaderProgram meshShader, indirectShader;
+    meshShader.loadShaders("Lighting.vert", "Lighting.frag");
+    indirectShader.loadShaders("Indirect.vert", "Indirect.frag");
+
+    //Every bundled mesh twice: with buffers and a VAO of its own, and in one arena. The arena is declared first,
+    //its meshes hand their ranges back when they go
+    const int numMeshes = 5;
+    GeometryArena arena(128 * 1024, 1024 * 1024, VertexFormat::compact());
+    Mesh ownMeshes[numMeshes];
+    std::unique_ptr<Mesh> arenaMeshes[numMeshes];
+    for (int i = 0; i < numMeshes; i++)
+    {
+        MeshData data;
+        loadMeshData(BENCH_OBJ_FILES[i], data, &ThreadPool::shared(), VertexFormat::compact());
+        ownMeshes[i].create(data, VertexFormat::compact());
+        arenaMeshes[i].reset(new Mesh());
+        arenaMeshes[i]->create(data, arena);
+    }
+
+    const char* textureFiles[] = { "Pattern1.jpg", "Pattern2.jpg", "Pattern3.jpg", "Brick.jpg" };
+    const int numTextures = 4;
+    IndirectRenderer renderer(arena, 256);
+    Texture2D textures[numTextures];
+    int layers[numTextures];
+    for (int i = 0; i < numTextures; i++)
+    {
+        Image image;
+        Texture2D::decodeImage(textureFiles[i], image);
+        textures[i].createTexture(image, true);
+        layers[i] = renderer.addTexture(image);
+    }
+
+    //10k objects on a 100 x 100 grid in front of the camera, the two smallest meshes at their coarsest level, so the
+    //submission rather than llvmpipe's vertex and pixel work dominates
+    const int numObjects = 10000;
+    const int objectMeshes[] = { 3, 4 }; // GroundPlane.obj, light.obj
+    std::vector<glm::mat4> models(numObjects);
+    for (int i = 0; i < numObjects; i++)
+        models[i] = glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3((i % 100 - 50) * 1.5f, 0.0f, -(i / 100) * 1.5f)), glm::vec3(0.5f));
+
+    glm::vec3 cameraPosition(0.0f, 40.0f, 30.0f);
+    glm::mat4 view = glm::lookAt(cameraPosition, glm::vec3(0.0f, 0.0f, -75.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    glm::mat4 projection = glm::perspective(glm::radians(60.0f), 320.0f / 240.0f, 0.1f, 300.0f);
+    FrameUniforms frameUniforms;
+    FrameUniforms::bindBlocks(meshShader);
+    FrameUniforms::bindBlocks(indirectShader);
+    setBenchUniforms(frameUniforms, view, projection, cameraPosition, glm::vec3(1.0f));
+
+    //What main.cpp did per object before: model uniform, texture bind, then Mesh binds and unbinds its VAO per draw
+    auto submitMeshes = [&]()
+    {
+        UniformHandle modelUniform = meshShader.getUniformHandle("model");
+        meshShader.use();
+        for (int i = 0; i < numObjects; i++)
+        {
+            Mesh& mesh = ownMeshes[objectMeshes[i % 2]];
+            meshShader.setUniform(modelUniform, models[i]);
+            textures[i % numTextures].bindTexture(0);
+            for (size_t m = 0; m < mesh.getMaterials().size(); m++)
+                mesh.drawSubmesh(m, (int)mesh.getLods().size() - 1, models[i], view, projection, cameraPosition);
+        }
+        textures[0].unbindTexture(0);
+    };
+    auto submitArena = [&]()
+    {
+        indirectShader.use();
+        for (int i = 0; i < numObjects; i++)
+        {
+            Mesh& mesh = *arenaMeshes[objectMeshes[i % 2]];
+            renderer.submit(mesh, models[i], layers[i % numTextures], (int)mesh.getLods().size() - 1);
+        }
+        return renderer.flush(indirectShader);
+    };
+
+    //submit: CPU time of the draw calls. frame: until glFinish returns. The timed frames skip rasterization, the image
+    //compared afterwards is drawn in full
+    std::ostringstream table;
+    table << "Multi-draw indirect " << (IndirectRenderer::isSupported() ? "supported" : "NOT supported, the arena modes use the fallback") << std::endl;
+    table << numObjects << " objects, best of " << BENCH_RUNS << " frames" << std::endl;
+    table << std::left << std::setw(30) << "Mode" << std::right << std::setw(8) << "draws" << std::setw(8) << "calls"
+        << std::setw(13) << "submit ms" << std::setw(12) << "frame ms" << std::endl;
+    std::vector<unsigned char> pixels[2];
+    for (int mode = 0; mode < 3; mode++)
+    {
+        renderer.setMultiDraw(mode == 2);
+        double bestSubmitMs = 1e30, bestFrameMs = 1e30;
+        IndirectStats stats = {};
+        glEnable(GL_RASTERIZER_DISCARD);
+        for (int run = 0; run < BENCH_RUNS; run++)
+        {
+            glFinish();
+            Clock::time_point start = Clock::now();
+            if (mode == 0)
+                submitMeshes();
+            else
+                stats = submitArena();
+            bestSubmitMs = std::min(bestSubmitMs, elapsedMs(start));
+            glFinish();
+            bestFrameMs = std::min(bestFrameMs, elapsedMs(start));
+        }
+        glDisable(GL_RASTERIZER_DISCARD);
+        if (mode > 0)
+        {
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            submitArena();
+            pixels[mode - 1].resize(320 * 240 * 4);
+            glReadPixels(0, 0, 320, 240, GL_RGBA, GL_UNSIGNED_BYTE, pixels[mode - 1].data());
+        }
+
+        const char* names[] = { "Mesh::draw per object", "arena, draw per object", "arena, multi-draw indirect" };
+        size_t draws = (mode == 0) ? numObjects : stats.draws;
+        table << std::left << std::setw(30) << names[mode] << std::right << std::setw(8) << draws
+            << std::setw(8) << (mode == 0 ? draws : stats.calls) << std::fixed << std::setprecision(2)
+            << std::setw(13) << bestSubmitMs << std::setw(12) << bestFrameMs << std::defaultfloat << std::endl;
+    }
+    table << "Arena frames " << (pixels[0] == pixels[1] ? "identical" : "DIFFER") << " with and without multi-draw" << std::endl;
+
+    //main.cpp's model pass, through RenderQueue both ways: level 0 culled by meshlets, one draw per visible range.
+    //The texture layers are blitted copies with mipmaps from glGenerateMipmap, so the images only match up to filtering
+    RenderQueue queue;
+    const float passX[] = { 0.0f, 3.0f, -3.0f }; // RubberToy, Suzan, Teapot as main.cpp places them
+    glm::vec3 passCamera(1.0f, 1.5f, 4.0f);
+    glm::mat4 passView = glm::lookAt(passCamera, glm::vec3(0.0f, 0.5f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    setBenchUniforms(frameUniforms, passView, projection, passCamera, glm::vec3(1.0f));
+    std::vector<unsigned char> passPixels[2];
+    for (int mode = 0; mode < 2; mode++)
+    {
+        ShaderProgram& shader = (mode == 0) ? meshShader : indirectShader;
+        shader.use();
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        for (int i = 0; i < 3; i++)
+            queue.submit(*arenaMeshes[i], glm::translate(glm::mat4(1.0f), glm::vec3(passX[i], 0.0f, 0.0f)), &textures[i]);
+        size_t draws, calls;
+        if (mode == 0)
+        {
+            draws = calls = queue.flush(meshShader, passView, projection, passCamera, 240.0f).draws;
+        }
+        else
+        {
+            const IndirectStats& stats = queue.flush(renderer, indirectShader, passView, projection, passCamera, 240.0f);
+            draws = stats.draws;
+            calls = stats.calls;
+        }
+        passPixels[mode].resize(320 * 240 * 4);
+        glReadPixels(0, 0, 320, 240, GL_RGBA, GL_UNSIGNED_BYTE, passPixels[mode].data());
+        table << "Model pass, " << (mode == 0 ? "RenderQueue draws: " : "RenderQueue to IndirectRenderer: ") << draws << " draws in "
+            << calls << " calls" << std::endl;
+    }
+    size_t differing = 0, covered = 0;
+    for (size_t p = 0; p < passPixels[0].size(); p += 4)
+    {
+        int difference = 0;
+        for (int c = 0; c < 3; c++)
+            difference = std::max(difference, std::abs(passPixels[0][p + c] - passPixels[1][p + c]));
+        differing += difference > 16;
+        covered += passPixels[0][p] != 0 || passPixels[0][p + 1] != 0 || passPixels[0][p + 2] != 0;
+    }
+    table << "Model pass images: " << differing << " of " << covered << " covered pixels differ by more than 16" << std::endl;
+
+    //The free list must end up as one block again once every mesh is gone
+    for (int i = 0; i < numMeshes; i += 2)
+        arenaMeshes[i].reset();
+    table << "Arena after freeing 3 of 5 meshes: " << arena.getVertices().numFreeBlocks() << " free vertex blocks, "
+        << arena.getIndices().numFreeBlocks() << " free index blocks" << std::endl;
+    for (int i = 1; i < numMeshes; i += 2)
+        arenaMeshes[i].reset();
+    table << "Arena after freeing all: " << arena.getVertices().numFreeBlocks() << " + " << arena.getIndices().numFreeBlocks()
+        << " free blocks, " << arena.getVertices().freeSpace() << " of " << arena.getVertices().capacity() << " vertices free" << std::endl;
+
+    std::cout << table.str();
+    destroyBenchContext(window);
+}
+
+void benchmarkInstancing()
+{
+    GLFWwindow* window = createBenchContext(320, 240);
+    if (window == NULL)
+        return;
+
+    ShaderProgram perDrawShader, instancedShader, groundShader;
+    perDrawShader.loadShaders("Lighting.vert", "Lighting.frag");
+    instancedShader.loadShaders("Lighting.vert", "Lighting.frag", ShaderDefines().set("INSTANCED").toString().c_str());
+    groundShader.loadShaders("Lighting.vert", "Lighting.frag",
+        ShaderDefines().set("INSTANCED").set("GROUND_UV_SCALE").toString().c_str());
+    GLint groundLinked = GL_FALSE;
+    glGetProgramiv(groundShader.getProgram(), GL_LINK_STATUS, &groundLinked);
+
+    //light.obj is small enough that the call overhead isn't hidden behind llvmpipe's vertex work
+    const char* meshFiles[] = { "Teapot.obj", "light.obj" };
+    Mesh meshes[2];
+    Texture2D texture;
+    if (!meshes[0].loadOBJ(meshFiles[0], VertexFormat::compact()) || !meshes[1].loadOBJ(meshFiles[1], VertexFormat::compact()) ||
+        !texture.loadTexture("Pattern3.jpg", true))
+    {
+        std::cout << "Teapot.obj, light.obj or Pattern3.jpg missing" << std::endl;
+        destroyBenchContext(window);
+        return;
+    }
+
+    //A 317 x 317 grid of small teapots seen from above
+    const int numInstances = 100000;
+    const int gridSide = 317;
+    std::vector<glm::mat4> models(numInstances);
+    for (int i = 0; i < numInstances; i++)
+    {
+        glm::vec3 position((i % gridSide - gridSide / 2) * 0.5f, 0.0f, -(i / gridSide) * 0.5f);
+        models[i] = glm::scale(glm::translate(glm::mat4(1.0f), position), glm::vec3(0.1f));
+    }
+
+    glm::vec3 cameraPosition(0.0f, 60.0f, 20.0f);
+    glm::mat4 view = glm::lookAt(cameraPosition, glm::vec3(0.0f, 0.0f, -80.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    glm::mat4 projection = glm::perspective(glm::radians(60.0f), 320.0f / 240.0f, 0.1f, 300.0f);
+    FrameUniforms frameUniforms;
+    FrameUniforms::bindBlocks(perDrawShader);
+    FrameUniforms::bindBlocks(instancedShader);
+    setBenchUniforms(frameUniforms, view, projection, cameraPosition, glm::vec3(1.0f));
+
+    InstanceBuffer instances;
+    auto submitPerDraw = [&](Mesh& mesh, int count)
+    {
+        int lod = (int)mesh.getLods().size() - 1;
+        UniformHandle modelUniform = perDrawShader.getUniformHandle("model");
+        perDrawShader.use();
+        for (int i = 0; i < count; i++)
+        {
+            perDrawShader.setUniform(modelUniform, models[i]);
+            for (size_t m = 0; m < mesh.getMaterials().size(); m++)
+                mesh.drawSubmesh(m, lod, models[i], view, projection, cameraPosition);
+        }
+    };
+    auto submitInstanced = [&](Mesh& mesh, int count)
+    {
+        //The transforms go up every frame, as they would for moving instances
+        instancedShader.use();
+        instances.update(models.data(), count);
+        mesh.drawInstanced(instances, (int)mesh.getLods().size() - 1);
+    };
+
+    //submit: CPU time of the calls, instance upload included. frame: until glFinish returns. Rasterization is skipped,
+    //the vertex work is the same for both
+    const int runs = 3;
+    std::ostringstream table;
+    table << numInstances << " instances at the coarsest level, best of " << runs << " frames" << std::endl;
+    table << std::left << std::setw(18) << "Mesh" << std::setw(24) << "Path" << std::right << std::setw(11) << "triangles"
+        << std::setw(8) << "calls" << std::setw(13) << "submit ms" << std::setw(12) << "frame ms" << std::endl;
+    texture.bindTexture(0);
+    glEnable(GL_RASTERIZER_DISCARD);
+    for (int row = 0; row < 4; row++)
+    {
+        Mesh& mesh = meshes[row / 2];
+        int path = row % 2;
+        GLuint triangles = mesh.getLods().back().numIndices / 3;
+        double bestSubmitMs = 1e30, bestFrameMs = 1e30;
+        for (int run = 0; run < runs; run++)
+        {
+            glFinish();
+            Clock::time_point start = Clock::now();
+            if (path == 0)
+                submitPerDraw(mesh, numInstances);
+            else
+                submitInstanced(mesh, numInstances);
+            bestSubmitMs = std::min(bestSubmitMs, elapsedMs(start));
+            glFinish();
+            bestFrameMs = std::min(bestFrameMs, elapsedMs(start));
+        }
+        table << std::left << std::setw(18) << meshFiles[row / 2] << std::setw(24) << (path == 0 ? "model uniform + draw" : "drawInstanced")
+            << std::right << std::setw(11) << triangles << std::setw(8) << (path == 0 ? numInstances : 1) << std::fixed << std::setprecision(2)
+            << std::setw(13) << bestSubmitMs << std::setw(12) << bestFrameMs << std::defaultfloat << std::endl;
+    }
+    glDisable(GL_RASTERIZER_DISCARD);
+
+    //The first rows in full, both ways. Same vertex math, so the images should match
+    const int compared = 5000;
+    std::vector<unsigned char> pixels[2];
+    for (int path = 0; path < 2; path++)
+    {
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        if (path == 0)
+            submitPerDraw(meshes[0], compared);
+        else
+            submitInstanced(meshes[0], compared);
+        pixels[path].resize(320 * 240 * 4);
+        glReadPixels(0, 0, 320, 240, GL_RGBA, GL_UNSIGNED_BYTE, pixels[path].data());
+    }
+    texture.unbindTexture(0);
+    table << "First " << compared << " Teapot.obj instances " << (pixels[0] == pixels[1] ? "identical" : "DIFFER") << " drawn both ways" << std::endl;
+    table << "Lighting with INSTANCED and GROUND_UV_SCALE " << (groundLinked ? "links" : "FAILS to link") << std::endl;
+
+    std::cout << table.str();
+    destroyBenchContext(window);
+}
+
+void benchmarkStreamBuffer()
+{
+    GLFWwindow* window = createBenchContext(320, 240);
+    if (window == NULL)
+        return;
+
+    ShaderProgram shader;
+    shader.loadShaders("Lighting.vert", "Lighting.frag");
+    shader.use();
+    GLint modelLocation = glGetUniformLocation(shader.getProgram(), "model");
+
+    //Every draw gets its own uniform block range, so each one starts at the binding alignment
+    const int numDraws = 10000;
+    const int numFrames = 30;
+    GLint uniformAlignment = 256;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uniformAlignment);
+    const size_t stride = ((sizeof(glm::mat4) + uniformAlignment - 1) / uniformAlignment) * uniformAlignment;
+    const size_t frameBytes = numDraws * stride;
+
+    //Different data every frame, as for moving objects
+    std::vector<glm::mat4> models(numDraws);
+    auto animate = [&](int frame)
+    {
+        for (int i = 0; i < numDraws; i++)
+            models[i] = glm::translate(glm::mat4(1.0f), glm::vec3((float)i, (float)frame, 0.0f));
+    };
+
+    GLuint uniformBuffer;
+    glGenBuffers(1, &uniformBuffer);
+    GLState::bindBuffer(GL_UNIFORM_BUFFER, uniformBuffer);
+    glBufferData(GL_UNIFORM_BUFFER, frameBytes, NULL, GL_DYNAMIC_DRAW);
+    GLState::bindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    std::ostringstream table;
+    table << numDraws << " draws x " << sizeof(glm::mat4) << " bytes per frame, " << stride << " byte stride, " << numFrames
+        << " frames. Persistent mapping " << (StreamBuffer::isPersistentSupported() ? "supported" : "NOT supported") << std::endl;
+    table << std::left << std::setw(30) << "Path" << std::right << std::setw(12) << "CPU ms/f" << std::setw(12) << "total ms/f"
+        << std::setw(10) << "MB/s" << std::setw(10) << "wait ms" << "  check" << std::endl;
+
+    for (int path = 0; path < 5; path++)
+    {
+        std::unique_ptr<StreamBuffer> stream;
+        if (path >= 3)
+            stream.reset(new StreamBuffer(frameBytes, path == 4));
+
+        //CPU: writing and issuing, without the data setup. total: all frames until glFinish returns, per frame
+        double cpuMs = 0.0, waitMs = 0.0;
+        GLintptr lastOffset = 0;
+        std::vector<unsigned char> block(frameBytes);
+        std::vector<GLintptr> offsets(numDraws);
+        glFinish();
+        Clock::time_point totalStart = Clock::now();
+        for (int frame = 0; frame < numFrames; frame++)
+        {
+            animate(frame);
+            Clock::time_point start = Clock::now();
+            if (path == 0)
+            {
+                for (int i = 0; i < numDraws; i++)
+                    glUniformMatrix4fv(modelLocation, 1, GL_FALSE, &models[i][0][0]);
+            }
+            else if (path == 1)
+            {
+                GLState::bindBuffer(GL_UNIFORM_BUFFER, uniformBuffer);
+                for (int i = 0; i < numDraws; i++)
+                {
+                    glBufferSubData(GL_UNIFORM_BUFFER, i * stride, sizeof(glm::mat4), &models[i]);
+                    glBindBufferRange(GL_UNIFORM_BUFFER, 0, uniformBuffer, i * stride, sizeof(glm::mat4));
+                }
+                lastOffset = (numDraws - 1) * stride;
+            }
+            else if (path == 2)
+            {
+                //Staged into one block on the CPU first, like the stream buffer's fallback
+                for (int i = 0; i < numDraws; i++)
+                    std::memcpy(&block[i * stride], &models[i], sizeof(glm::mat4));
+                GLState::bindBuffer(GL_UNIFORM_BUFFER, uniformBuffer);
+                glBufferSubData(GL_UNIFORM_BUFFER, 0, frameBytes, block.data());
+                for (int i = 0; i < numDraws; i++)
+                    glBindBufferRange(GL_UNIFORM_BUFFER, 0, uniformBuffer, i * stride, sizeof(glm::mat4));
+                lastOffset = (numDraws - 1) * stride;
+            }
+            else
+            {
+                stream->beginFrame();
+                for (int i = 0; i < numDraws; i++)
+                    std::memcpy(stream->allocate(sizeof(glm::mat4), uniformAlignment, offsets[i]), &models[i], sizeof(glm::mat4));
+                stream->commit();
+                for (int i = 0; i < numDraws; i++)
+                    glBindBufferRange(GL_UNIFORM_BUFFER, 0, stream->getBuffer(), offsets[i], sizeof(glm::mat4));
+                stream->endFrame();
+                waitMs += stream->getStats().waitMs;
+                lastOffset = offsets.back();
+            }
+            cpuMs += elapsedMs(start);
+        }
+        glFinish();
+        double totalMs = elapsedMs(totalStart);
+
+        //The last frame's last matrix must have arrived
+        glm::mat4 readBack(0.0f);
+        if (path == 0)
+            glGetUniformfv(shader.getProgram(), modelLocation, &readBack[0][0]);
+        else
+        {
+            GLState::bindBuffer(GL_COPY_READ_BUFFER, path < 3 ? uniformBuffer : stream->getBuffer());
+            glGetBufferSubData(GL_COPY_READ_BUFFER, lastOffset, sizeof(glm::mat4), &readBack[0][0]);
+            GLState::bindBuffer(GL_COPY_READ_BUFFER, 0);
+        }
+        GLState::bindBuffer(GL_UNIFORM_BUFFER, 0);
+
+        const char* names[] = { "glUniformMatrix4fv", "glBufferSubData per draw", "glBufferSubData per frame",
+            "StreamBuffer, orphaning", "StreamBuffer, persistent" };
+        const char* name = (path == 4 && !stream->isPersistent()) ? "StreamBuffer, persistent (fell back)" : names[path];
+        double payloadMB = numDraws * sizeof(glm::mat4) / (1024.0 * 1024.0);
+        table << std::left << std::setw(30) << name << std::right << std::fixed << std::setprecision(2)
+            << std::setw(12) << cpuMs / numFrames << std::setw(12) << totalMs / numFrames
+            << std::setw(10) << payloadMB / (cpuMs / numFrames / 1000.0) << std::setw(10) << waitMs
+            << "  " << (readBack == models.back() ? "ok" : "WRONG") << std::defaultfloat << std::endl;
+    }
+    GLState::deleteBuffers(1, &uniformBuffer);
+
+    std::cout << table.str();
+    destroyBenchContext(window);
+}
+
+void benchmarkUniforms()
+{
+    GLFWwindow* window = createBenchContext(320, 240);
+    if (window == NULL)
+        return;
+
+    ShaderProgram shader;
+    shader.loadShaders("Lighting.vert", "Lighting.frag");
+    shader.use();
+    GLuint program = shader.getProgram();
+
+    //What RenderQueue sets per draw. The color changes every 1250 draws, like materials sorted by color
+    const int numDraws = 10000;
+    std::vector<glm::mat4> models(numDraws);
+    std::vector<glm::vec3> colors(numDraws);
+    for (int i = 0; i < numDraws; i++)
+    {
+        models[i] = glm::translate(glm::mat4(1.0f), glm::vec3((float)i, 0.0f, 0.0f));
+        colors[i] = glm::vec3((float)(i / 1250) / 8.0f, 0.5f, 1.0f);
+    }
+
+    //ShaderProgram before the uniform table: a string is built for find, then operator[] searches again
+    std::map<std::string, GLint> locations;
+    auto mapLocation = [&](const GLchar* name)
+    {
+        std::map<std::string, GLint>::iterator it = locations.find(name);
+        if (it == locations.end())
+            locations[name] = glGetUniformLocation(program, name);
+        return locations[name];
+    };
+
+    GLint modelLocation = glGetUniformLocation(program, "model");
+    GLint colorLocation = glGetUniformLocation(program, "materialColor");
+    GLint textureLocation = glGetUniformLocation(program, "myTexture");
+    UniformHandle modelUniform = shader.getUniformHandle("model");
+    UniformHandle colorUniform = shader.getUniformHandle("materialColor");
+    UniformHandle textureUniform = shader.getUniformHandle("myTexture");
+
+    std::ostringstream table;
+    table << numDraws << " draws x 3 uniforms, best of "
+        << BENCH_RUNS << " frames" << std::endl;
+    table << std::left << std::setw(34) << "Path" << std::right << std::setw(12) << "ns/draw" << std::setw(12) << "glUniform"
+        << std::setw(10) << "skipped" << std::endl;
+    //The shadowed paths go first, the others change the program behind the shadow copies' back
+    for (int path = 0; path < 5; path++)
+    {
+        double bestMs = 1e30;
+        size_t calls = 0, skips = 0;
+        for (int run = 0; run < BENCH_RUNS; run++)
+        {
+            size_t callsBefore = shader.getUniformCalls(), skipsBefore = shader.getUniformSkips();
+            glFinish();
+            Clock::time_point start = Clock::now();
+            for (int i = 0; i < numDraws; i++)
+            {
+                if (path == 0)
+                {
+                    shader.setUniform("model", models[i]);
+                    shader.setUniform("materialColor", colors[i]);
+                    shader.setUniformSampler("myTexture", 0);
+                }
+                else if (path == 1)
+                {
+                    shader.setUniform(ShaderUniforms::model, models[i]);
+                    shader.setUniform(ShaderUniforms::materialColor, colors[i]);
+                    shader.setUniformSampler(ShaderUniforms::myTexture, 0);
+                }
+                else if (path == 2)
+                {
+                    shader.setUniform(modelUniform, models[i]);
+                    shader.setUniform(colorUniform, colors[i]);
+                    shader.setUniformInt(textureUniform, 0);
+                }
+                else if (path == 3)
+                {
+                    glUniformMatrix4fv(mapLocation("model"), 1, GL_FALSE, &models[i][0][0]);
+                    glUniform3f(mapLocation("materialColor"), colors[i].x, colors[i].y, colors[i].z);
+                    glUniform1i(mapLocation("myTexture"), 0);
+                }
+                else
+                {
+                    glUniformMatrix4fv(modelLocation, 1, GL_FALSE, &models[i][0][0]);
+                    glUniform3f(colorLocation, colors[i].x, colors[i].y, colors[i].z);
+                    glUniform1i(textureLocation, 0);
+                }
+            }
+            bestMs = std::min(bestMs, elapsedMs(start));
+            bool shadowed = (path < 3);
+            calls = shadowed ? shader.getUniformCalls() - callsBefore : 3 * numDraws;
+            skips = shadowed ? shader.getUniformSkips() - skipsBefore : 0;
+        }
+
+        const char* names[] = { "name hashed at run time", "ShaderUniforms, compile time hash", "precomputed handles", "std::map<string>, two lookups",
+            "glUniform, cached locations" };
+        table << std::left << std::setw(34) << names[path] << std::right << std::fixed << std::setprecision(1)
+            << std::setw(12) << bestMs * 1e6 / numDraws << std::setw(12) << calls << std::setw(10) << skips
+            << std::defaultfloat << std::endl;
+    }
+
+    //The shadow copies must match what the program really holds
+    glm::mat4 model;
+    glGetUniformfv(program, modelLocation, &model[0][0]);
+    table << "Program state after the runs " << (model == models.back() ? "matches" : "DOES NOT MATCH") << " the last value set" << std::endl;
+
+    std::cout << table.str();
+    destroyBenchContext(window);
+}
+
+void benchmarkStateCache()
+{
+    GLFWwindow* window = createBenchContext(320, 240);
+    if (window == NULL)
+        return;
+
+    //main.cpp's two programs, and its per object pattern: use, bind the texture, set the model, draw, unbind
+    ShaderProgram shaders[2];
+    shaders[0].loadShaders("Lighting.vert", "Lighting.frag", ShaderDefines().set("GROUND_UV_SCALE").toString().c_str());
+    shaders[1].loadShaders("Lighting.vert", "Lighting.frag");
+    UniformHandle modelUniforms[2] = { shaders[0].getUniformHandle("model"), shaders[1].getUniformHandle("model") };
+
+    Mesh meshes[2];
+    for (int i = 0; i < 2; i++)
+    {
+        MeshData data;
+        loadMeshData(BENCH_OBJ_FILES[3 + i], data, &ThreadPool::shared(), VertexFormat::compact()); // GroundPlane.obj, light.obj
+        meshes[i].create(data, VertexFormat::compact());
+    }
+    const char* textureFiles[] = { "Pattern1.jpg", "Pattern2.jpg", "Pattern3.jpg", "Brick.jpg" };
+    const int numTextures = 4;
+    Texture2D textures[numTextures];
+    for (int i = 0; i < numTextures; i++)
+        textures[i].loadTexture(textureFiles[i], true);
+
+    const int numObjects = 10000;
+    std::vector<glm::mat4> models(numObjects);
+    for (int i = 0; i < numObjects; i++)
+        models[i] = glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3((i % 100 - 50) * 1.5f, 0.0f, -(i / 100) * 1.5f)), glm::vec3(0.5f));
+
+    glm::vec3 cameraPosition(0.0f, 40.0f, 30.0f);
+    glm::mat4 view = glm::lookAt(cameraPosition, glm::vec3(0.0f, 0.0f, -75.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    glm::mat4 projection = glm::perspective(glm::radians(60.0f), 320.0f / 240.0f, 0.1f, 300.0f);
+    FrameUniforms frameUniforms;
+    for (ShaderProgram& shader : shaders)
+        FrameUniforms::bindBlocks(shader);
+    setBenchUniforms(frameUniforms, view, projection, cameraPosition, glm::vec3(1.0f));
+
+    std::ostringstream table;
+    table << numObjects << " objects, 2 programs, 2 meshes, " << numTextures << " textures, best of " << BENCH_RUNS
+        << " frames (rasterizer discard)" << std::endl;
+    table << std::left << std::setw(36) << "Order, unbind after draw" << std::right << std::setw(10) << "binds" << std::setw(10)
+        << "skipped" << std::setw(12) << "submit ms" << std::endl;
+
+    //Sorted: runs of 1250 objects share program, mesh and texture, as a sorted queue submits them. Interleaved: every
+    //object changes all three, nothing can be skipped
+    glEnable(GL_RASTERIZER_DISCARD);
+    for (int config = 0; config < 4; config++)
+    {
+        bool sorted = config < 2;
+        bool unbind = config % 2 == 0;
+        GLState::setUnbindAfterDraw(unbind);
+
+        double bestMs = 1e30;
+        GLStateStats stats = {};
+        for (int run = 0; run < BENCH_RUNS; run++)
+        {
+            glFinish();
+            GLState::resetStats();
+            Clock::time_point start = Clock::now();
+            for (int i = 0; i < numObjects; i++)
+            {
+                int group = sorted ? i / 1250 : i;
+                int kind = group % 2;
+                Texture2D& texture = textures[group / 2 % numTextures];
+                shaders[kind].use();
+                texture.bindTexture(0);
+                shaders[kind].setUniform(modelUniforms[kind], models[i]);
+                meshes[kind].draw();
+                texture.unbindTexture(0);
+            }
+            glFinish();
+            bestMs = std::min(bestMs, elapsedMs(start));
+            stats = GLState::getStats();
+        }
+
+        size_t binds = stats.programBinds + stats.textureBinds + stats.vertexArrayBinds + stats.bufferBinds;
+        size_t skips = stats.programSkips + stats.textureSkips + stats.vertexArraySkips + stats.bufferSkips;
+        std::string name = std::string(sorted ? "sorted" : "interleaved") + (unbind ? ", unbind" : ", keep bound");
+        table << std::left << std::setw(36) << name << std::right << std::setw(10) << binds << std::setw(10) << skips
+            << std::fixed << std::setprecision(2) << std::setw(12) << bestMs << std::defaultfloat << std::endl;
+    }
+    glDisable(GL_RASTERIZER_DISCARD);
+    GLState::setUnbindAfterDraw(true);
+
+    std::cout << table.str();
+    destroyBenchContext(window);
+}
+
+void benchmarkShaderCache()
+{
+    GLFWwindow* window = createBenchContext(320, 240);
+    if (window == NULL)
+        return;
+
+    //The three programs main.cpp draws the scene with, in a cache directory of their own that is removed at the end
+    const int numPrograms = 3;
+    const char* programFiles[numPrograms][3] = { { "Light.vert", "Light.frag", "" }, { "Lighting.vert", "Lighting.frag", "" },
+        { "Lighting.vert", "Lighting.frag", "#define GROUND_UV_SCALE 1\n" } };
+    const char* programNames[numPrograms] = { "Light", "Lighting", "Ground" };
+    const std::string cacheDirectory = "ShaderCacheBench";
+    std::string savedDirectory = ProgramCache::getDirectory();
+    std::filesystem::remove_all(cacheDirectory);
+
+    std::ostringstream table;
+    if (!ProgramCache::isEnabled())
+    {
+        std::cout << "The driver offers no program binary formats, nothing to cache" << std::endl;
+        destroyBenchContext(window);
+        return;
+    }
+    GLint numFormats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &numFormats);
+    table << numFormats << " program binary format(s), loadShaders best of " << BENCH_RUNS << " runs" << std::endl;
+    table << std::left << std::setw(18) << "Program" << std::right << std::setw(12) << "first ms" << std::setw(14)
+        << "no cache ms" << std::setw(14) << "cold ms" << std::setw(14) << "warm ms" << std::setw(12) << "bytes" << std::endl;
+
+    //No cache: compile and link. Cold: the same with the binary written, the file is removed before every run.
+    //Warm: the binary from the last cold run. Mesa keeps a shader cache of its own (~/.cache/mesa_shader_cache), only
+    //the very first compile misses it, so that one is listed apart. Point MESA_SHADER_CACHE_DIR at an empty directory
+    //to see a driver cold start
+    double totals[4] = {};
+    bool allFromCache = true;
+    for (int p = 0; p < numPrograms; p++)
+    {
+        double firstMs = 0.0;
+        double bestMs[3] = { 1e30, 1e30, 1e30 };
+        uintmax_t bytes = 0;
+        for (int mode = 0; mode < 3; mode++)
+        {
+            ProgramCache::setDirectory(mode == 0 ? "" : cacheDirectory);
+            for (int run = 0; run < BENCH_RUNS; run++)
+            {
+                if (mode == 1)
+                    std::filesystem::remove_all(cacheDirectory);
+                ShaderProgram shader;
+                glFinish();
+                Clock::time_point start = Clock::now();
+                shader.loadShaders(programFiles[p][0], programFiles[p][1], programFiles[p][2]);
+                glFinish();
+                double ms = elapsedMs(start);
+                bestMs[mode] = std::min(bestMs[mode], ms);
+                if (mode == 0 && run == 0)
+                    firstMs = ms;
+                if (mode == 2)
+                    allFromCache = allFromCache && shader.isFromCache();
+            }
+            if (mode == 1)
+            {
+                for (const auto& entry : std::filesystem::directory_iterator(cacheDirectory))
+                    bytes += entry.file_size();
+            }
+        }
+        totals[0] += firstMs;
+        for (int mode = 0; mode < 3; mode++)
+            totals[mode + 1] += bestMs[mode];
+        table << std::left << std::setw(18) << programNames[p] << std::right << std::fixed << std::setprecision(2)
+            << std::setw(12) << firstMs << std::setw(14) << bestMs[0] << std::setw(14) << bestMs[1] << std::setw(14) << bestMs[2]
+            << std::setw(12) << bytes << std::defaultfloat << std::endl;
+    }
+    table << std::left << std::setw(18) << "all three" << std::right << std::fixed << std::setprecision(2) << std::setw(12)
+        << totals[0] << std::setw(14) << totals[1] << std::setw(14) << totals[2] << std::setw(14) << totals[3] << std::defaultfloat
+        << std::endl;
+    table << "Warm runs " << (allFromCache ? "all loaded" : "NOT all loaded") << " from the cache" << std::endl;
+
+    //A Teapot drawn with the compiled and with the cached Lighting program has to come out the same
+    Mesh teapot;
+    teapot.loadOBJ("Teapot.obj", VertexFormat::compact());
+    Texture2D texture;
+    texture.loadTexture("Pattern3.jpg", true);
+    glm::vec3 cameraPosition(0.0f, 2.0f, 5.0f);
+    glm::mat4 view = glm::lookAt(cameraPosition, glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    glm::mat4 projection = glm::perspective(glm::radians(60.0f), 320.0f / 240.0f, 0.1f, 100.0f);
+    FrameUniforms frameUniforms;
+    setBenchUniforms(frameUniforms, view, projection, cameraPosition, glm::vec3(1.0f));
+
+    std::vector<unsigned char> pixels[2];
+    for (int mode = 0; mode < 2; mode++)
+    {
+        ProgramCache::setDirectory(mode == 0 ? "" : cacheDirectory);
+        ShaderProgram shader;
+        shader.loadShaders("Lighting.vert", "Lighting.frag");
+        FrameUniforms::bindBlocks(shader);
+        shader.use();
+        shader.setUniformSampler("myTexture", 0);
+        shader.setUniform("model", glm::mat4(1.0f));
+        texture.bindTexture(0);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        teapot.draw();
+        texture.unbindTexture(0);
+        pixels[mode].resize(320 * 240 * 4);
+        glReadPixels(0, 0, 320, 240, GL_RGBA, GL_UNSIGNED_BYTE, pixels[mode].data());
+    }
+    table << "Teapot " << (pixels[0] == pixels[1] ? "identical" : "DIFFERS") << " with the compiled and the cached program" << std::endl;
+
+    ProgramCache::setDirectory(savedDirectory);
+    std::filesystem::remove_all(cacheDirectory);
+
+    std::cout << table.str();
+    destroyBenchContext(window);
+}
+
+void benchmarkShaderCompile()
+{
+    GLFWwindow* window = createBenchContext(320, 240);
+    if (window == NULL)
+        return;
+
+    bool parallel = ShaderProgram::enableParallelCompile();
+    std::string savedDirectory = ProgramCache::getDirectory();
+    ProgramCache::setDirectory(""); // compile every time
+
+    //main.cpp's four programs. Every load gets a define no earlier one had, so Mesa's own shader cache misses as well
+    const int numPrograms = 4;
+    const char* programFiles[numPrograms][3] = { { "Light.vert", "Light.frag", "" }, { "Lighting.vert", "Lighting.frag", "" },
+        { "Lighting.vert", "Lighting.frag", "#define GROUND_UV_SCALE 1\n" }, { "Lighting.vert", "Lighting.frag", "#define INSTANCED 1\n" } };
+    long long salt = (long long)Clock::now().time_since_epoch().count();
+    auto saltDefine = [&salt](const char* defines)
+    {
+        return defines + std::string("#define COMPILE_BENCH_SALT ") + std::to_string(salt++);
+    };
+
+    std::ostringstream table;
+    table << numPrograms << " programs, best of " << BENCH_RUNS << " runs, parallel shader compile "
+        << (parallel ? "supported" : "not supported, isReady waits") << std::endl;
+    table << std::left << std::setw(28) << "Path" << std::right << std::setw(12) << "submit ms" << std::setw(12) << "ready ms"
+        << std::setw(14) << "in isReady ms" << std::setw(8) << "polls" << std::endl;
+
+    //One after the other, each waiting for its own compile
+    double serialMs = 1e30;
+    for (int run = 0; run < BENCH_RUNS; run++)
+    {
+        ShaderProgram shaders[numPrograms];
+        glFinish();
+        Clock::time_point start = Clock::now();
+        for (int p = 0; p < numPrograms; p++)
+            shaders[p].loadShaders(programFiles[p][0], programFiles[p][1], saltDefine(programFiles[p][2]).c_str());
+        serialMs = std::min(serialMs, elapsedMs(start));
+    }
+    table << std::left << std::setw(28) << "loadShaders one by one" << std::right << std::fixed << std::setprecision(2)
+        << std::setw(12) << serialMs << std::setw(12) << serialMs << std::setw(14) << serialMs << std::setw(8) << 0
+        << std::defaultfloat << std::endl;
+
+    //All started, then polled like main.cpp does once per frame. The time outside isReady is free for other work
+    double submitMs = 1e30, readyMs = 1e30, pollingMs = 1e30;
+    size_t polls = 0;
+    for (int run = 0; run < BENCH_RUNS; run++)
+    {
+        ShaderProgram shaders[numPrograms];
+        glFinish();
+        Clock::time_point start = Clock::now();
+        for (int p = 0; p < numPrograms; p++)
+            shaders[p].beginLoadShaders(programFiles[p][0], programFiles[p][1], saltDefine(programFiles[p][2]).c_str());
+        double runSubmitMs = elapsedMs(start);
+
+        double runPollingMs = 0.0;
+        size_t runPolls = 0;
+        bool allReady = false;
+        while (!allReady)
+        {
+            Clock::time_point pollStart = Clock::now();
+            allReady = true;
+            for (ShaderProgram& shader : shaders)
+                allReady = shader.isReady() && allReady;
+            runPollingMs += elapsedMs(pollStart);
+            runPolls++;
+            if (!allReady)
+                std::this_thread::sleep_for(std::chrono::microseconds(200)); // the rest of a frame
+        }
+        double runReadyMs = elapsedMs(start);
+        if (runReadyMs < readyMs)
+        {
+            submitMs = runSubmitMs;
+            readyMs = runReadyMs;
+            pollingMs = runPollingMs;
+            polls = runPolls;
+        }
+    }
+    table << std::left << std::setw(28) << "beginLoadShaders + isReady" << std::right << std::fixed << std::setprecision(2)
+        << std::setw(12) << submitMs << std::setw(12) << readyMs << std::setw(14) << pollingMs << std::setw(8) << polls
+        << std::defaultfloat << std::endl;
+
+    ProgramCache::setDirectory(savedDirectory);
+    std::cout << table.str();
+    destroyBenchContext(window);
+}
+
+namespace
+{
+    std::string readTextFile(const char* filename)
+    {
+        std::ifstream file(filename, std::ios::in | std::ios::binary);
+        std::ostringstream text;
+        text << file.rdbuf();
+        return text.str();
+    }
+
+    //Like an editor saving: a new file renamed over the old one
+    void replaceTextFile(const std::string& filename, const std::string& text)
+    {
+        writeFileAtomically(filename, [&](std::ostream& file) { file << text; });
+    }
+}
+
+void benchmarkHotReload()
+{
+    GLFWwindow* window = createBenchContext(320, 240);
+    if (window == NULL)
+        return;
+
+    //A copy of Lighting.vert and .frag to edit, removed at the end. Compiled every time, no program binary cache
+    const char* vertexFilename = "HotReload.vert";
+    const char* fragmentFilename = "HotReload.frag";
+    std::string fragmentSource = readTextFile("Lighting.frag");
+    replaceTextFile(vertexFilename, readTextFile("Lighting.vert"));
+    replaceTextFile(fragmentFilename, fragmentSource);
+    std::string savedDirectory = ProgramCache::getDirectory();
+    ProgramCache::setDirectory("");
+    ShaderProgram::enableParallelCompile();
+
+    ShaderProgram shader;
+    shader.loadShaders(vertexFilename, fragmentFilename);
+    FrameUniforms::bindBlocks(shader);
+    shader.setHotReload(true);
+    shader.use();
+    glm::vec3 materialColor(1.0f, 0.5f, 0.25f); // set once, has to survive the reloads
+    shader.setUniform("materialColor", materialColor);
+    shader.setUniformSampler("myTexture", 0);
+
+    Mesh teapot;
+    teapot.loadOBJ("Teapot.obj", VertexFormat::compact());
+    Texture2D texture;
+    texture.loadTexture("Pattern3.jpg", true);
+    glm::vec3 cameraPosition(0.0f, 2.0f, 5.0f);
+    glm::mat4 view = glm::lookAt(cameraPosition, glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    glm::mat4 projection = glm::perspective(glm::radians(60.0f), 320.0f / 240.0f, 0.1f, 100.0f);
+    FrameUniforms frameUniforms;
+    setBenchUniforms(frameUniforms, view, projection, cameraPosition, glm::vec3(1.0f));
+
+    //One frame as main.cpp has it: the reload check between frames, then the draws. Returns the frame's pixels
+    bool swapped = false;
+    auto frame = [&]()
+    {
+        swapped = shader.updateHotReload();
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        if (shader.use())
+        {
+            shader.setUniform("model", glm::mat4(1.0f));
+            texture.bindTexture(0);
+            teapot.draw();
+            texture.unbindTexture(0);
+        }
+        std::vector<unsigned char> pixels(320 * 240 * 4);
+        glReadPixels(0, 0, 320, 240, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+        return pixels;
+    };
+
+    std::ostringstream table;
+    double steadyMs = 1e30;
+    std::vector<unsigned char> before;
+    for (int i = 0; i < 20; i++)
+    {
+        Clock::time_point start = Clock::now();
+        before = frame();
+        steadyMs = std::min(steadyMs, elapsedMs(start));
+    }
+    table << "Steady frame " << std::fixed << std::setprecision(2) << steadyMs << " ms" << std::defaultfloat << std::endl;
+
+    //A working edit (half the light) and a broken one. Frames go on until the swap, or for 50 frames
+    GLuint firstProgram = shader.getProgram();
+    size_t firstLoadCount = shader.getLoadCount();
+    const char* lastLine = "frag_color = vec4(lighting, 1.0f)";
+    std::string darker = fragmentSource;
+    darker.replace(darker.find(lastLine), strlen(lastLine), "frag_color = vec4(lighting * 0.5, 1.0f)");
+    std::string broken = darker + "\nthis does not compile\n";
+    std::vector<unsigned char> afterEdit;
+    for (int edit = 0; edit < 2; edit++)
+    {
+        replaceTextFile(fragmentFilename, edit == 0 ? darker : broken);
+        Clock::time_point editTime = Clock::now();
+        double worstMs = 0.0;
+        int frames = 0;
+        swapped = false;
+        std::vector<unsigned char> pixels;
+        while (!swapped && frames < 50)
+        {
+            Clock::time_point start = Clock::now();
+            pixels = frame();
+            worstMs = std::max(worstMs, elapsedMs(start));
+            frames++;
+        }
+        if (edit == 0)
+        {
+            afterEdit = pixels;
+            table << "Working edit: " << (swapped ? "swapped in after " : "NOT swapped in after ") << frames << " frame(s), "
+                << std::fixed << std::setprecision(2) << elapsedMs(editTime) << " ms, worst frame " << worstMs << " ms"
+                << std::defaultfloat << std::endl;
+        }
+        else
+        {
+            table << "Broken edit: " << (swapped ? "SWAPPED IN" : "old program kept") << " for " << frames << " frames, "
+                << (pixels == afterEdit ? "frames unchanged" : "FRAMES CHANGED") << ", worst frame " << std::fixed
+                << std::setprecision(2) << worstMs << " ms" << std::defaultfloat << std::endl;
+        }
+    }
+
+    //The new program took over with the old one's uniform values
+    glm::vec3 reloadedColor;
+    glGetUniformfv(shader.getProgram(), glGetUniformLocation(shader.getProgram(), "materialColor"), &reloadedColor[0]);
+    size_t darkerPixels = 0;
+    for (size_t i = 0; i < before.size(); i++)
+        darkerPixels += afterEdit[i] < before[i] ? 1 : 0;
+    table << "Program " << (shader.getProgram() != firstProgram ? "replaced" : "NOT replaced") << ", load count "
+        << firstLoadCount << " -> " << shader.getLoadCount() << ", materialColor " << (reloadedColor == materialColor ? "kept" : "LOST")
+        << ", " << darkerPixels << " channel values darker" << std::endl;
+
+    shader.setHotReload(false);
+    std::remove(vertexFilename);
+    std::remove(fragmentFilename);
+    ProgramCache::setDirectory(savedDirectory);
+
+    std::cout << table.str();
+    destroyBenchContext(window);
+}
+
+void benchmarkShaderVariants()
+{
+    GLFWwindow* window = createBenchContext(320, 240);
+    if (window == NULL)
+        return;
+
+    std::string savedDirectory = ProgramCache::getDirectory();
+    ProgramCache::setDirectory(""); // compile every time
+    ShaderProgram::enableParallelCompile();
+    std::ostringstream table;
+
+    //main.cpp's variants, with a define no earlier run had so Mesa's own shader cache misses as well
+    int salt = (int)(Clock::now().time_since_epoch().count() % 1000000000);
+    ShaderDefines withSpotlight, withoutSpotlight;
+    withSpotlight.set("VARIANT_BENCH_SALT", salt);
+    withoutSpotlight.set("VARIANT_BENCH_SALT", salt).set("HAS_SPOTLIGHT", 0);
+    ShaderVariantCache variants;
+    Clock::time_point start = Clock::now();
+    variants.get("Light.vert", "Light.frag", withSpotlight);
+    ShaderProgram* lit[2] = { &variants.get("Lighting.vert", "Lighting.frag", withoutSpotlight),
+        &variants.get("Lighting.vert", "Lighting.frag", withSpotlight) };
+    for (int i = 0; i < 2; i++)
+    {
+        const ShaderDefines& defines = i == 0 ? withoutSpotlight : withSpotlight;
+        variants.get("Lighting.vert", "Lighting.frag", ShaderDefines(defines).set("GROUND_UV_SCALE"));
+        variants.get("Lighting.vert", "Lighting.frag", ShaderDefines(defines).set("INSTANCED"));
+    }
+    size_t builtCount = variants.size();
+    variants.get("Lighting.vert", "Lighting.frag", withSpotlight); // again, has to come from the cache
+    while (!variants.isReady())
+        std::this_thread::yield();
+    double readyMs = elapsedMs(start);
+    table << builtCount << " variants from 3 source files, " << (variants.size() == builtCount ? "a repeated get reuses its variant" :
+        "a repeated get BUILT ANOTHER") << ", all ready in " << std::fixed << std::setprecision(2) << readyMs << " ms" << std::defaultfloat
+        << std::endl;
+    variants.report(table);
+
+    //Fill bound: the Teapot close up, drawn 20 times over without depth test, with the flashlight off. The lean
+    //variant skips the spotlight code, the full one runs it on a black light, the pixels have to match
+    Mesh teapot;
+    teapot.loadOBJ("Teapot.obj", VertexFormat::compact());
+    Texture2D texture;
+    texture.loadTexture("Pattern3.jpg", true);
+    glm::vec3 cameraPosition(0.0f, 1.0f, 2.5f);
+    FrameBlock frameBlock = {};
+    frameBlock.view = glm::lookAt(cameraPosition, glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    frameBlock.projection = glm::perspective(glm::radians(60.0f), 320.0f / 240.0f, 0.1f, 100.0f);
+    frameBlock.viewPos = cameraPosition;
+    LightsBlock lightsBlock = {};
+    lightsBlock.dirLightDirection = glm::vec3(-0.3f, -1.0f, -0.4f);
+    lightsBlock.dirLightColor = glm::vec3(1.0f);
+    lightsBlock.spotLightPos = cameraPosition;
+    lightsBlock.spotLightDir = -cameraPosition;
+    lightsBlock.spotLightCutoff = glm::cos(glm::radians(20.0f));
+    lightsBlock.spotLightOuterCutoff = glm::cos(glm::radians(35.0f));
+    lightsBlock.spotLightRange = 40.0f;
+    FrameUniforms frameUniforms;
+    frameUniforms.set(frameBlock, lightsBlock);
+    glDisable(GL_DEPTH_TEST);
+
+    const int overdraw = 20;
+    double frameMs[2] = { 1e30, 1e30 };
+    std::vector<unsigned char> pixels[2];
+    for (int v = 0; v < 2; v++)
+    {
+        FrameUniforms::bindBlocks(*lit[v]);
+        lit[v]->use();
+        lit[v]->setUniform("model", glm::mat4(1.0f));
+        texture.bindTexture(0);
+        for (int run = 0; run < BENCH_RUNS; run++)
+        {
+            glClear(GL_COLOR_BUFFER_BIT);
+            glFinish();
+            Clock::time_point frameStart = Clock::now();
+            for (int i = 0; i < overdraw; i++)
+                teapot.draw();
+            glFinish();
+            frameMs[v] = std::min(frameMs[v], elapsedMs(frameStart));
+        }
+        texture.unbindTexture(0);
+        pixels[v].resize(320 * 240 * 4);
+        glReadPixels(0, 0, 320, 240, GL_RGBA, GL_UNSIGNED_BYTE, pixels[v].data());
+    }
+    glEnable(GL_DEPTH_TEST);
+    table << "Teapot x" << overdraw << " with the flashlight off, best of " << BENCH_RUNS << " runs: HAS_SPOTLIGHT 0 " << std::fixed
+        << std::setprecision(2) << frameMs[0] << " ms, HAS_SPOTLIGHT 1 " << frameMs[1] << " ms (" << frameMs[1] / frameMs[0]
+        << "x), pixels " << std::defaultfloat << (pixels[0] == pixels[1] ? "identical" : "DIFFER") << std::endl;
+
+    //An error in an included file has to point at that file: its source string number and the line within it
+    const char* includeFilename = "VariantBenchInclude.glsl";
+    const char* fragmentFilename = "VariantBench.frag";
+    replaceTextFile(includeFilename, "//included\nvec3 broken()\n{ return this does not compile; }\n");
+    replaceTextFile(fragmentFilename, "#version 330 core\n#include \"VariantBenchInclude.glsl\"\nout vec4 frag_color;\n"
+        "void main() { frag_color = vec4(broken(), 1.0); }\n");
+    std::ostringstream errors;
+    std::streambuf* savedErrors = std::cerr.rdbuf(errors.rdbuf());
+    {
+        ShaderProgram broken;
+        broken.loadShaders("Light.vert", fragmentFilename);
+    }
+    std::cerr.rdbuf(savedErrors);
+    std::string log = errors.str();
+    bool namesFile = log.find("1 VariantBenchInclude.glsl") != std::string::npos;
+    bool pointsAtLine = log.find("1:3(") != std::string::npos || log.find("1(3)") != std::string::npos;
+    table << "Error in an included file: " << (namesFile ? "file listed" : "file NOT listed") << ", "
+        << (pointsAtLine ? "reported at 1:3" : "NOT reported at 1:3") << std::endl;
+    std::remove(includeFilename);
+    std::remove(fragmentFilename);
+
+    ProgramCache::setDirectory(savedDirectory);
+    std::cout << table.str();
+    destroyBenchContext(window);
+}
+
+void benchmarkShaderLibrary()
+{
+    //Looked up while compiling, nothing is left to do at run time
+    constexpr const EmbeddedShader* LIGHTING_VERT = ShaderLibrary::find("Lighting.vert");
+    static_assert(LIGHTING_VERT->numFiles > 1, "Lighting.vert isn't embedded with its #includes");
+
+    std::ostringstream table;
+    size_t embeddedBytes = 0;
+    for (size_t i = 0; i < ShaderLibrary::size(); i++)
+        embeddedBytes += strlen(ShaderLibrary::get(i).source);
+    table << ShaderLibrary::size() << " shaders embedded, " << embeddedBytes << " bytes of source, " << LIGHTING_VERT->numFiles
+        << " files in Lighting.vert" << std::endl;
+
+    //The copies are from the last build, the files may have been edited since
+    size_t matching = 0;
+    for (size_t i = 0; i < ShaderLibrary::size(); i++)
+    {
+        const EmbeddedShader& shader = ShaderLibrary::get(i);
+        std::vector<std::string> files;
+        std::string source = ShaderSource::load(shader.name, files);
+        bool sameFiles = files.size() == shader.numFiles && std::equal(files.begin(), files.end(), shader.files);
+        if (source == shader.source && sameFiles)
+            matching++;
+        else
+            table << "  " << shader.name << " changed since the build" << std::endl;
+    }
+    table << matching << " of " << ShaderLibrary::size() << " embedded shaders match their files" << std::endl;
+
+    //Just the sources of the three file pairs in use: reading and resolving the #includes against a lookup
+    const char* programFiles[][2] = { { "Light.vert", "Light.frag" }, { "Lighting.vert", "Lighting.frag" },
+        { "Indirect.vert", "Indirect.frag" } };
+    const int numPairs = 3;
+    double sourceMs[2] = { 1e30, 1e30 };
+    size_t bytes = 0;
+    for (int path = 0; path < 2; path++)
+    {
+        for (int run = 0; run < BENCH_RUNS; run++)
+        {
+            bytes = 0;
+            Clock::time_point start = Clock::now();
+            for (int p = 0; p < numPairs; p++)
+            {
+                for (int stage = 0; stage < 2; stage++)
+                {
+                    if (path == 0)
+                    {
+                        std::vector<std::string> files;
+                        bytes += ShaderSource::load(programFiles[p][stage], files).size();
+                    }
+                    else
+                    {
+                        bytes += strlen(ShaderLibrary::find(programFiles[p][stage])->source);
+                    }
+                }
+            }
+            sourceMs[path] = std::min(sourceMs[path], elapsedMs(start));
+        }
+    }
+    table << "Sources of " << numPairs << " programs, best of " << BENCH_RUNS << " runs: files " << std::fixed << std::setprecision(3)
+        << sourceMs[0] << " ms, embedded " << sourceMs[1] << " ms (" << bytes << " bytes)" << std::defaultfloat << std::endl;
+
+    GLFWwindow* window = createBenchContext(320, 240);
+    if (window == NULL)
+    {
+        std::cout << table.str();
+        return;
+    }
+
+    //main.cpp's start: every variant begun, then polled until ready. No program binary cache, Mesa's own shader cache
+    //is warm after the first run so this is mostly the time outside of the compiler
+    std::string savedDirectory = ProgramCache::getDirectory();
+    ProgramCache::setDirectory("");
+    ShaderProgram::enableParallelCompile();
+    double readyMs[2] = { 1e30, 1e30 };
+    size_t numVariants = 0;
+    for (int run = 0; run < BENCH_RUNS; run++)
+    {
+        for (int path = 0; path < 2; path++)
+        {
+            ShaderProgram::setLoadFromFiles(path == 0);
+            glFinish();
+            Clock::time_point start = Clock::now();
+            ShaderVariantCache variants;
+            ShaderDefines withoutSpotlight;
+            withoutSpotlight.set("HAS_SPOTLIGHT", 0);
+            variants.get("Light.vert", "Light.frag");
+            for (int spotlight = 0; spotlight < 2; spotlight++)
+            {
+                ShaderDefines defines = spotlight == 0 ? withoutSpotlight : ShaderDefines();
+                variants.get("Lighting.vert", "Lighting.frag", defines);
+                variants.get("Lighting.vert", "Lighting.frag", ShaderDefines(defines).set("GROUND_UV_SCALE"));
+                variants.get("Lighting.vert", "Lighting.frag", ShaderDefines(defines).set("INSTANCED"));
+            }
+            while (!variants.isReady())
+                std::this_thread::yield();
+            readyMs[path] = std::min(readyMs[path], elapsedMs(start));
+            numVariants = variants.size();
+        }
+    }
+    ShaderProgram::setLoadFromFiles(false);
+    ProgramCache::setDirectory(savedDirectory);
+    table << numVariants << " variants ready, best of " << BENCH_RUNS << " runs: files " << std::fixed << std::setprecision(2)
+        << readyMs[0] << " ms, embedded " << readyMs[1] << " ms" << std::defaultfloat << std::endl;
+
+    std::cout << table.str();
+    destroyBenchContext(window);
+}
+
+namespace
+{
+    //Texture2D's loop before ImageKernels: the rows of stb_image's buffer swapped in place, a byte at a time
+    void flipRowsByteSwap(unsigned char* imageData, int widthInBytes, int height)
+    {
+        unsigned char* top = NULL;
+        unsigned char* bottom = NULL;
+        unsigned char temp = 0;
+        int halfHeight = height / 2;
+        for (int row = 0; row < halfHeight; row++)
+        {
+            top = imageData + (size_t)row * widthInBytes;
+            bottom = imageData + (size_t)(height - row - 1) * widthInBytes;
+            for (int col = 0; col < widthInBytes; col++)
+            {
+                temp = *top;
+                *top = *bottom;
+                *bottom = temp;
+                top++;
+                bottom++;
+            }
+        }
+    }
+}
+
+void benchmarkImageKernels()
+{
+    //A 4096 x 4096 image of noise with every alpha value in it, as RGBA and as RGB
+    const int size = 4096;
+    const size_t count = (size_t)size * size;
+    std::vector<unsigned char> rgba(count * 4), rgb(count * 3);
+    uint32_t seed = 12345;
+    for (size_t i = 0; i < rgba.size(); i++)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        rgba[i] = (unsigned char)(seed >> 24);
+    }
+    for (size_t i = 0; i < count; i++)
+        memcpy(&rgb[i * 3], &rgba[i * 4], 3);
+    std::vector<float> linear(count * 4);
+    ImageKernels::srgbToLinear(rgba.data(), linear.data(), count);
+
+    ImageKernels::Level supported = ImageKernels::getSupportedLevel();
+    std::ostringstream table;
+    table << size << " x " << size << " image, best of " << BENCH_RUNS << " runs, ms (GB/s read + written). CPU supports "
+        << ImageKernels::levelName(supported) << std::endl;
+    table << std::left << std::setw(26) << "Kernel" << std::right << std::setw(20) << "old loop";
+    for (int level = ImageKernels::SCALAR; level <= ImageKernels::AVX2; level++)
+        table << std::setw(20) << ImageKernels::levelName((ImageKernels::Level)level);
+    table << "  result" << std::endl;
+
+    auto cell = [&](double ms, size_t bytes)
+    {
+        std::ostringstream text;
+        text << std::fixed << std::setprecision(2) << ms << " (" << std::setprecision(1) << bytes / (ms * 1e6) << ")";
+        table << std::setw(20) << text.str();
+    };
+    //run(level) does one pass, reset() puts the input back untimed. result() is compared between the levels
+    auto row = [&](const char* name, size_t bytes, std::function<void()> oldLoop, std::function<void()> reset,
+        std::function<void()> run, std::function<std::vector<unsigned char>()> result)
+    {
+        table << std::left << std::setw(26) << name << std::right;
+        if (oldLoop)
+        {
+            double best = 1e30;
+            for (int r = 0; r < BENCH_RUNS; r++)
+            {
+                reset();
+                Clock::time_point start = Clock::now();
+                oldLoop();
+                best = std::min(best, elapsedMs(start));
+            }
+            cell(best, bytes);
+        }
+        else
+            table << std::setw(20) << "-";
+
+        std::vector<unsigned char> reference;
+        bool same = true;
+        for (int level = ImageKernels::SCALAR; level <= ImageKernels::AVX2; level++)
+        {
+            if (level > supported)
+            {
+                table << std::setw(20) << "-";
+                continue;
+            }
+            ImageKernels::setLevel((ImageKernels::Level)level);
+            double best = 1e30;
+            for (int r = 0; r < BENCH_RUNS; r++)
+            {
+                reset();
+                Clock::time_point start = Clock::now();
+                run();
+                best = std::min(best, elapsedMs(start));
+            }
+            cell(best, bytes);
+            std::vector<unsigned char> output = result();
+            if (level == ImageKernels::SCALAR)
+                reference.swap(output);
+            else
+                same = same && output == reference;
+        }
+        ImageKernels::setLevel(supported);
+        table << "  " << (same ? "same bytes" : "DIFFERENT BYTES") << std::endl;
+    };
+    auto bytesOf = [](const std::vector<unsigned char>& v) { return v; };
+    auto nothing = []() {};
+
+    std::vector<unsigned char> work(count * 4), output(count * 4);
+    auto restore = [&]() { memcpy(work.data(), rgba.data(), work.size()); };
+    const size_t rowBytes = (size_t)size * 4;
+
+    row("flip in place", count * 8, [&]() { flipRowsByteSwap(work.data(), (int)rowBytes, size); }, restore,
+        [&]() { ImageKernels::flipRows(work.data(), rowBytes, size); }, [&]() { return bytesOf(work); });
+    row("flip while copying", count * 8, [&]()
+        {
+            for (int r = 0; r < size; r++)
+                memcpy(&output[(size_t)(size - r - 1) * rowBytes], &rgba[(size_t)r * rowBytes], rowBytes);
+        }, nothing, [&]() { ImageKernels::copyRowsFlipped(rgba.data(), output.data(), rowBytes, size); },
+        [&]() { return bytesOf(output); });
+    row("RGB to RGBA", count * 7, std::function<void()>(), nothing,
+        [&]() { ImageKernels::rgbToRgba(rgb.data(), output.data(), count); }, [&]() { return bytesOf(output); });
+    row("premultiply alpha", count * 8, std::function<void()>(), restore,
+        [&]() { ImageKernels::premultiplyAlpha(work.data(), count); }, [&]() { return bytesOf(work); });
+    const int bgra[4] = { 2, 1, 0, 3 };
+    row("swizzle RGBA to BGRA", count * 8, std::function<void()>(), nothing,
+        [&]() { ImageKernels::swizzle(rgba.data(), output.data(), count, bgra); }, [&]() { return bytesOf(output); });
+    std::vector<float> linearOut(count * 4);
+    row("sRGB to linear float", count * 20, std::function<void()>(), nothing,
+        [&]() { ImageKernels::srgbToLinear(rgba.data(), linearOut.data(), count); }, [&]()
+        {
+            std::vector<unsigned char> bytes(linearOut.size() * 4);
+            memcpy(bytes.data(), linearOut.data(), bytes.size());
+            return bytes;
+        });
+    row("linear float to sRGB", count * 20, std::function<void()>(), nothing,
+        [&]() { ImageKernels::linearToSrgb(linear.data(), output.data(), count); }, [&]() { return bytesOf(output); });
+
+    //A 2:1 filter pass of 12 taps as MipChain runs it, on the linear floats: columns of rows, then along the rows
+    const size_t rowFloats = (size_t)size * 4, numTaps = 12;
+    std::vector<const float*> tapRows(numTaps);
+    std::vector<int> tapIndices((size / 2) * numTaps);
+    std::vector<float> tapWeights(tapIndices.size());
+    for (size_t i = 0; i < tapIndices.size(); i++)
+    {
+        int x = (int)(i / numTaps), t = (int)(i % numTaps);
+        tapIndices[i] = (2 * x - 5 + t + size) % size;
+        tapWeights[i] = 1.0f / numTaps + 0.01f * (t % 3 - 1);
+    }
+    auto floatBytes = [&]()
+    {
+        std::vector<unsigned char> bytes(linearOut.size() * 4);
+        memcpy(bytes.data(), linearOut.data(), bytes.size());
+        return bytes;
+    };
+    row("filter rows, 12 taps", (size_t)(size / 2) * (numTaps + 1) * rowFloats * 4, std::function<void()>(), nothing, [&]()
+        {
+            for (int y = 0; y < size / 2; y++)
+            {
+                for (size_t t = 0; t < numTaps; t++)
+                    tapRows[t] = &linear[(size_t)((2 * y - 5 + (int)t + size) % size) * rowFloats];
+                ImageKernels::sumRows(tapRows.data(), &tapWeights[0], numTaps, &linearOut[y * rowFloats], rowFloats);
+            }
+        }, floatBytes);
+    row("filter pixels, 12 taps", count * 16 * (numTaps + 1) / 2, std::function<void()>(), nothing, [&]()
+        {
+            for (int y = 0; y < size; y++)
+                ImageKernels::sumPixels(&linear[y * rowFloats], tapIndices.data(), tapWeights.data(), numTaps,
+                    &linearOut[y * rowFloats / 2], size / 2);
+        }, floatBytes);
+
+    //The byte round trip has to be lossless, and the table at most one step off the exact curve
+    table << "sRGB -> linear -> sRGB " << (output == rgba ? "lossless" : "LOSSY");
+    const int samples = 1 << 20;
+    std::vector<float> ramp(samples * 4);
+    std::vector<unsigned char> rampSrgb(samples * 4);
+    for (int i = 0; i < samples * 4; i++)
+        ramp[i] = (float)(i / 4) / (samples - 1);
+    ImageKernels::linearToSrgb(ramp.data(), rampSrgb.data(), samples);
+    int worst = 0;
+    for (int i = 0; i < samples * 4; i++)
+    {
+        if (i % 4 == 3)
+            continue;
+        double x = ramp[i];
+        double exact = (x <= 0.0031308 ? x * 12.92 : 1.055 * std::pow(x, 1.0 / 2.4) - 0.055) * 255.0 + 0.5;
+        worst = std::max(worst, std::abs((int)exact - (int)rampSrgb[i]));
+    }
+    table << ", linear ramp at most " << worst << " step(s) off the exact conversion" << std::endl;
+
+    //The load path: decodeImage against what it did before, stb_image converting to RGBA and a row copy
+    table << std::left << std::setw(26) << "decodeImage" << std::right << std::setw(20) << "before" << std::setw(20) << "now" << std::endl;
+    for (const char* filename : { "Brick.jpg", "Pattern1.jpg", "Pattern2.jpg" })
+    {
+        double beforeMs = 1e30, nowMs = 1e30;
+        Image before, now;
+        for (int r = 0; r < BENCH_RUNS; r++)
+        {
+            Clock::time_point start = Clock::now();
+            int width, height, components;
+            unsigned char* data = stbi_load(filename, &width, &height, &components, STBI_rgb_alpha);
+            if (data == NULL)
+                break;
+            before.width = width;
+            before.height = height;
+            before.pixels.resize((size_t)width * height * 4);
+            for (int y = 0; y < height; y++)
+                memcpy(&before.pixels[(size_t)(height - y - 1) * width * 4], data + (size_t)y * width * 4, (size_t)width * 4);
+            stbi_image_free(data);
+            beforeMs = std::min(beforeMs, elapsedMs(start));
+
+            start = Clock::now();
+            Texture2D::decodeImage(filename, now);
+            nowMs = std::min(nowMs, elapsedMs(start));
+        }
+        table << std::left << std::setw(26) << filename << std::right << std::fixed << std::setprecision(2) << std::setw(20)
+            << beforeMs << std::setw(20) << nowMs << std::defaultfloat << "  "
+            << (before.pixels == now.pixels ? "same pixels" : "DIFFERENT PIXELS") << std::endl;
+    }
+
+    std::cout << table.str();
+}
+
+void benchmarkMips()
+{
+    GLFWwindow* window = createBenchContext(320, 240);
+    if (window == NULL)
+        return;
+
+    const MipFilter filters[] = { MIP_FILTER_BOX, MIP_FILTER_KAISER, MIP_FILTER_LANCZOS };
+    const int runs = 5;
+    ImageKernels::Level supported = ImageKernels::getSupportedLevel();
+    unsigned int maxThreads = std::max(std::thread::hardware_concurrency(), 1u);
+
+    //Level 0 then glGenerateMipmap, the way Texture2D made its levels before. Returns the GL thread's time, and the
+    //given level read back
+    auto generateMipmap = [](const Image& image, int readLevel, std::vector<unsigned char>& pixels)
+    {
+        Clock::time_point start = Clock::now();
+        GLuint texture;
+        glGenTextures(1, &texture);
+        GLState::bindTexture(0, GL_TEXTURE_2D, texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, image.width, image.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image.pixels.data());
+        glGenerateMipmap(GL_TEXTURE_2D);
+        glFinish();
+        double ms = elapsedMs(start);
+        pixels.resize((size_t)mipLevelSize(image.width, readLevel) * mipLevelSize(image.height, readLevel) * 4);
+        glGetTexImage(GL_TEXTURE_2D, readLevel, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+        GLState::bindTexture(0, GL_TEXTURE_2D, 0);
+        GLState::deleteTextures(1, &texture);
+        return ms;
+    };
+    auto sameChains = [](const MipChain& a, const MipChain& b)
+    {
+        if (a.size() != b.size())
+            return false;
+        for (size_t level = 0; level < a.size(); level++)
+        {
+            if (a[level].pixels != b[level].pixels)
+                return false;
+        }
+        return true;
+    };
+
+    std::ostringstream table;
+    table << "Mip chains of main.cpp's textures, best of " << runs << " runs, ms. CPU: buildMipChain on " << maxThreads
+        << (maxThreads == 1 ? " thread" : " threads") << ", GL thread: until the texture is complete" << std::endl;
+    table << std::left << std::setw(16) << "Texture" << std::setw(20) << "Mode" << std::right;
+    for (int level = ImageKernels::SCALAR; level <= ImageKernels::AVX2; level++)
+        table << std::setw(12) << ImageKernels::levelName((ImageKernels::Level)level);
+    table << std::setw(12) << "GL thread" << "  result" << std::endl;
+
+    for (const char* filename : { "Pattern1.jpg", "Pattern2.jpg", "Pattern3.jpg", "Brick.jpg" })
+    {
+        Image image;
+        if (!Texture2D::decodeImage(filename, image))
+            continue;
+
+        std::vector<unsigned char> unused;
+        double glMs = 1e30;
+        for (int r = 0; r < runs; r++)
+            glMs = std::min(glMs, generateMipmap(image, 0, unused));
+        table << std::left << std::setw(16) << filename << std::setw(20) << "glGenerateMipmap" << std::right << std::setw(12)
+            << "-" << std::setw(12) << "-" << std::setw(12) << "-" << std::fixed << std::setprecision(2) << std::setw(12) << glMs
+            << std::defaultfloat << std::endl;
+
+        MipChain kaiser;
+        for (MipFilter filter : filters)
+        {
+            table << std::left << std::setw(16) << "" << std::setw(20) << mipFilterName(filter) << std::right << std::fixed
+                << std::setprecision(2);
+            MipChain reference;
+            bool same = true;
+            for (int level = ImageKernels::SCALAR; level <= ImageKernels::AVX2; level++)
+            {
+                if (level > supported)
+                {
+                    table << std::setw(12) << "-";
+                    continue;
+                }
+                ImageKernels::setLevel((ImageKernels::Level)level);
+                double best = 1e30;
+                MipChain chain;
+                for (int r = 0; r < runs; r++)
+                {
+                    chain.assign(1, image);
+                    Clock::time_point start = Clock::now();
+                    buildMipChain(chain, MipSettings(filter), &ThreadPool::shared());
+                    best = std::min(best, elapsedMs(start));
+                }
+                table << std::setw(12) << best;
+                if (level == ImageKernels::SCALAR)
+                    reference.swap(chain);
+                else
+                    same = same && sameChains(chain, reference);
+            }
+            ImageKernels::setLevel(supported);
+
+            //createTexture leaves its texture alive, a bench run or two of them is nothing
+            double uploadMs = 1e30;
+            for (int r = 0; r < runs; r++)
+            {
+                Texture2D texture;
+                Clock::time_point start = Clock::now();
+                texture.createTexture(reference);
+                glFinish();
+                uploadMs = std::min(uploadMs, elapsedMs(start));
+            }
+            table << std::setw(12) << uploadMs << std::defaultfloat << "  " << reference.size() << " levels, "
+                << (same ? "same bytes" : "DIFFERENT BYTES") << std::endl;
+            if (filter == MipSettings().filter)
+                kaiser.swap(reference);
+        }
+
+        //What start up does from now on: the chain straight from the cache, nothing filtered or decoded
+        std::remove(MipCache::cacheFilename(filename).c_str());
+        MipChain cached;
+        loadMipChain(filename, cached, MipSettings(), &ThreadPool::shared());
+        double cacheMs = 1e30;
+        for (int r = 0; r < runs; r++)
+        {
+            Clock::time_point start = Clock::now();
+            loadMipChain(filename, cached, MipSettings(), &ThreadPool::shared());
+            cacheMs = std::min(cacheMs, elapsedMs(start));
+        }
+        table << std::left << std::setw(16) << "" << std::setw(20) << "mip cache" << std::right << std::fixed
+            << std::setprecision(2) << std::setw(36) << cacheMs << std::setw(12) << "" << std::defaultfloat << "  read, "
+            << (sameChains(cached, kaiser) ? "same bytes as built" : "DIFFERENT BYTES") << std::endl;
+    }
+
+    //Averaging sRGB bytes darkens: black and white texels must give linear 0.5, sRGB 188, not 128. And texels with
+    //no alpha must not color their neighbours: green next to invisible red stays green
+    Image checker, cutout;
+    checker.width = checker.height = cutout.width = cutout.height = 64;
+    checker.pixels.resize(64 * 64 * 4);
+    cutout.pixels.resize(64 * 64 * 4);
+    for (int y = 0; y < 64; y++)
+    {
+        for (int x = 0; x < 64; x++)
+        {
+            unsigned char* c = &checker.pixels[(y * 64 + x) * 4];
+            c[0] = c[1] = c[2] = (x + y) % 2 ? 255 : 0;
+            c[3] = 255;
+            unsigned char* p = &cutout.pixels[(y * 64 + x) * 4];
+            bool green = x % 2 == 0;
+            p[0] = green ? 0 : 255;
+            p[1] = green ? 255 : 0;
+            p[2] = 0;
+            p[3] = green ? 255 : 0;
+        }
+    }
+    auto texel = [](const unsigned char* p)
+    {
+        std::ostringstream text;
+        text << "(" << (int)p[0] << ", " << (int)p[1] << ", " << (int)p[2] << ", " << (int)p[3] << ")";
+        return text.str();
+    };
+    std::vector<unsigned char> checkerLevel, cutoutLevel;
+    generateMipmap(checker, 1, checkerLevel);
+    generateMipmap(cutout, 1, cutoutLevel);
+    table << "Level 1 texel of a black and white checkerboard / of opaque green next to transparent red" << std::endl;
+    table << std::left << std::setw(36) << "glGenerateMipmap" << std::setw(24) << texel(&checkerLevel[0])
+        << texel(&cutoutLevel[0]) << std::endl;
+    for (MipFilter filter : filters)
+    {
+        MipChain checkerChain(1, checker), cutoutChain(1, cutout);
+        buildMipChain(checkerChain, MipSettings(filter));
+        buildMipChain(cutoutChain, MipSettings(filter));
+        table << std::setw(36) << mipFilterName(filter) << std::setw(24) << texel(&checkerChain[1].pixels[0])
+            << texel(&cutoutChain[1].pixels[0]) << std::endl;
+    }
+    table << std::right;
+
+    std::cout << table.str();
+    destroyBenchContext(window);
+}
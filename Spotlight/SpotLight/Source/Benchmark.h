@@ -0,0 +1,104 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <string>
+
+//----------------------------------------------
+//Command line benchmarks over the assets in bin/
+//Run from the bin folder: SpotLight.exe --bench <name>
+//----------------------------------------------
+
+//Runs the named benchmark. Returns false for unknown names
+bool runBenchmark(const std::string& name);
+
+//Mapped in place OBJ parser vs the original stringstream parser
+void benchmarkOBJLoading();
+
+//Chunked parallel OBJ parser from 1 to N threads, on the bundled files and a generated multi-million triangle grid
+void benchmarkOBJThreads();
+
+//Vertex count and memory of the welded, indexed meshes against one vertex per triangle corner
+void benchmarkIndexing();
+
+//CPU side of Mesh::loadOBJ without a binary cache (parse + weld) and with a valid one (map + validate)
+void benchmarkMeshCache();
+
+//ACMR/ATVR of every bundled mesh in export order, after vertex cache ordering and after the overdraw pass
+void benchmarkMeshOptimizer();
+
+//Size and worst case error of every packed vertex layout against the float vertices
+void benchmarkVertexFormats();
+
+//Triangle count, reported and measured error of every LOD level, determinism, and where the levels switch
+//when walking away from a mesh and back
+void benchmarkLodChain();
+
+//Meshlet sizes, then culling of the three models along a scripted FPSCamera walk: triangles rejected against CPU time
+void benchmarkMeshlets();
+
+//Normals generated for the bundled files with their vn stripped: time and angle error against the originals per
+//weighting, then thread scaling on RubberToy and a generated multi-million triangle grid
+void benchmarkNormals();
+
+//Hidden GL context: load time, per frame upload time, fence latency and the frames until the scene is drawable and
+//complete, for a blocking upload against streaming with several budgets and chunk sizes. Runs on llvmpipe
+void benchmarkStreaming();
+
+//Time until main.cpp's startup meshes and textures are all usable: one after another on the GL thread against
+//AssetLoader with 1 to N workers, with and without mesh caches
+void benchmarkAssetLoading();
+
+//Generated scene of tiled objects with many MTL materials over a few textures: texture binds and uniform changes per
+//frame drawn in submission order against RenderQueue's material order, and frame times next to one draw per object
+void benchmarkMaterials();
+
+//CPU submission cost of 10k objects: a VAO and draw call per Mesh, the shared GeometryArena with one draw each,
+//and the arena in a single glMultiDrawElementsIndirect
+void benchmarkIndirect();
+
+//100k Teapots, then 100k light bulbs, at their coarsest level: a model uniform and draw call each against one
+//Mesh::drawInstanced call. Plus a pixel comparison of both paths and a link check of the instanced ground variant
+void benchmarkInstancing();
+
+//Per-draw data of 10k draws a frame (a mat4 each) through glUniformMatrix4fv, glBufferSubData per draw and per frame,
+//and StreamBuffer with orphaning and persistent mapping: CPU time per frame, throughput, fence waits, read back check
+void benchmarkStreamBuffer();
+
+//Per draw uniform cost, 10k draws of a changing model matrix, a mostly unchanged material color and a sampler: names
+//hashed at run time and at compile time (ShaderUniforms), precomputed handles, the old std::map<string> lookup, and
+//bare glUniform calls for reference
+void benchmarkUniforms();
+
+//Binds per frame of 10k objects drawn the main.cpp way, sorted by program, mesh and texture and interleaved, with
+//GLState's unbind after draw on and off: binds issued to GL, binds skipped, and CPU submission time
+void benchmarkStateCache();
+
+//loadShaders time of Light, Lighting and Ground without the program binary cache, cold (compile and write) and warm
+//(glProgramBinary), plus a pixel comparison of a compiled and a cached program
+void benchmarkShaderCache();
+
+//main.cpp's programs compiled one by one against all started at once and polled: time until all are ready and how
+//much of it the calling thread spends waiting
+void benchmarkShaderCompile();
+
+//ShaderProgram hot reload on an edited copy of Lighting.frag: frames until the new program is in, the worst frame
+//meanwhile, a broken edit keeping the old program, and uniform values carried over
+void benchmarkHotReload();
+
+//main.cpp's shader variants built through ShaderVariantCache: count and build time, the flashlight off variant
+//against the full one on a fill bound frame, and an error in an included file reported against that file
+void benchmarkShaderVariants();
+
+//Shader sources from the files (read, #includes resolved) against the copies embedded at build time: time to get the
+//sources of main.cpp's programs and until they are ready, and whether the embedded copies match the files
+void benchmarkShaderLibrary();
+
+//ImageKernels on a 4096 x 4096 image at every level the CPU has, against the loops they replace: time, bandwidth and
+//whether all levels give the same bytes. Plus the sRGB round trip and Texture2D::decodeImage before and after
+void benchmarkImageKernels();
+
+//CPU mip chains of main.cpp's textures against glGenerateMipmap: build time per filter at every ImageKernels level,
+//GL thread time until the texture is complete, the mip cache, and a gamma and an alpha edge check of level 1
+void benchmarkMips();
+
+#endif
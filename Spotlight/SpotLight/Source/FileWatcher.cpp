@@ -0,0 +1,125 @@
+#include "FileWatcher.h"
+
+#ifdef _WIN32
+#include <filesystem>
+#else
+#include <fcntl.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+namespace
+{
+    long long lastWriteTime(const std::string& filename)
+    {
+        std::error_code error;
+        std::filesystem::file_time_type time = std::filesystem::last_write_time(filename, error);
+        return error ? -1 : (long long)time.time_since_epoch().count();
+    }
+}
+
+FileWatcher::FileWatcher()
+{
+}
+
+FileWatcher::~FileWatcher()
+{
+}
+
+bool FileWatcher::watch(const std::string& filename)
+{
+    WatchedFile file = { filename, lastWriteTime(filename) };
+    mFiles.push_back(file);
+    return true;
+}
+
+void FileWatcher::clear()
+{
+    mFiles.clear();
+}
+
+bool FileWatcher::poll()
+{
+    bool changed = false;
+    for (WatchedFile& file : mFiles)
+    {
+        long long lastWrite = lastWriteTime(file.filename);
+        if (lastWrite != file.lastWrite && lastWrite != -1)
+            changed = true;
+        file.lastWrite = lastWrite;
+    }
+    return changed;
+}
+
+#else
+
+FileWatcher::FileWatcher()
+    :mInotify(inotify_init1(IN_NONBLOCK | IN_CLOEXEC))
+{
+}
+
+FileWatcher::~FileWatcher()
+{
+    if (mInotify >= 0)
+        ::close(mInotify);
+}
+
+bool FileWatcher::watch(const std::string& filename)
+{
+    if (mInotify < 0)
+        return false;
+
+    size_t slash = filename.find_last_of('/');
+    std::string directory = slash == std::string::npos ? "." : filename.substr(0, slash);
+    std::string name = slash == std::string::npos ? filename : filename.substr(slash + 1);
+
+    //Watching a directory again returns its existing descriptor
+    int watch = inotify_add_watch(mInotify, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+    if (watch < 0)
+        return false;
+
+    WatchedFile file = { watch, name };
+    mFiles.push_back(file);
+    return true;
+}
+
+void FileWatcher::clear()
+{
+    for (const WatchedFile& file : mFiles)
+        inotify_rm_watch(mInotify, file.watch); // fails harmlessly for a directory removed already
+    mFiles.clear();
+}
+
+bool FileWatcher::poll()
+{
+    if (mInotify < 0)
+        return false;
+
+    //Drain everything queued, an editor's save is often several events
+    bool changed = false;
+    alignas(inotify_event) char buffer[4096];
+    for (;;)
+    {
+        ssize_t length = read(mInotify, buffer, sizeof(buffer));
+        if (length <= 0)
+            break;
+
+        for (char* next = buffer; next < buffer + length; )
+        {
+            const inotify_event* event = (const inotify_event*)next;
+            next += sizeof(inotify_event) + event->len;
+            if (event->len == 0)
+                continue;
+            for (const WatchedFile& file : mFiles)
+            {
+                if (file.watch == event->wd && file.name == event->name)
+                    changed = true;
+            }
+        }
+    }
+    return changed;
+}
+
+#endif
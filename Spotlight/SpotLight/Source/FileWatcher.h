@@ -0,0 +1,48 @@
+#ifndef FILE_WATCHER_H
+#define FILE_WATCHER_H
+
+#include <string>
+#include <vector>
+
+//----------------------------------------------
+//Tells when any of a few files was written since the last poll, without blocking.
+//Linux: inotify on the files' directories, so files that editors replace (write a new file, rename it over the old
+//one) keep being watched. Windows: the files' last write times, compared on every poll
+//----------------------------------------------
+class FileWatcher
+{
+public:
+    FileWatcher();
+    ~FileWatcher();
+
+    //False when the file's directory can't be watched
+    bool watch(const std::string& filename);
+    void clear();
+
+    //True when a watched file was written, created or renamed into place since the last call
+    bool poll();
+
+private:
+    //Owns an inotify descriptor, so it can't be copied
+    FileWatcher(const FileWatcher&);
+    FileWatcher& operator=(const FileWatcher&);
+
+#ifdef _WIN32
+    struct WatchedFile
+    {
+        std::string filename;
+        long long lastWrite; // std::filesystem::file_time_type ticks, -1 while the file is missing
+    };
+    std::vector<WatchedFile> mFiles;
+#else
+    struct WatchedFile
+    {
+        int watch; // inotify watch descriptor of the directory, shared by the files in it
+        std::string name; // without the directory, as inotify reports it
+    };
+    int mInotify; // -1 when inotify isn't available
+    std::vector<WatchedFile> mFiles;
+#endif
+};
+
+#endif
@@ -0,0 +1,192 @@
+#include "GLState.h"
+
+namespace
+{
+    const GLuint MAX_TRACKED_UNITS = 32;
+    const GLenum TEXTURE_TARGETS[] = { GL_TEXTURE_2D, GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BUFFER };
+    const int NUM_TEXTURE_TARGETS = 3;
+    const GLenum BUFFER_TARGETS[] = { GL_ARRAY_BUFFER, GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, GL_DRAW_INDIRECT_BUFFER, GL_TEXTURE_BUFFER };
+    const int NUM_BUFFER_TARGETS = 5;
+
+    struct Bindings
+    {
+        GLuint program;
+        GLuint activeUnit;
+        GLuint textures[MAX_TRACKED_UNITS][NUM_TEXTURE_TARGETS];
+        GLuint vertexArray;
+        GLuint buffers[NUM_BUFFER_TARGETS];
+    };
+
+    //Zero initialized, which is what a new context starts with
+    Bindings gBindings;
+    GLStateStats gStats;
+    bool gUnbindAfterDraw = true;
+
+    int textureTargetIndex(GLenum target)
+    {
+        for (int i = 0; i < NUM_TEXTURE_TARGETS; i++)
+        {
+            if (TEXTURE_TARGETS[i] == target)
+                return i;
+        }
+        return -1;
+    }
+
+    int bufferTargetIndex(GLenum target)
+    {
+        for (int i = 0; i < NUM_BUFFER_TARGETS; i++)
+        {
+            if (BUFFER_TARGETS[i] == target)
+                return i;
+        }
+        return -1;
+    }
+}
+
+void GLState::useProgram(GLuint program)
+{
+    if (program == gBindings.program)
+    {
+        gStats.programSkips++;
+        return;
+    }
+    glUseProgram(program);
+    gBindings.program = program;
+    gStats.programBinds++;
+}
+
+void GLState::bindTexture(GLuint unit, GLenum target, GLuint texture)
+{
+    //Untracked units and targets go straight through, and leave the active unit unknown
+    int targetIndex = textureTargetIndex(target);
+    if (unit >= MAX_TRACKED_UNITS || targetIndex < 0)
+    {
+        glActiveTexture(GL_TEXTURE0 + unit);
+        glBindTexture(target, texture);
+        gBindings.activeUnit = ~0u;
+        gStats.textureBinds += 2;
+        return;
+    }
+
+    GLuint& bound = gBindings.textures[unit][targetIndex];
+    if (bound == texture)
+    {
+        gStats.textureSkips++;
+        return;
+    }
+    if (gBindings.activeUnit != unit)
+    {
+        glActiveTexture(GL_TEXTURE0 + unit);
+        gBindings.activeUnit = unit;
+        gStats.textureBinds++;
+    }
+    glBindTexture(target, texture);
+    bound = texture;
+    gStats.textureBinds++;
+}
+
+void GLState::bindVertexArray(GLuint vertexArray)
+{
+    if (vertexArray == gBindings.vertexArray)
+    {
+        gStats.vertexArraySkips++;
+        return;
+    }
+    glBindVertexArray(vertexArray);
+    gBindings.vertexArray = vertexArray;
+    gStats.vertexArrayBinds++;
+}
+
+void GLState::bindBuffer(GLenum target, GLuint buffer)
+{
+    int targetIndex = bufferTargetIndex(target);
+    if (targetIndex < 0)
+    {
+        glBindBuffer(target, buffer);
+        gStats.bufferBinds++;
+        return;
+    }
+    if (gBindings.buffers[targetIndex] == buffer)
+    {
+        gStats.bufferSkips++;
+        return;
+    }
+    glBindBuffer(target, buffer);
+    gBindings.buffers[targetIndex] = buffer;
+    gStats.bufferBinds++;
+}
+
+void GLState::deleteProgram(GLuint program)
+{
+    //A program in use stays current until another one is, GL only deletes it then. Forgetting it here makes the next
+    //useProgram of a reused name go through
+    if (program != 0 && program == gBindings.program)
+        gBindings.program = ~0u;
+    glDeleteProgram(program);
+}
+
+void GLState::deleteTextures(GLsizei count, const GLuint* textures)
+{
+    for (GLsizei i = 0; i < count; i++)
+    {
+        if (textures[i] == 0)
+            continue;
+        for (GLuint unit = 0; unit < MAX_TRACKED_UNITS; unit++)
+        {
+            for (int target = 0; target < NUM_TEXTURE_TARGETS; target++)
+            {
+                if (gBindings.textures[unit][target] == textures[i])
+                    gBindings.textures[unit][target] = 0;
+            }
+        }
+    }
+    glDeleteTextures(count, textures);
+}
+
+void GLState::deleteVertexArrays(GLsizei count, const GLuint* vertexArrays)
+{
+    for (GLsizei i = 0; i < count; i++)
+    {
+        if (vertexArrays[i] != 0 && vertexArrays[i] == gBindings.vertexArray)
+            gBindings.vertexArray = 0;
+    }
+    glDeleteVertexArrays(count, vertexArrays);
+}
+
+void GLState::deleteBuffers(GLsizei count, const GLuint* buffers)
+{
+    for (GLsizei i = 0; i < count; i++)
+    {
+        for (int target = 0; target < NUM_BUFFER_TARGETS; target++)
+        {
+            if (buffers[i] != 0 && gBindings.buffers[target] == buffers[i])
+                gBindings.buffers[target] = 0;
+        }
+    }
+    glDeleteBuffers(count, buffers);
+}
+
+void GLState::reset()
+{
+    gBindings = Bindings();
+}
+
+void GLState::setUnbindAfterDraw(bool enabled)
+{
+    gUnbindAfterDraw = enabled;
+}
+
+bool GLState::unbindAfterDraw()
+{
+    return gUnbindAfterDraw;
+}
+
+const GLStateStats& GLState::getStats()
+{
+    return gStats;
+}
+
+void GLState::resetStats()
+{
+    gStats = GLStateStats();
+}
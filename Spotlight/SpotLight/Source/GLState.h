@@ -0,0 +1,51 @@
+#ifndef GL_STATE_H
+#define GL_STATE_H
+
+#include <cstddef>
+
+#include "GL/glew.h"
+
+//Binds issued to GL and binds dropped because the object was already bound, since the last resetStats
+struct GLStateStats
+{
+    size_t programBinds, programSkips;
+    size_t textureBinds, textureSkips; // glActiveTexture counts as a bind
+    size_t vertexArrayBinds, vertexArraySkips;
+    size_t bufferBinds, bufferSkips;
+};
+
+//----------------------------------------------
+//Shadow of the current context's bindings: program, texture per unit (2D, 2D array and buffer targets), vertex array,
+//and the buffer targets that aren't vertex array state (array, copy read/write, draw indirect, texture buffer).
+//Binding what is already bound costs a compare instead of a GL call.
+//Every bind and delete of those objects in the program goes through here, a direct glBind* or glDelete* would leave the
+//shadow wrong. GL_ELEMENT_ARRAY_BUFFER belongs to the bound VAO and isn't tracked, neither are indexed buffer bindings.
+//One GL context at a time, on its thread; reset() after making another context current
+//----------------------------------------------
+class GLState
+{
+public:
+    static void useProgram(GLuint program);
+    static void bindTexture(GLuint unit, GLenum target, GLuint texture);
+    static void bindVertexArray(GLuint vertexArray);
+    static void bindBuffer(GLenum target, GLuint buffer);
+
+    //Delete and forget, GL reuses the names
+    static void deleteProgram(GLuint program);
+    static void deleteTextures(GLsizei count, const GLuint* textures);
+    static void deleteVertexArrays(GLsizei count, const GLuint* vertexArrays);
+    static void deleteBuffers(GLsizei count, const GLuint* buffers);
+
+    //Back to a fresh context: nothing bound, unit 0 active
+    static void reset();
+
+    //On (the default): meshes unbind their VAO after drawing and Texture2D::unbindTexture unbinds, as before.
+    //Off: both leave things bound for the next draw to replace, or keep when it is the same
+    static void setUnbindAfterDraw(bool enabled);
+    static bool unbindAfterDraw();
+
+    static const GLStateStats& getStats();
+    static void resetStats();
+};
+
+#endif
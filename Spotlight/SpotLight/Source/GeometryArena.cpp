@@ -0,0 +1,128 @@
+#include "GeometryArena.h"
+#include "GLState.h"
+#include <algorithm>
+
+FreeListAllocator::FreeListAllocator(size_t capacity)
+    :mCapacity(capacity),
+    mFreeSpace(capacity)
+{
+    if (capacity > 0)
+        mFree[0] = capacity;
+}
+
+bool FreeListAllocator::allocate(size_t size, size_t& offset)
+{
+    if (size == 0)
+    {
+        offset = 0;
+        return true;
+    }
+
+    for (std::map<size_t, size_t>::iterator it = mFree.begin(); it != mFree.end(); ++it)
+    {
+        if (it->second < size)
+            continue;
+
+        //Take the front of the block, what is left stays free
+        offset = it->first;
+        size_t left = it->second - size;
+        mFree.erase(it);
+        if (left > 0)
+            mFree[offset + size] = left;
+        mFreeSpace -= size;
+        return true;
+    }
+    return false;
+}
+
+void FreeListAllocator::free(size_t offset, size_t size)
+{
+    if (size == 0)
+        return;
+    mFreeSpace += size;
+
+    //Merge with the free block right after, then with the one right before
+    std::map<size_t, size_t>::iterator next = mFree.lower_bound(offset);
+    if (next != mFree.end() && offset + size == next->first)
+    {
+        size += next->second;
+        next = mFree.erase(next);
+    }
+    if (next != mFree.begin())
+    {
+        std::map<size_t, size_t>::iterator previous = std::prev(next);
+        if (previous->first + previous->second == offset)
+        {
+            previous->second += size;
+            return;
+        }
+    }
+    mFree[offset] = size;
+}
+
+size_t FreeListAllocator::largestFree() const
+{
+    size_t largest = 0;
+    for (const std::pair<const size_t, size_t>& block : mFree)
+        largest = std::max(largest, block.second);
+    return largest;
+}
+
+GeometryArena::GeometryArena(size_t maxVertices, size_t maxIndices, const VertexFormat& format)
+    :mFormat(format),
+    mStride(0),
+    mVertices(maxVertices),
+    mIndices(maxIndices),
+    mVBO(0),
+    mEBO(0),
+    mVAO(0)
+{
+    VertexLayout layout = getVertexLayout(mFormat);
+    mStride = layout.stride;
+
+    //Storage only, every mesh uploads its own range
+    glGenBuffers(1, &mVBO);
+    GLState::bindBuffer(GL_ARRAY_BUFFER, mVBO);
+    glBufferData(GL_ARRAY_BUFFER, maxVertices * layout.stride, NULL, GL_STATIC_DRAW);
+
+    glGenVertexArrays(1, &mVAO);
+    GLState::bindVertexArray(mVAO);
+    setVertexAttributes(layout);
+
+    glGenBuffers(1, &mEBO);
+    GLState::bindBuffer(GL_ELEMENT_ARRAY_BUFFER, mEBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, maxIndices * sizeof(GLuint), NULL, GL_STATIC_DRAW);
+
+    GLState::bindVertexArray(0);
+}
+
+GeometryArena::~GeometryArena()
+{
+    GLState::deleteVertexArrays(1, &mVAO);
+    GLState::deleteBuffers(1, &mVBO);
+    GLState::deleteBuffers(1, &mEBO);
+}
+
+bool GeometryArena::allocate(size_t numVertices, size_t numIndices, ArenaAllocation& allocation)
+{
+    size_t firstVertex, firstIndex;
+    if (!mVertices.allocate(numVertices, firstVertex))
+        return false;
+    if (!mIndices.allocate(numIndices, firstIndex))
+    {
+        mVertices.free(firstVertex, numVertices);
+        return false;
+    }
+
+    allocation.firstVertex = (GLuint)firstVertex;
+    allocation.numVertices = (GLuint)numVertices;
+    allocation.firstIndex = (GLuint)firstIndex;
+    allocation.numIndices = (GLuint)numIndices;
+    return true;
+}
+
+void GeometryArena::free(const ArenaAllocation& allocation)
+{
+    mVertices.free(allocation.firstVertex, allocation.numVertices);
+    mIndices.free(allocation.firstIndex, allocation.numIndices);
+}
@@ -0,0 +1,75 @@
+#ifndef GEOMETRY_ARENA_H
+#define GEOMETRY_ARENA_H
+
+#include <map>
+
+#include "GL/glew.h"
+#include "VertexFormat.h"
+
+//First fit free list over [0, capacity) in whatever unit the caller counts. Freed blocks merge with free neighbours,
+//so the list stays as short as the fragmentation allows
+class FreeListAllocator
+{
+public:
+    explicit FreeListAllocator(size_t capacity = 0);
+
+    //Returns false when no free block is large enough
+    bool allocate(size_t size, size_t& offset);
+    void free(size_t offset, size_t size);
+
+    size_t capacity() const { return mCapacity; }
+    size_t freeSpace() const { return mFreeSpace; }
+    size_t largestFree() const;
+    size_t numFreeBlocks() const { return mFree.size(); }
+
+private:
+    size_t mCapacity;
+    size_t mFreeSpace;
+    std::map<size_t, size_t> mFree; // offset -> size, never two touching blocks
+};
+
+//Where a mesh lives in the arena, in vertices and indices
+struct ArenaAllocation
+{
+    GLuint firstVertex; // base vertex, the mesh's indices stay relative to its own vertices
+    GLuint numVertices;
+    GLuint firstIndex;
+    GLuint numIndices;
+};
+
+//----------------------------------------------
+//One vertex buffer, one index buffer and one VAO shared by every mesh created in it (Mesh::create with an arena).
+//Meshes suballocate ranges through free lists and draw with a base vertex, so switching meshes changes no GL state
+//and a whole pass can go out as one glMultiDrawElementsIndirect (see IndirectRenderer.h).
+//The buffers are sized once: a mesh that doesn't fit gets its own buffers instead.
+//Every mesh in an arena uses the arena's vertex format
+//----------------------------------------------
+class GeometryArena
+{
+public:
+    //Needs the GL context
+    GeometryArena(size_t maxVertices, size_t maxIndices, const VertexFormat& format = VertexFormat());
+    ~GeometryArena();
+
+    bool allocate(size_t numVertices, size_t numIndices, ArenaAllocation& allocation);
+    void free(const ArenaAllocation& allocation);
+
+    const VertexFormat& getFormat() const { return mFormat; }
+    GLsizei getStride() const { return mStride; }
+    GLuint getVertexArray() const { return mVAO; }
+    GLuint getVertexBuffer() const { return mVBO; }
+    GLuint getIndexBuffer() const { return mEBO; }
+    const FreeListAllocator& getVertices() const { return mVertices; }
+    const FreeListAllocator& getIndices() const { return mIndices; }
+
+private:
+    GeometryArena(const GeometryArena&);
+    GeometryArena& operator=(const GeometryArena&);
+
+    VertexFormat mFormat;
+    GLsizei mStride;
+    FreeListAllocator mVertices, mIndices;
+    GLuint mVBO, mEBO, mVAO;
+};
+
+#endif
@@ -0,0 +1,38 @@
+#ifndef HASH_H
+#define HASH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+//64-bit FNV-1a, eight bytes per step. Used to key caches by their source data, not for security
+inline uint64_t hashBytes(const void* data, size_t size, uint64_t seed = 14695981039346656037ull)
+{
+    const uint64_t PRIME = 1099511628211ull;
+    const unsigned char* bytes = (const unsigned char*)data;
+    uint64_t hash = seed;
+
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8)
+    {
+        uint64_t word;
+        memcpy(&word, bytes + i, 8);
+        hash = (hash ^ word) * PRIME;
+        hash ^= hash >> 32; // Fold the high bits back in, the multiply only carries upwards
+    }
+    for (; i < size; i++)
+        hash = (hash ^ bytes[i]) * PRIME;
+
+    return hash;
+}
+
+//32-bit FNV-1a of a zero terminated string. constexpr, so names known at compile time cost nothing at run time
+constexpr uint32_t hashString(const char* text)
+{
+    uint32_t hash = 2166136261u;
+    for (; *text != 0; text++)
+        hash = (hash ^ (unsigned char)*text) * 16777619u;
+    return hash;
+}
+
+#endif
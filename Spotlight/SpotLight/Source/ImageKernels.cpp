@@ -0,0 +1,622 @@
+#include "ImageKernels.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define IMAGE_KERNELS_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+//MSVC compiles the intrinsics of any level anywhere, GCC and Clang only in functions marked for them
+#define SSE2_TARGET
+#define AVX2_TARGET
+#else
+#define SSE2_TARGET __attribute__((target("sse2")))
+#define AVX2_TARGET __attribute__((target("avx2")))
+#endif
+#endif
+
+namespace
+{
+    ImageKernels::Level detectLevel()
+    {
+#if !defined(IMAGE_KERNELS_X86)
+        return ImageKernels::SCALAR;
+#elif defined(_MSC_VER)
+        int info[4];
+        __cpuid(info, 0);
+        int maxLeaf = info[0];
+        __cpuid(info, 1);
+        bool sse2 = (info[3] & (1 << 26)) != 0;
+        //AVX also needs the OS to save the YMM registers: OSXSAVE, then XCR0 bits 1 and 2
+        bool avx = (info[2] & (1 << 28)) != 0 && (info[2] & (1 << 27)) != 0 && (_xgetbv(0) & 6) == 6;
+        bool avx2 = false;
+        if (avx && maxLeaf >= 7)
+        {
+            __cpuidex(info, 7, 0);
+            avx2 = (info[1] & (1 << 5)) != 0;
+        }
+        return avx2 ? ImageKernels::AVX2 : sse2 ? ImageKernels::SSE2 : ImageKernels::SCALAR;
+#else
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2"))
+            return ImageKernels::AVX2;
+        return __builtin_cpu_supports("sse2") ? ImageKernels::SSE2 : ImageKernels::SCALAR;
+#endif
+    }
+
+    ImageKernels::Level& currentLevel()
+    {
+        static ImageKernels::Level level = ImageKernels::getSupportedLevel();
+        return level;
+    }
+
+    struct Tables
+    {
+        //[0, 256): sRGB byte to linear, [256, 512): alpha byte to a / 255. One table so AVX2 gathers both at once
+        float toLinear[512];
+        //Linear value times LINEAR_TO_SRGB_STEPS, rounded, to sRGB byte. Padded, AVX2 gathers 4 bytes at a time
+        unsigned char toSrgb[ImageKernels::LINEAR_TO_SRGB_STEPS + 4];
+    };
+
+    const Tables& tables()
+    {
+        static Tables tables = []()
+        {
+            Tables t = {};
+            for (int i = 0; i < 256; i++)
+            {
+                double c = i / 255.0;
+                t.toLinear[i] = (float)(c <= 0.04045 ? c / 12.92 : std::pow((c + 0.055) / 1.055, 2.4));
+                t.toLinear[256 + i] = (float)c;
+            }
+            for (int i = 0; i <= ImageKernels::LINEAR_TO_SRGB_STEPS; i++)
+            {
+                double x = (double)i / ImageKernels::LINEAR_TO_SRGB_STEPS;
+                double c = x <= 0.0031308 ? x * 12.92 : 1.055 * std::pow(x, 1.0 / 2.4) - 0.055;
+                t.toSrgb[i] = (unsigned char)(c * 255.0 + 0.5);
+            }
+            return t;
+        }();
+        return tables;
+    }
+
+    //Scalar versions. The vector ones do their tails with these, from pixel first on
+
+    void flipRowsScalar(unsigned char* top, unsigned char* bottom, size_t bytes)
+    {
+        std::swap_ranges(top, top + bytes, bottom);
+    }
+
+    void rgbToRgbaScalar(const unsigned char* in, unsigned char* out, size_t first, size_t count, unsigned char alpha)
+    {
+        for (size_t i = first; i < count; i++)
+        {
+            out[i * 4 + 0] = in[i * 3 + 0];
+            out[i * 4 + 1] = in[i * 3 + 1];
+            out[i * 4 + 2] = in[i * 3 + 2];
+            out[i * 4 + 3] = alpha;
+        }
+    }
+
+    void premultiplyAlphaScalar(unsigned char* rgba, size_t first, size_t count)
+    {
+        for (size_t i = first; i < count; i++)
+        {
+            unsigned char* pixel = rgba + i * 4;
+            for (int c = 0; c < 3; c++)
+            {
+                unsigned int t = pixel[c] * pixel[3] + 128;
+                pixel[c] = (unsigned char)((t + (t >> 8)) >> 8); // c * a / 255, rounded, without a division
+            }
+        }
+    }
+
+    void srgbToLinearScalar(const unsigned char* in, float* out, size_t first, size_t count)
+    {
+        const float* toLinear = tables().toLinear;
+        for (size_t i = first; i < count; i++)
+        {
+            out[i * 4 + 0] = toLinear[in[i * 4 + 0]];
+            out[i * 4 + 1] = toLinear[in[i * 4 + 1]];
+            out[i * 4 + 2] = toLinear[in[i * 4 + 2]];
+            out[i * 4 + 3] = toLinear[256 + in[i * 4 + 3]];
+        }
+    }
+
+    //The vector versions do the same float operations: NaN and negatives to 0, then scale, + 0.5, truncate
+    inline int toSteps(float x, float scale)
+    {
+        x = x > 0.0f ? x : 0.0f;
+        x = x < 1.0f ? x : 1.0f;
+        return (int)(x * scale + 0.5f);
+    }
+
+    void linearToSrgbScalar(const float* in, unsigned char* out, size_t first, size_t count)
+    {
+        const unsigned char* toSrgb = tables().toSrgb;
+        const float steps = (float)ImageKernels::LINEAR_TO_SRGB_STEPS;
+        for (size_t i = first; i < count; i++)
+        {
+            out[i * 4 + 0] = toSrgb[toSteps(in[i * 4 + 0], steps)];
+            out[i * 4 + 1] = toSrgb[toSteps(in[i * 4 + 1], steps)];
+            out[i * 4 + 2] = toSrgb[toSteps(in[i * 4 + 2], steps)];
+            out[i * 4 + 3] = (unsigned char)toSteps(in[i * 4 + 3], 255.0f);
+        }
+    }
+
+    void swizzleScalar(const unsigned char* in, unsigned char* out, size_t first, size_t count, const int order[4])
+    {
+        for (size_t i = first; i < count; i++)
+        {
+            unsigned char pixel[4] = { in[i * 4 + 0], in[i * 4 + 1], in[i * 4 + 2], in[i * 4 + 3] };
+            for (int c = 0; c < 4; c++)
+                out[i * 4 + c] = pixel[order[c]];
+        }
+    }
+
+    //Every version starts a sum with the first product and adds the others in order, so all give the same floats
+
+    void sumRowsScalar(const float* const* rows, const float* weights, size_t numRows, float* out, size_t first, size_t count)
+    {
+        for (size_t i = first; i < count; i++)
+        {
+            float sum = weights[0] * rows[0][i];
+            for (size_t r = 1; r < numRows; r++)
+                sum += weights[r] * rows[r][i];
+            out[i] = sum;
+        }
+    }
+
+    void sumPixelsScalar(const float* in, const int* indices, const float* weights, size_t numTaps, float* out, size_t first,
+        size_t count)
+    {
+        for (size_t i = first; i < count; i++)
+        {
+            const int* pixelIndices = indices + i * numTaps;
+            const float* pixelWeights = weights + i * numTaps;
+            for (int c = 0; c < 4; c++)
+            {
+                float sum = pixelWeights[0] * in[pixelIndices[0] * 4 + c];
+                for (size_t t = 1; t < numTaps; t++)
+                    sum += pixelWeights[t] * in[pixelIndices[t] * 4 + c];
+                out[i * 4 + c] = sum;
+            }
+        }
+    }
+
+#ifdef IMAGE_KERNELS_X86
+    //----------------------------------------------
+    //SSE2, 16 bytes at a time
+    //----------------------------------------------
+
+    SSE2_TARGET void flipRowsSSE2(unsigned char* top, unsigned char* bottom, size_t bytes)
+    {
+        size_t i = 0;
+        for (; i + 16 <= bytes; i += 16)
+        {
+            __m128i a = _mm_loadu_si128((const __m128i*)(top + i));
+            __m128i b = _mm_loadu_si128((const __m128i*)(bottom + i));
+            _mm_storeu_si128((__m128i*)(top + i), b);
+            _mm_storeu_si128((__m128i*)(bottom + i), a);
+        }
+        flipRowsScalar(top + i, bottom + i, bytes - i);
+    }
+
+    //The low 12 bytes, 4 RGB pixels, spread to 4 RGBA pixels. Without a byte shuffle: pixel k moves up k bytes
+    //with the whole register, then its 3 bytes are masked out of dword k
+    SSE2_TARGET inline __m128i expandRgbSSE2(__m128i rgb, __m128i alpha)
+    {
+        const __m128i mask0 = _mm_setr_epi32(0x00FFFFFF, 0, 0, 0);
+        const __m128i mask1 = _mm_setr_epi32(0, 0x00FFFFFF, 0, 0);
+        const __m128i mask2 = _mm_setr_epi32(0, 0, 0x00FFFFFF, 0);
+        const __m128i mask3 = _mm_setr_epi32(0, 0, 0, 0x00FFFFFF);
+        __m128i result = _mm_or_si128(_mm_and_si128(rgb, mask0), _mm_and_si128(_mm_slli_si128(rgb, 1), mask1));
+        result = _mm_or_si128(result, _mm_and_si128(_mm_slli_si128(rgb, 2), mask2));
+        result = _mm_or_si128(result, _mm_and_si128(_mm_slli_si128(rgb, 3), mask3));
+        return _mm_or_si128(result, alpha);
+    }
+
+    SSE2_TARGET void rgbToRgbaSSE2(const unsigned char* in, unsigned char* out, size_t count, unsigned char alpha)
+    {
+        const __m128i alphaBytes = _mm_set1_epi32((int)((unsigned int)alpha << 24));
+        size_t i = 0;
+        //16 pixels are exactly 3 registers of RGB
+        for (; i + 16 <= count; i += 16)
+        {
+            __m128i a = _mm_loadu_si128((const __m128i*)(in + i * 3));
+            __m128i b = _mm_loadu_si128((const __m128i*)(in + i * 3 + 16));
+            __m128i c = _mm_loadu_si128((const __m128i*)(in + i * 3 + 32));
+            __m128i pixels4 = _mm_or_si128(_mm_srli_si128(a, 12), _mm_slli_si128(b, 4));
+            __m128i pixels8 = _mm_or_si128(_mm_srli_si128(b, 8), _mm_slli_si128(c, 8));
+            __m128i pixels12 = _mm_srli_si128(c, 4);
+            _mm_storeu_si128((__m128i*)(out + i * 4), expandRgbSSE2(a, alphaBytes));
+            _mm_storeu_si128((__m128i*)(out + i * 4 + 16), expandRgbSSE2(pixels4, alphaBytes));
+            _mm_storeu_si128((__m128i*)(out + i * 4 + 32), expandRgbSSE2(pixels8, alphaBytes));
+            _mm_storeu_si128((__m128i*)(out + i * 4 + 48), expandRgbSSE2(pixels12, alphaBytes));
+        }
+        rgbToRgbaScalar(in, out, i, count, alpha);
+    }
+
+    //8 channels in 16-bit lanes times their pixel's alpha, alpha itself times 255
+    SSE2_TARGET inline __m128i premultiplyWordsSSE2(__m128i words)
+    {
+        const __m128i alphaLanes = _mm_setr_epi16(0, 0, 0, -1, 0, 0, 0, -1);
+        const __m128i ones = _mm_set1_epi16(255);
+        const __m128i half = _mm_set1_epi16(128);
+        __m128i alpha = _mm_shufflehi_epi16(_mm_shufflelo_epi16(words, 0xFF), 0xFF);
+        alpha = _mm_or_si128(_mm_andnot_si128(alphaLanes, alpha), _mm_and_si128(alphaLanes, ones));
+        __m128i t = _mm_add_epi16(_mm_mullo_epi16(words, alpha), half);
+        return _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+    }
+
+    SSE2_TARGET void premultiplyAlphaSSE2(unsigned char* rgba, size_t count)
+    {
+        const __m128i zero = _mm_setzero_si128();
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4)
+        {
+            __m128i pixels = _mm_loadu_si128((const __m128i*)(rgba + i * 4));
+            __m128i low = premultiplyWordsSSE2(_mm_unpacklo_epi8(pixels, zero));
+            __m128i high = premultiplyWordsSSE2(_mm_unpackhi_epi8(pixels, zero));
+            _mm_storeu_si128((__m128i*)(rgba + i * 4), _mm_packus_epi16(low, high));
+        }
+        premultiplyAlphaScalar(rgba, i, count);
+    }
+
+    //No gather below AVX2: the scaling is vector work, the table lookups are not
+    SSE2_TARGET void linearToSrgbSSE2(const float* in, unsigned char* out, size_t count)
+    {
+        const unsigned char* toSrgb = tables().toSrgb;
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 one = _mm_set1_ps(1.0f);
+        const __m128 half = _mm_set1_ps(0.5f);
+        const __m128 scale = _mm_setr_ps((float)ImageKernels::LINEAR_TO_SRGB_STEPS, (float)ImageKernels::LINEAR_TO_SRGB_STEPS,
+            (float)ImageKernels::LINEAR_TO_SRGB_STEPS, 255.0f);
+        alignas(16) int32_t steps[4];
+        for (size_t i = 0; i < count; i++)
+        {
+            __m128 x = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(in + i * 4), zero), one); // max first turns NaN into 0
+            _mm_store_si128((__m128i*)steps, _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(x, scale), half)));
+            out[i * 4 + 0] = toSrgb[steps[0]];
+            out[i * 4 + 1] = toSrgb[steps[1]];
+            out[i * 4 + 2] = toSrgb[steps[2]];
+            out[i * 4 + 3] = (unsigned char)steps[3];
+        }
+    }
+
+    //Bit shifts by a count in a register: the channel order is only known at run time
+    SSE2_TARGET void swizzleSSE2(const unsigned char* in, unsigned char* out, size_t count, const int order[4])
+    {
+        const __m128i lowByte = _mm_set1_epi32(0xFF);
+        __m128i from[4], to[4];
+        for (int c = 0; c < 4; c++)
+        {
+            from[c] = _mm_cvtsi32_si128(order[c] * 8);
+            to[c] = _mm_cvtsi32_si128(c * 8);
+        }
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4)
+        {
+            __m128i pixels = _mm_loadu_si128((const __m128i*)(in + i * 4));
+            __m128i result = _mm_setzero_si128();
+            for (int c = 0; c < 4; c++)
+                result = _mm_or_si128(result, _mm_sll_epi32(_mm_and_si128(_mm_srl_epi32(pixels, from[c]), lowByte), to[c]));
+            _mm_storeu_si128((__m128i*)(out + i * 4), result);
+        }
+        swizzleScalar(in, out, i, count, order);
+    }
+
+    SSE2_TARGET void sumRowsSSE2(const float* const* rows, const float* weights, size_t numRows, float* out, size_t count)
+    {
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4)
+        {
+            __m128 sum = _mm_mul_ps(_mm_set1_ps(weights[0]), _mm_loadu_ps(rows[0] + i));
+            for (size_t r = 1; r < numRows; r++)
+                sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(weights[r]), _mm_loadu_ps(rows[r] + i)));
+            _mm_storeu_ps(out + i, sum);
+        }
+        sumRowsScalar(rows, weights, numRows, out, i, count);
+    }
+
+    //A pixel is one register
+    SSE2_TARGET void sumPixelsSSE2(const float* in, const int* indices, const float* weights, size_t numTaps, float* out,
+        size_t count)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            const int* pixelIndices = indices + i * numTaps;
+            const float* pixelWeights = weights + i * numTaps;
+            __m128 sum = _mm_mul_ps(_mm_set1_ps(pixelWeights[0]), _mm_loadu_ps(in + pixelIndices[0] * 4));
+            for (size_t t = 1; t < numTaps; t++)
+                sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(pixelWeights[t]), _mm_loadu_ps(in + pixelIndices[t] * 4)));
+            _mm_storeu_ps(out + i * 4, sum);
+        }
+    }
+
+    //----------------------------------------------
+    //AVX2, 32 bytes at a time
+    //----------------------------------------------
+
+    AVX2_TARGET void flipRowsAVX2(unsigned char* top, unsigned char* bottom, size_t bytes)
+    {
+        size_t i = 0;
+        for (; i + 32 <= bytes; i += 32)
+        {
+            __m256i a = _mm256_loadu_si256((const __m256i*)(top + i));
+            __m256i b = _mm256_loadu_si256((const __m256i*)(bottom + i));
+            _mm256_storeu_si256((__m256i*)(top + i), b);
+            _mm256_storeu_si256((__m256i*)(bottom + i), a);
+        }
+        flipRowsScalar(top + i, bottom + i, bytes - i);
+    }
+
+    AVX2_TARGET void rgbToRgbaAVX2(const unsigned char* in, unsigned char* out, size_t count, unsigned char alpha)
+    {
+        //Each 128-bit half gets 4 pixels in its low 12 bytes, the shuffle spreads them and zeroes the alpha bytes
+        const __m256i spread = _mm256_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1,
+            0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+        const __m256i alphaBytes = _mm256_set1_epi32((int)((unsigned int)alpha << 24));
+        size_t i = 0;
+        //The second half loads 16 bytes from pixel 4 on: 4 bytes past these 8 pixels have to be there
+        for (; (i + 8) * 3 + 4 <= count * 3; i += 8)
+        {
+            __m128i low = _mm_loadu_si128((const __m128i*)(in + i * 3));
+            __m128i high = _mm_loadu_si128((const __m128i*)(in + i * 3 + 12));
+            __m256i rgb = _mm256_inserti128_si256(_mm256_castsi128_si256(low), high, 1);
+            __m256i rgba = _mm256_or_si256(_mm256_shuffle_epi8(rgb, spread), alphaBytes);
+            _mm256_storeu_si256((__m256i*)(out + i * 4), rgba);
+        }
+        rgbToRgbaScalar(in, out, i, count, alpha);
+    }
+
+    AVX2_TARGET inline __m256i premultiplyWordsAVX2(__m256i words)
+    {
+        const __m256i alphaLanes = _mm256_setr_epi16(0, 0, 0, -1, 0, 0, 0, -1, 0, 0, 0, -1, 0, 0, 0, -1);
+        const __m256i ones = _mm256_set1_epi16(255);
+        const __m256i half = _mm256_set1_epi16(128);
+        __m256i alpha = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(words, 0xFF), 0xFF);
+        alpha = _mm256_blendv_epi8(alpha, ones, alphaLanes);
+        __m256i t = _mm256_add_epi16(_mm256_mullo_epi16(words, alpha), half);
+        return _mm256_srli_epi16(_mm256_add_epi16(t, _mm256_srli_epi16(t, 8)), 8);
+    }
+
+    AVX2_TARGET void premultiplyAlphaAVX2(unsigned char* rgba, size_t count)
+    {
+        const __m256i zero = _mm256_setzero_si256();
+        size_t i = 0;
+        for (; i + 8 <= count; i += 8)
+        {
+            //Unpack and pack both work within 128-bit halves, so the pixels come back in order
+            __m256i pixels = _mm256_loadu_si256((const __m256i*)(rgba + i * 4));
+            __m256i low = premultiplyWordsAVX2(_mm256_unpacklo_epi8(pixels, zero));
+            __m256i high = premultiplyWordsAVX2(_mm256_unpackhi_epi8(pixels, zero));
+            _mm256_storeu_si256((__m256i*)(rgba + i * 4), _mm256_packus_epi16(low, high));
+        }
+        premultiplyAlphaScalar(rgba, i, count);
+    }
+
+    AVX2_TARGET void srgbToLinearAVX2(const unsigned char* in, float* out, size_t count)
+    {
+        const float* toLinear = tables().toLinear;
+        const __m256i alphaOffset = _mm256_setr_epi32(0, 0, 0, 256, 0, 0, 0, 256);
+        size_t i = 0;
+        for (; i + 2 <= count; i += 2)
+        {
+            __m256i bytes = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(in + i * 4)));
+            __m256 linear = _mm256_i32gather_ps(toLinear, _mm256_add_epi32(bytes, alphaOffset), 4);
+            _mm256_storeu_ps(out + i * 4, linear);
+        }
+        srgbToLinearScalar(in, out, i, count);
+    }
+
+    AVX2_TARGET void linearToSrgbAVX2(const float* in, unsigned char* out, size_t count)
+    {
+        const unsigned char* toSrgb = tables().toSrgb;
+        const __m256 zero = _mm256_setzero_ps();
+        const __m256 one = _mm256_set1_ps(1.0f);
+        const __m256 half = _mm256_set1_ps(0.5f);
+        const float steps = (float)ImageKernels::LINEAR_TO_SRGB_STEPS;
+        const __m256 scale = _mm256_setr_ps(steps, steps, steps, 255.0f, steps, steps, steps, 255.0f);
+        const __m256i lowByte = _mm256_set1_epi32(0xFF);
+        //Byte 0 of every dword to the low 4 bytes of its half
+        const __m256i gatherBytes = _mm256_setr_epi8(0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+            0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+        size_t i = 0;
+        for (; i + 2 <= count; i += 2)
+        {
+            __m256 x = _mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(in + i * 4), zero), one);
+            __m256i index = _mm256_cvttps_epi32(_mm256_add_ps(_mm256_mul_ps(x, scale), half));
+            //Gathers 4 table bytes per lane, only the first counts. Alpha lanes keep their value
+            __m256i srgb = _mm256_and_si256(_mm256_i32gather_epi32((const int*)toSrgb, index, 1), lowByte);
+            srgb = _mm256_shuffle_epi8(_mm256_blend_epi32(srgb, index, 0x88), gatherBytes);
+            int first = _mm_cvtsi128_si32(_mm256_castsi256_si128(srgb));
+            int second = _mm_cvtsi128_si32(_mm256_extracti128_si256(srgb, 1));
+            memcpy(out + i * 4, &first, 4);
+            memcpy(out + i * 4 + 4, &second, 4);
+        }
+        linearToSrgbScalar(in, out, i, count);
+    }
+
+    AVX2_TARGET void swizzleAVX2(const unsigned char* in, unsigned char* out, size_t count, const int order[4])
+    {
+        alignas(32) char shuffle[32];
+        for (int p = 0; p < 8; p++)
+        {
+            for (int c = 0; c < 4; c++)
+                shuffle[p * 4 + c] = (char)((p % 4) * 4 + order[c]); // within the pixel's 128-bit half
+        }
+        const __m256i mask = _mm256_load_si256((const __m256i*)shuffle);
+        size_t i = 0;
+        for (; i + 8 <= count; i += 8)
+        {
+            __m256i pixels = _mm256_loadu_si256((const __m256i*)(in + i * 4));
+            _mm256_storeu_si256((__m256i*)(out + i * 4), _mm256_shuffle_epi8(pixels, mask));
+        }
+        swizzleScalar(in, out, i, count, order);
+    }
+
+    //Separate multiply and add, not FMA: the rounding stays that of the other versions
+    AVX2_TARGET void sumRowsAVX2(const float* const* rows, const float* weights, size_t numRows, float* out, size_t count)
+    {
+        size_t i = 0;
+        for (; i + 8 <= count; i += 8)
+        {
+            __m256 sum = _mm256_mul_ps(_mm256_set1_ps(weights[0]), _mm256_loadu_ps(rows[0] + i));
+            for (size_t r = 1; r < numRows; r++)
+                sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_set1_ps(weights[r]), _mm256_loadu_ps(rows[r] + i)));
+            _mm256_storeu_ps(out + i, sum);
+        }
+        sumRowsScalar(rows, weights, numRows, out, i, count);
+    }
+
+    //Two pixels per register, each half loaded from its own taps
+    AVX2_TARGET void sumPixelsAVX2(const float* in, const int* indices, const float* weights, size_t numTaps, float* out,
+        size_t count)
+    {
+        size_t i = 0;
+        for (; i + 2 <= count; i += 2)
+        {
+            const int* a = indices + i * numTaps;
+            const int* b = a + numTaps;
+            const float* wa = weights + i * numTaps;
+            const float* wb = wa + numTaps;
+            __m256 sum = _mm256_mul_ps(_mm256_setr_m128(_mm_set1_ps(wa[0]), _mm_set1_ps(wb[0])),
+                _mm256_setr_m128(_mm_loadu_ps(in + a[0] * 4), _mm_loadu_ps(in + b[0] * 4)));
+            for (size_t t = 1; t < numTaps; t++)
+            {
+                __m256 pixels = _mm256_setr_m128(_mm_loadu_ps(in + a[t] * 4), _mm_loadu_ps(in + b[t] * 4));
+                sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_setr_m128(_mm_set1_ps(wa[t]), _mm_set1_ps(wb[t])), pixels));
+            }
+            _mm256_storeu_ps(out + i * 4, sum);
+        }
+        sumPixelsScalar(in, indices, weights, numTaps, out, i, count);
+    }
+#endif
+}
+
+ImageKernels::Level ImageKernels::getSupportedLevel()
+{
+    static Level supported = detectLevel();
+    return supported;
+}
+
+void ImageKernels::setLevel(Level level)
+{
+    currentLevel() = std::min(level, getSupportedLevel());
+}
+
+ImageKernels::Level ImageKernels::getLevel()
+{
+    return currentLevel();
+}
+
+const char* ImageKernels::levelName(Level level)
+{
+    const char* names[] = { "scalar", "SSE2", "AVX2" };
+    return names[level];
+}
+
+void ImageKernels::copyRowsFlipped(const unsigned char* in, unsigned char* out, size_t rowBytes, size_t rows)
+{
+    //memcpy is as fast as a vector loop here on every level, streaming stores measured slower
+    for (size_t row = 0; row < rows; row++)
+        memcpy(out + row * rowBytes, in + (rows - row - 1) * rowBytes, rowBytes);
+}
+
+void ImageKernels::flipRows(unsigned char* pixels, size_t rowBytes, size_t rows)
+{
+    Level level = getLevel();
+    for (size_t row = 0; row < rows / 2; row++)
+    {
+        unsigned char* top = pixels + row * rowBytes;
+        unsigned char* bottom = pixels + (rows - row - 1) * rowBytes;
+#ifdef IMAGE_KERNELS_X86
+        if (level == AVX2)
+            flipRowsAVX2(top, bottom, rowBytes);
+        else if (level == SSE2)
+            flipRowsSSE2(top, bottom, rowBytes);
+        else
+#endif
+            flipRowsScalar(top, bottom, rowBytes);
+    }
+}
+
+void ImageKernels::rgbToRgba(const unsigned char* in, unsigned char* out, size_t count, unsigned char alpha)
+{
+#ifdef IMAGE_KERNELS_X86
+    if (getLevel() == AVX2)
+        return rgbToRgbaAVX2(in, out, count, alpha);
+    if (getLevel() == SSE2)
+        return rgbToRgbaSSE2(in, out, count, alpha);
+#endif
+    rgbToRgbaScalar(in, out, 0, count, alpha);
+}
+
+void ImageKernels::premultiplyAlpha(unsigned char* rgba, size_t count)
+{
+#ifdef IMAGE_KERNELS_X86
+    if (getLevel() == AVX2)
+        return premultiplyAlphaAVX2(rgba, count);
+    if (getLevel() == SSE2)
+        return premultiplyAlphaSSE2(rgba, count);
+#endif
+    premultiplyAlphaScalar(rgba, 0, count);
+}
+
+void ImageKernels::srgbToLinear(const unsigned char* in, float* out, size_t count)
+{
+    //A table lookup per channel, only AVX2 can gather
+#ifdef IMAGE_KERNELS_X86
+    if (getLevel() == AVX2)
+        return srgbToLinearAVX2(in, out, count);
+#endif
+    srgbToLinearScalar(in, out, 0, count);
+}
+
+void ImageKernels::linearToSrgb(const float* in, unsigned char* out, size_t count)
+{
+#ifdef IMAGE_KERNELS_X86
+    if (getLevel() == AVX2)
+        return linearToSrgbAVX2(in, out, count);
+    if (getLevel() == SSE2)
+        return linearToSrgbSSE2(in, out, count);
+#endif
+    linearToSrgbScalar(in, out, 0, count);
+}
+
+void ImageKernels::swizzle(const unsigned char* in, unsigned char* out, size_t count, const int order[4])
+{
+#ifdef IMAGE_KERNELS_X86
+    if (getLevel() == AVX2)
+        return swizzleAVX2(in, out, count, order);
+    if (getLevel() == SSE2)
+        return swizzleSSE2(in, out, count, order);
+#endif
+    swizzleScalar(in, out, 0, count, order);
+}
+
+void ImageKernels::sumRows(const float* const* rows, const float* weights, size_t numRows, float* out, size_t count)
+{
+#ifdef IMAGE_KERNELS_X86
+    if (getLevel() == AVX2)
+        return sumRowsAVX2(rows, weights, numRows, out, count);
+    if (getLevel() == SSE2)
+        return sumRowsSSE2(rows, weights, numRows, out, count);
+#endif
+    sumRowsScalar(rows, weights, numRows, out, 0, count);
+}
+
+void ImageKernels::sumPixels(const float* in, const int* indices, const float* weights, size_t numTaps, float* out, size_t count)
+{
+#ifdef IMAGE_KERNELS_X86
+    if (getLevel() == AVX2)
+        return sumPixelsAVX2(in, indices, weights, numTaps, out, count);
+    if (getLevel() == SSE2)
+        return sumPixelsSSE2(in, indices, weights, numTaps, out, count);
+#endif
+    sumPixelsScalar(in, indices, weights, numTaps, out, 0, count);
+}
@@ -0,0 +1,63 @@
+#ifndef IMAGE_KERNELS_H
+#define IMAGE_KERNELS_H
+
+#include <cstddef>
+
+//----------------------------------------------
+//Pixel loops for 8-bit images on the CPU, and the float sums of image filters. Each has a scalar, an SSE2 and an AVX2
+//version; the best one the CPU runs is picked at start up and they all give the same bytes. Counts are in pixels, RGBA
+//pixels are 4 bytes.
+//----------------------------------------------
+class ImageKernels
+{
+public:
+    enum Level
+    {
+        SCALAR,
+        SSE2,
+        AVX2
+    };
+
+    //Highest level the CPU and the build support. SCALAR on anything but x86
+    static Level getSupportedLevel();
+
+    //The level the kernels use, getSupportedLevel unless lowered (to compare the versions). Higher ones are clamped
+    static void setLevel(Level level);
+    static Level getLevel();
+    static const char* levelName(Level level);
+
+    //Copies the rows, the last one first: a top-down image file the way OpenGL wants it. in and out must not overlap.
+    //Row memcpys on every level, nothing beats them for a plain copy
+    static void copyRowsFlipped(const unsigned char* in, unsigned char* out, size_t rowBytes, size_t rows);
+
+    //The same in place, the top and bottom rows swapped
+    static void flipRows(unsigned char* pixels, size_t rowBytes, size_t rows);
+
+    //RGB to RGBA with a constant alpha. in and out must not overlap
+    static void rgbToRgba(const unsigned char* in, unsigned char* out, size_t count, unsigned char alpha = 255);
+
+    //RGB times alpha, rounded like (c * a + 127) / 255. Alpha stays
+    static void premultiplyAlpha(unsigned char* rgba, size_t count);
+
+    //RGBA from sRGB to linear floats, 4 per pixel. Alpha is linear already, it becomes a / 255
+    static void srgbToLinear(const unsigned char* in, float* out, size_t count);
+
+    //And back, clamped to [0, 1]. The curve is a table of LINEAR_TO_SRGB_STEPS + 1 entries: every byte survives the
+    //round trip, other values are at most one step off the exact conversion
+    static void linearToSrgb(const float* in, unsigned char* out, size_t count);
+    static const int LINEAR_TO_SRGB_STEPS = 4096;
+
+    //RGBA channel reorder: out channel c is in channel order[c], e.g. { 2, 1, 0, 3 } for RGBA <-> BGRA. in and out may
+    //be the same
+    static void swizzle(const unsigned char* in, unsigned char* out, size_t count, const int order[4]);
+
+    //The two passes of a separable filter. sumRows: out[i] = the sum of weights[r] * rows[r][i], count floats, e.g. a
+    //column of taps for a whole row at once. numRows must be at least 1
+    static void sumRows(const float* const* rows, const float* weights, size_t numRows, float* out, size_t count);
+
+    //sumPixels, along a row of RGBA float pixels: out pixel i = the sum of weights[i * numTaps + t] times in pixel
+    //indices[i * numTaps + t]. numTaps must be at least 1
+    static void sumPixels(const float* in, const int* indices, const float* weights, size_t numTaps, float* out, size_t count);
+};
+
+#endif
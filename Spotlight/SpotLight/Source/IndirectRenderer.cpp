@@ -0,0 +1,280 @@
+#include "IndirectRenderer.h"
+#include "GLState.h"
+#include "MeshletBuilder.h"
+#include "ShaderLibrary.h"
+#include <algorithm>
+#include <chrono>
+
+namespace
+{
+    //RGBA32F texels per draw: model matrix columns, (color, layer), dequantization scale, dequantization offset
+    const size_t DRAW_DATA_TEXELS = 7;
+
+    //Bilinear, with the sample grid spread over the whole source
+    void resample(const Image& image, int size, std::vector<unsigned char>& out)
+    {
+        out.resize((size_t)size * size * 4);
+        for (int y = 0; y < size; y++)
+        {
+            float sy = std::max(0.0f, (y + 0.5f) * image.height / size - 0.5f);
+            int y0 = std::min((int)sy, image.height - 1), y1 = std::min(y0 + 1, image.height - 1);
+            float fy = sy - y0;
+            for (int x = 0; x < size; x++)
+            {
+                float sx = std::max(0.0f, (x + 0.5f) * image.width / size - 0.5f);
+                int x0 = std::min((int)sx, image.width - 1), x1 = std::min(x0 + 1, image.width - 1);
+                float fx = sx - x0;
+                for (int c = 0; c < 4; c++)
+                {
+                    float top = image.pixels[((size_t)y0 * image.width + x0) * 4 + c] * (1.0f - fx) + image.pixels[((size_t)y0 * image.width + x1) * 4 + c] * fx;
+                    float bottom = image.pixels[((size_t)y1 * image.width + x0) * 4 + c] * (1.0f - fx) + image.pixels[((size_t)y1 * image.width + x1) * 4 + c] * fx;
+                    out[((size_t)y * size + x) * 4 + c] = (unsigned char)(top * (1.0f - fy) + bottom * fy + 0.5f);
+                }
+            }
+        }
+    }
+}
+
+IndirectRenderer::IndirectRenderer(GeometryArena& arena, int layerSize, int maxLayers)
+    :mArena(arena),
+    mLayerSize(layerSize),
+    mMaxLayers(maxLayers),
+    mNumLayers(0),
+    mMipmapsDirty(false),
+    mMultiDraw(isSupported()),
+    mMaxDrawsPerCall(0),
+    mIndirectBuffer(0),
+    mDrawDataBuffer(0),
+    mDrawDataTexture(0),
+    mTextureArray(0),
+    mStats()
+{
+    mCopyFramebuffers[0] = mCopyFramebuffers[1] = 0;
+
+    GLint maxTexels = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &maxTexels);
+    mMaxDrawsPerCall = std::max<size_t>(1, (size_t)maxTexels / DRAW_DATA_TEXELS);
+
+    glGenBuffers(1, &mIndirectBuffer);
+    glGenBuffers(1, &mDrawDataBuffer);
+    GLState::bindBuffer(GL_TEXTURE_BUFFER, mDrawDataBuffer);
+    glBufferData(GL_TEXTURE_BUFFER, DRAW_DATA_TEXELS * sizeof(glm::vec4), NULL, GL_STREAM_DRAW);
+    glGenTextures(1, &mDrawDataTexture);
+    GLState::bindTexture(0, GL_TEXTURE_BUFFER, mDrawDataTexture);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, mDrawDataBuffer);
+    GLState::bindTexture(0, GL_TEXTURE_BUFFER, 0);
+    GLState::bindBuffer(GL_TEXTURE_BUFFER, 0);
+
+    //Every mip level of every layer, filled by addTexture and glGenerateMipmap
+    glGenTextures(1, &mTextureArray);
+    GLState::bindTexture(0, GL_TEXTURE_2D_ARRAY, mTextureArray);
+    for (int level = 0, size = layerSize; size > 0; level++, size /= 2)
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, level, GL_RGBA8, size, size, maxLayers, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    GLState::bindTexture(0, GL_TEXTURE_2D_ARRAY, 0);
+}
+
+IndirectRenderer::~IndirectRenderer()
+{
+    GLState::deleteBuffers(1, &mIndirectBuffer);
+    GLState::deleteBuffers(1, &mDrawDataBuffer);
+    GLState::deleteTextures(1, &mDrawDataTexture);
+    GLState::deleteTextures(1, &mTextureArray);
+    if (mCopyFramebuffers[0] != 0)
+        glDeleteFramebuffers(2, mCopyFramebuffers);
+}
+
+bool IndirectRenderer::isSupported()
+{
+    return (GLEW_VERSION_4_3 || GLEW_ARB_multi_draw_indirect) && GLEW_ARB_shader_draw_parameters;
+}
+
+int IndirectRenderer::addTexture(const Image& image)
+{
+    if (mNumLayers >= mMaxLayers || image.pixels.empty())
+        return -1;
+
+    std::vector<unsigned char> pixels;
+    resample(image, mLayerSize, pixels);
+    GLState::bindTexture(0, GL_TEXTURE_2D_ARRAY, mTextureArray);
+    glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, mNumLayers, mLayerSize, mLayerSize, 1, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+    GLState::bindTexture(0, GL_TEXTURE_2D_ARRAY, 0);
+    mMipmapsDirty = true;
+    return mNumLayers++;
+}
+
+int IndirectRenderer::addTexture(const Texture2D& texture)
+{
+    if (mNumLayers >= mMaxLayers || texture.getTexture() == 0)
+        return -1;
+
+    //Levels past the last one report a width of 0
+    GLint level = 0, width = 0, height = 0;
+    GLState::bindTexture(0, GL_TEXTURE_2D, texture.getTexture());
+    glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &width);
+    glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &height);
+    for (;;)
+    {
+        GLint nextWidth = 0, nextHeight = 0;
+        glGetTexLevelParameteriv(GL_TEXTURE_2D, level + 1, GL_TEXTURE_WIDTH, &nextWidth);
+        glGetTexLevelParameteriv(GL_TEXTURE_2D, level + 1, GL_TEXTURE_HEIGHT, &nextHeight);
+        if (nextWidth < mLayerSize || nextHeight < mLayerSize)
+            break;
+        level++;
+        width = nextWidth;
+        height = nextHeight;
+    }
+    GLState::bindTexture(0, GL_TEXTURE_2D, 0);
+    if (width == 0 || height == 0)
+        return -1;
+
+    if (mCopyFramebuffers[0] == 0)
+        glGenFramebuffers(2, mCopyFramebuffers);
+    GLint readFramebuffer = 0, drawFramebuffer = 0;
+    glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &readFramebuffer);
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &drawFramebuffer);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, mCopyFramebuffers[0]);
+    glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture.getTexture(), level);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, mCopyFramebuffers[1]);
+    glFramebufferTextureLayer(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, mTextureArray, 0, mNumLayers);
+    glBlitFramebuffer(0, 0, width, height, 0, 0, mLayerSize, mLayerSize, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+
+    //Detached again, so the framebuffers don't keep a deleted texture alive
+    glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, 0, 0);
+    glFramebufferTextureLayer(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, 0, 0, 0);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, readFramebuffer);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, drawFramebuffer);
+    mMipmapsDirty = true;
+    return mNumLayers++;
+}
+
+void IndirectRenderer::queue(const Mesh& mesh, GLuint firstIndex, GLuint numIndices, const glm::mat4& model, const glm::vec3& color,
+    int textureLayer)
+{
+    DrawElementsIndirectCommand command = { numIndices, 1, mesh.getFirstIndex() + firstIndex, mesh.getBaseVertex(), 0 };
+    mCommands.push_back(command);
+    mDrawData.push_back(model[0]);
+    mDrawData.push_back(model[1]);
+    mDrawData.push_back(model[2]);
+    mDrawData.push_back(model[3]);
+    mDrawData.push_back(glm::vec4(color, (float)textureLayer));
+    mDrawData.push_back(mesh.getDequantizeScale());
+    mDrawData.push_back(glm::vec4(mesh.getDequantizeOffset(), 0.0f));
+}
+
+void IndirectRenderer::submit(const Mesh& mesh, const glm::mat4& model, int textureLayer, int lod)
+{
+    if (!mesh.isDrawable() || mesh.getArena() != &mArena)
+        return;
+
+    lod = glm::clamp(lod, mesh.getResidentLod(), (int)mesh.getLods().size() - 1);
+    const std::vector<Material>& materials = mesh.getMaterials();
+    for (size_t m = 0; m < materials.size(); m++)
+    {
+        const Submesh& submesh = mesh.getSubmeshes()[lod * materials.size() + m];
+        if (submesh.numIndices > 0)
+            queue(mesh, submesh.firstIndex, submesh.numIndices, model, materials[m].diffuse, textureLayer);
+    }
+}
+
+void IndirectRenderer::submitSubmesh(const Mesh& mesh, size_t material, int lod, int textureLayer, const glm::mat4& model,
+    const glm::mat4& view, const glm::mat4& projection, const glm::vec3& cameraPosition)
+{
+    const std::vector<Material>& materials = mesh.getMaterials();
+    if (!mesh.isDrawable() || mesh.getArena() != &mArena || material >= materials.size())
+        return;
+
+    lod = glm::clamp(lod, mesh.getResidentLod(), (int)mesh.getLods().size() - 1);
+    const Submesh& submesh = mesh.getSubmeshes()[lod * materials.size() + material];
+    if (lod > 0)
+    {
+        if (submesh.numIndices > 0)
+            queue(mesh, submesh.firstIndex, submesh.numIndices, model, materials[material].diffuse, textureLayer);
+        return;
+    }
+
+    //As in Mesh::drawMeshlets, in model space. The offsets come back in bytes from the mesh's first index
+    Frustum frustum = extractFrustum(projection * view * model);
+    glm::vec3 localCamera = glm::vec3(glm::inverse(model) * glm::vec4(cameraPosition, 1.0f));
+    cullMeshlets(mesh.getMeshlets().data() + submesh.firstMeshlet, submesh.numMeshlets, frustum, localCamera, mCullCounts, mCullOffsets);
+    for (size_t i = 0; i < mCullCounts.size(); i++)
+    {
+        queue(mesh, (GLuint)((size_t)mCullOffsets[i] / sizeof(GLuint)), (GLuint)mCullCounts[i], model,
+            materials[material].diffuse, textureLayer);
+    }
+}
+
+const IndirectStats& IndirectRenderer::flush(ShaderProgram& shader)
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    mStats = IndirectStats();
+    mStats.draws = mCommands.size();
+    if (mCommands.empty())
+        return mStats;
+
+    if (mMipmapsDirty)
+    {
+        GLState::bindTexture(0, GL_TEXTURE_2D_ARRAY, mTextureArray);
+        glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+        mMipmapsDirty = false;
+    }
+
+    //Texture array on unit 0, per draw data on unit 1
+    GLState::bindTexture(0, GL_TEXTURE_2D_ARRAY, mTextureArray);
+    GLState::bindTexture(1, GL_TEXTURE_BUFFER, mDrawDataTexture);
+    shader.setUniformSampler(ShaderUniforms::textures, 0);
+    shader.setUniformSampler(ShaderUniforms::drawData, 1);
+    UniformHandle drawOffsetUniform = shader.getUniformHandle(ShaderUniforms::drawOffset);
+
+    GLState::bindVertexArray(mArena.getVertexArray());
+    if (mMultiDraw)
+    {
+        GLState::bindBuffer(GL_DRAW_INDIRECT_BUFFER, mIndirectBuffer);
+        glBufferData(GL_DRAW_INDIRECT_BUFFER, mCommands.size() * sizeof(DrawElementsIndirectCommand), mCommands.data(), GL_STREAM_DRAW);
+    }
+
+    //One call per batch. Batches only exist when the driver's buffer textures are smaller than the pass
+    GLState::bindBuffer(GL_TEXTURE_BUFFER, mDrawDataBuffer);
+    for (size_t first = 0; first < mCommands.size(); first += mMaxDrawsPerCall)
+    {
+        size_t count = std::min(mMaxDrawsPerCall, mCommands.size() - first);
+
+        //Orphaned every time, so the upload never waits for draws still reading the previous contents
+        glBufferData(GL_TEXTURE_BUFFER, count * DRAW_DATA_TEXELS * sizeof(glm::vec4), &mDrawData[first * DRAW_DATA_TEXELS], GL_STREAM_DRAW);
+
+        if (mMultiDraw)
+        {
+            shader.setUniformInt(drawOffsetUniform, 0);
+            glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (const GLvoid*)(first * sizeof(DrawElementsIndirectCommand)),
+                (GLsizei)count, 0);
+            mStats.calls++;
+        }
+        else
+        {
+            for (size_t i = 0; i < count; i++)
+            {
+                const DrawElementsIndirectCommand& command = mCommands[first + i];
+                shader.setUniformInt(drawOffsetUniform, (GLint)i);
+                glDrawElementsBaseVertex(GL_TRIANGLES, command.count, GL_UNSIGNED_INT, (GLvoid*)(command.firstIndex * sizeof(GLuint)),
+                    command.baseVertex);
+                mStats.calls++;
+            }
+        }
+    }
+    if (GLState::unbindAfterDraw())
+    {
+        GLState::bindBuffer(GL_TEXTURE_BUFFER, 0);
+        GLState::bindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+        GLState::bindVertexArray(0);
+        GLState::bindTexture(1, GL_TEXTURE_BUFFER, 0);
+        GLState::bindTexture(0, GL_TEXTURE_2D_ARRAY, 0);
+    }
+
+    mCommands.clear();
+    mDrawData.clear();
+    mStats.submitMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return mStats;
+}
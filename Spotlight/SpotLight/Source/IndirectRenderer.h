@@ -0,0 +1,93 @@
+#ifndef INDIRECT_RENDERER_H
+#define INDIRECT_RENDERER_H
+
+#include <vector>
+
+#include "GL/glew.h"
+#include "glm/glm.hpp"
+#include "GeometryArena.h"
+#include "Mesh.h"
+#include "ShaderProgram.h"
+#include "Texture2D.h"
+
+//Layout glMultiDrawElementsIndirect reads from GL_DRAW_INDIRECT_BUFFER
+struct DrawElementsIndirectCommand
+{
+    GLuint count;
+    GLuint instanceCount;
+    GLuint firstIndex;
+    GLint baseVertex;
+    GLuint baseInstance;
+};
+
+struct IndirectStats
+{
+    size_t draws;
+    size_t calls; // GL draw calls issued for them
+    double submitMs; // CPU time of flush
+};
+
+//----------------------------------------------
+//Draws everything queued for a pass over one GeometryArena with a single glMultiDrawElementsIndirect.
+//What differs between draws lives in a buffer texture that the vertex shader indexes with gl_DrawID: the model
+//matrix, the material color, the dequantization constants and a layer of the renderer's texture array, which holds
+//every texture resampled to one size. Use with Indirect.vert and Indirect.frag.
+//Without GL 4.3 / ARB_multi_draw_indirect and ARB_shader_draw_parameters it issues one glDrawElementsBaseVertex per
+//draw with the draw index in a uniform instead, still with one VAO and no other state change
+//----------------------------------------------
+class IndirectRenderer
+{
+public:
+    //Needs the GL context. The texture array has maxLayers layers of layerSize x layerSize
+    IndirectRenderer(GeometryArena& arena, int layerSize = 512, int maxLayers = 16);
+    ~IndirectRenderer();
+
+    static bool isSupported();
+
+    //Off compares against the fallback. Ignored when the extensions are missing
+    void setMultiDraw(bool enabled) { mMultiDraw = enabled && isSupported(); }
+    bool isMultiDraw() const { return mMultiDraw; }
+
+    //Copies the image into the next layer, bilinear resampled. Returns the layer, -1 when the array is full
+    int addTexture(const Image& image);
+
+    //Same from a created texture, copied on the GPU: the smallest of its mip levels still at least layerSize wide,
+    //scaled with a linear blit. Returns -1 as well while the texture isn't created
+    int addTexture(const Texture2D& texture);
+
+    //Queues every material of the mesh at the given level (clamped to what is resident), one draw each with the
+    //material's color. The mesh has to live in this renderer's arena
+    void submit(const Mesh& mesh, const glm::mat4& model, int textureLayer, int lod = 0);
+
+    //One material of the mesh, like Mesh::drawSubmesh: level 0 is culled by meshlets and every visible range becomes
+    //a draw of its own, with the same per draw data
+    void submitSubmesh(const Mesh& mesh, size_t material, int lod, int textureLayer, const glm::mat4& model,
+        const glm::mat4& view, const glm::mat4& projection, const glm::vec3& cameraPosition);
+
+    //Draws and empties the queue. The shader must be in use with view and projection set
+    const IndirectStats& flush(ShaderProgram& shader);
+
+    size_t numQueued() const { return mCommands.size(); }
+
+private:
+    IndirectRenderer(const IndirectRenderer&);
+    IndirectRenderer& operator=(const IndirectRenderer&);
+
+    //firstIndex counts from the start of the mesh's own indices
+    void queue(const Mesh& mesh, GLuint firstIndex, GLuint numIndices, const glm::mat4& model, const glm::vec3& color, int textureLayer);
+
+    GeometryArena& mArena;
+    int mLayerSize, mMaxLayers, mNumLayers;
+    bool mMipmapsDirty;
+    bool mMultiDraw;
+    size_t mMaxDrawsPerCall; // limited by GL_MAX_TEXTURE_BUFFER_SIZE
+    std::vector<DrawElementsIndirectCommand> mCommands;
+    std::vector<glm::vec4> mDrawData; // DRAW_DATA_TEXELS per command
+    std::vector<GLsizei> mCullCounts; // visible ranges of the last culled submesh
+    std::vector<const GLvoid*> mCullOffsets;
+    GLuint mIndirectBuffer, mDrawDataBuffer, mDrawDataTexture, mTextureArray;
+    GLuint mCopyFramebuffers[2]; // read and draw side of addTexture's blit, made on first use
+    IndirectStats mStats;
+};
+
+#endif
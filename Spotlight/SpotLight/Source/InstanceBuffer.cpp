@@ -0,0 +1,46 @@
+#include "InstanceBuffer.h"
+#include "GLState.h"
+
+InstanceBuffer::InstanceBuffer()
+    :mBuffer(0),
+    mCount(0)
+{
+}
+
+InstanceBuffer::~InstanceBuffer()
+{
+    GLState::deleteBuffers(1, &mBuffer);
+}
+
+void InstanceBuffer::update(const glm::mat4* models, size_t count)
+{
+    if (mBuffer == 0)
+        glGenBuffers(1, &mBuffer);
+
+    //GL_ARRAY_BUFFER is not part of the vertex array state, binding it here leaves every VAO untouched
+    GLState::bindBuffer(GL_ARRAY_BUFFER, mBuffer);
+    glBufferData(GL_ARRAY_BUFFER, count * sizeof(glm::mat4), models, GL_STREAM_DRAW);
+    GLState::bindBuffer(GL_ARRAY_BUFFER, 0);
+    mCount = (GLsizei)count;
+}
+
+void InstanceBuffer::bindAttributes(GLuint firstInstance) const
+{
+    //glDrawElementsInstancedBaseInstance is GL 4.2, so the first instance goes into the attribute offsets
+    GLState::bindBuffer(GL_ARRAY_BUFFER, mBuffer);
+    for (GLuint column = 0; column < INSTANCE_MODEL_COLUMNS; column++)
+    {
+        GLuint location = INSTANCE_MODEL_LOCATION + column;
+        glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4),
+            (GLvoid*)(firstInstance * sizeof(glm::mat4) + column * sizeof(glm::vec4)));
+        glVertexAttribDivisor(location, 1); // advance once per instance, not per vertex
+        glEnableVertexAttribArray(location);
+    }
+    GLState::bindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void InstanceBuffer::unbindAttributes()
+{
+    for (GLuint column = 0; column < INSTANCE_MODEL_COLUMNS; column++)
+        glDisableVertexAttribArray(INSTANCE_MODEL_LOCATION + column);
+}
@@ -0,0 +1,45 @@
+#ifndef INSTANCE_BUFFER_H
+#define INSTANCE_BUFFER_H
+
+#include <vector>
+
+#include "GL/glew.h"
+#include "glm/glm.hpp"
+
+//Vertex attribute locations of the per-instance model matrix, one column each. 0-2 are the vertex, 3-4 the
+//dequantization constants, see Mesh.h
+const GLuint INSTANCE_MODEL_LOCATION = 5;
+const GLuint INSTANCE_MODEL_COLUMNS = 4;
+
+//----------------------------------------------
+//GPU array of per-instance model matrices for Mesh::drawInstanced. Lighting.vert built with INSTANCED 1 (see
+//ShaderVariants.h) reads them as a mat4 attribute with divisor 1 instead of the model uniform.
+//update() orphans the buffer, so changing the transforms every frame never waits for draws still reading the old ones
+//----------------------------------------------
+class InstanceBuffer
+{
+public:
+    InstanceBuffer();
+    ~InstanceBuffer();
+
+    void update(const glm::mat4* models, size_t count);
+    void update(const std::vector<glm::mat4>& models) { update(models.data(), models.size()); }
+
+    //Points the instance attributes of the bound vertex array at instances [firstInstance, ...) and enables them
+    void bindAttributes(GLuint firstInstance) const;
+
+    //Disables them again, so draws without instances that share the vertex array don't read this buffer
+    static void unbindAttributes();
+
+    GLsizei size() const { return mCount; }
+    GLuint getBuffer() const { return mBuffer; }
+
+private:
+    InstanceBuffer(const InstanceBuffer&);
+    InstanceBuffer& operator=(const InstanceBuffer&);
+
+    GLuint mBuffer;
+    GLsizei mCount;
+};
+
+#endif
@@ -0,0 +1,167 @@
+#include "MappedFile.h"
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+MappedFile::MappedFile()
+    :mData(NULL),
+    mSize(0),
+    mFile(INVALID_HANDLE_VALUE),
+    mMapping(NULL)
+{
+}
+
+bool MappedFile::open(const std::string& filename)
+{
+    close();
+
+    mFile = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (mFile == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER fileSize;
+    //Empty files can't be mapped
+    if (!GetFileSizeEx(mFile, &fileSize) || fileSize.QuadPart == 0)
+    {
+        close();
+        return false;
+    }
+
+    mMapping = CreateFileMappingA(mFile, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (mMapping == NULL)
+    {
+        close();
+        return false;
+    }
+
+    mData = (const char*)MapViewOfFile(mMapping, FILE_MAP_READ, 0, 0, 0);
+    if (mData == NULL)
+    {
+        close();
+        return false;
+    }
+    mSize = (size_t)fileSize.QuadPart;
+    return true;
+}
+
+void MappedFile::close()
+{
+    if (mData != NULL)
+        UnmapViewOfFile(mData);
+    if (mMapping != NULL)
+        CloseHandle(mMapping);
+    if (mFile != INVALID_HANDLE_VALUE)
+        CloseHandle(mFile);
+
+    mData = NULL;
+    mSize = 0;
+    mMapping = NULL;
+    mFile = INVALID_HANDLE_VALUE;
+}
+
+#else
+
+MappedFile::MappedFile()
+    :mData(NULL),
+    mSize(0),
+    mFile(-1)
+{
+}
+
+bool MappedFile::open(const std::string& filename)
+{
+    close();
+
+    mFile = ::open(filename.c_str(), O_RDONLY);
+    if (mFile < 0)
+        return false;
+
+    struct stat fileInfo;
+    //Empty files can't be mapped
+    if (fstat(mFile, &fileInfo) != 0 || fileInfo.st_size == 0)
+    {
+        close();
+        return false;
+    }
+
+    void* data = mmap(NULL, (size_t)fileInfo.st_size, PROT_READ, MAP_PRIVATE, mFile, 0);
+    if (data == MAP_FAILED)
+    {
+        close();
+        return false;
+    }
+    madvise(data, (size_t)fileInfo.st_size, MADV_SEQUENTIAL); // We read front to back
+
+    mData = (const char*)data;
+    mSize = (size_t)fileInfo.st_size;
+    return true;
+}
+
+void MappedFile::close()
+{
+    if (mData != NULL)
+        munmap((void*)mData, mSize);
+    if (mFile >= 0)
+        ::close(mFile);
+
+    mData = NULL;
+    mSize = 0;
+    mFile = -1;
+}
+
+#endif
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+bool writeFileAtomically(const std::string& filename, const std::function<void(std::ostream&)>& writeContents)
+{
+    //Process id and a counter: unique across threads, and across processes sharing the directory
+    static std::atomic<unsigned> counter(0);
+#ifdef _WIN32
+    unsigned long processId = GetCurrentProcessId();
+#else
+    unsigned long processId = (unsigned long)getpid();
+#endif
+    std::string tempFilename = filename + "." + std::to_string(processId) + "." + std::to_string(counter++) + ".tmp";
+
+    {
+        std::ofstream file(tempFilename, std::ios::out | std::ios::binary | std::ios::trunc);
+        if (!file)
+            return false;
+
+        writeContents(file);
+        file.flush();
+        if (!file)
+        {
+            file.close();
+            std::remove(tempFilename.c_str());
+            return false;
+        }
+    }
+
+#ifdef _WIN32
+    //rename doesn't replace an existing file on Windows, and remove before it would leave a moment without one
+    bool replaced = MoveFileExA(tempFilename.c_str(), filename.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+    bool replaced = std::rename(tempFilename.c_str(), filename.c_str()) == 0;
+#endif
+    if (!replaced)
+        std::remove(tempFilename.c_str());
+    return replaced;
+}
@@ -0,0 +1,48 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <string>
+#include <cstddef>
+#include <functional>
+#include <ostream>
+
+//----------------------------------------------
+//Read-only memory mapped file
+//The whole file is mapped into our address space, so it can be scanned in place without copying it into a buffer
+//----------------------------------------------
+class MappedFile
+{
+public:
+    MappedFile();
+    ~MappedFile();
+
+    bool open(const std::string& filename);
+    void close();
+
+    bool isOpen() const { return mData != NULL; }
+    const char* data() const { return mData; }
+    size_t size() const { return mSize; }
+
+private:
+    //A mapping owns OS handles, so it can't be copied
+    MappedFile(const MappedFile&);
+    MappedFile& operator=(const MappedFile&);
+
+    const char* mData;
+    size_t mSize;
+
+#ifdef _WIN32
+    void* mFile; // HANDLE of the opened file
+    void* mMapping; // HANDLE of the file mapping object
+#else
+    int mFile; // file descriptor
+#endif
+};
+
+//Writes a file so that readers only ever see the old one or all of the new one: writeContents fills a temporary file
+//next to filename, which then replaces it in one step. The temporary name is unique to the call, so two threads or
+//processes writing the same file don't share it. Returns false and leaves the old file when anything fails, like
+//Windows refusing to replace a file that a MappedFile still has open. Writing it again later then succeeds
+bool writeFileAtomically(const std::string& filename, const std::function<void(std::ostream&)>& writeContents);
+
+#endif
@@ -0,0 +1,112 @@
+#include "Material.h"
+#include "MappedFile.h"
+#include <cstring>
+#include <iostream>
+#include <sstream>
+
+namespace
+{
+    //Directory part of a path including the trailing separator, "" for a bare file name
+    std::string directoryOf(const std::string& filename)
+    {
+        size_t slash = filename.find_last_of("/\\");
+        return (slash == std::string::npos) ? std::string() : filename.substr(0, slash + 1);
+    }
+
+    glm::vec3 readColor(std::istringstream& ss, const glm::vec3& fallback)
+    {
+        glm::vec3 color = fallback;
+        if (ss >> color.r)
+        {
+            //"Kd 0.5" is a grey
+            color.g = color.b = color.r;
+            ss >> color.g >> color.b;
+        }
+        return color;
+    }
+}
+
+bool parseMTL(const std::string& filename, std::vector<Material>& materials)
+{
+    MappedFile file;
+    if (!file.open(filename))
+        return false;
+
+    //MTL files are a few lines per material, so a stream per line is fast enough here
+    std::string directory = directoryOf(filename);
+    Material* material = NULL;
+    const char* p = file.data();
+    const char* end = p + file.size();
+    while (p < end)
+    {
+        const char* newline = (const char*)memchr(p, '\n', end - p);
+        const char* lineEnd = newline ? newline : end;
+        std::istringstream ss(std::string(p, lineEnd));
+        p = newline ? newline + 1 : end;
+
+        std::string cmd;
+        if (!(ss >> cmd))
+            continue;
+
+        if (cmd == "newmtl")
+        {
+            std::string name;
+            std::getline(ss >> std::ws, name);
+            while (!name.empty() && (name.back() == '\r' || name.back() == ' ' || name.back() == '\t'))
+                name.pop_back();
+            materials.push_back(Material(name));
+            material = &materials.back();
+        }
+        else if (material == NULL)
+            continue; // statements before the first newmtl have nothing to apply to
+        else if (cmd == "Ka")
+            material->ambient = readColor(ss, material->ambient);
+        else if (cmd == "Kd")
+            material->diffuse = readColor(ss, material->diffuse);
+        else if (cmd == "Ks")
+            material->specular = readColor(ss, material->specular);
+        else if (cmd == "Ns")
+            ss >> material->shininess;
+        else if (cmd == "d")
+            ss >> material->opacity;
+        else if (cmd == "Tr")
+        {
+            float transparency = 0.0f;
+            if (ss >> transparency)
+                material->opacity = 1.0f - transparency;
+        }
+        else if (cmd == "map_Kd")
+        {
+            //Options like "-s 1 1 1" come first, the file name is the last word
+            std::string word, map;
+            while (ss >> word)
+                map = word;
+            if (!map.empty())
+                material->diffuseMap = directory + map;
+        }
+    }
+    return true;
+}
+
+void loadMaterials(const std::string& objFilename, const std::vector<std::string>& libraries, std::vector<Material>& materials)
+{
+    std::vector<Material> defined;
+    std::string directory = directoryOf(objFilename);
+    for (const std::string& library : libraries)
+    {
+        if (!parseMTL(directory + library, defined))
+            std::cerr << "Cannot open material library: " << directory + library << std::endl;
+    }
+
+    for (Material& material : materials)
+    {
+        for (const Material& definition : defined)
+        {
+            if (definition.name == material.name)
+            {
+                material = definition;
+                break;
+            }
+        }
+    }
+}
@@ -0,0 +1,33 @@
+#ifndef MATERIAL_H
+#define MATERIAL_H
+
+#include <string>
+#include <vector>
+
+#include "glm/glm.hpp"
+
+//One newmtl block of an MTL file. Materials an OBJ names but no library defines keep these defaults, which draw
+//exactly like the plain textured meshes
+struct Material
+{
+    std::string name; // usemtl name, "" for faces before any usemtl
+    glm::vec3 ambient; // Ka
+    glm::vec3 diffuse; // Kd, multiplies the texture
+    glm::vec3 specular; // Ks
+    float shininess; // Ns
+    float opacity; // d, or 1 - Tr
+    std::string diffuseMap; // map_Kd, already joined with the MTL file's directory. "" when there is none
+
+    Material(const std::string& materialName = std::string())
+        :name(materialName), ambient(1.0f), diffuse(1.0f), specular(0.0f), shininess(0.0f), opacity(1.0f) {}
+};
+
+//Appends every material of an MTL file. Reads newmtl, Ka, Kd, Ks, Ns, d, Tr and map_Kd; other statements are skipped.
+//Returns false when the file can't be read
+bool parseMTL(const std::string& filename, std::vector<Material>& materials);
+
+//Fills in the materials an OBJ uses, by name, from its mtllib files. Library names are relative to the OBJ.
+//The first definition of a name wins, names no library defines stay at the defaults
+void loadMaterials(const std::string& objFilename, const std::vector<std::string>& libraries, std::vector<Material>& materials);
+
+#endif
@@ -1,199 +1,317 @@
 #include "Mesh.h"
+#include "GLState.h"
+#include "InstanceBuffer.h"
+#include "MeshBuilder.h"
+#include "MeshCache.h"
+#include "MeshSimplifier.h"
+#include "MeshStreamer.h"
+#include "MeshletBuilder.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cfloat>
 #include <iostream>
-#include <fstream>
-#include <sstream>
 
 
-std::vector<std::string> split(std::string& s, std::string t)
+Mesh::Mesh()
+    :mLoaded(false),
+    mNumIndices(0),
+    mCurrentLod(0),
+    mResidentLod(0),
+    mStreamer(NULL),
+    mBoundsMin(0.0f),
+    mBoundsMax(0.0f),
+    mDequantizeScale(1.0f, 1.0f, 1.0f, 0.0f),
+    mDequantizeOffset(0.0f),
+    mVBO(0),
+    mEBO(0),
+    mVAO(0),
+    mArena(NULL),
+    mAllocation()
+{
+}
+
+Mesh::~Mesh()
 {
-    std::vector<std::string> result;
-    size_t pos = 0;
-    while ((pos = s.find(t)) != std::string::npos)
+    release();
+}
+
+void Mesh::release()
+{
+    if (mStreamer != NULL)
+        mStreamer->cancel(this);
+    if (mArena != NULL)
+        mArena->free(mAllocation);
+    else
     {
-        result.push_back(s.substr(0, pos));
-        s = s.substr(pos + t.length()); // Move past the delimiter
+        GLState::deleteVertexArrays(1, &mVAO);
+        GLState::deleteBuffers(1, &mVBO);
+        GLState::deleteBuffers(1, &mEBO);
     }
-    result.push_back(s); // Add the remaining string after the last delimiter
-    return result;
+    mLoaded = false;
+    mCurrentLod = 0;
+    mResidentLod = 0;
+    mStreamer = NULL;
+    mVBO = mEBO = mVAO = 0;
+    mArena = NULL;
+    mAllocation = ArenaAllocation();
 }
 
+bool Mesh::loadOBJ(const std::string& filename, const VertexFormat& format, MeshStreamer* streamer)
+{
+    //immediately return if the file is not OBJ
+    if (filename.find(".obj") == std::string::npos)
+        return false;
+
+    MeshData mesh;
+    if (!loadMeshData(filename, mesh, &ThreadPool::shared(), format))
+        return false;
+    return create(mesh, format, streamer);
+}
 
-Mesh::Mesh()
-    :mLoaded(false)
+bool Mesh::create(const MeshData& data, const VertexFormat& format, MeshStreamer* streamer)
 {
+    if (data.lods.empty() || data.lods[0].numIndices == 0)
+        return false;
+
+    //A mesh created again gives back what it had first
+    release();
+    mFormat = format;
+    mBoundsMin = data.boundsMin;
+    mBoundsMax = data.boundsMax;
+    mLods = data.lods;
+    mMeshlets = data.meshlets;
+    mMaterials = data.materials;
+    mSubmeshes = data.submeshes;
+    initBuffer(data, streamer, NULL);
+    return (mLoaded = true);
 }
 
-Mesh::~Mesh()
+bool Mesh::create(const MeshData& data, GeometryArena& arena, MeshStreamer* streamer)
 {
-    glDeleteVertexArrays(1, &mVAO);
-    glDeleteBuffers(1, &mVBO);
+    if (data.lods.empty() || data.lods[0].numIndices == 0)
+        return false;
+
+    //A mesh created again gives back what it had first
+    release();
+    mFormat = arena.getFormat();
+    mBoundsMin = data.boundsMin;
+    mBoundsMax = data.boundsMax;
+    mLods = data.lods;
+    mMeshlets = data.meshlets;
+    mMaterials = data.materials;
+    mSubmeshes = data.submeshes;
+    initBuffer(data, streamer, &arena);
+    return (mLoaded = true);
 }
 
-bool Mesh::loadOBJ(const std::string& filename)
+void Mesh::draw()
 {
-    //temporary container when we are reading the file
-    std::vector<unsigned int> vertexIndices, uvIndices, normalIndices;
-    std::vector<glm::vec3> tempVertices;
-    std::vector<glm::vec2> tempUVs;
-    std::vector<glm::vec3> tempNormals;
-    
-    if (filename.find(".obj") != std::string::npos)
-    {
-        //try open the file
-        std::ifstream fin(filename, std::ios::in);
-        if (!fin)
-        {
-            std::cerr << "Cannot open file: " << filename << std::endl;
-            return false;
-        }
-        std::cout << "Loading OBJ file: " << filename << std::endl;
-        
-        std::string lineBuffer; // temporary string to hold "each line" read from the file
-        while (std::getline(fin, lineBuffer)) // reading line by line in the file
-        {
-            std::stringstream ss(lineBuffer); //Each line will create a string stream to manipulate strings
-            std::string cmd; // temporary string for processing
-            ss >> cmd; // The "first word" (divided by empty space) in the lineBuffer will be extracted into the cmd variable
-            
-            //checking every line and see if it includes the vertex position, texture coordinate or face
-            if (cmd == "v") //Vertex
-            {
-                glm::vec3 vertex;
-                int dim = 0;
-                // extract next 3 float value in ss and store them into vector
-                //The value in ss will be gone after being extracted
-                while (dim < 3 && ss >> vertex[dim]) 
-                    dim++;
-
-                tempVertices.push_back(vertex);//assign back to vertex value
-            }
-            else if (cmd == "vt") //UV
-            {
-                glm::vec2 uv;
-                int dim = 0;
-                while (dim < 2 && ss >> uv[dim])
-                    dim++;
-                
-                tempUVs.push_back(uv);//assign back to uv value
-            }
-            else if (cmd == "vn") //Normal
-            {
-                glm::vec3 normal;
-                int dim = 0;
-                while (dim < 3 && ss >> normal[dim])
-                    dim++;
-
-                normal = glm::normalize(normal);
-                tempNormals.push_back(normal);//assign back to normal value
-            }
-            else if (cmd == "f") // Face
-            {
-                std::string faceData;
-                int vertexIndex, uvIndex, normalIndex; // v/vt/vn
-
-                while (ss >> faceData)
-                {
-                    std::vector<std::string> data = split(faceData, "/");
-
-                    //vertex index
-                    if (data[0].size() > 0)
-                    {
-                        sscanf_s(data[0].c_str(), "%d", &vertexIndex);
-                        vertexIndices.push_back(vertexIndex);
-                    }
-
-                    //if the face vertex has a texture coordinate index
-                    if (data.size() >= 1)
-                    {
-                        if (data[1].size() > 0)
-                        {
-                            sscanf_s(data[1].c_str(), "%d", &uvIndex);
-                            uvIndices.push_back(uvIndex);
-                        }
-                    }
-
-                    //does the face vertex have normal index
-                    if (data.size() >= 2)
-                    {
-                        if (data[2].size() > 0)
-                        {
-                            sscanf_s(data[2].c_str(), "%d", &normalIndex);
-                            normalIndices.push_back(normalIndex);
-                        } 
-                    }
-                }
-            }
-        }
-        
+    if (!isDrawable()) return;
 
-        // close the file after reading
-        fin.close();
-        
-        //For each vertex of each triangle, set back the value
-        for (unsigned int i = 0; i < vertexIndices.size(); i++)
-        {
-            Vertex meshVertex;
-
-            if (tempVertices.size() > 0)
-            {
-                glm::vec3 vertex = tempVertices[vertexIndices[i] - 1];//C++ start from 0
-                meshVertex.position = vertex;
-            }
-            if (tempNormals.size() > 0)
-            {
-                glm::vec3 normal = tempNormals[normalIndices[i] - 1];
-                meshVertex.normal = normal;
-            }
-            if (tempUVs.size() > 0)
-            {
-                glm::vec2 uv = tempUVs[uvIndices[i] - 1];
-                meshVertex.texCoords = uv;
-            }
-            mVertices.push_back(meshVertex);
-        }
-        
-        initBuffer();
-        return (mLoaded = true);
-        
+    drawRange(mLods[mResidentLod].firstIndex, mLods[mResidentLod].numIndices);
+}
+
+void Mesh::drawLod(const glm::mat4& model, const glm::mat4& view, const glm::mat4& projection, const glm::vec3& cameraPosition,
+    float viewportHeight)
+{
+    if (!isDrawable()) return;
+
+    if (chooseLod(model, projection, cameraPosition, viewportHeight) == 0)
+        drawCulled(model, view, projection, cameraPosition);
+    else
+        drawRange(mLods[mCurrentLod].firstIndex, mLods[mCurrentLod].numIndices);
+}
+
+int Mesh::chooseLod(const glm::mat4& model, const glm::mat4& projection, const glm::vec3& cameraPosition, float viewportHeight)
+{
+    if (!isDrawable()) return mCurrentLod;
+
+    //Bounding sphere in world space. The largest axis scale keeps non uniform scaling conservative
+    glm::vec3 center = glm::vec3(model * glm::vec4((mBoundsMin + mBoundsMax) * 0.5f, 1.0f));
+    float scale = glm::max(glm::length(glm::vec3(model[0])), glm::max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))));
+    float radius = 0.5f * glm::length(mBoundsMax - mBoundsMin) * scale;
+
+    //Measured at the nearest point of the sphere. Inside it everything is full detail.
+    //projection[1][1] is 1 / tan(fovY / 2)
+    float distance = glm::length(center - cameraPosition) - radius;
+    float pixelsPerUnit = (distance > 0.0f) ? scale * viewportHeight * projection[1][1] / (2.0f * distance) : FLT_MAX;
+
+    //Never finer than what has been streamed in so far
+    mCurrentLod = std::max(selectLod(mLods, mCurrentLod, pixelsPerUnit), mResidentLod);
+    return mCurrentLod;
+}
+
+void Mesh::drawCulled(const glm::mat4& model, const glm::mat4& view, const glm::mat4& projection, const glm::vec3& cameraPosition)
+{
+    if (!isDrawable()) return;
+
+    //The meshlets cover the full level only
+    if (mResidentLod > 0)
+    {
+        drawRange(mLods[mResidentLod].firstIndex, mLods[mResidentLod].numIndices);
+        return;
     }
+    drawMeshlets(mMeshlets.data(), mMeshlets.size(), model, view, projection, cameraPosition);
+}
 
-    //immediately return if the file is not OBJ
-    return false;
+void Mesh::drawSubmesh(size_t material, int lod, const glm::mat4& model, const glm::mat4& view, const glm::mat4& projection,
+    const glm::vec3& cameraPosition)
+{
+    if (!isDrawable() || material >= mMaterials.size()) return;
+
+    lod = glm::clamp(lod, mResidentLod, (int)mLods.size() - 1);
+    const Submesh& submesh = mSubmeshes[lod * mMaterials.size() + material];
+    if (lod == 0)
+        drawMeshlets(mMeshlets.data() + submesh.firstMeshlet, submesh.numMeshlets, model, view, projection, cameraPosition);
+    else if (submesh.numIndices > 0)
+        drawRange(submesh.firstIndex, submesh.numIndices);
 }
 
-void Mesh::draw()
+void Mesh::drawInstanced(const InstanceBuffer& instances, int lod, GLuint firstInstance, GLsizei count)
+{
+    if (count < 0)
+        count = instances.size() - (GLsizei)firstInstance;
+    if (!isDrawable() || count <= 0)
+        return;
+    const MeshLod& level = mLods[std::max(std::min(lod, (int)mLods.size() - 1), mResidentLod)];
+
+    glVertexAttrib4fv(3, &mDequantizeScale[0]);
+    glVertexAttrib3fv(4, &mDequantizeOffset[0]);
+
+    GLState::bindVertexArray(mVAO);
+    instances.bindAttributes(firstInstance);
+    glDrawElementsInstancedBaseVertex(GL_TRIANGLES, level.numIndices, GL_UNSIGNED_INT,
+        (GLvoid*)((getFirstIndex() + level.firstIndex) * sizeof(GLuint)), count, getBaseVertex());
+    InstanceBuffer::unbindAttributes();
+    if (GLState::unbindAfterDraw())
+        GLState::bindVertexArray(0); // Unbind the VAO after drawing
+}
+
+void Mesh::drawMeshlets(const Meshlet* meshlets, size_t numMeshlets, const glm::mat4& model, const glm::mat4& view,
+    const glm::mat4& projection, const glm::vec3& cameraPosition)
 {
-    if (!mLoaded) return;
+    //Culling runs in model space: the frustum is brought in through the whole matrix chain, the camera through the inverse model
+    Frustum frustum = extractFrustum(projection * view * model);
+    glm::vec3 localCamera = glm::vec3(glm::inverse(model) * glm::vec4(cameraPosition, 1.0f));
+    cullMeshlets(meshlets, numMeshlets, frustum, localCamera, mDrawCounts, mDrawOffsets);
+    if (mDrawCounts.empty())
+        return;
 
-    glBindVertexArray(mVAO);
-    glDrawArrays(GL_TRIANGLES, 0, mVertices.size());
-    glBindVertexArray(0); // Unbind the VAO after drawing
+    //Ranges are relative to the mesh's own part of the buffers
+    mDrawBaseVertices.assign(mDrawCounts.size(), getBaseVertex());
+    for (const GLvoid*& offset : mDrawOffsets)
+        offset = (const char*)offset + getFirstIndex() * sizeof(GLuint);
+
+    //Dequantization constants for the vertex shaders. Attributes 3 and 4 have no array bound, so every vertex reads these values
+    glVertexAttrib4fv(3, &mDequantizeScale[0]);
+    glVertexAttrib3fv(4, &mDequantizeOffset[0]);
+
+    GLState::bindVertexArray(mVAO);
+    glMultiDrawElementsBaseVertex(GL_TRIANGLES, mDrawCounts.data(), GL_UNSIGNED_INT, (GLvoid**)mDrawOffsets.data(), (GLsizei)mDrawCounts.size(),
+        mDrawBaseVertices.data()); // GLEW declares the offsets non const
+    if (GLState::unbindAfterDraw())
+        GLState::bindVertexArray(0); // Unbind the VAO after drawing
+}
+
+void Mesh::drawRange(GLuint firstIndex, GLuint numIndices)
+{
+    //Dequantization constants for the vertex shaders. Attributes 3 and 4 have no array bound, so every vertex reads these values
+    glVertexAttrib4fv(3, &mDequantizeScale[0]);
+    glVertexAttrib3fv(4, &mDequantizeOffset[0]);
+
+    GLState::bindVertexArray(mVAO);
+    glDrawElementsBaseVertex(GL_TRIANGLES, numIndices, GL_UNSIGNED_INT, (GLvoid*)((getFirstIndex() + firstIndex) * sizeof(GLuint)),
+        getBaseVertex());
+    if (GLState::unbindAfterDraw())
+        GLState::bindVertexArray(0); // Unbind the VAO after drawing
 }
 
-void Mesh::initBuffer()
+void Mesh::initBuffer(const MeshData& data, MeshStreamer* streamer, GeometryArena* arena)
 {
-    // Generate and bind Vertex Buffer Object (VBO)
-    //A VBO is a memory buffer in the GPU that stores vertex data (e.g., positions, colors, normals)
-    glGenBuffers(1, &mVBO);
-    glBindBuffer(GL_ARRAY_BUFFER, mVBO);
-    glBufferData(GL_ARRAY_BUFFER, mVertices.size() * sizeof(Vertex), &mVertices[0], GL_STATIC_DRAW);
-
-    // Generate and bind Vertex Array Object (VAO)
-    //A VAO is an OpenGL object that stores the configuration of vertex attributes.It simplifies the process of switching between different vertex configurations.Related to VBO
-    glGenVertexArrays(1, &mVAO);
-    glBindVertexArray(mVAO);
-    
-    // Position attribute
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), NULL);
-    glEnableVertexAttribArray(0);
-
-    //Normals attribute
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLvoid*)(3 * sizeof(GLfloat)));
-    glEnableVertexAttribArray(1);
-    
-    //Texture coordinate attribute
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLvoid*)(6 * sizeof(GLfloat))); 
-    glEnableVertexAttribArray(2);
-
-    glBindVertexArray(0); // Unbind the VAO. We are done
+    //Straight from the cache's mapping when loadMeshData left the arrays there. See MeshCache.h
+    const Vertex* vertices = data.vertices.data();
+    size_t numVertices = data.vertices.size();
+    const GLuint* indices = data.indices.data();
+    size_t numIndices = data.indices.size();
+    if (data.cache != NULL)
+    {
+        vertices = data.cache->vertices();
+        numVertices = data.cache->numVertices();
+        indices = data.cache->indices();
+        numIndices = data.cache->numIndices();
+    }
+    mNumIndices = (GLsizei)numIndices;
+
+    //Compact formats are packed from the float vertices first, unless the cache holds them packed already. See VertexFormat.h
+    VertexLayout layout = getVertexLayout(mFormat);
+    getDequantization(mFormat, mBoundsMin, mBoundsMax, mDequantizeScale, mDequantizeOffset);
+
+    std::vector<unsigned char> packed;
+    const GLvoid* vertexData = data.cache != NULL ? data.cache->packedVertices(mFormat) : NULL;
+    if (vertexData == NULL && mFormat.isFloat())
+        vertexData = vertices;
+    else if (vertexData == NULL)
+    {
+        packVertices(vertices, numVertices, mFormat, mBoundsMin, mBoundsMax, packed);
+        vertexData = packed.data();
+    }
+
+    //Streamed meshes get their buffers allocated now and filled later. The streamer keeps its own copy of the data,
+    //the vertices may point into a cache mapping that closes when loadOBJ returns
+    if (streamer != NULL)
+    {
+        if (packed.empty())
+            packed.assign((const unsigned char*)vertexData, (const unsigned char*)vertexData + numVertices * layout.stride);
+        vertexData = NULL;
+        mResidentLod = (int)mLods.size();
+        mStreamer = streamer;
+    }
+
+    //Meshes in an arena only fill their part of its buffers, the VAO is the arena's
+    if (arena != NULL && arena->allocate(numVertices, numIndices, mAllocation))
+    {
+        mArena = arena;
+        mVBO = arena->getVertexBuffer();
+        mEBO = arena->getIndexBuffer();
+        mVAO = arena->getVertexArray();
+        if (streamer == NULL)
+        {
+            GLState::bindBuffer(GL_COPY_WRITE_BUFFER, mVBO);
+            glBufferSubData(GL_COPY_WRITE_BUFFER, mAllocation.firstVertex * layout.stride, numVertices * layout.stride, vertexData);
+            GLState::bindBuffer(GL_COPY_WRITE_BUFFER, mEBO);
+            glBufferSubData(GL_COPY_WRITE_BUFFER, mAllocation.firstIndex * sizeof(GLuint), numIndices * sizeof(GLuint), indices);
+            GLState::bindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        }
+    }
+    else
+    {
+        if (arena != NULL)
+            std::cerr << "Geometry arena full, " << numVertices << " vertices and " << numIndices << " indices get their own buffers" << std::endl;
+
+        // Generate and bind Vertex Buffer Object (VBO)
+        //A VBO is a memory buffer in the GPU that stores vertex data (e.g., positions, colors, normals)
+        glGenBuffers(1, &mVBO);
+        GLState::bindBuffer(GL_ARRAY_BUFFER, mVBO);
+        glBufferData(GL_ARRAY_BUFFER, numVertices * layout.stride, vertexData, GL_STATIC_DRAW);
+
+        // Generate and bind Vertex Array Object (VAO)
+        //A VAO is an OpenGL object that stores the configuration of vertex attributes.It simplifies the process of switching between different vertex configurations.Related to VBO
+        glGenVertexArrays(1, &mVAO);
+        GLState::bindVertexArray(mVAO);
+        setVertexAttributes(layout);
+
+        // Generate the Element Buffer Object (EBO) while the VAO is bound, so the VAO remembers it
+        //An EBO stores the indices of the vertices that make up each triangle. Shared vertices are stored only once
+        glGenBuffers(1, &mEBO);
+        GLState::bindBuffer(GL_ELEMENT_ARRAY_BUFFER, mEBO);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, numIndices * sizeof(GLuint), streamer != NULL ? NULL : indices, GL_STATIC_DRAW);
+
+        GLState::bindVertexArray(0); // Unbind the VAO. We are done
+    }
+
+    if (streamer != NULL)
+    {
+        std::vector<GLuint> indexData(indices, indices + numIndices);
+        streamer->enqueue(this, packed, layout.stride, indexData);
+    }
 }
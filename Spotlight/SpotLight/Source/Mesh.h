@@ -6,14 +6,46 @@
 
 #include "GL/glew.h"
 #include "glm/glm.hpp"
+#include "VertexFormat.h" // struct Vertex and the compact GPU layouts
+#include "Material.h"
+#include "GeometryArena.h"
 
-struct Vertex
+class InstanceBuffer;
+class MeshStreamer;
+struct MeshData;
+
+//One level of detail: a range of the index buffer over the shared vertices
+struct MeshLod
 {
-    glm::vec3 position; // Vertex position
-    glm::vec3 normal; //Normal
-    glm::vec2 texCoords; // Texture coordinates
+    GLuint firstIndex;
+    GLuint numIndices;
+    float error; // how far this level may deviate from the full mesh, in model units
+    GLuint numVertices; // the level only uses vertices [0, numVertices), see sortVerticesByLod in MeshSimplifier.h
 };
 
+//A small cluster of the full detail triangles, see MeshletBuilder.h. Model space
+struct Meshlet
+{
+    GLuint firstIndex;
+    GLuint numIndices;
+    glm::vec3 center; // bounding sphere
+    float radius;
+    glm::vec3 coneApex; // backfacing when dot(normalize(coneApex - camera), coneAxis) >= coneCutoff
+    glm::vec3 coneAxis;
+    float coneCutoff;
+};
+
+//The triangles of one material within one level of detail: a range of the index buffer inside that level's range.
+//Every level has one submesh per material, so submesh lod * numMaterials + material is the one to draw
+struct Submesh
+{
+    GLuint material; // into the mesh's material table
+    GLuint lod;
+    GLuint firstIndex;
+    GLuint numIndices;
+    GLuint firstMeshlet; // level 0 only: the meshlets covering this range
+    GLuint numMeshlets;
+};
 
 class Mesh
 {
@@ -21,16 +53,94 @@ public:
     Mesh();
     ~Mesh();
 
-    bool loadOBJ(const std::string& filename);
-    void draw();
+    //format picks the GPU vertex layout, see VertexFormat.h. The default is full float.
+    //With a streamer the GPU buffers are filled over the next frames, coarsest level first, see MeshStreamer.h.
+    //Until then every draw call uses the finest level already on the GPU, or draws nothing
+    bool loadOBJ(const std::string& filename, const VertexFormat& format = VertexFormat(), MeshStreamer* streamer = NULL);
+
+    //GL half of loadOBJ, for data loaded off the GL thread with loadMeshData (MeshBuilder.h), see AssetLoader.h
+    bool create(const MeshData& data, const VertexFormat& format = VertexFormat(), MeshStreamer* streamer = NULL);
+
+    //Same, with the vertices and indices suballocated from a shared arena in its vertex format, see GeometryArena.h.
+    //Falls back to buffers of its own when the arena is full
+    bool create(const MeshData& data, GeometryArena& arena, MeshStreamer* streamer = NULL);
+    void draw(); // full detail
+
+    //Picks the level of detail from how large its error would look on screen, see selectLod in MeshSimplifier.h.
+    //Full detail goes through drawCulled. viewportHeight in pixels
+    void drawLod(const glm::mat4& model, const glm::mat4& view, const glm::mat4& projection, const glm::vec3& cameraPosition,
+        float viewportHeight);
+
+    //Full detail, minus the meshlets outside the frustum or facing away from the camera. One glMultiDrawElements call
+    void drawCulled(const glm::mat4& model, const glm::mat4& view, const glm::mat4& projection, const glm::vec3& cameraPosition);
+
+    //The level drawLod would draw with, keeping its hysteresis. For callers that draw the materials one by one
+    int chooseLod(const glm::mat4& model, const glm::mat4& projection, const glm::vec3& cameraPosition, float viewportHeight);
+
+    //Only the triangles of one material, at a level from chooseLod. Level 0 culls meshlets like drawCulled.
+    //Binding the material's textures and uniforms is up to the caller, see RenderQueue.h
+    void drawSubmesh(size_t material, int lod, const glm::mat4& model, const glm::mat4& view, const glm::mat4& projection,
+        const glm::vec3& cameraPosition);
+
+    //count copies of one level in a single call, each with its model matrix from instances, starting at firstInstance.
+    //count -1 draws the rest of the buffer. Needs the instanced shaders, see InstanceBuffer.h. No meshlet culling
+    void drawInstanced(const InstanceBuffer& instances, int lod = 0, GLuint firstInstance = 0, GLsizei count = -1);
+
+    //Axis aligned bounding box in model space
+    const glm::vec3& getBoundsMin() const { return mBoundsMin; }
+    const glm::vec3& getBoundsMax() const { return mBoundsMax; }
+
+    //Level drawn by the last drawLod call
+    int getCurrentLod() const { return mCurrentLod; }
+    const std::vector<MeshLod>& getLods() const { return mLods; }
+    const std::vector<Meshlet>& getMeshlets() const { return mMeshlets; }
+
+    //From the OBJ's usemtl lines and mtllib files. Meshes without usemtl have one default material
+    const std::vector<Material>& getMaterials() const { return mMaterials; }
+    const std::vector<Submesh>& getSubmeshes() const { return mSubmeshes; }
+
+    //NULL unless the mesh lives in an arena. Index ranges then start at getFirstIndex(), indices count from getBaseVertex()
+    GeometryArena* getArena() const { return mArena; }
+    GLuint getFirstIndex() const { return mArena != NULL ? mAllocation.firstIndex : 0; }
+    GLint getBaseVertex() const { return mArena != NULL ? (GLint)mAllocation.firstVertex : 0; }
+
+    //Per mesh constants of the compact formats, see getDequantization in VertexFormat.h
+    const glm::vec4& getDequantizeScale() const { return mDequantizeScale; }
+    const glm::vec3& getDequantizeOffset() const { return mDequantizeOffset; }
+
+    //Finest level on the GPU. getLods().size() while a streamed mesh has nothing drawable yet
+    int getResidentLod() const { return mResidentLod; }
+    bool isDrawable() const { return mLoaded && mResidentLod < (int)mLods.size(); }
 
 private:
+    friend class MeshStreamer;
 
-    void initBuffer();
+    //Frees the buffers, or the arena allocation, and stops streaming. Before creating again and on destruction
+    void release();
+    void initBuffer(const MeshData& data, MeshStreamer* streamer, GeometryArena* arena);
+    void drawRange(GLuint firstIndex, GLuint numIndices);
+    void drawMeshlets(const Meshlet* meshlets, size_t numMeshlets, const glm::mat4& model, const glm::mat4& view,
+        const glm::mat4& projection, const glm::vec3& cameraPosition);
     
     bool mLoaded;
-    std::vector<Vertex> mVertices;// store collections elements(vertex structure) of the same data type
-    GLuint mVBO, mVAO;
+    GLsizei mNumIndices; // three per triangle, all levels
+    std::vector<MeshLod> mLods; // mLods[0] is the full mesh
+    int mCurrentLod;
+    int mResidentLod;
+    MeshStreamer* mStreamer; // while parts of the buffers are still queued or in flight
+    std::vector<Meshlet> mMeshlets; // over mLods[0]
+    std::vector<Material> mMaterials;
+    std::vector<Submesh> mSubmeshes; // mMaterials.size() per level, level by level
+    std::vector<GLsizei> mDrawCounts; // glMultiDrawElements arguments, kept to avoid allocating every frame
+    std::vector<const GLvoid*> mDrawOffsets;
+    std::vector<GLint> mDrawBaseVertices;
+    glm::vec3 mBoundsMin, mBoundsMax;
+    VertexFormat mFormat;
+    glm::vec4 mDequantizeScale; // position scale, w = 1 for octahedral normals
+    glm::vec3 mDequantizeOffset;
+    GLuint mVBO, mEBO, mVAO; // the arena's when mArena is set, not owned then
+    GeometryArena* mArena;
+    ArenaAllocation mAllocation;
     
 };
 
@@ -0,0 +1,199 @@
+#include "MeshBuilder.h"
+#include "Hash.h"
+#include "MappedFile.h"
+#include "Material.h"
+#include "MeshCache.h"
+#include "MeshIndexer.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+#include "MeshletBuilder.h"
+#include "NormalGenerator.h"
+#include "ObjParser.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <iostream>
+
+namespace
+{
+    //The per material half of the pipeline. Every material gets its own triangle order and LOD chain, then the index
+    //buffer is laid out level by level, and within a level material by material. So a level stays one range for the
+    //plain draws and the streamer, and every submesh is a range inside it. A material whose chain ends early repeats
+    //its coarsest level in the levels after, every level has to cover the whole mesh
+    void buildMaterialLevels(std::vector<Vertex>& vertices, const std::vector<GLuint>& triangles, const ObjData& data, MeshData& mesh)
+    {
+        //Triangles by material, in file order. Materials no triangle uses are dropped
+        std::vector<std::vector<GLuint> > groups(data.materialNames.size());
+        bool perTriangle = data.triangleMaterials.size() * 3 == triangles.size();
+        for (size_t t = 0; t < triangles.size() / 3; t++)
+        {
+            std::vector<GLuint>& group = groups[perTriangle ? data.triangleMaterials[t] : 0];
+            group.insert(group.end(), triangles.begin() + t * 3, triangles.begin() + t * 3 + 3);
+        }
+
+        mesh.materials.clear();
+        for (size_t m = 0; m < groups.size(); m++)
+        {
+            if (!groups[m].empty())
+                mesh.materials.push_back(Material(data.materialNames[m]));
+        }
+        groups.erase(std::remove_if(groups.begin(), groups.end(), [](const std::vector<GLuint>& group) { return group.empty(); }), groups.end());
+
+        //Triangle order for the post-transform cache and overdraw per material, vertex order for fetch over all of them.
+        //With a single material this is exactly optimizeMesh. See MeshOptimizer.h
+        std::vector<GLuint> all;
+        for (std::vector<GLuint>& group : groups)
+        {
+            std::vector<size_t> clusters;
+            optimizeVertexCache(group, vertices.size(), VERTEX_CACHE_SIZE, &clusters);
+            optimizeOverdraw(group, vertices, clusters);
+            all.insert(all.end(), group.begin(), group.end());
+        }
+        optimizeVertexFetch(vertices, all);
+
+        //Simplified levels share the vertices and go after each material's full index list. See MeshSimplifier.h
+        std::vector<std::vector<MeshLod> > groupLods(groups.size());
+        size_t numLevels = 0, offset = 0;
+        for (size_t g = 0; g < groups.size(); g++)
+        {
+            groups[g].assign(all.begin() + offset, all.begin() + offset + groups[g].size());
+            offset += groups[g].size();
+            buildLodChain(vertices, groups[g], groupLods[g]);
+            numLevels = std::max(numLevels, groupLods[g].size());
+        }
+
+        mesh.indices.clear();
+        mesh.lods.clear();
+        mesh.submeshes.clear();
+        for (size_t level = 0; level < numLevels; level++)
+        {
+            MeshLod lod = { (GLuint)mesh.indices.size(), 0, 0.0f, (GLuint)vertices.size() };
+            for (size_t g = 0; g < groups.size(); g++)
+            {
+                const MeshLod& source = groupLods[g][std::min(level, groupLods[g].size() - 1)];
+                Submesh submesh = { (GLuint)g, (GLuint)level, (GLuint)mesh.indices.size(), source.numIndices, 0, 0 };
+                mesh.indices.insert(mesh.indices.end(), groups[g].begin() + source.firstIndex,
+                    groups[g].begin() + source.firstIndex + source.numIndices);
+                mesh.submeshes.push_back(submesh);
+                lod.error = std::max(lod.error, source.error);
+            }
+            lod.numIndices = (GLuint)mesh.indices.size() - lod.firstIndex;
+            mesh.lods.push_back(lod);
+        }
+    }
+}
+
+bool buildMeshData(const char* objBegin, const char* objEnd, MeshData& mesh, ThreadPool* pool)
+{
+    //In place parsing, split across the pool for big files. See ObjParser.h
+    ObjData data;
+    parseOBJBuffer(objBegin, objEnd, data, pool);
+    if (data.corners.empty())
+        return false;
+
+    //Scans and CAD exports often come without vn. Smooth normals from the faces instead. See NormalGenerator.h
+    if (needsNormals(data))
+        generateNormals(data, NormalOptions(), pool);
+
+    //Corners sharing the same v/vt/vn become one vertex, triangles index into them
+    std::vector<GLuint> triangles;
+    buildIndexedMesh(data, mesh.vertices, triangles);
+
+    //Optimized and simplified per material, see above
+    mesh.materialLibraries = data.materialLibraries;
+    buildMaterialLevels(mesh.vertices, triangles, data, mesh);
+
+    //Vertices of the coarse levels first, so streaming can draw them early. See MeshStreamer.h
+    sortVerticesByLod(mesh.vertices, mesh.indices, mesh.lods);
+
+    //Clusters of the full level with bounds for per frame culling, material by material. See MeshletBuilder.h
+    mesh.meshlets.clear();
+    for (size_t m = 0; m < mesh.materials.size(); m++)
+    {
+        Submesh& submesh = mesh.submeshes[m];
+        std::vector<Meshlet> meshlets;
+        buildMeshlets(mesh.vertices, mesh.indices, submesh.firstIndex, submesh.numIndices, meshlets);
+        submesh.firstMeshlet = (GLuint)mesh.meshlets.size();
+        submesh.numMeshlets = (GLuint)meshlets.size();
+        mesh.meshlets.insert(mesh.meshlets.end(), meshlets.begin(), meshlets.end());
+    }
+
+    computeBounds(mesh.vertices, mesh.boundsMin, mesh.boundsMax);
+    return true;
+}
+
+bool loadMeshData(const std::string& filename, MeshData& mesh, ThreadPool* pool, const VertexFormat& format)
+{
+    MappedFile objFile;
+    if (!objFile.open(filename))
+    {
+        std::cerr << "Cannot open file: " << filename << std::endl;
+        return false;
+    }
+    std::cout << "Loading OBJ file: " << filename << std::endl;
+
+    //The binary cache is only used when it was built from exactly these bytes. See MeshCache.h
+    uint64_t sourceHash = hashBytes(objFile.data(), objFile.size());
+    std::string cacheFilename = MeshCache::cacheFilename(filename);
+
+    std::shared_ptr<MeshCache> cache = std::make_shared<MeshCache>();
+    if (cache->open(cacheFilename, sourceHash))
+    {
+        //The vertices and indices stay in the mapping. The small arrays are copied, the Mesh keeps them anyway
+        mesh.vertices.clear();
+        mesh.indices.clear();
+        mesh.lods.assign(cache->lods(), cache->lods() + cache->numLods());
+        mesh.meshlets.assign(cache->meshlets(), cache->meshlets() + cache->numMeshlets());
+        mesh.submeshes.assign(cache->submeshes(), cache->submeshes() + cache->numSubmeshes());
+        mesh.materialLibraries = cache->materialLibraries();
+        mesh.materials.clear();
+        for (const std::string& name : cache->materialNames())
+            mesh.materials.push_back(Material(name));
+        mesh.boundsMin = cache->boundsMin();
+        mesh.boundsMax = cache->boundsMax();
+        mesh.cache = cache;
+    }
+    else
+    {
+        mesh.cache.reset();
+        //No usable cache: run the full CPU pipeline and save the result for next time
+        if (!buildMeshData(objFile.data(), objFile.data() + objFile.size(), mesh, pool))
+        {
+            std::cerr << "No faces in OBJ file: " << filename << std::endl;
+            return false;
+        }
+        if (!MeshCache::write(cacheFilename, sourceHash, mesh, format))
+            std::cerr << "Cannot write mesh cache: " << cacheFilename << std::endl;
+    }
+
+    //Colors and texture names from the mtllib files. See Material.h
+    loadMaterials(filename, mesh.materialLibraries, mesh.materials);
+    return true;
+}
+
+bool cookOBJ(const std::string& filename, const VertexFormat& format)
+{
+    MappedFile objFile;
+    if (!objFile.open(filename))
+    {
+        std::cerr << "Cannot open file: " << filename << std::endl;
+        return false;
+    }
+
+    MeshData mesh;
+    if (!buildMeshData(objFile.data(), objFile.data() + objFile.size(), mesh, &ThreadPool::shared()))
+    {
+        std::cerr << "No faces in OBJ file: " << filename << std::endl;
+        return false;
+    }
+
+    std::string cacheFilename = MeshCache::cacheFilename(filename);
+    if (!MeshCache::write(cacheFilename, hashBytes(objFile.data(), objFile.size()), mesh, format))
+    {
+        std::cerr << "Cannot write mesh cache: " << cacheFilename << std::endl;
+        return false;
+    }
+
+    std::cout << "Cooked " << filename << ": " << mesh.vertices.size() << " vertices, " << mesh.lods[0].numIndices / 3 << " triangles, "
+        << mesh.lods.size() << " levels of detail, " << mesh.meshlets.size() << " meshlets, " << mesh.materials.size() << " materials" << std::endl;
+    return true;
+}
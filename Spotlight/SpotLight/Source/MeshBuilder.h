@@ -0,0 +1,45 @@
+#ifndef MESH_BUILDER_H
+#define MESH_BUILDER_H
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Mesh.h"
+
+class MeshCache;
+class ThreadPool;
+
+//CPU side of a mesh: everything that goes into the GPU buffers and the binary cache
+struct MeshData
+{
+    std::vector<Vertex> vertices; // empty when they stay in the cache, see below
+    std::vector<GLuint> indices; // three per triangle, every level of detail one after the other. Empty with the cache too
+    std::vector<MeshLod> lods; // ranges of indices, lods[0] is the full mesh
+    std::vector<Meshlet> meshlets; // clusters of lods[0] for culling, none crosses a material
+    std::vector<Submesh> submeshes; // the ranges of every material in every level
+    std::vector<std::string> materialLibraries; // mtllib, relative to the OBJ
+    std::vector<Material> materials; // the materials with triangles. buildMeshData only sets the names, loadMeshData the rest
+    glm::vec3 boundsMin, boundsMax;
+
+    //Set by loadMeshData when it found a valid binary cache. Its mapping holds the vertices and indices, and stays open
+    //until the last copy of this goes, so Mesh::create uploads them from there without a copy. See MeshCache.h
+    std::shared_ptr<MeshCache> cache;
+};
+
+//The whole pipeline from OBJ text: parse, generate the missing normals, weld into indexed vertices, optimize for the vertex cache, overdraw and
+//vertex fetch, build the LOD chain and the meshlets, then compute the bounds. Returns false when the file has no faces.
+//Each usemtl material is optimized, simplified and clustered on its own, so every level can be drawn material by material
+bool buildMeshData(const char* objBegin, const char* objEnd, MeshData& mesh, ThreadPool* pool);
+
+//CPU half of Mesh::loadOBJ, safe to run on any thread: the arrays from the binary cache when it was built from this
+//exact file, otherwise the full pipeline above, whose result is then cached with the vertices packed in format, the
+//GPU layout the mesh will be created with. The MTL files are read every time, they are small and can change without
+//the OBJ. Returns false when the file can't be read or has no faces
+bool loadMeshData(const std::string& filename, MeshData& mesh, ThreadPool* pool, const VertexFormat& format = VertexFormat());
+
+//Offline step: builds the binary cache next to an OBJ so the app never parses, optimizes or packs it at runtime.
+//Used by "SpotLight.exe --cook <file.obj>...", with the layout main.cpp draws its models in
+bool cookOBJ(const std::string& filename, const VertexFormat& format = VertexFormat::compact());
+
+#endif
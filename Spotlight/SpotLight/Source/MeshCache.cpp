@@ -0,0 +1,233 @@
+#include "MeshCache.h"
+#include "Hash.h"
+#include <cstring>
+
+namespace
+{
+    const char MESH_CACHE_MAGIC[4] = { 'M', 'S', 'H', 'C' };
+
+    //Bump whenever the file layout or the content of the arrays changes. Older caches are then rebuilt
+    const uint32_t MESH_CACHE_VERSION = 9;
+
+    //96 bytes, so the vertex array that follows stays 16 byte aligned
+    struct MeshCacheHeader
+    {
+        char magic[4];
+        uint32_t version;
+        uint32_t vertexSize; // sizeof(Vertex) of the writer
+        uint32_t numVertices;
+        uint32_t numIndices;
+        uint32_t numLods;
+        uint64_t sourceHash; // hash of the OBJ file the arrays were built from
+        uint64_t payloadHash; // hash of everything after the header, catches truncated or damaged files
+        float boundsMin[3];
+        float boundsMax[3];
+        uint32_t numMeshlets;
+        uint32_t numSubmeshes; // numLods * materials
+        uint32_t numMaterialLibraries; // the first names of the string block, the material names follow
+        uint32_t stringBytes; // zero terminated names after the submeshes
+        uint32_t packedPosition; // VertexFormat of the packed vertices after the float ones
+        uint32_t packedNormal;
+        uint32_t packedTexCoords;
+        uint32_t packedStride; // 0 when there is no packed copy
+    };
+    static_assert(sizeof(MeshCacheHeader) == 96, "MeshCacheHeader must stay 96 bytes");
+
+    uint64_t hashPayload(const Vertex* vertices, size_t numVertices, const unsigned char* packed, size_t packedBytes,
+        const GLuint* indices, size_t numIndices, const MeshLod* lods, size_t numLods, const Meshlet* meshlets, size_t numMeshlets,
+        const Submesh* submeshes, size_t numSubmeshes, const char* strings, size_t stringBytes)
+    {
+        uint64_t hash = hashBytes(vertices, numVertices * sizeof(Vertex));
+        hash = hashBytes(packed, packedBytes, hash);
+        hash = hashBytes(indices, numIndices * sizeof(GLuint), hash);
+        hash = hashBytes(lods, numLods * sizeof(MeshLod), hash);
+        hash = hashBytes(meshlets, numMeshlets * sizeof(Meshlet), hash);
+        hash = hashBytes(submeshes, numSubmeshes * sizeof(Submesh), hash);
+        return hashBytes(strings, stringBytes, hash);
+    }
+}
+
+MeshCache::MeshCache()
+    :mVertices(NULL),
+    mNumVertices(0),
+    mPackedVertices(NULL),
+    mIndices(NULL),
+    mNumIndices(0),
+    mLods(NULL),
+    mNumLods(0),
+    mMeshlets(NULL),
+    mNumMeshlets(0),
+    mSubmeshes(NULL),
+    mNumSubmeshes(0),
+    mBoundsMin(0.0f),
+    mBoundsMax(0.0f)
+{
+}
+
+bool MeshCache::open(const std::string& filename, uint64_t sourceHash)
+{
+    close();
+
+    if (!mFile.open(filename))
+        return false;
+
+    if (mFile.size() < sizeof(MeshCacheHeader))
+    {
+        close();
+        return false;
+    }
+
+    MeshCacheHeader header;
+    memcpy(&header, mFile.data(), sizeof(header));
+
+    //A packed copy has to be in a layout this build knows, with the stride it gives. Strides are multiples of 4, so the
+    //indices after it stay aligned
+    VertexFormat packedFormat((PositionFormat)header.packedPosition, (NormalFormat)header.packedNormal,
+        (TexCoordFormat)header.packedTexCoords);
+    bool knownFormat = header.packedPosition <= POSITION_UNORM16 && header.packedNormal <= NORMAL_OCT16 &&
+        header.packedTexCoords <= TEXCOORD_HALF;
+    size_t packedBytes = (size_t)header.numVertices * header.packedStride;
+
+    size_t expectedSize = sizeof(MeshCacheHeader) + (size_t)header.numVertices * sizeof(Vertex) + packedBytes + (size_t)header.numIndices * sizeof(GLuint) +
+        (size_t)header.numLods * sizeof(MeshLod) + (size_t)header.numMeshlets * sizeof(Meshlet) +
+        (size_t)header.numSubmeshes * sizeof(Submesh) + header.stringBytes;
+    bool valid = memcmp(header.magic, MESH_CACHE_MAGIC, sizeof(MESH_CACHE_MAGIC)) == 0 &&
+        header.version == MESH_CACHE_VERSION &&
+        header.vertexSize == sizeof(Vertex) &&
+        header.sourceHash == sourceHash &&
+        header.numLods > 0 &&
+        header.numSubmeshes > 0 && header.numSubmeshes % header.numLods == 0 &&
+        (header.packedStride == 0 || (knownFormat && !packedFormat.isFloat() &&
+            header.packedStride == (uint32_t)getVertexLayout(packedFormat).stride && header.packedStride % 4 == 0)) &&
+        mFile.size() == expectedSize;
+
+    if (!valid)
+    {
+        close();
+        return false;
+    }
+
+    const Vertex* vertices = (const Vertex*)(mFile.data() + sizeof(MeshCacheHeader));
+    const unsigned char* packed = (const unsigned char*)(vertices + header.numVertices);
+    const GLuint* indices = (const GLuint*)(packed + packedBytes);
+    const MeshLod* lods = (const MeshLod*)(indices + header.numIndices);
+    const Meshlet* meshlets = (const Meshlet*)(lods + header.numLods);
+    const Submesh* submeshes = (const Submesh*)(meshlets + header.numMeshlets);
+    const char* strings = (const char*)(submeshes + header.numSubmeshes);
+    if (hashPayload(vertices, header.numVertices, packed, packedBytes, indices, header.numIndices, lods, header.numLods, meshlets,
+        header.numMeshlets, submeshes, header.numSubmeshes, strings, header.stringBytes) != header.payloadHash)
+    {
+        close();
+        return false;
+    }
+
+    //The names, one after the other. The block has to hold exactly the libraries plus one name per material
+    std::vector<std::string> names;
+    for (const char* p = strings; p < strings + header.stringBytes; p += names.back().size() + 1)
+        names.push_back(std::string(p, strnlen(p, strings + header.stringBytes - p)));
+    if (names.size() != header.numMaterialLibraries + header.numSubmeshes / header.numLods)
+    {
+        close();
+        return false;
+    }
+    mMaterialLibraries.assign(names.begin(), names.begin() + header.numMaterialLibraries);
+    mMaterialNames.assign(names.begin() + header.numMaterialLibraries, names.end());
+
+    mVertices = vertices;
+    mNumVertices = header.numVertices;
+    mPackedVertices = header.packedStride > 0 ? packed : NULL;
+    mPackedFormat = packedFormat;
+    mIndices = indices;
+    mNumIndices = header.numIndices;
+    mLods = lods;
+    mNumLods = header.numLods;
+    mMeshlets = meshlets;
+    mNumMeshlets = header.numMeshlets;
+    mSubmeshes = submeshes;
+    mNumSubmeshes = header.numSubmeshes;
+    mBoundsMin = glm::vec3(header.boundsMin[0], header.boundsMin[1], header.boundsMin[2]);
+    mBoundsMax = glm::vec3(header.boundsMax[0], header.boundsMax[1], header.boundsMax[2]);
+    return true;
+}
+
+void MeshCache::close()
+{
+    mFile.close();
+    mVertices = NULL;
+    mNumVertices = 0;
+    mPackedVertices = NULL;
+    mPackedFormat = VertexFormat();
+    mIndices = NULL;
+    mNumIndices = 0;
+    mLods = NULL;
+    mNumLods = 0;
+    mMeshlets = NULL;
+    mNumMeshlets = 0;
+    mSubmeshes = NULL;
+    mNumSubmeshes = 0;
+    mMaterialLibraries.clear();
+    mMaterialNames.clear();
+}
+
+const void* MeshCache::packedVertices(const VertexFormat& format) const
+{
+    if (format.isFloat())
+        return mVertices;
+    return mPackedVertices != NULL && format == mPackedFormat ? mPackedVertices : NULL;
+}
+
+bool MeshCache::write(const std::string& filename, uint64_t sourceHash, const MeshData& mesh, const VertexFormat& format)
+{
+    const std::vector<Vertex>& vertices = mesh.vertices;
+    const std::vector<GLuint>& indices = mesh.indices;
+    const std::vector<MeshLod>& lods = mesh.lods;
+    const std::vector<Meshlet>& meshlets = mesh.meshlets;
+    const std::vector<Submesh>& submeshes = mesh.submeshes;
+
+    std::string strings;
+    for (const std::string& library : mesh.materialLibraries)
+        strings.append(library.c_str(), library.size() + 1);
+    for (const Material& material : mesh.materials)
+        strings.append(material.name.c_str(), material.name.size() + 1);
+
+    //Packed with the bounds stored below, as Mesh::create would pack them
+    std::vector<unsigned char> packed;
+    if (!format.isFloat())
+        packVertices(vertices.data(), vertices.size(), format, mesh.boundsMin, mesh.boundsMax, packed);
+
+    MeshCacheHeader header = {};
+    memcpy(header.magic, MESH_CACHE_MAGIC, sizeof(MESH_CACHE_MAGIC));
+    header.version = MESH_CACHE_VERSION;
+    header.vertexSize = sizeof(Vertex);
+    header.numVertices = (uint32_t)vertices.size();
+    header.numIndices = (uint32_t)indices.size();
+    header.numLods = (uint32_t)lods.size();
+    header.numMeshlets = (uint32_t)meshlets.size();
+    header.numSubmeshes = (uint32_t)submeshes.size();
+    header.numMaterialLibraries = (uint32_t)mesh.materialLibraries.size();
+    header.stringBytes = (uint32_t)strings.size();
+    header.packedPosition = format.position;
+    header.packedNormal = format.normal;
+    header.packedTexCoords = format.texCoords;
+    header.packedStride = format.isFloat() ? 0 : (uint32_t)getVertexLayout(format).stride;
+    header.sourceHash = sourceHash;
+    header.payloadHash = hashPayload(vertices.data(), vertices.size(), packed.data(), packed.size(), indices.data(), indices.size(),
+        lods.data(), lods.size(), meshlets.data(), meshlets.size(), submeshes.data(), submeshes.size(), strings.data(), strings.size());
+    for (int i = 0; i < 3; i++)
+    {
+        header.boundsMin[i] = mesh.boundsMin[i];
+        header.boundsMax[i] = mesh.boundsMax[i];
+    }
+
+    return writeFileAtomically(filename, [&](std::ostream& file)
+    {
+        file.write((const char*)&header, sizeof(header));
+        file.write((const char*)vertices.data(), vertices.size() * sizeof(Vertex));
+        file.write((const char*)packed.data(), packed.size());
+        file.write((const char*)indices.data(), indices.size() * sizeof(GLuint));
+        file.write((const char*)lods.data(), lods.size() * sizeof(MeshLod));
+        file.write((const char*)meshlets.data(), meshlets.size() * sizeof(Meshlet));
+        file.write((const char*)submeshes.data(), submeshes.size() * sizeof(Submesh));
+        file.write(strings.data(), strings.size());
+    });
+}
@@ -0,0 +1,70 @@
+#ifndef MESH_CACHE_H
+#define MESH_CACHE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Mesh.h"
+#include "MappedFile.h"
+#include "MeshBuilder.h"
+
+//----------------------------------------------
+//Binary sidecar written next to an OBJ ("RubberToy.obj.meshcache") holding the final vertex, index, LOD, meshlet and
+//submesh arrays, followed by the mtllib and material names. The vertices are also stored packed in the GPU layout
+//they were cached for (VertexFormat.h), so loading them in that layout skips packVertices.
+//Opening it is a file mapping plus a few checks, and the arrays go to OpenGL straight from the mapping.
+//----------------------------------------------
+class MeshCache
+{
+public:
+    MeshCache();
+
+    static std::string cacheFilename(const std::string& objFilename) { return objFilename + ".meshcache"; }
+
+    //Maps the cache and checks that it is complete, undamaged and was built from this exact source
+    bool open(const std::string& filename, uint64_t sourceHash);
+    void close();
+
+    //Writes to a temporary file first, so a crash never leaves a half written cache behind.
+    //format is the GPU layout the packed copy of the vertices is stored in. Full float stores none, it would be the same bytes
+    static bool write(const std::string& filename, uint64_t sourceHash, const MeshData& mesh, const VertexFormat& format = VertexFormat());
+
+    const Vertex* vertices() const { return mVertices; }
+    size_t numVertices() const { return mNumVertices; }
+    //The vertices in format's GPU layout: the packed copy when the cache holds that layout, the float array for full
+    //float, NULL otherwise
+    const void* packedVertices(const VertexFormat& format) const;
+    const GLuint* indices() const { return mIndices; }
+    size_t numIndices() const { return mNumIndices; }
+    const MeshLod* lods() const { return mLods; }
+    size_t numLods() const { return mNumLods; }
+    const Meshlet* meshlets() const { return mMeshlets; }
+    size_t numMeshlets() const { return mNumMeshlets; }
+    const Submesh* submeshes() const { return mSubmeshes; }
+    size_t numSubmeshes() const { return mNumSubmeshes; }
+    const std::vector<std::string>& materialLibraries() const { return mMaterialLibraries; }
+    const std::vector<std::string>& materialNames() const { return mMaterialNames; }
+    const glm::vec3& boundsMin() const { return mBoundsMin; }
+    const glm::vec3& boundsMax() const { return mBoundsMax; }
+
+private:
+    MappedFile mFile;
+    const Vertex* mVertices;
+    size_t mNumVertices;
+    const unsigned char* mPackedVertices;
+    VertexFormat mPackedFormat;
+    const GLuint* mIndices;
+    size_t mNumIndices;
+    const MeshLod* mLods;
+    size_t mNumLods;
+    const Meshlet* mMeshlets;
+    size_t mNumMeshlets;
+    const Submesh* mSubmeshes;
+    size_t mNumSubmeshes;
+    std::vector<std::string> mMaterialLibraries; // copied out of the mapping, they are only a few short strings
+    std::vector<std::string> mMaterialNames;
+    glm::vec3 mBoundsMin, mBoundsMax;
+};
+
+#endif
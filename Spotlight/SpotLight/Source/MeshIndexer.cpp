@@ -0,0 +1,67 @@
+#include "MeshIndexer.h"
+#include <unordered_map>
+
+namespace
+{
+    struct CornerHash
+    {
+        size_t operator()(const ObjCorner& corner) const
+        {
+            //Large odd multipliers spread the three indices over the whole word
+            unsigned long long h = (unsigned int)corner.position * 0x9E3779B97F4A7C15ull;
+            h ^= (unsigned int)corner.uv * 0xC2B2AE3D27D4EB4Full + (h >> 29);
+            h ^= (unsigned int)corner.normal * 0x165667B19E3779F9ull + (h >> 32);
+            return (size_t)h;
+        }
+    };
+
+    struct CornerEqual
+    {
+        bool operator()(const ObjCorner& a, const ObjCorner& b) const
+        {
+            return a.position == b.position && a.uv == b.uv && a.normal == b.normal;
+        }
+    };
+}
+
+void buildIndexedMesh(const ObjData& data, std::vector<Vertex>& vertices, std::vector<GLuint>& indices)
+{
+    std::unordered_map<ObjCorner, GLuint, CornerHash, CornerEqual> uniqueCorners;
+    uniqueCorners.reserve(data.corners.size() / 2); // Closed meshes share every corner a few times
+
+    vertices.clear();
+    vertices.reserve(data.corners.size() / 2);
+    indices.resize(data.corners.size());
+
+    for (size_t i = 0; i < data.corners.size(); i++)
+    {
+        const ObjCorner& corner = data.corners[i];
+
+        std::pair<std::unordered_map<ObjCorner, GLuint, CornerHash, CornerEqual>::iterator, bool> inserted =
+            uniqueCorners.insert(std::make_pair(corner, (GLuint)vertices.size()));
+
+        //First time we see this triple: gather its attributes into a new vertex
+        if (inserted.second)
+        {
+            Vertex meshVertex = {};
+            if (corner.position >= 0)
+                meshVertex.position = data.positions[corner.position];
+            if (corner.normal >= 0)
+                meshVertex.normal = data.normals[corner.normal];
+            if (corner.uv >= 0)
+                meshVertex.texCoords = data.uvs[corner.uv];
+            vertices.push_back(meshVertex);
+        }
+        indices[i] = inserted.first->second;
+    }
+}
+
+void computeBounds(const std::vector<Vertex>& vertices, glm::vec3& boundsMin, glm::vec3& boundsMax)
+{
+    boundsMin = boundsMax = vertices.empty() ? glm::vec3(0.0f) : vertices[0].position;
+    for (size_t i = 1; i < vertices.size(); i++)
+    {
+        boundsMin = glm::min(boundsMin, vertices[i].position);
+        boundsMax = glm::max(boundsMax, vertices[i].position);
+    }
+}
@@ -0,0 +1,16 @@
+#ifndef MESH_INDEXER_H
+#define MESH_INDEXER_H
+
+#include <vector>
+
+#include "Mesh.h"
+#include "ObjParser.h"
+
+//Welds triangle corners that reference the same position/uv/normal triple into one vertex.
+//vertices gets the unique vertices in first use order, indices three entries per triangle
+void buildIndexedMesh(const ObjData& data, std::vector<Vertex>& vertices, std::vector<GLuint>& indices);
+
+//Axis aligned bounding box of the vertex positions
+void computeBounds(const std::vector<Vertex>& vertices, glm::vec3& boundsMin, glm::vec3& boundsMax);
+
+#endif
@@ -0,0 +1,305 @@
+#include "MeshOptimizer.h"
+#include <algorithm>
+
+namespace
+{
+    //Triangles around every vertex, as ranges into one flat list
+    struct Adjacency
+    {
+        std::vector<unsigned int> offsets; // numVertices + 1 entries
+        std::vector<unsigned int> triangles;
+    };
+
+    void buildAdjacency(const std::vector<GLuint>& indices, size_t numVertices, Adjacency& adjacency)
+    {
+        adjacency.offsets.assign(numVertices + 1, 0);
+        for (size_t i = 0; i < indices.size(); i++)
+            adjacency.offsets[indices[i] + 1]++;
+        for (size_t v = 0; v < numVertices; v++)
+            adjacency.offsets[v + 1] += adjacency.offsets[v];
+
+        std::vector<unsigned int> fill(adjacency.offsets.begin(), adjacency.offsets.end() - 1);
+        adjacency.triangles.resize(indices.size());
+        for (size_t i = 0; i < indices.size(); i++)
+            adjacency.triangles[fill[indices[i]]++] = (unsigned int)(i / 3);
+    }
+
+    //FIFO cache on time stamps: a vertex is cached if fewer than cacheSize misses happened since it went in.
+    //Returns true on a miss
+    inline bool touchCache(GLuint vertex, std::vector<unsigned int>& cacheTime, unsigned int& timeStamp, unsigned int cacheSize)
+    {
+        if (timeStamp - cacheTime[vertex] > cacheSize)
+        {
+            cacheTime[vertex] = timeStamp++;
+            return true;
+        }
+        return false;
+    }
+
+    //Moving the time stamp past the cache size evicts everything
+    inline void flushCache(unsigned int& timeStamp, unsigned int cacheSize)
+    {
+        timeStamp += cacheSize + 1;
+    }
+
+    //Tipsify fallback when no vertex of the last fan can continue: the most recently emitted vertex that still has
+    //triangles left, else the next such vertex in input order
+    long long skipDeadEnd(std::vector<GLuint>& deadEnd, const std::vector<unsigned int>& liveTriangles, size_t& cursor)
+    {
+        while (!deadEnd.empty())
+        {
+            GLuint vertex = deadEnd.back();
+            deadEnd.pop_back();
+            if (liveTriangles[vertex] > 0)
+                return vertex;
+        }
+
+        for (; cursor < liveTriangles.size(); cursor++)
+        {
+            if (liveTriangles[cursor] > 0)
+                return (long long)cursor;
+        }
+        return -1;
+    }
+
+    unsigned int countMisses(const GLuint* indices, size_t count, std::vector<unsigned int>& cacheTime, unsigned int& timeStamp, unsigned int cacheSize)
+    {
+        unsigned int misses = 0;
+        for (size_t i = 0; i < count; i++)
+            misses += touchCache(indices[i], cacheTime, timeStamp, cacheSize) ? 1 : 0;
+        return misses;
+    }
+}
+
+VertexCacheStats analyzeVertexCache(const std::vector<GLuint>& indices, size_t numVertices, unsigned int cacheSize)
+{
+    VertexCacheStats stats = {};
+    if (indices.empty())
+        return stats;
+
+    std::vector<unsigned int> cacheTime(numVertices, 0);
+    unsigned int timeStamp = cacheSize + 1;
+    unsigned int misses = countMisses(&indices[0], indices.size(), cacheTime, timeStamp, cacheSize);
+
+    //Only vertices that some triangle uses count towards ATVR
+    std::vector<char> used(numVertices, 0);
+    size_t numUsed = 0;
+    for (size_t i = 0; i < indices.size(); i++)
+    {
+        if (!used[indices[i]])
+        {
+            used[indices[i]] = 1;
+            numUsed++;
+        }
+    }
+
+    stats.acmr = (float)misses / (float)(indices.size() / 3);
+    stats.atvr = (float)misses / (float)numUsed;
+    return stats;
+}
+
+void optimizeVertexCache(std::vector<GLuint>& indices, size_t numVertices, unsigned int cacheSize, std::vector<size_t>* clusters)
+{
+    size_t numTriangles = indices.size() / 3;
+    if (clusters != NULL)
+        clusters->clear();
+    if (numTriangles == 0)
+        return;
+
+    Adjacency adjacency;
+    buildAdjacency(indices, numVertices, adjacency);
+
+    std::vector<unsigned int> liveTriangles(numVertices);
+    for (size_t v = 0; v < numVertices; v++)
+        liveTriangles[v] = adjacency.offsets[v + 1] - adjacency.offsets[v];
+
+    std::vector<unsigned int> cacheTime(numVertices, 0);
+    unsigned int timeStamp = cacheSize + 1;
+    std::vector<char> emitted(numTriangles, 0);
+    std::vector<GLuint> deadEnd;
+    deadEnd.reserve(indices.size());
+    std::vector<GLuint> candidates;
+    std::vector<GLuint> output;
+    output.reserve(indices.size());
+    size_t cursor = 0;
+
+    long long fanning = skipDeadEnd(deadEnd, liveTriangles, cursor);
+    if (clusters != NULL)
+        clusters->push_back(0);
+
+    while (fanning >= 0)
+    {
+        //Emit every remaining triangle around the fanning vertex
+        candidates.clear();
+        for (unsigned int a = adjacency.offsets[fanning]; a < adjacency.offsets[fanning + 1]; a++)
+        {
+            unsigned int triangle = adjacency.triangles[a];
+            if (emitted[triangle])
+                continue;
+
+            for (int k = 0; k < 3; k++)
+            {
+                GLuint vertex = indices[triangle * 3 + k];
+                output.push_back(vertex);
+                deadEnd.push_back(vertex);
+                candidates.push_back(vertex);
+                liveTriangles[vertex]--;
+                touchCache(vertex, cacheTime, timeStamp, cacheSize);
+            }
+            emitted[triangle] = 1;
+        }
+
+        //Next fan: the oldest candidate whose own fan will still find it in the cache
+        long long next = -1;
+        long long bestPriority = -1;
+        for (size_t c = 0; c < candidates.size(); c++)
+        {
+            GLuint vertex = candidates[c];
+            if (liveTriangles[vertex] == 0)
+                continue;
+
+            long long age = timeStamp - cacheTime[vertex];
+            long long priority = (age + 2 * liveTriangles[vertex] <= cacheSize) ? age : 0;
+            if (priority > bestPriority)
+            {
+                bestPriority = priority;
+                next = vertex;
+            }
+        }
+
+        if (next < 0)
+        {
+            next = skipDeadEnd(deadEnd, liveTriangles, cursor);
+            if (next >= 0 && clusters != NULL)
+                clusters->push_back(output.size() / 3);
+        }
+        fanning = next;
+    }
+
+    indices.swap(output);
+}
+
+void optimizeOverdraw(std::vector<GLuint>& indices, const std::vector<Vertex>& vertices, const std::vector<size_t>& clusters,
+    float threshold, unsigned int cacheSize)
+{
+    size_t numTriangles = indices.size() / 3;
+    if (numTriangles == 0)
+        return;
+
+    //Split the clusters wherever the cache efficiency so far is already as good as the whole cluster's.
+    //Smaller clusters sort better, and each one starts with a cold cache anyway once they are shuffled
+    std::vector<size_t> splits;
+    std::vector<unsigned int> cacheTime(vertices.size(), 0);
+    unsigned int timeStamp = cacheSize + 1;
+    for (size_t c = 0; c < clusters.size(); c++)
+    {
+        size_t start = clusters[c];
+        size_t end = (c + 1 < clusters.size()) ? clusters[c + 1] : numTriangles;
+
+        flushCache(timeStamp, cacheSize);
+        float clusterACMR = (float)countMisses(&indices[start * 3], (end - start) * 3, cacheTime, timeStamp, cacheSize) / (end - start);
+
+        flushCache(timeStamp, cacheSize);
+        splits.push_back(start);
+        size_t splitStart = start;
+        unsigned int misses = 0;
+        for (size_t t = start; t < end; t++)
+        {
+            misses += countMisses(&indices[t * 3], 3, cacheTime, timeStamp, cacheSize);
+
+            size_t size = t + 1 - splitStart;
+            if (t + 1 < end && size >= cacheSize && misses <= threshold * clusterACMR * size)
+            {
+                splits.push_back(t + 1);
+                splitStart = t + 1;
+                misses = 0;
+                flushCache(timeStamp, cacheSize);
+            }
+        }
+    }
+
+    //Area weighted centroid and normal of every cluster and of the whole mesh
+    size_t numClusters = splits.size();
+    std::vector<glm::vec3> centroids(numClusters, glm::vec3(0.0f));
+    std::vector<glm::vec3> normals(numClusters, glm::vec3(0.0f));
+    std::vector<float> areas(numClusters, 0.0f);
+    glm::vec3 meshCentroid(0.0f);
+    float meshArea = 0.0f;
+
+    for (size_t c = 0; c < numClusters; c++)
+    {
+        size_t end = (c + 1 < numClusters) ? splits[c + 1] : numTriangles;
+        for (size_t t = splits[c]; t < end; t++)
+        {
+            const glm::vec3& p0 = vertices[indices[t * 3 + 0]].position;
+            const glm::vec3& p1 = vertices[indices[t * 3 + 1]].position;
+            const glm::vec3& p2 = vertices[indices[t * 3 + 2]].position;
+
+            glm::vec3 normal = glm::cross(p1 - p0, p2 - p0); // length is twice the area
+            float area = glm::length(normal);
+
+            centroids[c] += (p0 + p1 + p2) * (area / 3.0f);
+            normals[c] += normal;
+            areas[c] += area;
+        }
+        meshCentroid += centroids[c];
+        meshArea += areas[c];
+    }
+    if (meshArea > 0.0f)
+        meshCentroid /= meshArea;
+
+    //Clusters that sit far out along the way they face are likely to hide the rest: draw them first
+    std::vector<float> sortKeys(numClusters, 0.0f);
+    for (size_t c = 0; c < numClusters; c++)
+    {
+        float normalLength = glm::length(normals[c]);
+        if (areas[c] > 0.0f && normalLength > 0.0f)
+            sortKeys[c] = glm::dot(centroids[c] / areas[c] - meshCentroid, normals[c] / normalLength);
+    }
+
+    std::vector<size_t> order(numClusters);
+    for (size_t c = 0; c < numClusters; c++)
+        order[c] = c;
+    std::stable_sort(order.begin(), order.end(), [&sortKeys](size_t a, size_t b) { return sortKeys[a] > sortKeys[b]; });
+
+    std::vector<GLuint> output;
+    output.reserve(indices.size());
+    for (size_t i = 0; i < numClusters; i++)
+    {
+        size_t c = order[i];
+        size_t end = (c + 1 < numClusters) ? splits[c + 1] : numTriangles;
+        output.insert(output.end(), indices.begin() + splits[c] * 3, indices.begin() + end * 3);
+    }
+    indices.swap(output);
+}
+
+void optimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<GLuint>& indices)
+{
+    const GLuint UNUSED = 0xFFFFFFFFu;
+    std::vector<GLuint> remap(vertices.size(), UNUSED);
+    GLuint numUsed = 0;
+
+    for (size_t i = 0; i < indices.size(); i++)
+    {
+        GLuint& index = indices[i];
+        if (remap[index] == UNUSED)
+            remap[index] = numUsed++;
+        index = remap[index];
+    }
+
+    std::vector<Vertex> output(numUsed);
+    for (size_t v = 0; v < vertices.size(); v++)
+    {
+        if (remap[v] != UNUSED)
+            output[remap[v]] = vertices[v];
+    }
+    vertices.swap(output);
+}
+
+void optimizeMesh(std::vector<Vertex>& vertices, std::vector<GLuint>& indices)
+{
+    std::vector<size_t> clusters;
+    optimizeVertexCache(indices, vertices.size(), VERTEX_CACHE_SIZE, &clusters);
+    optimizeOverdraw(indices, vertices, clusters);
+    optimizeVertexFetch(vertices, indices);
+}
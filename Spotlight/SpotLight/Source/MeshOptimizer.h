@@ -0,0 +1,37 @@
+#ifndef MESH_OPTIMIZER_H
+#define MESH_OPTIMIZER_H
+
+#include <vector>
+
+#include "Mesh.h"
+
+//Post-transform vertex cache model. A FIFO of this many vertices is a fair stand-in for current GPUs
+const unsigned int VERTEX_CACHE_SIZE = 16;
+
+struct VertexCacheStats
+{
+    float acmr; // average cache miss ratio: vertex shader runs per triangle. 0.5 is the ideal for big meshes, 3 the worst
+    float atvr; // average transformed vertex ratio: vertex shader runs per vertex. 1 is the ideal
+};
+
+//Simulates the FIFO cache over the index buffer
+VertexCacheStats analyzeVertexCache(const std::vector<GLuint>& indices, size_t numVertices, unsigned int cacheSize = VERTEX_CACHE_SIZE);
+
+//Tipsify (Sander, Nehab, Barczak 2007): reorders triangles so consecutive ones share cached vertices.
+//clusters, if given, receives the first triangle of every run that starts with a cold cache
+void optimizeVertexCache(std::vector<GLuint>& indices, size_t numVertices, unsigned int cacheSize = VERTEX_CACHE_SIZE,
+    std::vector<size_t>* clusters = NULL);
+
+//Reorders the clusters from optimizeVertexCache so outward facing parts of the mesh are drawn first and hide what is behind
+//them. Clusters are split further while their cache efficiency stays within threshold of the unsplit order
+void optimizeOverdraw(std::vector<GLuint>& indices, const std::vector<Vertex>& vertices, const std::vector<size_t>& clusters,
+    float threshold = 1.05f, unsigned int cacheSize = VERTEX_CACHE_SIZE);
+
+//Reorders vertices into the order the index buffer first uses them, so vertex fetch walks memory forwards.
+//Vertices no triangle uses are dropped
+void optimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<GLuint>& indices);
+
+//All of the above, in order
+void optimizeMesh(std::vector<Vertex>& vertices, std::vector<GLuint>& indices);
+
+#endif
@@ -0,0 +1,632 @@
+#include "MeshSimplifier.h"
+#include "MeshIndexer.h"
+#include "MeshOptimizer.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace
+{
+    enum VertexKind
+    {
+        KIND_MANIFOLD, // inside the surface, free to move onto any neighbour
+        KIND_BORDER, // on one open border loop, only slides along it
+        KIND_SEAM, // two vertices share the position (uv or normal seam), only slides along the seam
+        KIND_LOCKED // corners, non-manifold geometry and everything else that can't move safely
+    };
+
+    //Open borders are held harder than the surface, they would otherwise shrink away first
+    const double BORDER_WEIGHT = 10.0;
+    const double SEAM_WEIGHT = 1.0;
+
+    //Symmetric 4x4 matrix of the summed planes, plus their total weight
+    struct Quadric
+    {
+        double a00, a11, a22, a01, a02, a12;
+        double b0, b1, b2;
+        double c;
+        double weight;
+    };
+
+    void addPlane(Quadric& q, const glm::dvec3& n, double d, double weight)
+    {
+        q.a00 += weight * n.x * n.x;
+        q.a11 += weight * n.y * n.y;
+        q.a22 += weight * n.z * n.z;
+        q.a01 += weight * n.x * n.y;
+        q.a02 += weight * n.x * n.z;
+        q.a12 += weight * n.y * n.z;
+        q.b0 += weight * n.x * d;
+        q.b1 += weight * n.y * d;
+        q.b2 += weight * n.z * d;
+        q.c += weight * d * d;
+        q.weight += weight;
+    }
+
+    void addQuadric(Quadric& q, const Quadric& other)
+    {
+        q.a00 += other.a00; q.a11 += other.a11; q.a22 += other.a22;
+        q.a01 += other.a01; q.a02 += other.a02; q.a12 += other.a12;
+        q.b0 += other.b0; q.b1 += other.b1; q.b2 += other.b2;
+        q.c += other.c;
+        q.weight += other.weight;
+    }
+
+    //Weighted mean squared distance from p to the planes
+    double quadricError(const Quadric& q, const glm::vec3& p)
+    {
+        double x = p.x, y = p.y, z = p.z;
+        double r = q.a00 * x * x + q.a11 * y * y + q.a22 * z * z + 2.0 * (q.a01 * x * y + q.a02 * x * z + q.a12 * y * z)
+            + 2.0 * (q.b0 * x + q.b1 * y + q.b2 * z) + q.c;
+        return q.weight > 0.0 ? fabs(r) / q.weight : 0.0;
+    }
+
+    //Plane through a, b and perpendicular to the triangle, so moving off the edge costs and sliding along it doesn't
+    void addEdgePlane(Quadric& q, const glm::vec3& a, const glm::vec3& b, const glm::dvec3& triangleNormal, double weight)
+    {
+        glm::dvec3 edge = glm::dvec3(b) - glm::dvec3(a);
+        glm::dvec3 n = glm::cross(edge, triangleNormal);
+        double length = glm::length(n);
+        if (length == 0.0)
+            return;
+        n /= length;
+        addPlane(q, n, -glm::dot(n, glm::dvec3(a)), weight * glm::dot(edge, edge));
+    }
+
+    inline uint64_t edgeKey(GLuint a, GLuint b)
+    {
+        return ((uint64_t)a << 32) | b;
+    }
+
+    struct PositionHash
+    {
+        size_t operator()(const glm::vec3& p) const
+        {
+            //-0.0 == 0.0 for the map, so both must hash alike. Blender writes -0.000000 often enough
+            glm::vec3 canonical = p;
+            for (int i = 0; i < 3; i++)
+            {
+                if (canonical[i] == 0.0f)
+                    canonical[i] = 0.0f;
+            }
+            uint32_t bits[3];
+            memcpy(bits, &canonical, sizeof(bits));
+            unsigned long long h = bits[0] * 0x9E3779B97F4A7C15ull;
+            h ^= bits[1] * 0xC2B2AE3D27D4EB4Full + (h >> 29);
+            h ^= bits[2] * 0x165667B19E3779F9ull + (h >> 32);
+            return (size_t)h;
+        }
+    };
+
+    struct Collapse
+    {
+        GLuint from, to; // vertices, so seams know which side they are on
+        double error;
+    };
+
+    //Vertices grouped by position. Positions are numbered in first use order, so the numbering is deterministic
+    struct PositionTable
+    {
+        std::vector<GLuint> positionOf; // per vertex
+        std::vector<glm::vec3> positions;
+        std::vector<GLuint> wedgeOffsets; // per position + 1
+        std::vector<GLuint> wedges; // vertices of every position
+    };
+
+    void buildPositionTable(const std::vector<Vertex>& vertices, PositionTable& table)
+    {
+        std::unordered_map<glm::vec3, GLuint, PositionHash> ids;
+        ids.reserve(vertices.size());
+        table.positionOf.resize(vertices.size());
+        table.positions.clear();
+
+        for (size_t v = 0; v < vertices.size(); v++)
+        {
+            std::pair<std::unordered_map<glm::vec3, GLuint, PositionHash>::iterator, bool> inserted =
+                ids.insert(std::make_pair(vertices[v].position, (GLuint)table.positions.size()));
+            if (inserted.second)
+                table.positions.push_back(vertices[v].position);
+            table.positionOf[v] = inserted.first->second;
+        }
+
+        table.wedgeOffsets.assign(table.positions.size() + 1, 0);
+        for (size_t v = 0; v < vertices.size(); v++)
+            table.wedgeOffsets[table.positionOf[v] + 1]++;
+        for (size_t p = 0; p < table.positions.size(); p++)
+            table.wedgeOffsets[p + 1] += table.wedgeOffsets[p];
+
+        std::vector<GLuint> fill(table.wedgeOffsets.begin(), table.wedgeOffsets.end() - 1);
+        table.wedges.resize(vertices.size());
+        for (size_t v = 0; v < vertices.size(); v++)
+            table.wedges[fill[table.positionOf[v]]++] = (GLuint)v;
+    }
+
+    //Directed edges of the current triangles, by position and by vertex. An edge with no reverse twin is open
+    struct EdgeSets
+    {
+        std::unordered_set<uint64_t> positionEdges;
+        std::unordered_set<uint64_t> vertexEdges;
+        std::vector<char> nonManifold; // per position: a directed edge appears twice
+    };
+
+    void buildEdgeSets(const std::vector<GLuint>& indices, const PositionTable& table, EdgeSets& edges)
+    {
+        edges.positionEdges.clear();
+        edges.vertexEdges.clear();
+        edges.positionEdges.reserve(indices.size());
+        edges.vertexEdges.reserve(indices.size());
+        edges.nonManifold.assign(table.positions.size(), 0);
+
+        for (size_t i = 0; i < indices.size(); i += 3)
+        {
+            for (int k = 0; k < 3; k++)
+            {
+                GLuint v0 = indices[i + k], v1 = indices[i + (k + 1) % 3];
+                GLuint p0 = table.positionOf[v0], p1 = table.positionOf[v1];
+                if (!edges.positionEdges.insert(edgeKey(p0, p1)).second)
+                    edges.nonManifold[p0] = edges.nonManifold[p1] = 1;
+                edges.vertexEdges.insert(edgeKey(v0, v1));
+            }
+        }
+    }
+
+    void classifyVertices(const std::vector<GLuint>& indices, const PositionTable& table, const EdgeSets& edges,
+        std::vector<VertexKind>& kinds)
+    {
+        size_t numPositions = table.positions.size();
+        std::vector<unsigned int> openOut(numPositions, 0), openIn(numPositions, 0);
+        std::vector<unsigned int> seamOut(table.positionOf.size(), 0), seamIn(table.positionOf.size(), 0);
+
+        for (size_t i = 0; i < indices.size(); i += 3)
+        {
+            for (int k = 0; k < 3; k++)
+            {
+                GLuint v0 = indices[i + k], v1 = indices[i + (k + 1) % 3];
+                GLuint p0 = table.positionOf[v0], p1 = table.positionOf[v1];
+                if (edges.positionEdges.count(edgeKey(p1, p0)) == 0)
+                {
+                    openOut[p0]++;
+                    openIn[p1]++;
+                }
+                if (edges.vertexEdges.count(edgeKey(v1, v0)) == 0)
+                {
+                    seamOut[v0]++;
+                    seamIn[v1]++;
+                }
+            }
+        }
+
+        kinds.assign(numPositions, KIND_LOCKED);
+        for (size_t p = 0; p < numPositions; p++)
+        {
+            GLuint numWedges = table.wedgeOffsets[p + 1] - table.wedgeOffsets[p];
+            if (edges.nonManifold[p] || numWedges == 0)
+                continue;
+
+            if (openOut[p] == 0 && openIn[p] == 0)
+            {
+                if (numWedges == 1)
+                    kinds[p] = KIND_MANIFOLD;
+                else if (numWedges == 2)
+                {
+                    //A clean seam: each side has exactly one seam edge coming in and one going out
+                    GLuint w0 = table.wedges[table.wedgeOffsets[p]], w1 = table.wedges[table.wedgeOffsets[p] + 1];
+                    if (seamOut[w0] == 1 && seamIn[w0] == 1 && seamOut[w1] == 1 && seamIn[w1] == 1)
+                        kinds[p] = KIND_SEAM;
+                }
+            }
+            else if (openOut[p] == 1 && openIn[p] == 1 && numWedges == 1)
+                kinds[p] = KIND_BORDER;
+        }
+    }
+
+    //Triangles around every position, as ranges into one flat list
+    void buildPositionAdjacency(const std::vector<GLuint>& indices, const PositionTable& table,
+        std::vector<GLuint>& offsets, std::vector<GLuint>& triangles)
+    {
+        offsets.assign(table.positions.size() + 1, 0);
+        for (size_t i = 0; i < indices.size(); i++)
+            offsets[table.positionOf[indices[i]] + 1]++;
+        for (size_t p = 0; p < table.positions.size(); p++)
+            offsets[p + 1] += offsets[p];
+
+        std::vector<GLuint> fill(offsets.begin(), offsets.end() - 1);
+        triangles.resize(indices.size());
+        for (size_t i = 0; i < indices.size(); i++)
+            triangles[fill[table.positionOf[indices[i]]]++] = (GLuint)(i / 3);
+    }
+
+    void collectRing(GLuint position, const std::vector<GLuint>& indices, const PositionTable& table,
+        const std::vector<GLuint>& offsets, const std::vector<GLuint>& triangles, std::vector<GLuint>& ring)
+    {
+        ring.clear();
+        for (GLuint a = offsets[position]; a < offsets[position + 1]; a++)
+        {
+            for (int k = 0; k < 3; k++)
+            {
+                GLuint p = table.positionOf[indices[triangles[a] * 3 + k]];
+                if (p != position)
+                    ring.push_back(p);
+            }
+        }
+        std::sort(ring.begin(), ring.end());
+        ring.erase(std::unique(ring.begin(), ring.end()), ring.end());
+    }
+
+    //Distance from p to the triangle abc (Ericson, Real-Time Collision Detection 5.1.5)
+    float pointTriangleDistance(const glm::vec3& p, const glm::vec3& a, const glm::vec3& b, const glm::vec3& c)
+    {
+        glm::vec3 ab = b - a, ac = c - a, ap = p - a;
+        float d1 = glm::dot(ab, ap), d2 = glm::dot(ac, ap);
+        if (d1 <= 0.0f && d2 <= 0.0f) return glm::length(ap);
+
+        glm::vec3 bp = p - b;
+        float d3 = glm::dot(ab, bp), d4 = glm::dot(ac, bp);
+        if (d3 >= 0.0f && d4 <= d3) return glm::length(bp);
+
+        float vc = d1 * d4 - d3 * d2;
+        if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f)
+            return glm::length(p - (a + ab * (d1 / (d1 - d3))));
+
+        glm::vec3 cp = p - c;
+        float d5 = glm::dot(ab, cp), d6 = glm::dot(ac, cp);
+        if (d6 >= 0.0f && d5 <= d6) return glm::length(cp);
+
+        float vb = d5 * d2 - d1 * d6;
+        if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f)
+            return glm::length(p - (a + ac * (d2 / (d2 - d6))));
+
+        float va = d3 * d6 - d5 * d4;
+        if (va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f)
+            return glm::length(p - (b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)))));
+
+        float denom = 1.0f / (va + vb + vc);
+        return glm::length(p - (a + ab * (vb * denom) + ac * (vc * denom)));
+    }
+}
+
+void simplifyMesh(const std::vector<Vertex>& vertices, const std::vector<GLuint>& indices, size_t targetIndexCount,
+    float maxError, std::vector<GLuint>& output, float* resultError)
+{
+    std::vector<GLuint> result(indices);
+    double errorReached = 0.0;
+
+    PositionTable table;
+    buildPositionTable(vertices, table);
+    size_t numPositions = table.positions.size();
+
+    EdgeSets edges;
+    buildEdgeSets(result, table, edges);
+    std::vector<VertexKind> kinds;
+    classifyVertices(result, table, edges, kinds);
+
+    //Area weighted triangle planes, plus edge planes that hold borders and seams in place
+    std::vector<Quadric> quadrics(numPositions);
+    memset(quadrics.data(), 0, quadrics.size() * sizeof(Quadric));
+    for (size_t i = 0; i < result.size(); i += 3)
+    {
+        GLuint p[3] = { table.positionOf[result[i]], table.positionOf[result[i + 1]], table.positionOf[result[i + 2]] };
+        glm::dvec3 a(table.positions[p[0]]), b(table.positions[p[1]]), c(table.positions[p[2]]);
+        glm::dvec3 normal = glm::cross(b - a, c - a);
+        double doubleArea = glm::length(normal);
+        if (doubleArea == 0.0)
+            continue;
+        normal /= doubleArea;
+
+        for (int k = 0; k < 3; k++)
+            addPlane(quadrics[p[k]], normal, -glm::dot(normal, a), doubleArea * 0.5);
+
+        for (int k = 0; k < 3; k++)
+        {
+            GLuint v0 = result[i + k], v1 = result[i + (k + 1) % 3];
+            GLuint p0 = p[k], p1 = p[(k + 1) % 3];
+            double weight = 0.0;
+            if (edges.positionEdges.count(edgeKey(p1, p0)) == 0)
+                weight = BORDER_WEIGHT;
+            else if (edges.vertexEdges.count(edgeKey(v1, v0)) == 0)
+                weight = SEAM_WEIGHT;
+            if (weight > 0.0)
+            {
+                addEdgePlane(quadrics[p0], table.positions[p0], table.positions[p1], normal, weight);
+                addEdgePlane(quadrics[p1], table.positions[p0], table.positions[p1], normal, weight);
+            }
+        }
+    }
+
+    double maxErrorSquared = (double)maxError * maxError;
+    std::vector<GLuint> adjacencyOffsets, adjacencyTriangles;
+    std::vector<Collapse> candidates;
+    std::vector<GLuint> collapseTo(vertices.size());
+    std::vector<char> positionLocked(numPositions);
+    std::vector<GLuint> ring0, ring1;
+
+    //Each pass collapses a batch of the cheapest independent edges, then rebuilds the index list
+    while (result.size() > targetIndexCount)
+    {
+        buildEdgeSets(result, table, edges);
+        buildPositionAdjacency(result, table, adjacencyOffsets, adjacencyTriangles);
+
+        //Every directed edge proposes moving its first position onto its second. Border edges exist in one direction
+        //only, which keeps border collapses going the same way round the loop
+        candidates.clear();
+        for (size_t i = 0; i < result.size(); i += 3)
+        {
+            for (int k = 0; k < 3; k++)
+            {
+                GLuint v0 = result[i + k], v1 = result[i + (k + 1) % 3];
+                GLuint p0 = table.positionOf[v0], p1 = table.positionOf[v1];
+                VertexKind kind = kinds[p0];
+
+                bool allowed = false;
+                if (kind == KIND_MANIFOLD)
+                    allowed = true;
+                else if (kind == KIND_BORDER)
+                    allowed = (kinds[p1] == KIND_BORDER || kinds[p1] == KIND_LOCKED) && edges.positionEdges.count(edgeKey(p1, p0)) == 0;
+                else if (kind == KIND_SEAM)
+                    allowed = (kinds[p1] == KIND_SEAM || kinds[p1] == KIND_LOCKED) && edges.vertexEdges.count(edgeKey(v1, v0)) == 0;
+                if (!allowed)
+                    continue;
+
+                Collapse collapse = { v0, v1, quadricError(quadrics[p0], table.positions[p1]) };
+                candidates.push_back(collapse);
+            }
+        }
+
+        //Ties broken by vertex index so the order never depends on the sort implementation
+        std::sort(candidates.begin(), candidates.end(), [](const Collapse& a, const Collapse& b)
+        {
+            if (a.error != b.error) return a.error < b.error;
+            if (a.from != b.from) return a.from < b.from;
+            return a.to < b.to;
+        });
+
+        for (size_t v = 0; v < collapseTo.size(); v++)
+            collapseTo[v] = (GLuint)v;
+        std::fill(positionLocked.begin(), positionLocked.end(), 0);
+
+        size_t trianglesToRemove = (result.size() - targetIndexCount) / 3;
+        size_t trianglesRemoved = 0;
+        size_t numCollapses = 0;
+
+        for (size_t c = 0; c < candidates.size() && trianglesRemoved < trianglesToRemove; c++)
+        {
+            const Collapse& collapse = candidates[c];
+            if (collapse.error > maxErrorSquared)
+                break;
+
+            GLuint p0 = table.positionOf[collapse.from], p1 = table.positionOf[collapse.to];
+            if (positionLocked[p0] || positionLocked[p1])
+                continue;
+
+            //Triangles around p0: the ones on the edge disappear, the rest must not flip
+            size_t sharedTriangles = 0;
+            bool flipped = false;
+            const glm::vec3& target = table.positions[p1];
+            for (GLuint a = adjacencyOffsets[p0]; a < adjacencyOffsets[p0 + 1] && !flipped; a++)
+            {
+                const GLuint* triangle = &result[adjacencyTriangles[a] * 3];
+                glm::vec3 corners[3], moved[3];
+                bool hasTarget = false;
+                for (int k = 0; k < 3; k++)
+                {
+                    GLuint p = table.positionOf[triangle[k]];
+                    hasTarget = hasTarget || p == p1;
+                    corners[k] = table.positions[p];
+                    moved[k] = (p == p0) ? target : corners[k];
+                }
+                if (hasTarget)
+                {
+                    sharedTriangles++;
+                    continue;
+                }
+
+                glm::vec3 before = glm::cross(corners[1] - corners[0], corners[2] - corners[0]);
+                glm::vec3 after = glm::cross(moved[1] - moved[0], moved[2] - moved[0]);
+                flipped = glm::dot(before, after) <= 0.0f;
+            }
+            if (flipped || sharedTriangles == 0)
+                continue;
+
+            //Link condition: p0 and p1 may only share the neighbours opposite their common edge, or the collapse
+            //pinches the surface into non-manifold geometry
+            collectRing(p0, result, table, adjacencyOffsets, adjacencyTriangles, ring0);
+            collectRing(p1, result, table, adjacencyOffsets, adjacencyTriangles, ring1);
+            size_t common = 0;
+            for (size_t a = 0, b = 0; a < ring0.size() && b < ring1.size();)
+            {
+                if (ring0[a] < ring1[b]) a++;
+                else if (ring1[b] < ring0[a]) b++;
+                else { common++; a++; b++; }
+            }
+            if (common != sharedTriangles)
+                continue;
+
+            //Every vertex at p0 needs a partner at p1 on the same side of the seam
+            bool mapped = true;
+            if (kinds[p0] == KIND_SEAM)
+            {
+                for (GLuint w = table.wedgeOffsets[p0]; w < table.wedgeOffsets[p0 + 1] && mapped; w++)
+                {
+                    GLuint from = table.wedges[w];
+                    GLuint to = from;
+                    for (GLuint x = table.wedgeOffsets[p1]; x < table.wedgeOffsets[p1 + 1]; x++)
+                    {
+                        GLuint candidate = table.wedges[x];
+                        if (edges.vertexEdges.count(edgeKey(from, candidate)) || edges.vertexEdges.count(edgeKey(candidate, from)))
+                        {
+                            to = candidate;
+                            break;
+                        }
+                    }
+                    mapped = to != from;
+                }
+                if (!mapped)
+                    continue;
+
+                for (GLuint w = table.wedgeOffsets[p0]; w < table.wedgeOffsets[p0 + 1]; w++)
+                {
+                    GLuint from = table.wedges[w];
+                    for (GLuint x = table.wedgeOffsets[p1]; x < table.wedgeOffsets[p1 + 1]; x++)
+                    {
+                        GLuint candidate = table.wedges[x];
+                        if (edges.vertexEdges.count(edgeKey(from, candidate)) || edges.vertexEdges.count(edgeKey(candidate, from)))
+                        {
+                            collapseTo[from] = candidate;
+                            break;
+                        }
+                    }
+                }
+            }
+            else
+                collapseTo[collapse.from] = collapse.to;
+
+            //Nothing around p0 may change again this pass, the checks above would be stale
+            positionLocked[p0] = positionLocked[p1] = 1;
+            for (size_t r = 0; r < ring0.size(); r++)
+                positionLocked[ring0[r]] = 1;
+
+            addQuadric(quadrics[p1], quadrics[p0]);
+            errorReached = std::max(errorReached, collapse.error);
+            trianglesRemoved += sharedTriangles;
+            numCollapses++;
+        }
+
+        if (numCollapses == 0)
+            break;
+
+        //Remap and drop the triangles that collapsed to a line
+        size_t write = 0;
+        for (size_t i = 0; i < result.size(); i += 3)
+        {
+            GLuint a = collapseTo[result[i]], b = collapseTo[result[i + 1]], c = collapseTo[result[i + 2]];
+            GLuint pa = table.positionOf[a], pb = table.positionOf[b], pc = table.positionOf[c];
+            if (pa == pb || pb == pc || pa == pc)
+                continue;
+            result[write++] = a;
+            result[write++] = b;
+            result[write++] = c;
+        }
+        result.resize(write);
+    }
+
+    output.swap(result);
+    if (resultError != NULL)
+        *resultError = (float)sqrt(errorReached);
+}
+
+void buildLodChain(const std::vector<Vertex>& vertices, std::vector<GLuint>& indices, std::vector<MeshLod>& lods)
+{
+    lods.clear();
+    MeshLod full = { 0, (GLuint)indices.size(), 0.0f, (GLuint)vertices.size() };
+    lods.push_back(full);
+
+    glm::vec3 boundsMin, boundsMax;
+    computeBounds(vertices, boundsMin, boundsMax);
+    float maxError = LOD_MAX_ERROR * glm::length(boundsMax - boundsMin);
+
+    std::vector<GLuint> previous(indices);
+    float error = 0.0f;
+    for (float ratio : LOD_RATIOS)
+    {
+        size_t target = (size_t)(full.numIndices / 3 * ratio) * 3;
+        std::vector<GLuint> level;
+        float levelError = 0.0f;
+        simplifyMesh(vertices, previous, target, maxError - error, level, &levelError);
+
+        //Not worth a draw range when the simplifier ran out of cheap collapses
+        if (level.empty() || level.size() > previous.size() * 4 / 5)
+            break;
+
+        optimizeVertexCache(level, vertices.size());
+
+        //Each level is simplified from the one before, so its error against the full mesh is at most the sum
+        error += levelError;
+        MeshLod lod = { (GLuint)indices.size(), (GLuint)level.size(), error, (GLuint)vertices.size() };
+        indices.insert(indices.end(), level.begin(), level.end());
+        lods.push_back(lod);
+        previous.swap(level);
+    }
+}
+
+void sortVerticesByLod(std::vector<Vertex>& vertices, std::vector<GLuint>& indices, std::vector<MeshLod>& lods)
+{
+    //Coarsest level every vertex is used by. Levels are visited fine to coarse, so the last write wins
+    std::vector<int> coarsest(vertices.size(), -1);
+    for (size_t level = 0; level < lods.size(); level++)
+    {
+        for (GLuint i = lods[level].firstIndex; i < lods[level].firstIndex + lods[level].numIndices; i++)
+            coarsest[indices[i]] = (int)level;
+    }
+
+    //Stable counting sort on that level, coarsest group first. Unused vertices, if any, go last
+    int numLevels = (int)lods.size();
+    std::vector<GLuint> groupStarts(numLevels + 2, 0);
+    for (size_t v = 0; v < vertices.size(); v++)
+        groupStarts[(coarsest[v] < 0 ? numLevels : numLevels - 1 - coarsest[v]) + 1]++;
+    for (int group = 0; group <= numLevels; group++)
+        groupStarts[group + 1] += groupStarts[group];
+
+    std::vector<GLuint> remap(vertices.size());
+    std::vector<GLuint> cursors(groupStarts.begin(), groupStarts.end() - 1);
+    for (size_t v = 0; v < vertices.size(); v++)
+        remap[v] = cursors[coarsest[v] < 0 ? numLevels : numLevels - 1 - coarsest[v]]++;
+
+    std::vector<Vertex> sorted(vertices.size());
+    for (size_t v = 0; v < vertices.size(); v++)
+        sorted[remap[v]] = vertices[v];
+    vertices.swap(sorted);
+    for (size_t i = 0; i < indices.size(); i++)
+        indices[i] = remap[indices[i]];
+
+    //A level uses its own group and every coarser one, which all come before it
+    for (int level = 0; level < numLevels; level++)
+        lods[level].numVertices = groupStarts[numLevels - level];
+}
+
+int selectLod(const std::vector<MeshLod>& lods, int currentLod, float pixelsPerUnit)
+{
+    if (lods.empty())
+        return 0;
+    currentLod = std::min(std::max(currentLod, 0), (int)lods.size() - 1);
+
+    //Errors grow with the level, so the first one from the coarse end that fits is the one to draw
+    int target = 0;
+    for (int i = (int)lods.size() - 1; i > 0; i--)
+    {
+        if (lods[i].error * pixelsPerUnit <= LOD_PIXEL_ERROR)
+        {
+            target = i;
+            break;
+        }
+    }
+
+    //Finer levels are taken at once. Coarser ones only with some margin
+    while (target > currentLod && lods[target].error * pixelsPerUnit > LOD_PIXEL_ERROR * LOD_HYSTERESIS)
+        target--;
+    return target;
+}
+
+float measureLodError(const std::vector<Vertex>& vertices, const std::vector<GLuint>& indices, const MeshLod& lod,
+    float* meanError)
+{
+    float maxDistance = 0.0f;
+    double sumDistance = 0.0;
+    for (size_t v = 0; v < vertices.size(); v++)
+    {
+        const glm::vec3& p = vertices[v].position;
+        float nearest = FLT_MAX;
+        for (GLuint i = lod.firstIndex; i + 2 < lod.firstIndex + lod.numIndices; i += 3)
+        {
+            nearest = std::min(nearest, pointTriangleDistance(p, vertices[indices[i]].position,
+                vertices[indices[i + 1]].position, vertices[indices[i + 2]].position));
+        }
+        maxDistance = std::max(maxDistance, nearest);
+        sumDistance += nearest;
+    }
+    if (meanError != NULL)
+        *meanError = (float)(sumDistance / std::max<size_t>(vertices.size(), 1));
+    return maxDistance;
+}
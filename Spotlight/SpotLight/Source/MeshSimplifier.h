@@ -0,0 +1,47 @@
+#ifndef MESH_SIMPLIFIER_H
+#define MESH_SIMPLIFIER_H
+
+#include <vector>
+
+#include "Mesh.h"
+
+//Fraction of the full triangle count each level of the LOD chain aims for
+const float LOD_RATIOS[] = { 0.5f, 0.25f, 0.125f };
+
+//Largest error a level may reach, relative to the bounding box diagonal. The chain ends early at this point
+const float LOD_MAX_ERROR = 0.05f;
+
+//How far a level may deviate on screen, in pixels, before a finer one is drawn
+const float LOD_PIXEL_ERROR = 1.0f;
+
+//A coarser level is only taken once its screen error is this far below LOD_PIXEL_ERROR, so a mesh
+//sitting right at the threshold distance doesn't flip between two levels every frame
+const float LOD_HYSTERESIS = 0.75f;
+
+//Quadric error metric edge collapse (Garland, Heckbert 1997). Vertices are only ever merged into their neighbours, so
+//the output indexes the same vertex array. Positions on open borders and on uv/normal seams only slide along the
+//border or seam, and vertices where that isn't well defined stay put.
+//Stops at targetIndexCount, or before a collapse that would move the surface further than maxError (model units).
+//resultError receives the error reached. The result only depends on the input: no threads, no hash ordering
+void simplifyMesh(const std::vector<Vertex>& vertices, const std::vector<GLuint>& indices, size_t targetIndexCount,
+    float maxError, std::vector<GLuint>& output, float* resultError = NULL);
+
+//Appends a level for every LOD_RATIOS entry to indices, each simplified from the one before and ordered for the
+//vertex cache. lods[0] is the full mesh. The chain stops when the simplifier can't reduce a level any further
+void buildLodChain(const std::vector<Vertex>& vertices, std::vector<GLuint>& indices, std::vector<MeshLod>& lods);
+
+//Largest distance from the vertices to the triangles of the level, what MeshLod::error estimates. meanError, if given,
+//receives the average. Brute force over every vertex and triangle, for the benchmark and MeshTests
+float measureLodError(const std::vector<Vertex>& vertices, const std::vector<GLuint>& indices, const MeshLod& lod,
+    float* meanError = NULL);
+
+//Reorders the vertices by the coarsest level that uses them, coarsest first, and sets every MeshLod::numVertices.
+//Each level then only needs a prefix of the vertex buffer, so a streamed mesh can draw its coarse levels before the
+//rest arrives. The sort is stable, so within a group the vertex fetch order of the full level is kept
+void sortVerticesByLod(std::vector<Vertex>& vertices, std::vector<GLuint>& indices, std::vector<MeshLod>& lods);
+
+//Coarsest level whose error stays under LOD_PIXEL_ERROR, with hysteresis against currentLod.
+//pixelsPerUnit is how many pixels one model space unit covers at the mesh's distance
+int selectLod(const std::vector<MeshLod>& lods, int currentLod, float pixelsPerUnit);
+
+#endif
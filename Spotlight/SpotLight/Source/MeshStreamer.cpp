@@ -0,0 +1,158 @@
+#include "MeshStreamer.h"
+#include "GLState.h"
+#include "Mesh.h"
+#include <algorithm>
+#include <chrono>
+
+namespace
+{
+    double nowMs()
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+}
+
+MeshStreamer::MeshStreamer(double budgetMs, size_t chunkBytes)
+    :mBudgetMs(budgetMs),
+    mChunkBytes(std::max<size_t>(chunkBytes, 1)),
+    mMsPerByte(0.0),
+    mStats()
+{
+}
+
+MeshStreamer::~MeshStreamer()
+{
+    for (Upload& upload : mUploads)
+        upload.mesh->mStreamer = NULL;
+    for (Fence& fence : mFences)
+    {
+        if (fence.mesh != NULL)
+            fence.mesh->mStreamer = NULL;
+        glDeleteSync(fence.sync);
+    }
+}
+
+void MeshStreamer::enqueue(Mesh* mesh, std::vector<unsigned char>& vertexData, GLsizei stride, std::vector<GLuint>& indices)
+{
+    mUploads.push_back(Upload());
+    Upload& upload = mUploads.back();
+    upload.mesh = mesh;
+    upload.vertexData.swap(vertexData);
+    upload.indices.swap(indices);
+    upload.nextChunk = 0;
+    upload.vertexBase = (size_t)mesh->getBaseVertex() * stride;
+    upload.indexBase = mesh->getFirstIndex() * sizeof(GLuint);
+
+    //Coarsest level first. Each level adds the vertices it needs beyond the coarser ones, then its indices.
+    //The full level takes whatever vertices are left, so its last index chunk is the mesh's last chunk
+    const std::vector<MeshLod>& lods = mesh->getLods();
+    size_t vertexEnd = 0;
+    for (int level = (int)lods.size() - 1, step = 0; level >= 0; level--, step++)
+    {
+        size_t levelVertexEnd = (level == 0) ? upload.vertexData.size() : std::max(vertexEnd, (size_t)lods[level].numVertices * stride);
+        addChunks(upload, false, vertexEnd, levelVertexEnd, step, -1);
+        vertexEnd = levelVertexEnd;
+        addChunks(upload, true, lods[level].firstIndex * sizeof(GLuint),
+            (lods[level].firstIndex + lods[level].numIndices) * sizeof(GLuint), step, level);
+    }
+}
+
+void MeshStreamer::addChunks(Upload& upload, bool indices, size_t begin, size_t end, int step, int completesLevel)
+{
+    for (size_t offset = begin; offset < end; offset += mChunkBytes)
+    {
+        Chunk chunk;
+        chunk.indices = indices;
+        chunk.offset = offset;
+        chunk.size = std::min(mChunkBytes, end - offset);
+        chunk.step = step;
+        chunk.completesLevel = (offset + chunk.size == end) ? completesLevel : -1;
+        upload.chunks.push_back(chunk);
+    }
+}
+
+void MeshStreamer::cancel(Mesh* mesh)
+{
+    for (size_t i = 0; i < mUploads.size(); i++)
+    {
+        if (mUploads[i].mesh == mesh)
+        {
+            mUploads.erase(mUploads.begin() + i);
+            break;
+        }
+    }
+    for (Fence& fence : mFences)
+    {
+        if (fence.mesh == mesh)
+            fence.mesh = NULL;
+    }
+}
+
+const MeshStreamStats& MeshStreamer::update()
+{
+    mStats = MeshStreamStats();
+
+    //Fences signal in order, so the first one that hasn't stops the scan. A timeout of 0 only polls
+    double startMs = nowMs();
+    while (!mFences.empty())
+    {
+        Fence& fence = mFences.front();
+        GLenum status = glClientWaitSync(fence.sync, 0, 0);
+        if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+            break;
+
+        if (fence.mesh != NULL && fence.completesLevel >= 0)
+        {
+            fence.mesh->mResidentLod = std::min(fence.mesh->mResidentLod, fence.completesLevel);
+
+            //Nothing of this mesh is left in flight
+            if (fence.completesLevel == 0)
+                fence.mesh->mStreamer = NULL;
+        }
+        mStats.chunksResident++;
+        mStats.maxFenceMs = std::max(mStats.maxFenceMs, startMs - fence.issuedMs);
+        glDeleteSync(fence.sync);
+        mFences.pop_front();
+    }
+
+    //GL_COPY_WRITE_BUFFER leaves the array and element buffer bindings, and so every VAO, untouched
+    while (!mUploads.empty())
+    {
+        size_t next = 0;
+        for (size_t i = 1; i < mUploads.size(); i++)
+        {
+            if (mUploads[i].chunks[mUploads[i].nextChunk].step < mUploads[next].chunks[mUploads[next].nextChunk].step)
+                next = i;
+        }
+        Upload& upload = mUploads[next];
+        const Chunk& chunk = upload.chunks[upload.nextChunk];
+
+        double chunkStartMs = nowMs();
+        if (mStats.chunksUploaded > 0 && chunkStartMs - startMs + chunk.size * mMsPerByte > mBudgetMs)
+            break;
+
+        const unsigned char* source = chunk.indices ? (const unsigned char*)upload.indices.data() : upload.vertexData.data();
+        GLState::bindBuffer(GL_COPY_WRITE_BUFFER, chunk.indices ? upload.mesh->mEBO : upload.mesh->mVBO);
+        glBufferSubData(GL_COPY_WRITE_BUFFER, (chunk.indices ? upload.indexBase : upload.vertexBase) + chunk.offset, chunk.size, source + chunk.offset);
+
+        Fence fence = { glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0), upload.mesh, chunk.completesLevel, nowMs() };
+        mFences.push_back(fence);
+
+        double chunkMsPerByte = (fence.issuedMs - chunkStartMs) / chunk.size;
+        mMsPerByte = (mMsPerByte == 0.0) ? chunkMsPerByte : 0.75 * mMsPerByte + 0.25 * chunkMsPerByte;
+        mStats.chunksUploaded++;
+        mStats.bytesUploaded += chunk.size;
+
+        //The CPU copy can go as soon as the last chunk is issued, glBufferSubData doesn't keep the pointer
+        if (++upload.nextChunk == upload.chunks.size())
+            mUploads.erase(mUploads.begin() + next);
+    }
+    GLState::bindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    //Fences only signal once their commands reach the GPU
+    if (mStats.chunksUploaded > 0)
+        glFlush();
+
+    mStats.uploadMs = nowMs() - startMs;
+    return mStats;
+}
@@ -0,0 +1,92 @@
+#ifndef MESH_STREAMER_H
+#define MESH_STREAMER_H
+
+#include <deque>
+#include <vector>
+
+#include "GL/glew.h"
+
+class Mesh;
+
+//Default share of a frame spent in glBufferSubData, and the largest single upload
+const double STREAM_BUDGET_MS = 2.0;
+const size_t STREAM_CHUNK_BYTES = 256 * 1024;
+
+//What the last update did
+struct MeshStreamStats
+{
+    size_t chunksUploaded;
+    size_t bytesUploaded;
+    double uploadMs; // CPU time spent issuing the uploads
+    size_t chunksResident; // chunks whose fence signaled during this update
+    double maxFenceMs; // longest time from issuing one of those chunks to seeing its fence signaled
+};
+
+//Fills the buffers of meshes loaded with a streamer over several frames instead of in one blocking upload.
+//Every mesh is sent coarsest level first, and the coarse levels of all queued meshes go before any finer level, so
+//everything becomes drawable early and sharpens as the rest arrives (see sortVerticesByLod in MeshSimplifier.h).
+//Uploads are glBufferSubData calls of at most chunkBytes, each followed by a fence. A level is only drawn once the
+//fence of its last chunk has signaled, so draws never wait on a copy still in flight
+class MeshStreamer
+{
+public:
+    MeshStreamer(double budgetMs = STREAM_BUDGET_MS, size_t chunkBytes = STREAM_CHUNK_BYTES);
+    ~MeshStreamer();
+
+    void setBudget(double budgetMs) { mBudgetMs = budgetMs; }
+    double getBudget() const { return mBudgetMs; }
+
+    //Once per frame on the GL thread, before drawing. Marks the levels whose chunks have arrived, then issues chunks
+    //until the budget is spent. At least one chunk goes out every frame, so a tiny budget is slow but never stalls
+    const MeshStreamStats& update();
+
+    //Nothing left to issue and no fence pending
+    bool isIdle() const { return mUploads.empty() && mFences.empty(); }
+
+private:
+    friend class Mesh;
+
+    //Takes over the vertex bytes (already in the mesh's GPU layout) and the indices
+    void enqueue(Mesh* mesh, std::vector<unsigned char>& vertexData, GLsizei stride, std::vector<GLuint>& indices);
+
+    //Drops what is left of a mesh's upload, for meshes destroyed while streaming
+    void cancel(Mesh* mesh);
+
+    struct Chunk
+    {
+        bool indices; // element buffer, otherwise the vertex buffer
+        size_t offset; // bytes into the source array and the mesh's part of the buffer
+        size_t size;
+        int step; // 0 for the coarsest level, scheduling goes by this across meshes
+        int completesLevel; // level drawable once this chunk is resident, -1 when it isn't a level's last chunk
+    };
+
+    struct Upload
+    {
+        Mesh* mesh;
+        std::vector<unsigned char> vertexData;
+        std::vector<GLuint> indices;
+        std::vector<Chunk> chunks;
+        size_t nextChunk;
+        size_t vertexBase, indexBase; // bytes to the mesh's part of the buffers, not 0 in a GeometryArena
+    };
+
+    struct Fence
+    {
+        GLsync sync;
+        Mesh* mesh; // NULL once the mesh is gone
+        int completesLevel;
+        double issuedMs;
+    };
+
+    void addChunks(Upload& upload, bool indices, size_t begin, size_t end, int step, int completesLevel);
+
+    double mBudgetMs;
+    size_t mChunkBytes;
+    double mMsPerByte; // running estimate, so a chunk that would overrun the budget waits for the next frame
+    std::vector<Upload> mUploads;
+    std::deque<Fence> mFences; // in issue order, which is also the order they signal in
+    MeshStreamStats mStats;
+};
+
+#endif
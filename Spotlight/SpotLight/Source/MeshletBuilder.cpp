@@ -0,0 +1,324 @@
+#include "MeshletBuilder.h"
+#include "MeshOptimizer.h"
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    //Bounding sphere around the box of the positions, and the backface cone of the triangle normals
+    void computeMeshletBounds(const std::vector<Vertex>& vertices, const std::vector<GLuint>& indices, Meshlet& meshlet)
+    {
+        const GLuint* triangles = &indices[meshlet.firstIndex];
+        GLuint numTriangles = meshlet.numIndices / 3;
+
+        glm::vec3 boundsMin(vertices[triangles[0]].position), boundsMax(boundsMin);
+        for (GLuint i = 0; i < meshlet.numIndices; i++)
+        {
+            boundsMin = glm::min(boundsMin, vertices[triangles[i]].position);
+            boundsMax = glm::max(boundsMax, vertices[triangles[i]].position);
+        }
+
+        glm::vec3 center = (boundsMin + boundsMax) * 0.5f;
+        float radius = 0.0f;
+        for (GLuint i = 0; i < meshlet.numIndices; i++)
+            radius = std::max(radius, glm::length(vertices[triangles[i]].position - center));
+
+        meshlet.center = center;
+        meshlet.radius = radius;
+
+        //Cone axis: the mean direction of the triangle normals. The cone is as wide as the normal furthest from it
+        std::vector<glm::vec3> normals(numTriangles, glm::vec3(0.0f));
+        glm::vec3 axis(0.0f);
+        for (GLuint t = 0; t < numTriangles; t++)
+        {
+            const glm::vec3& p0 = vertices[triangles[t * 3 + 0]].position;
+            const glm::vec3& p1 = vertices[triangles[t * 3 + 1]].position;
+            const glm::vec3& p2 = vertices[triangles[t * 3 + 2]].position;
+            glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+            float length = glm::length(normal);
+            if (length > 0.0f)
+                normals[t] = normal / length;
+            axis += normals[t];
+        }
+
+        //A cutoff of 1 never rejects: dot of two unit vectors is never above it
+        meshlet.coneApex = center;
+        meshlet.coneAxis = glm::vec3(0.0f);
+        meshlet.coneCutoff = 1.0f;
+
+        float axisLength = glm::length(axis);
+        if (axisLength == 0.0f)
+            return;
+        axis /= axisLength;
+
+        float minDot = 1.0f;
+        for (GLuint t = 0; t < numTriangles; t++)
+            minDot = std::min(minDot, glm::dot(normals[t], axis));
+
+        //Normals spread over more than a hemisphere-ish: some triangle always faces the camera
+        if (minDot <= 0.1f)
+            return;
+
+        //Apex far enough back along the axis that every triangle plane lies in front of it, so the cone test is
+        //exact for perspective views, not just for the direction to the center
+        float maxT = 0.0f;
+        for (GLuint t = 0; t < numTriangles; t++)
+        {
+            float dn = glm::dot(normals[t], axis);
+            if (dn <= 0.0f)
+                continue;
+            for (int k = 0; k < 3; k++)
+            {
+                float dc = glm::dot(center - vertices[triangles[t * 3 + k]].position, axis);
+                maxT = std::max(maxT, dc / dn);
+            }
+        }
+
+        meshlet.coneApex = center - axis * maxT;
+        meshlet.coneAxis = axis;
+        meshlet.coneCutoff = sqrtf(1.0f - minDot * minDot);
+    }
+}
+
+void buildMeshlets(const std::vector<Vertex>& vertices, std::vector<GLuint>& indices, GLuint firstIndex, GLuint numIndices,
+    std::vector<Meshlet>& meshlets)
+{
+    meshlets.clear();
+    GLuint numTriangles = numIndices / 3;
+    if (numTriangles == 0)
+        return;
+    const GLuint* triangles = &indices[firstIndex];
+
+    //Triangles around every vertex, as ranges into one flat list
+    std::vector<GLuint> adjacencyOffsets(vertices.size() + 1, 0), adjacency(numIndices);
+    for (GLuint i = 0; i < numIndices; i++)
+        adjacencyOffsets[triangles[i] + 1]++;
+    for (size_t v = 0; v < vertices.size(); v++)
+        adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+    std::vector<GLuint> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+    for (GLuint i = 0; i < numIndices; i++)
+        adjacency[fill[triangles[i]]++] = i / 3;
+
+    std::vector<glm::vec3> normals(numTriangles, glm::vec3(0.0f));
+    for (GLuint t = 0; t < numTriangles; t++)
+    {
+        glm::vec3 normal = glm::cross(vertices[triangles[t * 3 + 1]].position - vertices[triangles[t * 3]].position,
+            vertices[triangles[t * 3 + 2]].position - vertices[triangles[t * 3]].position);
+        float length = glm::length(normal);
+        if (length > 0.0f)
+            normals[t] = normal / length;
+    }
+
+    //Which meshlet last used every vertex, so membership is a compare instead of a set
+    const GLuint NONE = 0xFFFFFFFFu;
+    std::vector<GLuint> usedBy(vertices.size(), NONE);
+    std::vector<char> emitted(numTriangles, 0);
+    std::vector<GLuint> order;
+    order.reserve(numTriangles);
+    std::vector<GLuint> candidates;
+    GLuint cursor = 0;
+
+    //Grow each meshlet from a seed over shared vertices: the triangle adding the fewest new vertices first, then the
+    //one whose normal is closest to the meshlet's so far. Tight normals give narrow cones that cull more often
+    while (order.size() < numTriangles)
+    {
+        while (emitted[cursor])
+            cursor++;
+
+        Meshlet meshlet = {};
+        meshlet.firstIndex = firstIndex + (GLuint)order.size() * 3;
+        GLuint id = (GLuint)meshlets.size();
+        size_t numVertices = 0;
+        glm::vec3 normalSum(0.0f);
+        candidates.clear();
+        long long next = cursor;
+
+        while (next >= 0)
+        {
+            GLuint triangle = (GLuint)next;
+            emitted[triangle] = 1;
+            order.push_back(triangle);
+            meshlet.numIndices += 3;
+            normalSum += normals[triangle];
+
+            for (int k = 0; k < 3; k++)
+            {
+                GLuint vertex = triangles[triangle * 3 + k];
+                if (usedBy[vertex] == id)
+                    continue;
+                usedBy[vertex] = id;
+                numVertices++;
+                for (GLuint a = adjacencyOffsets[vertex]; a < adjacencyOffsets[vertex + 1]; a++)
+                {
+                    if (!emitted[adjacency[a]])
+                        candidates.push_back(adjacency[a]);
+                }
+            }
+
+            next = -1;
+            if (meshlet.numIndices / 3 >= MESHLET_MAX_TRIANGLES)
+                break;
+
+            size_t bestNew = 4;
+            float bestDot = -2.0f;
+            size_t write = 0;
+            for (size_t c = 0; c < candidates.size(); c++)
+            {
+                GLuint candidate = candidates[c];
+                if (emitted[candidate])
+                    continue;
+                candidates[write++] = candidate;
+
+                size_t newVertices = 0;
+                for (int k = 0; k < 3; k++)
+                    newVertices += (usedBy[triangles[candidate * 3 + k]] != id) ? 1 : 0;
+                if (numVertices + newVertices > MESHLET_MAX_VERTICES)
+                    continue;
+
+                float alignment = glm::dot(normals[candidate], normalSum);
+                if (newVertices < bestNew || (newVertices == bestNew && (alignment > bestDot || (alignment == bestDot && candidate < next))))
+                {
+                    bestNew = newVertices;
+                    bestDot = alignment;
+                    next = candidate;
+                }
+            }
+            candidates.resize(write);
+
+            //Boxed in by finished triangles, or across a uv seam: continue with the next triangle in optimized order,
+            //which is usually close by, instead of leaving the meshlet half empty
+            if (next < 0 && meshlet.numIndices / 3 < MESHLET_MAX_TRIANGLES / 4 && numVertices + 3 <= MESHLET_MAX_VERTICES)
+            {
+                while (cursor < numTriangles && emitted[cursor])
+                    cursor++;
+                if (cursor < numTriangles)
+                    next = cursor;
+            }
+        }
+        meshlets.push_back(meshlet);
+    }
+
+    std::vector<GLuint> reordered(numIndices);
+    for (GLuint t = 0; t < numTriangles; t++)
+        for (int k = 0; k < 3; k++)
+            reordered[t * 3 + k] = triangles[order[t] * 3 + k];
+    std::copy(reordered.begin(), reordered.end(), indices.begin() + firstIndex);
+
+    for (size_t m = 0; m < meshlets.size(); m++)
+        computeMeshletBounds(vertices, indices, meshlets[m]);
+
+    //Same idea as optimizeOverdraw: meshlets far out along the way they face go first and hide the rest
+    glm::vec3 meshCenter(0.0f);
+    for (size_t m = 0; m < meshlets.size(); m++)
+        meshCenter += meshlets[m].center * (float)meshlets[m].numIndices;
+    meshCenter /= (float)numIndices;
+
+    std::vector<float> sortKeys(meshlets.size());
+    std::vector<size_t> meshletOrder(meshlets.size());
+    for (size_t m = 0; m < meshlets.size(); m++)
+    {
+        sortKeys[m] = glm::dot(meshlets[m].center - meshCenter, meshlets[m].coneAxis);
+        meshletOrder[m] = m;
+    }
+    std::stable_sort(meshletOrder.begin(), meshletOrder.end(), [&sortKeys](size_t a, size_t b) { return sortKeys[a] > sortKeys[b]; });
+
+    std::vector<Meshlet> sorted(meshlets.size());
+    GLuint write = 0;
+    for (size_t i = 0; i < meshletOrder.size(); i++)
+    {
+        Meshlet meshlet = meshlets[meshletOrder[i]];
+        std::copy(indices.begin() + meshlet.firstIndex, indices.begin() + meshlet.firstIndex + meshlet.numIndices, reordered.begin() + write);
+        meshlet.firstIndex = firstIndex + write;
+        write += meshlet.numIndices;
+        sorted[i] = meshlet;
+    }
+    std::copy(reordered.begin(), reordered.end(), indices.begin() + firstIndex);
+    meshlets.swap(sorted);
+
+    //Growing by normals costs some vertex cache efficiency, Tipsify inside every meshlet wins it back
+    std::vector<GLuint> local;
+    for (size_t m = 0; m < meshlets.size(); m++)
+    {
+        std::vector<GLuint>::iterator begin = indices.begin() + meshlets[m].firstIndex;
+        local.assign(begin, begin + meshlets[m].numIndices);
+        optimizeVertexCache(local, vertices.size());
+        std::copy(local.begin(), local.end(), begin);
+    }
+}
+
+Frustum extractFrustum(const glm::mat4& m)
+{
+    //Gribb/Hartmann: each plane is the fourth row of the matrix plus or minus one of the others
+    glm::vec4 row0(m[0][0], m[1][0], m[2][0], m[3][0]);
+    glm::vec4 row1(m[0][1], m[1][1], m[2][1], m[3][1]);
+    glm::vec4 row2(m[0][2], m[1][2], m[2][2], m[3][2]);
+    glm::vec4 row3(m[0][3], m[1][3], m[2][3], m[3][3]);
+
+    Frustum frustum;
+    frustum.planes[0] = row3 + row0; // left
+    frustum.planes[1] = row3 - row0; // right
+    frustum.planes[2] = row3 + row1; // bottom
+    frustum.planes[3] = row3 - row1; // top
+    frustum.planes[4] = row3 + row2; // near
+    frustum.planes[5] = row3 - row2; // far
+
+    //Unit normals, so plane distances are in model units and compare against sphere radii
+    for (int i = 0; i < 6; i++)
+    {
+        float length = glm::length(glm::vec3(frustum.planes[i]));
+        if (length > 0.0f)
+            frustum.planes[i] /= length;
+    }
+    return frustum;
+}
+
+MeshletCullStats cullMeshlets(const std::vector<Meshlet>& meshlets, const Frustum& frustum, const glm::vec3& cameraPosition,
+    std::vector<GLsizei>& counts, std::vector<const GLvoid*>& offsets)
+{
+    return cullMeshlets(meshlets.data(), meshlets.size(), frustum, cameraPosition, counts, offsets);
+}
+
+MeshletCullStats cullMeshlets(const Meshlet* meshlets, size_t numMeshlets, const Frustum& frustum, const glm::vec3& cameraPosition,
+    std::vector<GLsizei>& counts, std::vector<const GLvoid*>& offsets)
+{
+    MeshletCullStats stats = {};
+    counts.clear();
+    offsets.clear();
+
+    GLuint rangeEnd = 0xFFFFFFFFu;
+    for (size_t m = 0; m < numMeshlets; m++)
+    {
+        const Meshlet& meshlet = meshlets[m];
+
+        bool outside = false;
+        for (int i = 0; i < 6 && !outside; i++)
+            outside = glm::dot(glm::vec3(frustum.planes[i]), meshlet.center) + frustum.planes[i].w < -meshlet.radius;
+        if (outside)
+        {
+            stats.frustumCulled++;
+            continue;
+        }
+
+        //Every triangle faces away when the camera sits inside the cone behind the apex
+        glm::vec3 toApex = meshlet.coneApex - cameraPosition;
+        float distance = glm::length(toApex);
+        if (distance > 0.0f && glm::dot(toApex, meshlet.coneAxis) >= meshlet.coneCutoff * distance)
+        {
+            stats.backfaceCulled++;
+            continue;
+        }
+
+        stats.visibleTriangles += meshlet.numIndices / 3;
+        if (meshlet.firstIndex == rangeEnd)
+            counts.back() += meshlet.numIndices;
+        else
+        {
+            counts.push_back(meshlet.numIndices);
+            offsets.push_back((const GLvoid*)(meshlet.firstIndex * sizeof(GLuint)));
+        }
+        rangeEnd = meshlet.firstIndex + meshlet.numIndices;
+    }
+
+    stats.numRanges = counts.size();
+    return stats;
+}
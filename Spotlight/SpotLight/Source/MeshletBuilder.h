@@ -0,0 +1,43 @@
+#ifndef MESHLET_BUILDER_H
+#define MESHLET_BUILDER_H
+
+#include <vector>
+
+#include "Mesh.h"
+
+//Cluster limits. 64 vertices and 124 triangles keep a cluster inside one GPU wave and match what mesh shaders expect
+const size_t MESHLET_MAX_VERTICES = 64;
+const size_t MESHLET_MAX_TRIANGLES = 124;
+
+//Splits the triangles in [firstIndex, firstIndex + numIndices) into meshlets and reorders that range so every meshlet
+//is a contiguous run of it. Meshlets grow over shared vertices, so the order stays friendly to the vertex cache
+void buildMeshlets(const std::vector<Vertex>& vertices, std::vector<GLuint>& indices, GLuint firstIndex, GLuint numIndices,
+    std::vector<Meshlet>& meshlets);
+
+//The six clip planes of a model-view-projection matrix, in model space. A point p is inside when
+//dot(plane.xyz, p) + plane.w >= 0 for all of them
+struct Frustum
+{
+    glm::vec4 planes[6];
+};
+
+Frustum extractFrustum(const glm::mat4& modelViewProjection);
+
+struct MeshletCullStats
+{
+    size_t frustumCulled; // meshlets outside the frustum
+    size_t backfaceCulled; // meshlets whose normal cone faces away from the camera
+    size_t visibleTriangles;
+    size_t numRanges; // draws after merging neighbouring visible meshlets
+};
+
+//Collects the index ranges of the meshlets that may be visible, as glMultiDrawElements arguments. Meshlets next to
+//each other in the index buffer become one range. cameraPosition is in model space
+MeshletCullStats cullMeshlets(const std::vector<Meshlet>& meshlets, const Frustum& frustum, const glm::vec3& cameraPosition,
+    std::vector<GLsizei>& counts, std::vector<const GLvoid*>& offsets);
+
+//Same over a part of the array, like the meshlets of one submesh
+MeshletCullStats cullMeshlets(const Meshlet* meshlets, size_t numMeshlets, const Frustum& frustum, const glm::vec3& cameraPosition,
+    std::vector<GLsizei>& counts, std::vector<const GLvoid*>& offsets);
+
+#endif
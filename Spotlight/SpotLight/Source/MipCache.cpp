@@ -0,0 +1,159 @@
+#include "MipCache.h"
+#include "Hash.h"
+#include <cstring>
+
+namespace
+{
+    const char MIP_CACHE_MAGIC[4] = { 'M', 'I', 'P', 'C' };
+
+    //Bump whenever the file layout or the filters change. Older caches are then rebuilt
+    const uint32_t MIP_CACHE_VERSION = 1;
+
+    const uint32_t MIP_CACHE_SRGB = 1;
+    const uint32_t MIP_CACHE_WRAP = 2;
+
+    struct MipCacheHeader
+    {
+        char magic[4];
+        uint32_t version;
+        uint32_t width; // of level 0
+        uint32_t height;
+        uint32_t numLevels;
+        uint32_t filter; // MipFilter
+        uint32_t flags; // MIP_CACHE_SRGB, MIP_CACHE_WRAP
+        uint32_t padding;
+        uint64_t sourceHash; // hash of the image file the levels were built from
+        uint64_t payloadHash; // hash of everything after the header, catches truncated or damaged files
+    };
+    static_assert(sizeof(MipCacheHeader) == 48, "MipCacheHeader must stay 48 bytes");
+
+    uint32_t settingsFlags(const MipSettings& settings)
+    {
+        return (settings.srgb ? MIP_CACHE_SRGB : 0) | (settings.wrap ? MIP_CACHE_WRAP : 0);
+    }
+
+    size_t levelBytes(int width, int height, int level)
+    {
+        return (size_t)mipLevelSize(width, level) * mipLevelSize(height, level) * 4;
+    }
+}
+
+MipCache::MipCache()
+    :mWidth(0),
+    mHeight(0),
+    mNumLevels(0)
+{
+}
+
+bool MipCache::open(const std::string& filename, uint64_t sourceHash, const MipSettings& settings)
+{
+    close();
+
+    if (!mFile.open(filename))
+        return false;
+
+    if (mFile.size() < sizeof(MipCacheHeader))
+    {
+        close();
+        return false;
+    }
+
+    MipCacheHeader header;
+    memcpy(&header, mFile.data(), sizeof(header));
+
+    bool valid = memcmp(header.magic, MIP_CACHE_MAGIC, sizeof(MIP_CACHE_MAGIC)) == 0 &&
+        header.version == MIP_CACHE_VERSION &&
+        header.sourceHash == sourceHash &&
+        header.filter == (uint32_t)settings.filter &&
+        header.flags == settingsFlags(settings) &&
+        header.width > 0 && header.height > 0 && header.width <= 65536 && header.height <= 65536 &&
+        (int)header.numLevels == numMipLevels(header.width, header.height);
+    if (valid)
+    {
+        size_t expectedSize = sizeof(MipCacheHeader);
+        for (uint32_t level = 0; level < header.numLevels; level++)
+            expectedSize += levelBytes(header.width, header.height, level);
+        valid = mFile.size() == expectedSize;
+    }
+    if (valid)
+    {
+        //Level by level, as write hashed them
+        const char* pixels = mFile.data() + sizeof(MipCacheHeader);
+        uint64_t payloadHash = hashBytes(NULL, 0);
+        for (uint32_t level = 0; level < header.numLevels; level++)
+        {
+            size_t bytes = levelBytes(header.width, header.height, level);
+            payloadHash = hashBytes(pixels, bytes, payloadHash);
+            pixels += bytes;
+        }
+        valid = payloadHash == header.payloadHash;
+    }
+
+    if (!valid)
+    {
+        close();
+        return false;
+    }
+
+    mWidth = header.width;
+    mHeight = header.height;
+    mNumLevels = header.numLevels;
+    return true;
+}
+
+void MipCache::close()
+{
+    mFile.close();
+    mWidth = 0;
+    mHeight = 0;
+    mNumLevels = 0;
+}
+
+const unsigned char* MipCache::levelPixels(int level) const
+{
+    const unsigned char* pixels = (const unsigned char*)mFile.data() + sizeof(MipCacheHeader);
+    for (int i = 0; i < level; i++)
+        pixels += levelBytes(mWidth, mHeight, i);
+    return pixels;
+}
+
+void MipCache::read(MipChain& chain) const
+{
+    chain.resize(mNumLevels);
+    const unsigned char* pixels = levelPixels(0);
+    for (int level = 0; level < mNumLevels; level++)
+    {
+        size_t bytes = levelBytes(mWidth, mHeight, level);
+        chain[level].width = mipLevelSize(mWidth, level);
+        chain[level].height = mipLevelSize(mHeight, level);
+        chain[level].pixels.assign(pixels, pixels + bytes);
+        pixels += bytes;
+    }
+}
+
+bool MipCache::write(const std::string& filename, uint64_t sourceHash, const MipSettings& settings, const MipChain& chain)
+{
+    if (chain.empty() || (int)chain.size() != numMipLevels(chain[0].width, chain[0].height))
+        return false;
+
+    MipCacheHeader header = {};
+    memcpy(header.magic, MIP_CACHE_MAGIC, sizeof(MIP_CACHE_MAGIC));
+    header.version = MIP_CACHE_VERSION;
+    header.width = chain[0].width;
+    header.height = chain[0].height;
+    header.numLevels = (uint32_t)chain.size();
+    header.filter = settings.filter;
+    header.flags = settingsFlags(settings);
+    header.sourceHash = sourceHash;
+    uint64_t payloadHash = hashBytes(NULL, 0);
+    for (const Image& level : chain)
+        payloadHash = hashBytes(level.pixels.data(), level.pixels.size(), payloadHash);
+    header.payloadHash = payloadHash;
+
+    return writeFileAtomically(filename, [&](std::ostream& file)
+    {
+        file.write((const char*)&header, sizeof(header));
+        for (const Image& level : chain)
+            file.write((const char*)level.pixels.data(), level.pixels.size());
+    });
+}
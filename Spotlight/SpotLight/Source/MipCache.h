@@ -0,0 +1,45 @@
+#ifndef MIP_CACHE_H
+#define MIP_CACHE_H
+
+#include <cstdint>
+#include <string>
+
+#include "MappedFile.h"
+#include "MipChain.h"
+
+//----------------------------------------------
+//Binary sidecar written next to an image ("Brick.jpg.mipcache") holding every level of its mip chain as RGBA8,
+//bottom row first, level 0 first. Loading it replaces decoding the image and filtering the levels.
+//----------------------------------------------
+class MipCache
+{
+public:
+    MipCache();
+
+    static std::string cacheFilename(const std::string& imageFilename) { return imageFilename + ".mipcache"; }
+
+    //Maps the cache and checks that it is complete, undamaged and was built from this exact source with these settings
+    bool open(const std::string& filename, uint64_t sourceHash, const MipSettings& settings);
+    void close();
+
+    //Writes to a temporary file first, so a crash never leaves a half written cache behind
+    static bool write(const std::string& filename, uint64_t sourceHash, const MipSettings& settings, const MipChain& chain);
+
+    int width() const { return mWidth; }
+    int height() const { return mHeight; }
+    int numLevels() const { return mNumLevels; }
+
+    //mipLevelSize(width(), level) x mipLevelSize(height(), level) pixels, straight from the mapping
+    const unsigned char* levelPixels(int level) const;
+
+    //Copies the levels out of the mapping
+    void read(MipChain& chain) const;
+
+private:
+    MappedFile mFile;
+    int mWidth;
+    int mHeight;
+    int mNumLevels;
+};
+
+#endif
@@ -0,0 +1,281 @@
+#include "MipChain.h"
+#include "Hash.h"
+#include "ImageKernels.h"
+#include "MappedFile.h"
+#include "MipCache.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+namespace
+{
+    //Pixels in a chunk of rows handed to the pool, see rowsPerChunk
+    const size_t MIN_PIXELS_PER_CHUNK = 16384;
+
+    //In texels of the smaller level. 3 lobes of the sinc each side
+    const double SINC_RADIUS = 3.0;
+    const double KAISER_ALPHA = 4.0;
+    const double PI = 3.14159265358979323846;
+
+    double sinc(double x)
+    {
+        if (x == 0.0)
+            return 1.0;
+        x *= PI;
+        return sin(x) / x;
+    }
+
+    //Modified Bessel function of the first kind, order 0, summed from its series
+    double besselI0(double x)
+    {
+        double sum = 1.0, term = 1.0;
+        for (int k = 1; k < 50 && term > sum * 1e-12; k++)
+        {
+            double factor = x / (2.0 * k);
+            term *= factor * factor;
+            sum += term;
+        }
+        return sum;
+    }
+
+    double filterRadius(MipFilter filter)
+    {
+        return filter == MIP_FILTER_BOX ? 0.5 : SINC_RADIUS;
+    }
+
+    //x is the distance in texels of the smaller level
+    double filterWeight(MipFilter filter, double x)
+    {
+        x = fabs(x);
+        if (filter == MIP_FILTER_BOX)
+            return x < 0.5 ? 1.0 : 0.0;
+        if (x >= SINC_RADIUS)
+            return 0.0;
+        if (filter == MIP_FILTER_KAISER)
+        {
+            double r = x / SINC_RADIUS;
+            return sinc(x) * besselI0(KAISER_ALPHA * sqrt(1.0 - r * r)) / besselI0(KAISER_ALPHA);
+        }
+        return sinc(x) * sinc(x / SINC_RADIUS);
+    }
+
+    //Along one axis, the texels of the bigger level under the filter of each texel of the smaller one, and their
+    //weights, which sum to 1. The same number for every texel, the layout ImageKernels::sumPixels takes
+    struct Taps
+    {
+        size_t numTaps;
+        std::vector<int> indices; // numTaps per texel
+        std::vector<float> weights;
+    };
+
+    Taps computeTaps(int sourceSize, int size, const MipSettings& settings)
+    {
+        //2 for even sizes. Odd ones don't halve exactly, their filters are stretched a little to cover all texels
+        double scale = (double)sourceSize / size;
+        double radius = filterRadius(settings.filter) * scale;
+
+        Taps taps;
+        taps.numTaps = std::max(1, (int)ceil(2.0 * radius));
+        taps.indices.resize(size * taps.numTaps);
+        taps.weights.resize(size * taps.numTaps);
+        std::vector<double> weights(taps.numTaps);
+        for (int x = 0; x < size; x++)
+        {
+            //The texels whose centers are strictly inside the filter
+            double center = (x + 0.5) * scale;
+            int first = (int)floor(center - radius - 0.5) + 1;
+            double sum = 0.0;
+            for (size_t t = 0; t < taps.numTaps; t++)
+            {
+                int i = first + (int)t;
+                weights[t] = filterWeight(settings.filter, (i + 0.5 - center) / scale);
+                sum += weights[t];
+                if (settings.wrap)
+                    i = (i % sourceSize + sourceSize) % sourceSize;
+                else
+                    i = std::min(std::max(i, 0), sourceSize - 1);
+                taps.indices[x * taps.numTaps + t] = i;
+            }
+            for (size_t t = 0; t < taps.numTaps; t++)
+                taps.weights[x * taps.numTaps + t] = (float)(weights[t] / sum);
+        }
+        return taps;
+    }
+
+    //RGBA8 to the premultiplied linear floats the filters work on. Color weighted by alpha, so texels that are hardly
+    //there don't bleed their color into the levels
+    void toFloat(const unsigned char* in, float* out, size_t count, bool srgb)
+    {
+        if (srgb)
+            ImageKernels::srgbToLinear(in, out, count);
+        else
+        {
+            for (size_t i = 0; i < count * 4; i++)
+                out[i] = in[i] / 255.0f;
+        }
+        for (size_t i = 0; i < count; i++)
+        {
+            float alpha = out[i * 4 + 3];
+            out[i * 4 + 0] *= alpha;
+            out[i * 4 + 1] *= alpha;
+            out[i * 4 + 2] *= alpha;
+        }
+    }
+
+    //And back, overwriting pixels. Where alpha is gone the color went with it
+    void toBytes(float* pixels, unsigned char* out, size_t count, bool srgb)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            float alpha = pixels[i * 4 + 3];
+            float scale = alpha > 0.0f ? 1.0f / alpha : 0.0f;
+            pixels[i * 4 + 0] *= scale;
+            pixels[i * 4 + 1] *= scale;
+            pixels[i * 4 + 2] *= scale;
+        }
+        if (srgb)
+            ImageKernels::linearToSrgb(pixels, out, count);
+        else
+        {
+            for (size_t i = 0; i < count * 4; i++)
+                out[i] = (unsigned char)(std::min(std::max(pixels[i], 0.0f), 1.0f) * 255.0f + 0.5f);
+        }
+    }
+
+    size_t rowsPerChunk(int width)
+    {
+        return std::max((size_t)1, MIN_PIXELS_PER_CHUNK / width);
+    }
+}
+
+const char* mipFilterName(MipFilter filter)
+{
+    const char* names[] = { "box", "Kaiser", "Lanczos" };
+    return names[filter];
+}
+
+int numMipLevels(int width, int height)
+{
+    int size = std::max(width, height);
+    int levels = 1;
+    while (size >> levels > 0)
+        levels++;
+    return levels;
+}
+
+void buildMipChain(MipChain& chain, const MipSettings& settings, ThreadPool* pool)
+{
+    if (chain.empty() || chain[0].pixels.empty())
+        return;
+
+    int width = chain[0].width, height = chain[0].height;
+    int numLevels = numMipLevels(width, height);
+    chain.resize(numLevels);
+
+    //Level 0 as floats, then each level filtered from the floats of the one before
+    std::vector<float> source((size_t)width * height * 4), destination;
+    size_t chunkRows = rowsPerChunk(width);
+    ThreadPool::parallelFor(pool, (height + chunkRows - 1) / chunkRows, [&](size_t chunk)
+    {
+        size_t first = chunk * chunkRows, last = std::min(first + chunkRows, (size_t)height);
+        toFloat(&chain[0].pixels[first * width * 4], &source[first * width * 4], (last - first) * width, settings.srgb);
+    });
+
+    for (int level = 1; level < numLevels; level++)
+    {
+        int sourceWidth = chain[level - 1].width, sourceHeight = chain[level - 1].height;
+        Image& image = chain[level];
+        image.width = mipLevelSize(width, level);
+        image.height = mipLevelSize(height, level);
+        image.pixels.resize((size_t)image.width * image.height * 4);
+        destination.resize(image.pixels.size());
+
+        //Separable: each row of the level sums its taps of source rows into one row of columns, then filters along it
+        Taps columnTaps = computeTaps(sourceWidth, image.width, settings);
+        Taps rowTaps = computeTaps(sourceHeight, image.height, settings);
+        chunkRows = rowsPerChunk(image.width);
+        ThreadPool::parallelFor(pool, (image.height + chunkRows - 1) / chunkRows, [&](size_t chunk)
+        {
+            std::vector<float> columns((size_t)sourceWidth * 4);
+            std::vector<const float*> rows(rowTaps.numTaps);
+            std::vector<float> straight((size_t)image.width * 4);
+            size_t first = chunk * chunkRows, last = std::min(first + chunkRows, (size_t)image.height);
+            for (size_t y = first; y < last; y++)
+            {
+                for (size_t t = 0; t < rowTaps.numTaps; t++)
+                    rows[t] = &source[(size_t)rowTaps.indices[y * rowTaps.numTaps + t] * sourceWidth * 4];
+                ImageKernels::sumRows(rows.data(), &rowTaps.weights[y * rowTaps.numTaps], rowTaps.numTaps, columns.data(),
+                    columns.size());
+
+                float* row = &destination[y * image.width * 4];
+                ImageKernels::sumPixels(columns.data(), columnTaps.indices.data(), columnTaps.weights.data(), columnTaps.numTaps,
+                    row, image.width);
+
+                //The floats stay premultiplied for the next level, the bytes don't
+                memcpy(straight.data(), row, straight.size() * sizeof(float));
+                toBytes(straight.data(), &image.pixels[y * image.width * 4], image.width, settings.srgb);
+            }
+        });
+        source.swap(destination);
+    }
+}
+
+bool loadMipChain(const std::string& filename, MipChain& chain, const MipSettings& settings, ThreadPool* pool)
+{
+    uint64_t sourceHash;
+    {
+        MappedFile imageFile;
+        if (!imageFile.open(filename))
+        {
+            std::cerr << "Failed to load texture: " << filename << std::endl;
+            return false;
+        }
+        sourceHash = hashBytes(imageFile.data(), imageFile.size());
+    }
+
+    std::string cacheFilename = MipCache::cacheFilename(filename);
+    MipCache cache;
+    if (cache.open(cacheFilename, sourceHash, settings))
+    {
+        cache.read(chain);
+        return true;
+    }
+
+    //No usable cache: decode and filter, and save the result for next time
+    chain.resize(1);
+    if (!Texture2D::decodeImage(filename, chain[0]))
+        return false;
+    buildMipChain(chain, settings, pool);
+    if (!MipCache::write(cacheFilename, sourceHash, settings, chain))
+        std::cerr << "Cannot write mip cache: " << cacheFilename << std::endl;
+    return true;
+}
+
+bool cookTexture(const std::string& filename, const MipSettings& settings)
+{
+    MappedFile imageFile;
+    if (!imageFile.open(filename))
+    {
+        std::cerr << "Cannot open file: " << filename << std::endl;
+        return false;
+    }
+
+    MipChain chain(1);
+    if (!Texture2D::decodeImage(filename, chain[0]))
+        return false;
+    buildMipChain(chain, settings, &ThreadPool::shared());
+
+    std::string cacheFilename = MipCache::cacheFilename(filename);
+    if (!MipCache::write(cacheFilename, hashBytes(imageFile.data(), imageFile.size()), settings, chain))
+    {
+        std::cerr << "Cannot write mip cache: " << cacheFilename << std::endl;
+        return false;
+    }
+
+    std::cout << "Cooked " << filename << ": " << chain[0].width << " x " << chain[0].height << ", " << chain.size()
+        << " mip levels, " << mipFilterName(settings.filter) << " filter" << std::endl;
+    return true;
+}
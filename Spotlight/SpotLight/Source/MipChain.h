@@ -0,0 +1,51 @@
+#ifndef MIP_CHAIN_H
+#define MIP_CHAIN_H
+
+#include <string>
+
+#include "Texture2D.h"
+
+class ThreadPool;
+
+//How each level is filtered down from the one before
+enum MipFilter
+{
+    MIP_FILTER_BOX, // average of 2 x 2 texels, what glGenerateMipmap does. Soft, fine patterns alias into it
+    MIP_FILTER_KAISER, // Kaiser windowed sinc over 12 x 12 texels: sharp, with little ringing
+    MIP_FILTER_LANCZOS // Lanczos 3 over 12 x 12 texels: the sharpest, rings a bit at hard edges
+};
+
+struct MipSettings
+{
+    MipFilter filter;
+    bool srgb; // the colors are sRGB, filtered as linear light. Off for data such as normal maps
+    bool wrap; // the texture repeats, filters reach across the edges as GL_REPEAT does. Off clamps them
+
+    MipSettings(MipFilter f = MIP_FILTER_KAISER, bool s = true, bool w = true)
+        :filter(f), srgb(s), wrap(w) {}
+
+    bool operator==(const MipSettings& other) const { return filter == other.filter && srgb == other.srgb && wrap == other.wrap; }
+};
+
+const char* mipFilterName(MipFilter filter);
+
+//Levels down to 1 x 1, each half the size of the one before rounded down, the way OpenGL counts them
+int numMipLevels(int width, int height);
+inline int mipLevelSize(int size, int level) { return size >> level > 0 ? size >> level : 1; }
+
+//----------------------------------------------
+//Fills in levels 1 and on of a chain holding the image as level 0, on the CPU instead of glGenerateMipmap.
+//Filtering is done on premultiplied linear floats, level to level without rounding to bytes in between; each level
+//is only rounded to RGBA8 for its copy in the chain. The rows of a level are split across the pool, the levels follow
+//each other since each is filtered from the one before. The sums run on ImageKernels
+//----------------------------------------------
+void buildMipChain(MipChain& chain, const MipSettings& settings = MipSettings(), ThreadPool* pool = NULL);
+
+//Decodes the image and builds its chain, or takes both from the cache next to it (MipCache.h) when that was built
+//from this exact file with these settings. A new chain is written to the cache for next time
+bool loadMipChain(const std::string& filename, MipChain& chain, const MipSettings& settings = MipSettings(), ThreadPool* pool = NULL);
+
+//Used by "SpotLight.exe --cook <image>...": builds the chain and writes the cache, so none is built at run time
+bool cookTexture(const std::string& filename, const MipSettings& settings = MipSettings());
+
+#endif
@@ -0,0 +1,226 @@
+#include "NormalGenerator.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+namespace
+{
+    const size_t MIN_TRIANGLES_PER_CHUNK = 16384;
+
+    //Angle between two edges leaving the same corner, in radians
+    float cornerAngle(const glm::vec3& e0, const glm::vec3& e1)
+    {
+        float lengths = glm::length(e0) * glm::length(e1);
+        if (lengths == 0.0f)
+            return 0.0f;
+        return acosf(glm::clamp(glm::dot(e0, e1) / lengths, -1.0f, 1.0f));
+    }
+
+    //Only degenerate fans sum to zero. Pointing them up at least lights them like the ground
+    glm::vec3 normalizeOrUp(const glm::vec3& v)
+    {
+        float length = glm::length(v);
+        return length > 0.0f ? v / length : glm::vec3(0.0f, 1.0f, 0.0f);
+    }
+}
+
+bool needsNormals(const ObjData& data)
+{
+    for (size_t i = 0; i < data.corners.size(); i++)
+    {
+        if (data.corners[i].normal < 0)
+            return true;
+    }
+    return false;
+}
+
+void generateNormals(ObjData& data, const NormalOptions& options, ThreadPool* pool)
+{
+    size_t numCorners = data.corners.size();
+    size_t numTriangles = numCorners / 3;
+    size_t numPositions = data.positions.size();
+    if (numTriangles == 0 || numPositions == 0)
+        return;
+
+    size_t numChunks = ThreadPool::numChunks(pool, numTriangles, MIN_TRIANGLES_PER_CHUNK);
+    size_t trianglesPerChunk = (numTriangles + numChunks - 1) / numChunks;
+
+    //The sums run over contiguous position ranges, as many as there are triangle chunks
+    size_t numBlocks = numChunks;
+    size_t positionsPerBlock = (numPositions + numBlocks - 1) / numBlocks;
+
+    bool useCrease = options.creaseAngle < 180.0f;
+    float creaseCos = cosf(glm::radians(options.creaseAngle));
+
+    //Pass 1, per triangle chunk: the weighted face normal every corner contributes, kept as three float arrays so the
+    //sums below stream through memory, plus unit face normals for the crease test. Also counts how many corners each
+    //chunk sends to each position range
+    std::vector<float> weightedX(numCorners), weightedY(numCorners), weightedZ(numCorners);
+    std::vector<glm::vec3> faceNormals(useCrease ? numTriangles : 0);
+    std::vector<size_t> partitionOffsets(numChunks * numBlocks, 0);
+
+    ThreadPool::parallelFor(pool, numChunks, [&](size_t chunk)
+    {
+        size_t first = chunk * trianglesPerChunk, last = std::min(numTriangles, first + trianglesPerChunk);
+        size_t* counts = &partitionOffsets[chunk * numBlocks];
+        for (size_t t = first; t < last; t++)
+        {
+            const ObjCorner* corners = &data.corners[t * 3];
+            bool valid = corners[0].position >= 0 && corners[1].position >= 0 && corners[2].position >= 0;
+            glm::vec3 p[3];
+            for (int k = 0; k < 3; k++)
+                p[k] = corners[k].position >= 0 ? data.positions[corners[k].position] : glm::vec3(0.0f);
+
+            glm::vec3 cross = valid ? glm::cross(p[1] - p[0], p[2] - p[0]) : glm::vec3(0.0f);
+            float length = glm::length(cross);
+            glm::vec3 unit = length > 0.0f ? cross / length : glm::vec3(0.0f);
+            if (useCrease)
+                faceNormals[t] = unit;
+
+            float area = options.weightByArea ? length * 0.5f : 1.0f;
+            for (int k = 0; k < 3; k++)
+            {
+                float weight = area;
+                if (options.weightByAngle)
+                    weight *= cornerAngle(p[(k + 1) % 3] - p[k], p[(k + 2) % 3] - p[k]);
+
+                size_t corner = t * 3 + k;
+                weightedX[corner] = unit.x * weight;
+                weightedY[corner] = unit.y * weight;
+                weightedZ[corner] = unit.z * weight;
+                if (corners[k].position >= 0)
+                    counts[corners[k].position / positionsPerBlock]++;
+            }
+        }
+    });
+
+    //Exclusive prefix sum, range major: every range gets its corners in chunk order, so in input order
+    std::vector<size_t> blockStarts(numBlocks + 1, 0);
+    size_t numPartitioned = 0;
+    for (size_t block = 0; block < numBlocks; block++)
+    {
+        blockStarts[block] = numPartitioned;
+        for (size_t chunk = 0; chunk < numChunks; chunk++)
+        {
+            size_t count = partitionOffsets[chunk * numBlocks + block];
+            partitionOffsets[chunk * numBlocks + block] = numPartitioned;
+            numPartitioned += count;
+        }
+    }
+    blockStarts[numBlocks] = numPartitioned;
+
+    //Pass 2, per triangle chunk: write every corner into its position range. Each chunk owns its slots, nothing is shared
+    std::vector<uint32_t> partitioned(numPartitioned);
+    ThreadPool::parallelFor(pool, numChunks, [&](size_t chunk)
+    {
+        size_t first = chunk * trianglesPerChunk, last = std::min(numTriangles, first + trianglesPerChunk);
+        size_t* cursors = &partitionOffsets[chunk * numBlocks];
+        for (size_t corner = first * 3; corner < last * 3; corner++)
+        {
+            int position = data.corners[corner].position;
+            if (position >= 0)
+                partitioned[cursors[position / positionsPerBlock]++] = (uint32_t)corner;
+        }
+    });
+
+    //Pass 3, per position range: sum around every position. Only corners without a vn get a new normal, and equal
+    //normals at one position are stored once so the indexer welds their corners into one vertex
+    std::vector<std::vector<glm::vec3> > blockNormals(numBlocks);
+    std::vector<uint32_t> cornerSlots(numCorners, 0);
+
+    ThreadPool::parallelFor(pool, numBlocks, [&](size_t block)
+    {
+        size_t firstPosition = std::min(numPositions, block * positionsPerBlock);
+        size_t lastPosition = std::min(numPositions, firstPosition + positionsPerBlock);
+        const uint32_t* begin = partitioned.data() + blockStarts[block];
+        size_t count = blockStarts[block + 1] - blockStarts[block];
+
+        //Counting sort by position inside the range. Stable, so the summation order stays the input order
+        std::vector<uint32_t> offsets(lastPosition - firstPosition + 1, 0);
+        for (size_t i = 0; i < count; i++)
+            offsets[data.corners[begin[i]].position - firstPosition + 1]++;
+        for (size_t p = 0; p + 1 < offsets.size(); p++)
+            offsets[p + 1] += offsets[p];
+        std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+        std::vector<uint32_t> sorted(count);
+        for (size_t i = 0; i < count; i++)
+            sorted[fill[data.corners[begin[i]].position - firstPosition]++] = begin[i];
+
+        std::vector<glm::vec3>& normals = blockNormals[block];
+        for (size_t p = 0; p + 1 < offsets.size(); p++)
+        {
+            const uint32_t* around = sorted.data() + offsets[p];
+            size_t numAround = offsets[p + 1] - offsets[p];
+
+            bool needed = false;
+            for (size_t i = 0; i < numAround && !needed; i++)
+                needed = data.corners[around[i]].normal < 0;
+            if (!needed)
+                continue;
+
+            if (!useCrease)
+            {
+                //One sum shared by every corner at this position
+                glm::vec3 sum(0.0f);
+                for (size_t i = 0; i < numAround; i++)
+                    sum += glm::vec3(weightedX[around[i]], weightedY[around[i]], weightedZ[around[i]]);
+
+                normals.push_back(normalizeOrUp(sum));
+                for (size_t i = 0; i < numAround; i++)
+                    cornerSlots[around[i]] = (uint32_t)normals.size() - 1;
+                continue;
+            }
+
+            //Each corner only sums the faces within the crease angle of its own
+            size_t positionFirstSlot = normals.size();
+            for (size_t i = 0; i < numAround; i++)
+            {
+                uint32_t corner = around[i];
+                if (data.corners[corner].normal >= 0)
+                    continue;
+
+                const glm::vec3& face = faceNormals[corner / 3];
+                glm::vec3 sum(0.0f);
+                for (size_t j = 0; j < numAround; j++)
+                {
+                    if (j == i || glm::dot(face, faceNormals[around[j] / 3]) >= creaseCos)
+                        sum += glm::vec3(weightedX[around[j]], weightedY[around[j]], weightedZ[around[j]]);
+                }
+                glm::vec3 normal = normalizeOrUp(sum);
+
+                size_t slot = positionFirstSlot;
+                while (slot < normals.size() && memcmp(&normals[slot], &normal, sizeof(glm::vec3)) != 0)
+                    slot++;
+                if (slot == normals.size())
+                    normals.push_back(normal);
+                cornerSlots[corner] = (uint32_t)slot;
+            }
+        }
+    });
+
+    //Every range's normals go after the ones read from the file, in range order
+    size_t firstNew = data.normals.size();
+    std::vector<size_t> normalStarts(numBlocks, 0);
+    size_t numNew = 0;
+    for (size_t block = 0; block < numBlocks; block++)
+    {
+        normalStarts[block] = firstNew + numNew;
+        numNew += blockNormals[block].size();
+    }
+    data.normals.resize(firstNew + numNew);
+    for (size_t block = 0; block < numBlocks; block++)
+        std::copy(blockNormals[block].begin(), blockNormals[block].end(), data.normals.begin() + normalStarts[block]);
+
+    ThreadPool::parallelFor(pool, numChunks, [&](size_t chunk)
+    {
+        size_t first = chunk * trianglesPerChunk, last = std::min(numTriangles, first + trianglesPerChunk);
+        for (size_t corner = first * 3; corner < last * 3; corner++)
+        {
+            ObjCorner& objCorner = data.corners[corner];
+            if (objCorner.normal < 0 && objCorner.position >= 0)
+                objCorner.normal = (int)(normalStarts[objCorner.position / positionsPerBlock] + cornerSlots[corner]);
+        }
+    });
+}
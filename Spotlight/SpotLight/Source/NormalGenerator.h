@@ -0,0 +1,28 @@
+#ifndef NORMAL_GENERATOR_H
+#define NORMAL_GENERATOR_H
+
+#include "ObjParser.h"
+
+class ThreadPool;
+
+struct NormalOptions
+{
+    float creaseAngle; // degrees. Faces meeting at a sharper angle than this keep separate normals, 180 smooths everything
+    bool weightByArea; // larger triangles pull the normal harder
+    bool weightByAngle; // the corner angle, so how a polygon was split into triangles doesn't change the result
+
+    NormalOptions(float crease = 180.0f, bool area = true, bool angle = true)
+        :creaseAngle(crease), weightByArea(area), weightByAngle(angle) {}
+};
+
+//True when some face corner has no vn
+bool needsNormals(const ObjData& data);
+
+//Gives every corner without a vn a smooth normal from the faces around its position. Appends to data.normals and
+//points the corners at the new entries; corners that already have a vn are left alone.
+//Runs in three parallel passes over triangles and position ranges with no atomics and no locks:
+//face normals per triangle chunk, a partition of the corners by position range, then one sum per position.
+//The summation order is fixed, so the result is the same for any number of threads
+void generateNormals(ObjData& data, const NormalOptions& options = NormalOptions(), ThreadPool* pool = NULL);
+
+#endif
@@ -0,0 +1,343 @@
+#include "ObjParser.h"
+#include "MappedFile.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <sstream>
+
+namespace
+{
+    const size_t MIN_CHUNK_BYTES = 256 * 1024;
+
+    struct ObjCounts
+    {
+        size_t positions, uvs, normals, triangles;
+    };
+
+    //mtllib and usemtl lines of one chunk, in file order. Few enough to copy out as strings
+    struct ObjChunkMaterials
+    {
+        std::vector<std::string> libraries;
+        std::vector<std::string> uses;
+        std::vector<int> useIds; // uses as indices into ObjData::materialNames, filled in between the two passes
+        int startId; // material of the faces before the chunk's first usemtl
+    };
+
+    inline bool isBlank(char c)
+    {
+        return c == ' ' || c == '\t' || c == '\r';
+    }
+
+    inline const char* skipBlanks(const char* p, const char* end)
+    {
+        while (p < end && isBlank(*p))
+            p++;
+        return p;
+    }
+
+    //Returns the first character of the next line
+    inline const char* nextLine(const char* p, const char* end)
+    {
+        const char* newline = (const char*)memchr(p, '\n', end - p);
+        return newline ? newline + 1 : end;
+    }
+
+    //True when the line at p starts with the keyword followed by a blank ("v 1 2 3" is a vertex, "vt 1 2" is not)
+    inline bool isKeyword(const char* p, const char* end, const char* keyword, size_t length)
+    {
+        return (size_t)(end - p) > length && memcmp(p, keyword, length) == 0 && isBlank(p[length]);
+    }
+
+    //Reads up to count floats. Missing components are left untouched
+    inline void parseFloats(const char* p, const char* end, float* out, int count)
+    {
+        for (int i = 0; i < count; i++)
+        {
+            p = skipBlanks(p, end);
+            if (p < end && *p == '+')
+                p++; // from_chars doesn't accept an explicit plus sign
+
+            std::from_chars_result result = std::from_chars(p, end, out[i]);
+            if (result.ec != std::errc())
+                break;
+            p = result.ptr;
+        }
+    }
+
+    //Parses one v, v/vt, v//vn or v/vt/vn group. Returns NULL when there is no corner at p
+    inline const char* parseCorner(const char* p, const char* end, int corner[3])
+    {
+        corner[0] = corner[1] = corner[2] = 0;
+
+        std::from_chars_result result = std::from_chars(p, end, corner[0]);
+        if (result.ec != std::errc())
+            return NULL;
+        p = result.ptr;
+
+        for (int i = 1; i < 3 && p < end && *p == '/'; i++)
+        {
+            p++;
+            result = std::from_chars(p, end, corner[i]); // "v//vn" leaves the uv index at 0
+            if (result.ec == std::errc())
+                p = result.ptr;
+        }
+
+        //Skip anything we don't understand up to the next blank
+        while (p < end && !isBlank(*p) && *p != '\n')
+            p++;
+        return p;
+    }
+
+    //OBJ indices are 1-based, negative values count back from the last record read so far
+    inline int resolveIndex(int index, size_t readSoFar, size_t total)
+    {
+        long long resolved = -1;
+        if (index > 0)
+            resolved = (long long)index - 1;
+        else if (index < 0)
+            resolved = (long long)readSoFar + index;
+
+        return (resolved >= 0 && resolved < (long long)total) ? (int)resolved : -1;
+    }
+
+    //Number of v/vt/vn groups on a face line
+    inline size_t countCorners(const char* p, const char* end)
+    {
+        size_t count = 0;
+        while (true)
+        {
+            p = skipBlanks(p, end);
+            if (p >= end || *p == '\n')
+                break;
+
+            count++;
+            while (p < end && !isBlank(*p) && *p != '\n')
+                p++;
+        }
+        return count;
+    }
+
+    //The rest of the line without the surrounding blanks
+    inline std::string lineArgument(const char* p, const char* end)
+    {
+        p = skipBlanks(p, end);
+        if (p >= end)
+            return std::string();
+        const char* last = nextLine(p, end);
+        while (last > p && (last[-1] == '\n' || isBlank(last[-1])))
+            last--;
+        return std::string(p, last);
+    }
+
+    //Blank separated names, mtllib may list several files
+    inline void splitNames(const std::string& line, std::vector<std::string>& names)
+    {
+        std::istringstream ss(line);
+        std::string name;
+        while (ss >> name)
+            names.push_back(name);
+    }
+
+    void countRecords(const char* p, const char* end, ObjCounts& counts, ObjChunkMaterials& materials)
+    {
+        while (p < end)
+        {
+            p = skipBlanks(p, end);
+
+            if (isKeyword(p, end, "v", 1))
+                counts.positions++;
+            else if (isKeyword(p, end, "vt", 2))
+                counts.uvs++;
+            else if (isKeyword(p, end, "vn", 2))
+                counts.normals++;
+            else if (isKeyword(p, end, "f", 1))
+            {
+                size_t corners = countCorners(p + 1, end);
+                if (corners >= 3)
+                    counts.triangles += corners - 2;
+            }
+            else if (isKeyword(p, end, "usemtl", 6))
+                materials.uses.push_back(lineArgument(p + 6, end));
+            else if (isKeyword(p, end, "mtllib", 6))
+                splitNames(lineArgument(p + 6, end), materials.libraries);
+
+            p = nextLine(p, end);
+        }
+    }
+
+    //Parses the records of one chunk. start holds how many records of each kind come before the chunk, which is where
+    //this chunk writes its output and what relative indices are resolved against. Returns the number of corners written
+    size_t parseRecords(const char* p, const char* end, ObjData& data, const ObjCounts& start, const ObjChunkMaterials& materials,
+        size_t cornerLimit)
+    {
+        size_t numPositions = start.positions, numUVs = start.uvs, numNormals = start.normals;
+        size_t numCorners = start.triangles * 3;
+        size_t numUses = 0;
+        int material = materials.startId;
+
+        while (p < end)
+        {
+            p = skipBlanks(p, end);
+
+            if (isKeyword(p, end, "v", 1))
+            {
+                glm::vec3& position = data.positions[numPositions++];
+                parseFloats(p + 1, end, &position[0], 3);
+            }
+            else if (isKeyword(p, end, "vt", 2))
+            {
+                glm::vec2& uv = data.uvs[numUVs++];
+                parseFloats(p + 2, end, &uv[0], 2);
+            }
+            else if (isKeyword(p, end, "vn", 2))
+            {
+                glm::vec3& normal = data.normals[numNormals++];
+                parseFloats(p + 2, end, &normal[0], 3);
+                normal = glm::normalize(normal);
+            }
+            else if (isKeyword(p, end, "f", 1))
+            {
+                //Fan triangulate: (first, previous, current) for every corner after the second
+                ObjCorner first, previous;
+                int cornerCount = 0;
+                int corner[3];
+                const char* q = p + 1;
+
+                while (true)
+                {
+                    q = skipBlanks(q, end);
+                    if (q >= end || *q == '\n')
+                        break;
+
+                    q = parseCorner(q, end, corner);
+                    if (q == NULL)
+                        break;
+
+                    ObjCorner current;
+                    current.position = resolveIndex(corner[0], numPositions, data.positions.size());
+                    current.uv = resolveIndex(corner[1], numUVs, data.uvs.size());
+                    current.normal = resolveIndex(corner[2], numNormals, data.normals.size());
+
+                    if (cornerCount == 0)
+                        first = current;
+                    else if (cornerCount >= 2 && numCorners + 3 <= cornerLimit)
+                    {
+                        data.triangleMaterials[numCorners / 3] = material;
+                        data.corners[numCorners++] = first;
+                        data.corners[numCorners++] = previous;
+                        data.corners[numCorners++] = current;
+                    }
+                    previous = current;
+                    cornerCount++;
+                }
+            }
+            else if (isKeyword(p, end, "usemtl", 6) && numUses < materials.useIds.size())
+                material = materials.useIds[numUses++];
+
+            p = nextLine(p, end);
+        }
+
+        return numCorners - start.triangles * 3;
+    }
+
+    //Splits [begin, end) into numChunks pieces of about the same size. Every boundary is moved to the start of a line
+    std::vector<const char*> splitChunks(const char* begin, const char* end, size_t numChunks)
+    {
+        std::vector<const char*> boundaries(numChunks + 1, end);
+        boundaries[0] = begin;
+
+        size_t chunkSize = (end - begin) / numChunks;
+        for (size_t i = 1; i < numChunks; i++)
+            boundaries[i] = std::max(boundaries[i - 1], nextLine(begin + i * chunkSize, end));
+        return boundaries;
+    }
+}
+
+bool parseOBJ(const std::string& filename, ObjData& data, ThreadPool* pool)
+{
+    MappedFile file;
+    if (!file.open(filename))
+        return false;
+
+    parseOBJBuffer(file.data(), file.data() + file.size(), data, pool);
+    return true;
+}
+
+void parseOBJBuffer(const char* begin, const char* end, ObjData& data, ThreadPool* pool)
+{
+    size_t numChunks = ThreadPool::numChunks(pool, end - begin, MIN_CHUNK_BYTES);
+    std::vector<const char*> boundaries = splitChunks(begin, end, numChunks);
+
+    //First pass: count records per chunk
+    std::vector<ObjCounts> starts(numChunks, ObjCounts());
+    std::vector<ObjChunkMaterials> materials(numChunks);
+    std::function<void(size_t)> countChunk = [&](size_t chunk)
+    {
+        countRecords(boundaries[chunk], boundaries[chunk + 1], starts[chunk], materials[chunk]);
+    };
+
+    ThreadPool::parallelFor(pool, numChunks, countChunk);
+
+    //Exclusive prefix sum turns the counts into each chunk's output offsets
+    ObjCounts totals = {};
+    for (size_t chunk = 0; chunk < numChunks; chunk++)
+    {
+        ObjCounts counts = starts[chunk];
+        starts[chunk] = totals;
+        totals.positions += counts.positions;
+        totals.uvs += counts.uvs;
+        totals.normals += counts.normals;
+        totals.triangles += counts.triangles;
+    }
+
+    //Material names get their ids in file order, and every chunk starts with the material the chunks before it ended on
+    data.materialLibraries.clear();
+    data.materialNames.assign(1, std::string());
+    int material = 0;
+    for (ObjChunkMaterials& chunk : materials)
+    {
+        data.materialLibraries.insert(data.materialLibraries.end(), chunk.libraries.begin(), chunk.libraries.end());
+        chunk.startId = material;
+        for (const std::string& name : chunk.uses)
+        {
+            material = (int)(std::find(data.materialNames.begin(), data.materialNames.end(), name) - data.materialNames.begin());
+            if (material == (int)data.materialNames.size())
+                data.materialNames.push_back(name);
+            chunk.useIds.push_back(material);
+        }
+    }
+
+    //Every array is allocated exactly once. Value initialized, so components missing in the file read as 0
+    data.positions.assign(totals.positions, glm::vec3(0.0f));
+    data.uvs.assign(totals.uvs, glm::vec2(0.0f));
+    data.normals.assign(totals.normals, glm::vec3(0.0f));
+    data.corners.resize(totals.triangles * 3);
+    data.triangleMaterials.resize(totals.triangles);
+
+    //Second pass: parse every chunk in place, straight into its slice of the output
+    std::vector<size_t> written(numChunks, 0);
+    std::function<void(size_t)> parseChunk = [&](size_t chunk)
+    {
+        size_t cornerLimit = (chunk + 1 < numChunks) ? starts[chunk + 1].triangles * 3 : data.corners.size();
+        written[chunk] = parseRecords(boundaries[chunk], boundaries[chunk + 1], data, starts[chunk], materials[chunk], cornerLimit);
+    };
+
+    ThreadPool::parallelFor(pool, numChunks, parseChunk);
+
+    //Close the gaps left by faces the counting pass expected but that turned out to be malformed
+    size_t numCorners = 0;
+    for (size_t chunk = 0; chunk < numChunks; chunk++)
+    {
+        size_t from = starts[chunk].triangles * 3;
+        if (from != numCorners)
+        {
+            std::copy(data.corners.begin() + from, data.corners.begin() + from + written[chunk], data.corners.begin() + numCorners);
+            std::copy(data.triangleMaterials.begin() + from / 3, data.triangleMaterials.begin() + (from + written[chunk]) / 3,
+                data.triangleMaterials.begin() + numCorners / 3);
+        }
+        numCorners += written[chunk];
+    }
+    data.corners.resize(numCorners);
+    data.triangleMaterials.resize(numCorners / 3);
+}
@@ -0,0 +1,40 @@
+#ifndef OBJ_PARSER_H
+#define OBJ_PARSER_H
+
+#include <vector>
+#include <string>
+
+#include "glm/glm.hpp"
+
+//One corner of a triangle. Indices are 0-based into the ObjData arrays, -1 when the face doesn't reference that attribute
+struct ObjCorner
+{
+    int position;
+    int uv;
+    int normal;
+};
+
+//Raw records read from an OBJ file
+struct ObjData
+{
+    std::vector<glm::vec3> positions; // v
+    std::vector<glm::vec2> uvs; // vt
+    std::vector<glm::vec3> normals; // vn
+    std::vector<ObjCorner> corners; // f, three corners per triangle (polygons are fan triangulated)
+    std::vector<std::string> materialLibraries; // mtllib, file names as written
+    std::vector<std::string> materialNames; // usemtl, every name once in order of first use. [0] is "", the faces before any usemtl
+    std::vector<int> triangleMaterials; // one per triangle, into materialNames
+};
+
+class ThreadPool;
+
+//Memory maps the file and scans it in place.
+//A first pass counts the records so every array is sized once, the second pass parses numbers straight out of the mapping.
+//Nothing is allocated per line.
+//With a pool, large files are cut into line aligned chunks that are counted and parsed in parallel. Prefix sums of the
+//per chunk counts give every chunk its output offsets, so the result is identical to the serial parse. The usemtl
+//lines are collected by the first pass as well, which tells every chunk the material its first faces continue with.
+bool parseOBJ(const std::string& filename, ObjData& data, ThreadPool* pool = NULL);
+void parseOBJBuffer(const char* begin, const char* end, ObjData& data, ThreadPool* pool = NULL);
+
+#endif
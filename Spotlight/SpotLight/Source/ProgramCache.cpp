@@ -0,0 +1,124 @@
+#include "ProgramCache.h"
+#include "Hash.h"
+#include "MappedFile.h"
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <vector>
+
+namespace
+{
+    const char PROGRAM_CACHE_MAGIC[4] = { 'P', 'R', 'G', 'B' };
+
+    //Bump whenever the file layout or the key changes
+    const uint32_t PROGRAM_CACHE_VERSION = 1;
+
+    struct ProgramCacheHeader
+    {
+        char magic[4];
+        uint32_t version;
+        uint32_t binaryFormat; // the GLenum glGetProgramBinary returned
+        uint32_t binaryBytes;
+        uint64_t key;
+        uint64_t payloadHash; // hash of the binary, catches truncated or damaged files
+    };
+    static_assert(sizeof(ProgramCacheHeader) == 32, "ProgramCacheHeader must stay 32 bytes");
+
+    std::string gDirectory = "ShaderCache";
+
+    uint64_t hashString64(const char* text, uint64_t seed)
+    {
+        //With the terminator, so "ab" + "c" and "a" + "bc" differ
+        return hashBytes(text, text == NULL ? 0 : strlen(text) + 1, seed);
+    }
+}
+
+void ProgramCache::setDirectory(const std::string& directory)
+{
+    gDirectory = directory;
+}
+
+const std::string& ProgramCache::getDirectory()
+{
+    return gDirectory;
+}
+
+bool ProgramCache::isEnabled()
+{
+    if (gDirectory.empty() || !(GLEW_VERSION_4_1 || GLEW_ARB_get_program_binary))
+        return false;
+
+    GLint numFormats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &numFormats);
+    return numFormats > 0;
+}
+
+uint64_t ProgramCache::makeKey(const std::string& vertexSource, const std::string& fragmentSource, const std::string& defines)
+{
+    uint64_t key = hashString64(vertexSource.c_str(), 14695981039346656037ull);
+    key = hashString64(fragmentSource.c_str(), key);
+    key = hashString64(defines.c_str(), key);
+    key = hashString64((const char*)glGetString(GL_VENDOR), key);
+    key = hashString64((const char*)glGetString(GL_RENDERER), key);
+    key = hashString64((const char*)glGetString(GL_VERSION), key);
+    return key;
+}
+
+std::string ProgramCache::cacheFilename(uint64_t key)
+{
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.progbin", (unsigned long long)key);
+    return gDirectory + "/" + name;
+}
+
+bool ProgramCache::load(const std::string& filename, uint64_t key, GLuint program)
+{
+    MappedFile file;
+    if (!file.open(filename) || file.size() < sizeof(ProgramCacheHeader))
+        return false;
+
+    ProgramCacheHeader header;
+    memcpy(&header, file.data(), sizeof(header));
+    const char* binary = file.data() + sizeof(header);
+    if (memcmp(header.magic, PROGRAM_CACHE_MAGIC, sizeof(PROGRAM_CACHE_MAGIC)) != 0 || header.version != PROGRAM_CACHE_VERSION ||
+        header.key != key || header.binaryBytes != file.size() - sizeof(header) ||
+        header.payloadHash != hashBytes(binary, header.binaryBytes))
+        return false;
+
+    //Uniform values and block bindings come back as after a fresh link, the caller sets them again either way
+    glProgramBinary(program, (GLenum)header.binaryFormat, binary, (GLsizei)header.binaryBytes);
+    GLint status = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &status);
+    return status == GL_TRUE;
+}
+
+bool ProgramCache::write(const std::string& filename, uint64_t key, GLuint program)
+{
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0)
+        return false;
+
+    std::vector<char> binary(length);
+    GLenum format = 0;
+    glGetProgramBinary(program, length, &length, &format, binary.data());
+    if (length <= 0)
+        return false;
+
+    ProgramCacheHeader header = {};
+    memcpy(header.magic, PROGRAM_CACHE_MAGIC, sizeof(PROGRAM_CACHE_MAGIC));
+    header.version = PROGRAM_CACHE_VERSION;
+    header.binaryFormat = format;
+    header.binaryBytes = (uint32_t)length;
+    header.key = key;
+    header.payloadHash = hashBytes(binary.data(), length);
+
+    std::error_code error;
+    std::filesystem::create_directories(std::filesystem::path(filename).parent_path(), error);
+
+    return writeFileAtomically(filename, [&](std::ostream& file)
+    {
+        file.write((const char*)&header, sizeof(header));
+        file.write(binary.data(), length);
+    });
+}
@@ -0,0 +1,39 @@
+#ifndef PROGRAM_CACHE_H
+#define PROGRAM_CACHE_H
+
+#include <cstdint>
+#include <string>
+
+#include "GL/glew.h"
+
+//----------------------------------------------
+//Linked programs saved with glGetProgramBinary, one file per program in a cache directory ("ShaderCache/<key>.progbin").
+//The key hashes the GLSL sources, the #defines and the driver's vendor, renderer and version strings, so an edited
+//shader or a driver update simply misses and the program is compiled again.
+//A binary the driver refuses (glProgramBinary leaves the program unlinked) counts as a miss as well.
+//Hot reloads only read from it, their edits would pile up as keys nothing ever uses again.
+//----------------------------------------------
+class ProgramCache
+{
+public:
+    //Empty turns the cache off. "ShaderCache" by default, relative to the working directory
+    static void setDirectory(const std::string& directory);
+    static const std::string& getDirectory();
+
+    //Directory set and the driver offers at least one binary format. Needs the GL context
+    static bool isEnabled();
+
+    //Needs the GL context, the driver strings are part of it
+    static uint64_t makeKey(const std::string& vertexSource, const std::string& fragmentSource, const std::string& defines);
+    static std::string cacheFilename(uint64_t key);
+
+    //Loads the binary into program, which then is linked. False when there is no such file, it is damaged or from
+    //another key, or the driver rejects it
+    static bool load(const std::string& filename, uint64_t key, GLuint program);
+
+    //Writes to a temporary file first, so a crash never leaves a half written binary behind. The program has to be
+    //linked with GL_PROGRAM_BINARY_RETRIEVABLE_HINT set
+    static bool write(const std::string& filename, uint64_t key, GLuint program);
+};
+
+#endif
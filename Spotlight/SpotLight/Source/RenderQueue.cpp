@@ -0,0 +1,138 @@
+#include "RenderQueue.h"
+#include "GLState.h"
+#include "ShaderLibrary.h"
+#include <algorithm>
+
+RenderQueue::RenderQueue()
+    :mStats()
+{
+}
+
+Texture2D* RenderQueue::getTexture(const std::string& filename)
+{
+    std::map<std::string, std::unique_ptr<Texture2D> >::iterator it = mTextures.find(filename);
+    if (it == mTextures.end())
+    {
+        std::unique_ptr<Texture2D> texture(new Texture2D());
+        if (!texture->loadTexture(filename, true))
+            texture.reset();
+        it = mTextures.insert(std::make_pair(filename, std::move(texture))).first;
+    }
+    return it->second.get();
+}
+
+int RenderQueue::getLayer(IndirectRenderer& renderer, const Texture2D* texture)
+{
+    if (texture == NULL)
+        return -1;
+
+    std::map<const Texture2D*, int>::iterator it = mLayers.find(texture);
+    if (it != mLayers.end())
+        return it->second;
+
+    //Still loading, asked again next frame. A full array is remembered
+    if (texture->getTexture() == 0)
+        return -1;
+    int layer = renderer.addTexture(*texture);
+    mLayers[texture] = layer;
+    return layer;
+}
+
+void RenderQueue::submit(Mesh& mesh, const glm::mat4& model, Texture2D* fallbackTexture)
+{
+    if (!mesh.isDrawable())
+        return;
+
+    Object object = { &mesh, model, 0 };
+    mObjects.push_back(object);
+
+    const std::vector<Material>& materials = mesh.getMaterials();
+    for (size_t m = 0; m < materials.size(); m++)
+    {
+        Texture2D* texture = materials[m].diffuseMap.empty() ? NULL : getTexture(materials[m].diffuseMap);
+        Item item = { mObjects.size() - 1, (GLuint)m, texture != NULL ? texture : fallbackTexture, materials[m].diffuse };
+        mItems.push_back(item);
+    }
+}
+
+const RenderStats& RenderQueue::flush(ShaderProgram& shader, const glm::mat4& view, const glm::mat4& projection,
+    const glm::vec3& cameraPosition, float viewportHeight, RenderOrder order)
+{
+    mStats = RenderStats();
+
+    //Once per object, so all its materials agree on the level
+    for (Object& object : mObjects)
+        object.lod = object.mesh->chooseLod(object.model, projection, cameraPosition, viewportHeight);
+
+    //Stable, so draws of equal state keep the submission order
+    if (order == RENDER_BY_MATERIAL)
+    {
+        std::stable_sort(mItems.begin(), mItems.end(), [this](const Item& a, const Item& b)
+        {
+            if (a.texture != b.texture)
+                return a.texture < b.texture;
+            if (a.color.r != b.color.r) return a.color.r < b.color.r;
+            if (a.color.g != b.color.g) return a.color.g < b.color.g;
+            if (a.color.b != b.color.b) return a.color.b < b.color.b;
+            return mObjects[a.object].mesh < mObjects[b.object].mesh;
+        });
+    }
+
+    UniformHandle materialColorUniform = shader.getUniformHandle(ShaderUniforms::materialColor);
+    UniformHandle modelUniform = shader.getUniformHandle(ShaderUniforms::model);
+
+    const Item* previous = NULL;
+    for (const Item& item : mItems)
+    {
+        const Object& object = mObjects[item.object];
+        if (previous == NULL || item.texture != previous->texture)
+        {
+            if (item.texture != NULL)
+                item.texture->bindTexture(0);
+            else
+                GLState::bindTexture(0, GL_TEXTURE_2D, 0);
+            mStats.textureBinds++;
+        }
+        if (previous == NULL || item.color != previous->color)
+        {
+            shader.setUniform(materialColorUniform, item.color);
+            mStats.colorChanges++;
+        }
+        if (previous == NULL || item.object != previous->object)
+        {
+            shader.setUniform(modelUniform, object.model);
+            mStats.modelChanges++;
+        }
+
+        object.mesh->drawSubmesh(item.material, object.lod, object.model, view, projection, cameraPosition);
+        mStats.draws++;
+        previous = &item;
+    }
+    if (GLState::unbindAfterDraw())
+        GLState::bindTexture(0, GL_TEXTURE_2D, 0); // Unbind the texture after drawing
+
+    mObjects.clear();
+    mItems.clear();
+    return mStats;
+}
+
+const IndirectStats& RenderQueue::flush(IndirectRenderer& renderer, ShaderProgram& shader, const glm::mat4& view,
+    const glm::mat4& projection, const glm::vec3& cameraPosition, float viewportHeight)
+{
+    for (Object& object : mObjects)
+        object.lod = object.mesh->chooseLod(object.model, projection, cameraPosition, viewportHeight);
+
+    //No sorting, the draw data carries the texture layer and the color
+    for (const Item& item : mItems)
+    {
+        int layer = getLayer(renderer, item.texture);
+        if (layer < 0)
+            continue;
+        const Object& object = mObjects[item.object];
+        renderer.submitSubmesh(*object.mesh, item.material, object.lod, layer, object.model, view, projection, cameraPosition);
+    }
+
+    mObjects.clear();
+    mItems.clear();
+    return renderer.flush(shader);
+}
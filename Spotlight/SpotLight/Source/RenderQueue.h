@@ -0,0 +1,89 @@
+#ifndef RENDER_QUEUE_H
+#define RENDER_QUEUE_H
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "IndirectRenderer.h"
+#include "Mesh.h"
+#include "ShaderProgram.h"
+#include "Texture2D.h"
+
+enum RenderOrder
+{
+    RENDER_SUBMISSION_ORDER, // object by object, material by material, as submitted
+    RENDER_BY_MATERIAL // sorted by texture, then material color, then mesh
+};
+
+//State changes issued by the last flush. A renderer without the queue binds everything once per draw
+struct RenderStats
+{
+    size_t draws; // one per visible submesh
+    size_t textureBinds;
+    size_t colorChanges; // materialColor uniform updates
+    size_t modelChanges; // model matrix uniform updates
+};
+
+//----------------------------------------------
+//Collects the submeshes of every object drawn in a frame and draws them grouped by material, so objects sharing a
+//texture share one bind. State is only set when it differs from the previous draw.
+//map_Kd textures are loaded on first use and shared by every material naming the same file
+//----------------------------------------------
+class RenderQueue
+{
+public:
+    RenderQueue();
+
+    //Queues every material of the mesh. Materials without a map_Kd are drawn with fallbackTexture
+    void submit(Mesh& mesh, const glm::mat4& model, Texture2D* fallbackTexture = NULL);
+
+    //Draws and empties the queue. The shader must be in use with its camera uniforms set; the queue sets "model" and
+    //"materialColor" and binds texture unit 0. Levels of detail are chosen per object like Mesh::drawLod
+    const RenderStats& flush(ShaderProgram& shader, const glm::mat4& view, const glm::mat4& projection,
+        const glm::vec3& cameraPosition, float viewportHeight, RenderOrder order = RENDER_BY_MATERIAL);
+
+    //Same levels and meshlet culling, but every draw goes to renderer, which issues them with one multi-draw call
+    //(IndirectRenderer.h). The shader is the renderer's, in use. Textures are copied into its array the first time they
+    //are drawn, so a queue feeds only one renderer. Left out: meshes outside the renderer's arena, and items whose
+    //texture isn't created yet or no longer fits in the array. getStats() stays with the other flush
+    const IndirectStats& flush(IndirectRenderer& renderer, ShaderProgram& shader, const glm::mat4& view, const glm::mat4& projection,
+        const glm::vec3& cameraPosition, float viewportHeight);
+
+    const RenderStats& getStats() const { return mStats; }
+    size_t numTextures() const { return mTextures.size(); }
+
+private:
+    RenderQueue(const RenderQueue&);
+    RenderQueue& operator=(const RenderQueue&);
+
+    struct Object
+    {
+        Mesh* mesh;
+        glm::mat4 model;
+        int lod;
+    };
+
+    struct Item
+    {
+        size_t object;
+        GLuint material;
+        Texture2D* texture;
+        glm::vec3 color;
+    };
+
+    //NULL when the file can't be read, which is only reported once
+    Texture2D* getTexture(const std::string& filename);
+
+    //Layer of the texture in renderer's array, added on first use. -1 when it can't be drawn (yet)
+    int getLayer(IndirectRenderer& renderer, const Texture2D* texture);
+
+    std::vector<Object> mObjects;
+    std::vector<Item> mItems;
+    std::map<std::string, std::unique_ptr<Texture2D> > mTextures;
+    std::map<const Texture2D*, int> mLayers;
+    RenderStats mStats;
+};
+
+#endif
@@ -0,0 +1,69 @@
+#ifndef SHADER_LIBRARY_H
+#define SHADER_LIBRARY_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "Hash.h"
+#include "ShaderProgram.h"
+
+//One shader file as the build embedded it
+struct EmbeddedShader
+{
+    const char* name; // the file name loadShaders gets, relative to bin
+    uint32_t hash; // hashString(name)
+    const char* source; // #includes resolved, what ShaderSource::load gives for the file
+    const char* const* files; // the file and its includes, by source string number
+    size_t numFiles;
+};
+
+//EMBEDDED_SHADERS, sorted by hash, and namespace ShaderUniforms: a constexpr UniformName for every uniform outside of
+//blocks the shaders declare, e.g. shader.setUniform(ShaderUniforms::model, model)
+#include "Generated/EmbeddedShaders.h"
+
+//----------------------------------------------
+//The shaders compiled into the executable. Source/Generated/EmbeddedShaders.h is written before every build by the
+//ShaderEmbed tool (SpotLight.vcxproj's pre-build step) from the .vert and .frag files in bin, their #includes resolved
+//at that time. ShaderProgram takes its sources from here, so starting up reads no shader files; see
+//ShaderProgram::setLoadFromFiles for working on the files themselves.
+//----------------------------------------------
+class ShaderLibrary
+{
+public:
+    static constexpr size_t size() { return sizeof(EMBEDDED_SHADERS) / sizeof(EMBEDDED_SHADERS[0]); }
+    static constexpr const EmbeddedShader& get(size_t index) { return EMBEDDED_SHADERS[index]; }
+
+    //NULL for files that weren't embedded. A name known at compile time is looked up at compile time
+    static constexpr const EmbeddedShader* find(const char* name) { return find(hashString(name)); }
+
+    static constexpr const EmbeddedShader* find(uint32_t hash)
+    {
+        size_t first = 0, last = size();
+        while (first < last)
+        {
+            size_t middle = (first + last) / 2;
+            if (EMBEDDED_SHADERS[middle].hash < hash)
+                first = middle + 1;
+            else
+                last = middle;
+        }
+        return first < size() && EMBEDDED_SHADERS[first].hash == hash ? &EMBEDDED_SHADERS[first] : NULL;
+    }
+
+    //The hashes ShaderEmbed wrote are hashString's and in order
+    static constexpr bool isConsistent()
+    {
+        for (size_t i = 0; i < size(); i++)
+        {
+            if (EMBEDDED_SHADERS[i].hash != hashString(EMBEDDED_SHADERS[i].name))
+                return false;
+            if (i > 0 && EMBEDDED_SHADERS[i - 1].hash >= EMBEDDED_SHADERS[i].hash)
+                return false;
+        }
+        return true;
+    }
+};
+
+static_assert(ShaderLibrary::isConsistent(), "Generated/EmbeddedShaders.h doesn't match Hash.h, build ShaderEmbed again");
+
+#endif
@@ -1,23 +1,237 @@
 #include "ShaderProgram.h"
-#include <fstream> 
+#include "GLState.h"
+#include "ProgramCache.h"
+#include "ShaderLibrary.h"
+#include "ShaderSource.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
 #include <iostream>
-#include <sstream>
 #include "glm/gtc/type_ptr.hpp"
 
 ShaderProgram::ShaderProgram()
-    : mHandle(0)
+    : mHandle(0),
+    mFromCache(false),
+    mLoadCount(0),
+    mLoad(),
+    mReload(),
+    mBuildMs(0.0),
+    mUniformCalls(0),
+    mUniformSkips(0)
 {
 }
 
 ShaderProgram::~ShaderProgram()
 {
-    glDeleteProgram(mHandle);
+    dropBuild(mLoad);
+    dropBuild(mReload);
+    GLState::deleteProgram(mHandle);
 }
 
-bool ShaderProgram::loadShaders(const char* VertexShaderFilename, const char* FragmentShaderFilename)
+namespace
 {
-    string vsString = FileToString(VertexShaderFilename);
-    string fsString = FileToString(FragmentShaderFilename);
+    bool gLoadFromFiles = false;
+
+    double elapsedMs(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    //The defines go after "#version", which has to stay the first line
+    string insertDefines(const string& source, const string& defines)
+    {
+        if (defines.empty())
+            return source;
+
+        size_t lineEnd = 0;
+        if (source.compare(0, 8, "#version") == 0)
+        {
+            lineEnd = source.find('\n');
+            lineEnd = lineEnd == string::npos ? source.size() : lineEnd + 1;
+        }
+        string definesLine = defines;
+        if (definesLine.back() != '\n')
+            definesLine += '\n';
+        definesLine += lineEnd > 0 ? "#line 2 0\n" : "#line 1 0\n"; // error messages keep the file's line numbers
+        return source.substr(0, lineEnd) + definesLine + source.substr(lineEnd);
+    }
+}
+
+bool ShaderProgram::loadShaders(const char* VertexShaderFilename, const char* FragmentShaderFilename, const char* defines)
+{
+    beginLoadShaders(VertexShaderFilename, FragmentShaderFilename, defines);
+    waitUntilReady();
+
+    return true;
+}
+
+void ShaderProgram::beginLoadShaders(const char* VertexShaderFilename, const char* FragmentShaderFilename, const char* defines)
+{
+    //Loads still running are dropped
+    dropBuild(mLoad);
+    dropBuild(mReload);
+
+    mVertexFilename = VertexShaderFilename;
+    mFragmentFilename = FragmentShaderFilename;
+    mDefines = defines == NULL ? "" : defines;
+
+    GLState::deleteProgram(mHandle);
+    mHandle = 0;
+    mUniforms.clear();
+
+    startBuild(mLoad, gLoadFromFiles);
+    if (mLoad.fromCache)
+        activate(mLoad, false); // from the cache, nothing to wait for
+}
+
+bool ShaderProgram::isReady()
+{
+    if (mLoad.program == 0)
+        return mHandle != 0;
+    if (!isBuildDone(mLoad))
+        return false;
+
+    //A program that failed to link is used all the same, as loadShaders always did. The log says why
+    finishBuild(mLoad);
+    activate(mLoad, false);
+    return true;
+}
+
+void ShaderProgram::waitUntilReady()
+{
+    if (mLoad.program != 0)
+    {
+        finishBuild(mLoad);
+        activate(mLoad, false);
+    }
+}
+
+bool ShaderProgram::enableParallelCompile()
+{
+    //0xFFFFFFFF: as many threads as the driver wants
+    if (GLEW_KHR_parallel_shader_compile)
+        glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+    else if (GLEW_ARB_parallel_shader_compile)
+        glMaxShaderCompilerThreadsARB(0xFFFFFFFF);
+    else
+        return false;
+    return true;
+}
+
+void ShaderProgram::setHotReload(bool enabled)
+{
+    if (!enabled)
+    {
+        mWatcher.reset();
+        dropBuild(mReload);
+        return;
+    }
+    if (!mWatcher)
+    {
+        mWatcher.reset(new FileWatcher());
+        watchFiles();
+    }
+}
+
+void ShaderProgram::watchFiles()
+{
+    mWatcher->clear();
+    for (const string& filename : mSourceFiles)
+        mWatcher->watch(filename);
+}
+
+bool ShaderProgram::updateHotReload()
+{
+    //Nothing to reload before the first load is in
+    if (!mWatcher || mHandle == 0 || mLoad.program != 0)
+        return false;
+
+    //Saving again while a rebuild runs starts it over with the newest files
+    if (mWatcher->poll())
+    {
+        dropBuild(mReload);
+        startBuild(mReload, true, false);
+    }
+    if (mReload.program == 0 || !isBuildDone(mReload))
+        return false;
+
+    if (!finishBuild(mReload))
+    {
+        std::cerr << "Reloading " << mVertexFilename << " + " << mFragmentFilename << " failed, the old program stays" << std::endl;
+        dropBuild(mReload);
+        return false;
+    }
+    activate(mReload, true);
+    std::cout << "Reloaded " << mVertexFilename << " + " << mFragmentFilename << std::endl;
+    return true;
+}
+
+void ShaderProgram::setLoadFromFiles(bool enabled)
+{
+    gLoadFromFiles = enabled;
+}
+
+void ShaderProgram::startBuild(Build& build, bool fromFiles, bool saveToCache)
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    build.vertexFiles.clear();
+    build.fragmentFiles.clear();
+
+    //The embedded copies when both files were embedded, their #includes are resolved already
+    const EmbeddedShader* embedded[2] = { ShaderLibrary::find(mVertexFilename.c_str()), ShaderLibrary::find(mFragmentFilename.c_str()) };
+    string vsString, fsString;
+    if (!fromFiles && embedded[0] != NULL && embedded[1] != NULL)
+    {
+        vsString = insertDefines(embedded[0]->source, mDefines);
+        fsString = insertDefines(embedded[1]->source, mDefines);
+        build.vertexFiles.assign(embedded[0]->files, embedded[0]->files + embedded[0]->numFiles);
+        build.fragmentFiles.assign(embedded[1]->files, embedded[1]->files + embedded[1]->numFiles);
+    }
+    else
+    {
+        vsString = insertDefines(ShaderSource::load(mVertexFilename, build.vertexFiles), mDefines);
+        fsString = insertDefines(ShaderSource::load(mFragmentFilename, build.fragmentFiles), mDefines);
+    }
+
+    //Hot reload watches the included files as well
+    std::vector<string> sourceFiles = build.vertexFiles;
+    for (const string& filename : build.fragmentFiles)
+    {
+        if (std::find(sourceFiles.begin(), sourceFiles.end(), filename) == sourceFiles.end())
+            sourceFiles.push_back(filename);
+    }
+    if (sourceFiles != mSourceFiles)
+    {
+        mSourceFiles.swap(sourceFiles);
+        if (mWatcher)
+            watchFiles();
+    }
+
+    build.program = glCreateProgram();
+    build.vertexShader = build.fragmentShader = 0;
+    build.fromCache = false;
+    build.cacheKey = 0;
+    build.cacheFilename.clear();
+
+    //A binary from an earlier run skips compiling and linking. Any problem with it and the program is built from source
+    if (ProgramCache::isEnabled())
+    {
+        build.cacheKey = ProgramCache::makeKey(vsString, fsString, mDefines);
+        build.cacheFilename = ProgramCache::cacheFilename(build.cacheKey);
+        build.fromCache = ProgramCache::load(build.cacheFilename, build.cacheKey, build.program);
+        if (build.fromCache)
+        {
+            build.ms = elapsedMs(start);
+            return;
+        }
+
+        //A rejected binary leaves the program in an unspecified state, start over with a new one
+        glDeleteProgram(build.program);
+        build.program = glCreateProgram();
+        if (!saveToCache)
+            build.cacheFilename.clear();
+    }
+
     const GLchar* vsSourcePtr = vsString.c_str();
     const GLchar* fsSourcePtr = fsString.c_str();
 
@@ -35,99 +249,285 @@ bool ShaderProgram::loadShaders(const char* VertexShaderFilename, const char* Fr
     ////////////////////////////////////////////////////////////////////////
     */
 
-    GLuint VertexShader = glCreateShader(GL_VERTEX_SHADER);
-    GLuint FragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
+    build.vertexShader = glCreateShader(GL_VERTEX_SHADER);
+    build.fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
 
-    glShaderSource(VertexShader, 1, &vsSourcePtr, NULL); // Set the source code for the vertex shader
-    glShaderSource(FragmentShader, 1, &fsSourcePtr, NULL);
+    glShaderSource(build.vertexShader, 1, &vsSourcePtr, NULL); // Set the source code for the vertex shader
+    glShaderSource(build.fragmentShader, 1, &fsSourcePtr, NULL);
 
-    glCompileShader(VertexShader);
-    CheckCompileErrors(VertexShader, VERTEX);
-    glCompileShader(FragmentShader);
-    CheckCompileErrors(FragmentShader, FRAGMENT);
-    
- 
+    //No status queries until the build is done, each one would wait for the compiler
+    glCompileShader(build.vertexShader);
+    glCompileShader(build.fragmentShader);
 
-    //Create, Attach and Link Shader Program
-    mHandle = glCreateProgram();
-    glAttachShader(mHandle, VertexShader);
-    glAttachShader(mHandle, FragmentShader);
-    glLinkProgram(mHandle);
-    
-    CheckCompileErrors(mHandle, PROGRAM);
-    
-    //Delete the shaders after linking
-    glDeleteShader(VertexShader);
-    glDeleteShader(FragmentShader);
+    //Attach and Link Shader Program. The driver only keeps what glGetProgramBinary needs when asked before linking
+    if (!build.cacheFilename.empty())
+        glProgramParameteri(build.program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    glAttachShader(build.program, build.vertexShader);
+    glAttachShader(build.program, build.fragmentShader);
+    glLinkProgram(build.program);
+    build.ms = elapsedMs(start);
+}
+
+bool ShaderProgram::isBuildDone(const Build& build)
+{
+    if (build.fromCache)
+        return true;
 
+    //Same enum for the KHR and the ARB extension. Without either the status queries in finishBuild wait
+    if (GLEW_KHR_parallel_shader_compile || GLEW_ARB_parallel_shader_compile)
+    {
+        GLint done = GL_FALSE;
+        glGetProgramiv(build.program, GL_COMPLETION_STATUS_KHR, &done);
+        return done == GL_TRUE;
+    }
     return true;
 }
 
-void ShaderProgram::use()
+bool ShaderProgram::finishBuild(Build& build)
 {
-    if (mHandle > 0)
+    if (build.fromCache)
+        return true;
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    CheckCompileErrors(build.vertexShader, VERTEX);
+    CheckCompileErrors(build.fragmentShader, FRAGMENT);
+    CheckCompileErrors(build.program, PROGRAM);
+
+    //The logs give included files by number, as "1:12" or "1(12)"
+    GLuint shaders[2] = { build.vertexShader, build.fragmentShader };
+    const std::vector<string>* files[2] = { &build.vertexFiles, &build.fragmentFiles };
+    for (int i = 0; i < 2; i++)
     {
-        glUseProgram(mHandle); // Use the shader program for rendering
+        GLint compiled = GL_TRUE;
+        glGetShaderiv(shaders[i], GL_COMPILE_STATUS, &compiled);
+        if (compiled == GL_TRUE || files[i]->size() < 2)
+            continue;
+        std::cerr << "Source string numbers:";
+        for (size_t f = 0; f < files[i]->size(); f++)
+            std::cerr << " " << f << " " << (*files[i])[f];
+        std::cerr << std::endl;
     }
     
+    //Delete the shaders after linking
+    glDeleteShader(build.vertexShader);
+    glDeleteShader(build.fragmentShader);
+    build.vertexShader = build.fragmentShader = 0;
+
+    GLint status = GL_FALSE;
+    glGetProgramiv(build.program, GL_LINK_STATUS, &status);
+    if (status == GL_TRUE && !build.cacheFilename.empty())
+    {
+        if (!ProgramCache::write(build.cacheFilename, build.cacheKey, build.program))
+            std::cerr << "Could not write the program binary " << build.cacheFilename << std::endl;
+    }
+    build.ms += elapsedMs(start);
+    return status == GL_TRUE;
 }
 
-void ShaderProgram::setUniform(const GLchar* name, const glm::vec2& v)
+void ShaderProgram::dropBuild(Build& build)
 {
-    GLint loc = getUniformLocation(name);
-    glUniform2f(loc, v.x, v.y);
+    if (build.program == 0)
+        return;
+    glDeleteShader(build.vertexShader);
+    glDeleteShader(build.fragmentShader);
+    glDeleteProgram(build.program);
+    build = Build();
 }
 
-void ShaderProgram::setUniform(const GLchar* name, const glm::vec3& v)
+void ShaderProgram::activate(Build& build, bool keepValues)
 {
-    GLint loc = getUniformLocation(name);
-    glUniform3f(loc, v.x, v.y, v.z);
+    std::vector<Uniform> oldUniforms;
+    if (keepValues)
+        oldUniforms.swap(mUniforms);
+
+    GLState::deleteProgram(mHandle);
+    mHandle = build.program;
+    mFromCache = build.fromCache;
+    mBuildMs = build.ms;
+    build = Build();
+    mLoadCount++;
+
+    reflectUniforms();
+    applyBlockBindings();
+    if (oldUniforms.empty())
+        return;
+
+    //Values the old program had are set on the new one, so a reload doesn't lose what was set once at startup.
+    //Locations may have moved, the values go by name and type
+    GLState::useProgram(mHandle);
+    for (Uniform& uniform : mUniforms)
+    {
+        std::vector<Uniform>::const_iterator old = std::lower_bound(oldUniforms.begin(), oldUniforms.end(), uniform.hash,
+            [](const Uniform& a, uint32_t hash) { return a.hash < hash; });
+        if (old == oldUniforms.end() || old->hash != uniform.hash || old->type != uniform.type ||
+            std::memcmp(old->value, uniform.value, sizeof(uniform.value)) == 0)
+            continue;
+
+        std::memcpy(uniform.value, old->value, sizeof(uniform.value));
+        switch (uniform.type)
+        {
+        case GL_FLOAT: glUniform1fv(uniform.location, 1, uniform.value); break;
+        case GL_FLOAT_VEC2: glUniform2fv(uniform.location, 1, uniform.value); break;
+        case GL_FLOAT_VEC3: glUniform3fv(uniform.location, 1, uniform.value); break;
+        case GL_FLOAT_VEC4: glUniform4fv(uniform.location, 1, uniform.value); break;
+        case GL_FLOAT_MAT4: glUniformMatrix4fv(uniform.location, 1, GL_FALSE, uniform.value); break;
+        default: glUniform1iv(uniform.location, 1, (const GLint*)uniform.value); break; // ints, bools and samplers
+        }
+    }
 }
 
-void ShaderProgram::setUniform(const GLchar* name, const glm::vec4& v)
+bool ShaderProgram::use()
 {
-    GLint loc = getUniformLocation(name);
-    glUniform4f(loc, v.x, v.y, v.z, v.w);
+    if (!isReady())
+        return false;
+
+    GLState::useProgram(mHandle); // Use the shader program for rendering
+    return true;
 }
 
-void ShaderProgram::setUniform(const GLchar* name, const glm::mat4& m)
+UniformHandle ShaderProgram::getUniformHandle(UniformName name) const
 {
-    GLint loc = getUniformLocation(name);
-    glUniformMatrix4fv(loc, 1, GL_FALSE, glm::value_ptr(m));
+    std::vector<Uniform>::const_iterator it = std::lower_bound(mUniforms.begin(), mUniforms.end(), name.hash,
+        [](const Uniform& uniform, uint32_t hash) { return uniform.hash < hash; });
+    if (it == mUniforms.end() || it->hash != name.hash)
+        return -1;
+    return (UniformHandle)(it - mUniforms.begin());
 }
 
-GLint ShaderProgram::getUniformLocation(const GLchar* name)
+bool ShaderProgram::changeValue(UniformHandle handle, const void* value, size_t size)
 {
-    std::map<string, GLint>::iterator it = mUniformLocations.find(name);
+    if (handle < 0)
+        return false;
 
-    if (it == mUniformLocations.end())
+    GLfloat* shadow = mUniforms[handle].value;
+    if (std::memcmp(shadow, value, size) == 0)
     {
-        mUniformLocations[name] = glGetUniformLocation(mHandle, name);
+        mUniformSkips++;
+        return false;
     }
-    return mUniformLocations[name];
+    std::memcpy(shadow, value, size);
+    mUniformCalls++;
+    return true;
 }
 
-string ShaderProgram::FileToString(const string& filename)
+void ShaderProgram::setUniform(UniformHandle handle, GLfloat f)
 {
-    std::stringstream ss; //create a string stream to hold the file content
-    std::ifstream file; //open and read files
+    if (changeValue(handle, &f, sizeof(f)))
+        glUniform1f(mUniforms[handle].location, f);
+}
 
-    try
+void ShaderProgram::setUniform(UniformHandle handle, const glm::vec2& v)
+{
+    if (changeValue(handle, &v, sizeof(v)))
+        glUniform2f(mUniforms[handle].location, v.x, v.y);
+}
+
+void ShaderProgram::setUniform(UniformHandle handle, const glm::vec3& v)
+{
+    if (changeValue(handle, &v, sizeof(v)))
+        glUniform3f(mUniforms[handle].location, v.x, v.y, v.z);
+}
+
+void ShaderProgram::setUniform(UniformHandle handle, const glm::vec4& v)
+{
+    if (changeValue(handle, &v, sizeof(v)))
+        glUniform4f(mUniforms[handle].location, v.x, v.y, v.z, v.w);
+}
+
+void ShaderProgram::setUniform(UniformHandle handle, const glm::mat4& m)
+{
+    if (changeValue(handle, &m, sizeof(m)))
+        glUniformMatrix4fv(mUniforms[handle].location, 1, GL_FALSE, glm::value_ptr(m));
+}
+
+void ShaderProgram::setUniformInt(UniformHandle handle, GLint i)
+{
+    if (changeValue(handle, &i, sizeof(i)))
+        glUniform1i(mUniforms[handle].location, i);
+}
+
+bool ShaderProgram::bindUniformBlock(const GLchar* blockName, GLuint bindingPoint)
+{
+    bool known = false;
+    for (std::pair<string, GLuint>& binding : mBlockBindings)
     {
-        file.open(filename, std::ios::in);
-        if (!file.fail())
+        if (binding.first == blockName)
         {
-            //store the file content in the string stream
-            ss << file.rdbuf();
+            binding.second = bindingPoint;
+            known = true;
         }
-        file.close();
     }
-    catch (std::exception ex)
+    if (!known)
+        mBlockBindings.push_back(std::make_pair(string(blockName), bindingPoint));
+
+    if (mHandle == 0)
+        return true;
+
+    GLuint index = glGetUniformBlockIndex(mHandle, blockName);
+    if (index == GL_INVALID_INDEX)
+        return false;
+
+    glUniformBlockBinding(mHandle, index, bindingPoint);
+    return true;
+}
+
+void ShaderProgram::reflectUniforms()
+{
+    mUniforms.clear();
+    mUniformCalls = mUniformSkips = 0;
+
+    GLint count = 0, maxLength = 0;
+    glGetProgramiv(mHandle, GL_ACTIVE_UNIFORMS, &count);
+    glGetProgramiv(mHandle, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+    std::vector<GLchar> name(std::max(maxLength, 1));
+
+    for (GLint i = 0; i < count; i++)
+    {
+        GLsizei length = 0;
+        GLint size = 0;
+        Uniform uniform;
+        glGetActiveUniform(mHandle, (GLuint)i, (GLsizei)name.size(), &length, &size, &uniform.type, name.data());
+
+        //Block members have no location, they are set through the block's buffer
+        uniform.location = glGetUniformLocation(mHandle, name.data());
+        if (uniform.location < 0)
+            continue;
+
+        //"lights[0]" for arrays
+        string baseName(name.data(), length);
+        if (baseName.size() > 3 && baseName.compare(baseName.size() - 3, 3, "[0]") == 0)
+            baseName.resize(baseName.size() - 3);
+        uniform.hash = hashString(baseName.c_str());
+
+        //The shadow starts out as what linking left in the program: 0, or the initializer in the shader
+        std::memset(uniform.value, 0, sizeof(uniform.value));
+        bool isInt = uniform.type == GL_INT || uniform.type == GL_BOOL || (uniform.type >= GL_SAMPLER_1D && uniform.type <= GL_SAMPLER_2D_SHADOW) ||
+            uniform.type == GL_SAMPLER_2D_ARRAY || uniform.type == GL_SAMPLER_BUFFER;
+        if (isInt)
+            glGetUniformiv(mHandle, uniform.location, (GLint*)uniform.value);
+        else
+            glGetUniformfv(mHandle, uniform.location, uniform.value);
+
+        mUniforms.push_back(uniform);
+    }
+
+    std::sort(mUniforms.begin(), mUniforms.end(), [](const Uniform& a, const Uniform& b) { return a.hash < b.hash; });
+    for (size_t i = 1; i < mUniforms.size(); i++)
+    {
+        if (mUniforms[i].hash == mUniforms[i - 1].hash)
+            std::cerr << "Two uniforms share the hash " << mUniforms[i].hash << ", rename one of them" << std::endl;
+    }
+}
+
+void ShaderProgram::applyBlockBindings()
+{
+    //Linking and glProgramBinary reset them
+    for (const std::pair<string, GLuint>& binding : mBlockBindings)
     {
-        std::cout << "Error reading shader file"<< std::endl;
+        GLuint index = glGetUniformBlockIndex(mHandle, binding.first.c_str());
+        if (index != GL_INVALID_INDEX)
+            glUniformBlockBinding(mHandle, index, binding.second);
     }
-    //return stored content 
-    return ss.str();
 }
 
 void ShaderProgram::CheckCompileErrors(GLuint shader, ShaderType type)
@@ -137,14 +537,14 @@ void ShaderProgram::CheckCompileErrors(GLuint shader, ShaderType type)
     //Use functions to check for compile errors and return error messages
     if (type == PROGRAM)
     {
-        glGetProgramiv(mHandle, GL_LINK_STATUS, &status);
+        glGetProgramiv(shader, GL_LINK_STATUS, &status);
         if (status == GL_FALSE)
         {
             GLint length = 0;
-            glGetProgramiv(mHandle, GL_INFO_LOG_LENGTH, &length);
+            glGetProgramiv(shader, GL_INFO_LOG_LENGTH, &length);
 
             string errorLog(length, ' ');
-            glGetProgramInfoLog(mHandle, length, &length, &errorLog[0]);
+            glGetProgramInfoLog(shader, length, &length, &errorLog[0]);
             std::cerr << "Program failed to link. " << errorLog << std::endl;
         }
     }
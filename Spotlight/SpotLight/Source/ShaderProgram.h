@@ -3,11 +3,27 @@
 #define SHADER_PROGRAM_H
 
 #include <GL/glew.h>
+#include <memory>
 #include <string>
+#include <vector>
 #include "glm/glm.hpp"
-#include <map>
+#include "Hash.h"
+#include "FileWatcher.h"
 using std::string;
 
+//A uniform's name as the hash the program's uniform table is keyed by. Declared constexpr, the hashing happens at
+//compile time: constexpr UniformName MODEL_UNIFORM("model"). ShaderUniforms (ShaderLibrary.h) has one for every uniform
+//the shaders declare
+struct UniformName
+{
+    constexpr UniformName(const char* name) : hash(hashString(name)) {}
+    uint32_t hash;
+};
+
+//Index into a program's uniform table, from getUniformHandle. -1 for uniforms the program doesn't have, setting those
+//does nothing
+typedef int UniformHandle;
+
 class ShaderProgram
 {
 public:
@@ -23,25 +39,148 @@ public:
         PROGRAM
     };
 
-    //Load shaders from extra files in this project
-    bool loadShaders(const char* VertexShaderFilename, const char* FragmentShaderFilename);
+    //Load shaders from extra files in this project, or rather their copies embedded at build time (ShaderLibrary.h)
+    //unless setLoadFromFiles is on or a file wasn't embedded. #include "file" lines are resolved relative to the
+    //including file.
+    //defines: "#define NAME VALUE" lines put after the #version line of both shaders (see ShaderDefines in
+    //ShaderVariants.h). The linked program is saved to and later loaded from ProgramCache's directory
+    bool loadShaders(const char* VertexShaderFilename, const char* FragmentShaderFilename, const char* defines = NULL);
+
+    //loadShaders without waiting: starts the compile and link and returns. Start all programs first, then poll
+    //isReady, so the driver compiles them in parallel (GL_KHR_parallel_shader_compile) while this thread goes on.
+    //A program from the cache is ready right away
+    void beginLoadShaders(const char* VertexShaderFilename, const char* FragmentShaderFilename, const char* defines = NULL);
+
+    //Never blocks when the driver has parallel compile, otherwise waits for the driver like loadShaders. The first call
+    //that sees the link done checks the logs, caches the binary and reads the uniforms
+    bool isReady();
+
+    //Waits for the compile and link, like loadShaders
+    void waitUntilReady();
+
+    //Read the shader files on every load instead of taking the embedded copies, for working on shaders without
+    //building again. Off by default. Hot reload reads the files either way
+    static void setLoadFromFiles(bool enabled);
+
+    //Lets the driver use as many compiler threads as it likes. Needs the GL context; false without the extension
+    static bool enableParallelCompile();
+
+    //Watch the loaded files and build the program again when one changes, see updateHotReload
+    void setHotReload(bool enabled);
+
+    //Call once per frame, between frames. Starts a rebuild when a watched file changed, and when one is done swaps it
+    //in: the uniforms are reflected again and keep their values, the block bindings are set again. Until then, and
+    //when the new version fails to compile or link, the old program stays. True when a new program took over
+    bool updateHotReload();
+
+    //Activate the shader program. Does nothing and returns false while it is still compiling, the caller skips
+    //its draws then (or draws with another program)
+    bool use();
+
+    GLuint getProgram() const { return mHandle; }
+
+    //The last loadShaders took the program binary from the cache instead of compiling
+    bool isFromCache() const { return mFromCache; }
+
+    //Counts the programs that took over, by loading or hot reload. UniformHandles from before a change are stale
+    size_t getLoadCount() const { return mLoadCount; }
+
+    //Time the calling thread spent on the current program: reading, compile and link calls, status checks, binary cache
+    double getBuildMs() const { return mBuildMs; }
 
-    //Activate the shader program
-    void use();
-    
-    void setUniform(const GLchar* name, const glm::vec2& v);
-    void setUniform(const GLchar* name, const glm::vec3& v);
-    void setUniform(const GLchar* name, const glm::vec4& v);
-    void setUniform(const GLchar* name, const glm::mat4& m);
+    //Binary search of the table loadShaders builds from the linked program's active uniforms. Look handles up once
+    //(per program, and again when getLoadCount changes) and keep them for the per draw calls
+    UniformHandle getUniformHandle(UniformName name) const;
+
+    //The program must be in use. Every uniform keeps a copy of its last value, setting the same value again skips the
+    //glUniform call. Changing uniforms of this program any other way breaks that
+    void setUniform(UniformHandle handle, GLfloat f);
+    void setUniform(UniformHandle handle, const glm::vec2& v);
+    void setUniform(UniformHandle handle, const glm::vec3& v);
+    void setUniform(UniformHandle handle, const glm::vec4& v);
+    void setUniform(UniformHandle handle, const glm::mat4& m);
+    void setUniformInt(UniformHandle handle, GLint i);
+
+    //By name, hashed at run time. For setup code and the occasional call
+    void setUniform(const GLchar* name, GLfloat f) { setUniform(getUniformHandle(name), f); }
+    void setUniform(const GLchar* name, const glm::vec2& v) { setUniform(getUniformHandle(name), v); }
+    void setUniform(const GLchar* name, const glm::vec3& v) { setUniform(getUniformHandle(name), v); }
+    void setUniform(const GLchar* name, const glm::vec4& v) { setUniform(getUniformHandle(name), v); }
+    void setUniform(const GLchar* name, const glm::mat4& m) { setUniform(getUniformHandle(name), m); }
+
+    //By a name hashed at compile time, see ShaderUniforms in ShaderLibrary.h: one binary search, no string work
+    void setUniform(UniformName name, GLfloat f) { setUniform(getUniformHandle(name), f); }
+    void setUniform(UniformName name, const glm::vec2& v) { setUniform(getUniformHandle(name), v); }
+    void setUniform(UniformName name, const glm::vec3& v) { setUniform(getUniformHandle(name), v); }
+    void setUniform(UniformName name, const glm::vec4& v) { setUniform(getUniformHandle(name), v); }
+    void setUniform(UniformName name, const glm::mat4& m) { setUniform(getUniformHandle(name), m); }
+
+    //Points a sampler uniform at a texture unit
+    void setUniformSampler(const GLchar* name, GLint textureUnit) { setUniformInt(getUniformHandle(name), textureUnit); }
+    void setUniformSampler(UniformName name, GLint textureUnit) { setUniformInt(getUniformHandle(name), textureUnit); }
+
+    //glUniform calls issued and skipped because the value was already set, since loadShaders
+    size_t getUniformCalls() const { return mUniformCalls; }
+    size_t getUniformSkips() const { return mUniformSkips; }
+
+    //Points a named uniform block at a binding point, see UniformBlocks.h. Returns false when the program has no such
+    //block. While compiling the binding is kept and set once the program is ready
+    bool bindUniformBlock(const GLchar* blockName, GLuint bindingPoint);
 
 
 private:
-    string FileToString(const string& filename);
+    //One active uniform outside of blocks. Arrays are listed under their name without [0] and set from element 0
+    struct Uniform
+    {
+        uint32_t hash;
+        GLint location;
+        GLenum type;
+        GLfloat value[16]; // shadow copy, a GLint for int and sampler types
+    };
+
+    //A program being built, from source or from the cache
+    struct Build
+    {
+        GLuint program; // 0 when there is no build
+        GLuint vertexShader, fragmentShader; // 0 once finished, and for a binary from the cache
+        std::vector<string> vertexFiles, fragmentFiles; // the file and its #includes, by source string number
+        bool fromCache;
+        double ms; // time of this thread in startBuild and finishBuild
+        uint64_t cacheKey;
+        string cacheFilename; // empty without the cache
+    };
+
     void CheckCompileErrors(GLuint shader, ShaderType type);
-    GLint getUniformLocation(const GLchar* name);
-    
+    void reflectUniforms();
+    void applyBlockBindings();
+
+    //fromFiles: read the files even when they were embedded. saveToCache false still loads a cached binary but never
+    //writes one, for hot reloads: every saved edit is a new key, and nothing would ever evict them
+    void startBuild(Build& build, bool fromFiles, bool saveToCache = true);
+    static bool isBuildDone(const Build& build);
+    //Checks the logs, deletes the shaders, writes the binary. Returns the link status
+    bool finishBuild(Build& build);
+    static void dropBuild(Build& build);
+    //The build's program replaces the current one. keepValues: uniforms of the same name and type get the old values
+    void activate(Build& build, bool keepValues);
+    void watchFiles();
+
+    //Compares against the shadow copy and updates it. False when the value was already set
+    bool changeValue(UniformHandle handle, const void* value, size_t size);
+
     GLuint mHandle;
-    std::map<string, GLint> mUniformLocations;
+    bool mFromCache;
+    size_t mLoadCount;
+    Build mLoad; // beginLoadShaders until isReady sees it linked
+    Build mReload; // hot reload in progress, mHandle stays in use meanwhile
+    string mVertexFilename, mFragmentFilename, mDefines;
+    std::vector<string> mSourceFiles; // of the last build, with the #includes
+    double mBuildMs;
+    std::unique_ptr<FileWatcher> mWatcher; // set while hot reload is on
+    std::vector<Uniform> mUniforms; // sorted by hash
+    size_t mUniformCalls;
+    size_t mUniformSkips;
+    std::vector<std::pair<string, GLuint> > mBlockBindings; // bindUniformBlock calls, set again after every load
 
 };
 #endif// SHADER_PROGRAM_H
@@ -0,0 +1,75 @@
+#include "ShaderSource.h"
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+std::string ShaderSource::readFile(const std::string& filename)
+{
+    std::stringstream ss; //create a string stream to hold the file content
+    std::ifstream file; //open and read files
+
+    try
+    {
+        file.open(filename, std::ios::in);
+        if (!file.fail())
+        {
+            //store the file content in the string stream
+            ss << file.rdbuf();
+        }
+        file.close();
+    }
+    catch (const std::exception&)
+    {
+        std::cout << "Error reading shader file"<< std::endl;
+    }
+    //return stored content 
+    return ss.str();
+}
+
+std::string ShaderSource::load(const std::string& filename, std::vector<std::string>& files)
+{
+    files.push_back(filename);
+    std::string source = readFile(filename);
+    int sourceNumber = (int)files.size() - 1;
+    if (source.empty() && sourceNumber > 0)
+        std::cerr << "Cannot open shader include file " << filename << std::endl;
+
+    std::string result;
+    size_t lineStart = 0;
+    int lineNumber = 1;
+    while (lineStart < source.size())
+    {
+        size_t lineEnd = source.find('\n', lineStart);
+        lineEnd = lineEnd == std::string::npos ? source.size() : lineEnd + 1;
+        size_t first = source.find_first_not_of(" \t", lineStart);
+        if (first < lineEnd && source.compare(first, 8, "#include") == 0)
+        {
+            size_t open = source.find('"', first);
+            size_t close = open < lineEnd ? source.find('"', open + 1) : std::string::npos;
+            if (close < lineEnd)
+            {
+                size_t slash = filename.find_last_of("/\\");
+                std::string includeName = (slash == std::string::npos ? "" : filename.substr(0, slash + 1)) +
+                    source.substr(open + 1, close - open - 1);
+                if (std::find(files.begin(), files.end(), includeName) == files.end())
+                {
+                    result += "#line 1 " + std::to_string(files.size()) + "\n";
+                    result += load(includeName, files);
+                    result += "\n#line " + std::to_string(lineNumber + 1) + " " + std::to_string(sourceNumber) + "\n";
+                }
+                else
+                {
+                    result += "\n";
+                }
+                lineStart = lineEnd;
+                lineNumber++;
+                continue;
+            }
+        }
+        result.append(source, lineStart, lineEnd - lineStart);
+        lineStart = lineEnd;
+        lineNumber++;
+    }
+    return result;
+}
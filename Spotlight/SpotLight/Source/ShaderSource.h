@@ -0,0 +1,23 @@
+#ifndef SHADER_SOURCE_H
+#define SHADER_SOURCE_H
+
+#include <string>
+#include <vector>
+
+//----------------------------------------------
+//GLSL text from files, with #include "name" resolved. No GL in here: ShaderProgram loads with it at run time and the
+//ShaderEmbed tool at build time, so both give the same text.
+//----------------------------------------------
+class ShaderSource
+{
+public:
+    //The whole file, empty when it can't be read
+    static std::string readFile(const std::string& filename);
+
+    //The file with its #includes resolved, relative to the including file. Every file is included once, later
+    //#includes of it are dropped. Included text is put between #line directives numbering it as files numbers it:
+    //the file names get appended, the first one is source string 0
+    static std::string load(const std::string& filename, std::vector<std::string>& files);
+};
+
+#endif
@@ -0,0 +1,91 @@
+#include "ShaderVariants.h"
+#include "Hash.h"
+#include <algorithm>
+#include <iomanip>
+
+ShaderDefines& ShaderDefines::set(const std::string& name, int value)
+{
+    std::vector<std::pair<std::string, int> >::iterator it = std::lower_bound(mDefines.begin(), mDefines.end(), name,
+        [](const std::pair<std::string, int>& define, const std::string& name) { return define.first < name; });
+    if (it != mDefines.end() && it->first == name)
+        it->second = value;
+    else
+        mDefines.insert(it, std::make_pair(name, value));
+    return *this;
+}
+
+std::string ShaderDefines::toString() const
+{
+    std::string text;
+    for (const std::pair<std::string, int>& define : mDefines)
+        text += "#define " + define.first + " " + std::to_string(define.second) + "\n";
+    return text;
+}
+
+ShaderProgram& ShaderVariantCache::get(const std::string& vertexFilename, const std::string& fragmentFilename,
+    const ShaderDefines& defines)
+{
+    //With the terminators, so the three strings can't run into each other
+    std::string defineText = defines.toString();
+    uint64_t key = hashBytes(vertexFilename.c_str(), vertexFilename.size() + 1);
+    key = hashBytes(fragmentFilename.c_str(), fragmentFilename.size() + 1, key);
+    key = hashBytes(defineText.c_str(), defineText.size() + 1, key);
+
+    std::map<uint64_t, Variant>::iterator it = mVariants.find(key);
+    if (it != mVariants.end())
+        return *it->second.program;
+
+    Variant& variant = mVariants[key];
+    variant.vertexFilename = vertexFilename;
+    variant.fragmentFilename = fragmentFilename;
+    variant.defines = defineText;
+    variant.program.reset(new ShaderProgram());
+    variant.program->beginLoadShaders(vertexFilename.c_str(), fragmentFilename.c_str(), defineText.c_str());
+    mOrder.push_back(key);
+    return *variant.program;
+}
+
+bool ShaderVariantCache::isReady()
+{
+    bool ready = true;
+    for (std::pair<const uint64_t, Variant>& variant : mVariants)
+        ready = variant.second.program->isReady() && ready;
+    return ready;
+}
+
+void ShaderVariantCache::setHotReload(bool enabled)
+{
+    for (std::pair<const uint64_t, Variant>& variant : mVariants)
+        variant.second.program->setHotReload(enabled);
+}
+
+void ShaderVariantCache::updateHotReload()
+{
+    for (std::pair<const uint64_t, Variant>& variant : mVariants)
+        variant.second.program->updateHotReload();
+}
+
+double ShaderVariantCache::getBuildMs() const
+{
+    double ms = 0.0;
+    for (const std::pair<const uint64_t, Variant>& variant : mVariants)
+        ms += variant.second.program->getBuildMs();
+    return ms;
+}
+
+void ShaderVariantCache::report(std::ostream& out) const
+{
+    out << mVariants.size() << " shader variants, " << std::fixed << std::setprecision(2) << getBuildMs() << " ms to build"
+        << std::defaultfloat << std::endl;
+    for (uint64_t key : mOrder)
+    {
+        const Variant& variant = mVariants.find(key)->second;
+        std::string defines = variant.defines;
+        std::replace(defines.begin(), defines.end(), '\n', ' ');
+        if (defines.empty())
+            defines = "(no defines) ";
+        out << "  " << variant.vertexFilename << " + " << variant.fragmentFilename << ": " << defines << std::fixed
+            << std::setprecision(2) << variant.program->getBuildMs() << " ms" << std::defaultfloat
+            << (variant.program->isFromCache() ? ", from the binary cache" : "") << std::endl;
+    }
+}
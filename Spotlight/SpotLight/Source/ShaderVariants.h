@@ -0,0 +1,67 @@
+#ifndef SHADER_VARIANTS_H
+#define SHADER_VARIANTS_H
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "ShaderProgram.h"
+
+//A set of #defines for one variant of a shader, e.g. ShaderDefines().set("INSTANCED").set("HAS_SPOTLIGHT", 0)
+class ShaderDefines
+{
+public:
+    ShaderDefines& set(const std::string& name, int value = 1);
+
+    //"#define NAME VALUE" lines sorted by name, so the same set always gives the same text and cache key
+    std::string toString() const;
+    bool empty() const { return mDefines.empty(); }
+
+private:
+    std::vector<std::pair<std::string, int> > mDefines; // sorted by name
+};
+
+//----------------------------------------------
+//The variants of the programs in use, each built once: the first get() of a file pair and define set starts loading it
+//(ShaderProgram::beginLoadShaders), later ones return the same program. The linked binaries are also kept on disk,
+//keyed by the source and the defines (ProgramCache.h).
+//Instead of one shader branching on uniforms, every draw uses the variant with only the code it needs
+//----------------------------------------------
+class ShaderVariantCache
+{
+public:
+    ShaderProgram& get(const std::string& vertexFilename, const std::string& fragmentFilename,
+        const ShaderDefines& defines = ShaderDefines());
+
+    size_t size() const { return mVariants.size(); }
+
+    //All variants ready, see ShaderProgram::isReady
+    bool isReady();
+
+    //For every variant, see ShaderProgram
+    void setHotReload(bool enabled);
+    void updateHotReload();
+
+    //Sum of ShaderProgram::getBuildMs over the variants
+    double getBuildMs() const;
+
+    //One line per variant: files, defines, build ms and whether the binary came from the cache
+    void report(std::ostream& out) const;
+
+private:
+    struct Variant
+    {
+        std::string vertexFilename, fragmentFilename;
+        std::string defines;
+        std::unique_ptr<ShaderProgram> program;
+    };
+
+    std::map<uint64_t, Variant> mVariants; // by hash of the file names and defines
+    std::vector<uint64_t> mOrder; // keys in the order of the first get, for the report
+};
+
+#endif
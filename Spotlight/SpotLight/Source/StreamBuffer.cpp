@@ -0,0 +1,125 @@
+#include "StreamBuffer.h"
+#include "GLState.h"
+#include <chrono>
+
+StreamBuffer::StreamBuffer(size_t frameBytes, bool persistent)
+    :mFrameBytes(frameBytes),
+    mBuffer(0),
+    mMapped(NULL),
+    mFrame(STREAM_BUFFER_FRAMES - 1), // the first beginFrame moves to region 0
+    mUsed(0),
+    mCommitted(0),
+    mStats()
+{
+    for (GLsync& fence : mFences)
+        fence = NULL;
+
+    //GL_COPY_WRITE_BUFFER is not part of any VAO or indexed binding, the buffer can be used with any target afterwards
+    glGenBuffers(1, &mBuffer);
+    GLState::bindBuffer(GL_COPY_WRITE_BUFFER, mBuffer);
+    if (persistent && isPersistentSupported())
+    {
+        //Coherent: CPU writes show up for commands issued after them without glFlushMappedBufferRange or a barrier
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(GL_COPY_WRITE_BUFFER, mFrameBytes * STREAM_BUFFER_FRAMES, NULL, flags);
+        mMapped = (unsigned char*)glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, mFrameBytes * STREAM_BUFFER_FRAMES, flags);
+
+        //The fallback orphans with glBufferData, which needs mutable storage. glBufferStorage made this buffer's
+        //immutable, so it is replaced by a fresh one
+        if (mMapped == NULL)
+        {
+            GLState::deleteBuffers(1, &mBuffer);
+            glGenBuffers(1, &mBuffer);
+            GLState::bindBuffer(GL_COPY_WRITE_BUFFER, mBuffer);
+        }
+    }
+    if (mMapped == NULL)
+    {
+        glBufferData(GL_COPY_WRITE_BUFFER, mFrameBytes, NULL, GL_STREAM_DRAW);
+        mStaging.resize(mFrameBytes);
+    }
+    GLState::bindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+StreamBuffer::~StreamBuffer()
+{
+    for (GLsync fence : mFences)
+        glDeleteSync(fence);
+    if (mMapped != NULL)
+    {
+        GLState::bindBuffer(GL_COPY_WRITE_BUFFER, mBuffer);
+        glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+        GLState::bindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    }
+    GLState::deleteBuffers(1, &mBuffer);
+}
+
+bool StreamBuffer::isPersistentSupported()
+{
+    return GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage;
+}
+
+void StreamBuffer::beginFrame()
+{
+    mStats = StreamBufferStats();
+    mUsed = 0;
+    mCommitted = 0;
+    if (mMapped == NULL)
+        return;
+
+    mFrame = (mFrame + 1) % STREAM_BUFFER_FRAMES;
+    GLsync& fence = mFences[mFrame];
+    if (fence == NULL)
+        return;
+
+    //Only blocks when the CPU is STREAM_BUFFER_FRAMES frames ahead. The flush bit makes sure the fence gets submitted
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000) == GL_TIMEOUT_EXPIRED)
+    {
+    }
+    mStats.waitMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    glDeleteSync(fence);
+    fence = NULL;
+}
+
+void* StreamBuffer::allocate(size_t size, size_t alignment, GLintptr& offset)
+{
+    size_t begin = (alignment > 1) ? (mUsed + alignment - 1) / alignment * alignment : mUsed;
+    if (begin + size > mFrameBytes)
+    {
+        mStats.overflows++;
+        return NULL;
+    }
+    mUsed = begin + size;
+    mStats.bytesWritten += size;
+    mStats.allocations++;
+
+    if (mMapped == NULL)
+    {
+        offset = (GLintptr)begin;
+        return &mStaging[begin];
+    }
+    offset = (GLintptr)(mFrame * mFrameBytes + begin);
+    return mMapped + offset;
+}
+
+void StreamBuffer::commit()
+{
+    if (mMapped != NULL || mCommitted == mUsed)
+        return;
+
+    //Orphan, then upload everything of this frame again: ranges bound before the last commit refer to the buffer name,
+    //so they must find their data in the new storage too
+    GLState::bindBuffer(GL_COPY_WRITE_BUFFER, mBuffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, mFrameBytes, NULL, GL_STREAM_DRAW);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, 0, mUsed, mStaging.data());
+    GLState::bindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    mCommitted = mUsed;
+}
+
+void StreamBuffer::endFrame()
+{
+    commit();
+    if (mMapped != NULL)
+        mFences[mFrame] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
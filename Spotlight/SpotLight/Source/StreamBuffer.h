@@ -0,0 +1,76 @@
+#ifndef STREAM_BUFFER_H
+#define STREAM_BUFFER_H
+
+#include <vector>
+
+#include "GL/glew.h"
+
+//Frames the CPU may run ahead of the GPU before beginFrame waits
+const int STREAM_BUFFER_FRAMES = 3;
+
+struct StreamBufferStats
+{
+    size_t bytesWritten; // this frame
+    size_t allocations;
+    size_t overflows; // allocations that didn't fit in the frame's region and returned NULL
+    double waitMs; // beginFrame blocked on the fence of the region it reuses
+};
+
+//----------------------------------------------
+//Ring buffer for data written once per frame or per draw: uniform blocks, instance transforms, indirect commands.
+//The buffer holds one region per frame in flight. With GL 4.4 / ARB_buffer_storage it is created with glBufferStorage
+//and mapped once, persistent and coherent, so allocate() hands out pointers straight into GPU visible memory and nothing
+//is ever copied by the driver. A fence at the end of every frame guards its region until the GPU is done with it.
+//Without buffer storage the frame is written to a CPU copy and commit() uploads it into an orphaned buffer.
+//
+//  stream.beginFrame();
+//  GLintptr offset;
+//  memcpy(stream.allocate(size, alignment, offset), data, size);
+//  stream.commit();
+//  glBindBufferRange(GL_UNIFORM_BUFFER, binding, stream.getBuffer(), offset, size); draw...
+//  stream.endFrame();
+//----------------------------------------------
+class StreamBuffer
+{
+public:
+    //Needs the GL context. frameBytes is the most one frame may allocate. persistent false forces the fallback
+    StreamBuffer(size_t frameBytes, bool persistent = true);
+    ~StreamBuffer();
+
+    static bool isPersistentSupported();
+    bool isPersistent() const { return mMapped != NULL; }
+
+    //Moves to the next frame's region, waiting for the GPU if it is still reading it
+    void beginFrame();
+
+    //size bytes at a multiple of alignment (GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT for uniform blocks). offset is where
+    //they will be in getBuffer() for binding and drawing. NULL when the frame's region is full
+    void* allocate(size_t size, size_t alignment, GLintptr& offset);
+
+    //Makes what was allocated so far visible to the GPU. A no-op when the mapping is coherent, an upload otherwise.
+    //Call before the draws that read it, allocating again afterwards is fine
+    void commit();
+
+    //Fences the frame's region
+    void endFrame();
+
+    GLuint getBuffer() const { return mBuffer; }
+    size_t getFrameBytes() const { return mFrameBytes; }
+    const StreamBufferStats& getStats() const { return mStats; }
+
+private:
+    StreamBuffer(const StreamBuffer&);
+    StreamBuffer& operator=(const StreamBuffer&);
+
+    size_t mFrameBytes;
+    GLuint mBuffer;
+    unsigned char* mMapped; // the whole ring, NULL in the fallback
+    std::vector<unsigned char> mStaging; // fallback: the current frame before commit
+    GLsync mFences[STREAM_BUFFER_FRAMES];
+    int mFrame; // region being written
+    size_t mUsed; // bytes allocated in the region
+    size_t mCommitted; // fallback: bytes already uploaded
+    StreamBufferStats mStats;
+};
+
+#endif
@@ -1,5 +1,12 @@
 #include "Texture2D.h"
+#include "GLState.h"
+#include "ImageKernels.h"
+#include "MappedFile.h"
+#include "MipChain.h"
+#include "ThreadPool.h"
 #define STB_IMAGE_IMPLEMENTATION
+#include <climits>
+#include <cstring>
 #include <iostream>
 #include "stb_image/stb_image.h"
 
@@ -14,69 +21,133 @@ Texture2D::~Texture2D()
 
 bool Texture2D::loadTexture(const string& filename, bool generateMipMaps)
 {
-    //Loading image using custom library
+    MipChain chain(1);
+    if (generateMipMaps)
+        return loadMipChain(filename, chain, MipSettings(), &ThreadPool::shared()) && createTexture(chain);
+    return decodeImage(filename, chain[0]) && createTexture(chain);
+}
+
+bool Texture2D::decodeImage(const string& filename, Image& image)
+{
+    MappedFile file;
+    if (!file.open(filename) || file.size() > INT_MAX)
+    {
+        std::cerr << "Failed to load texture: " << filename << std::endl;
+        return false;
+    }
+
+    //Loading image using custom library. Its JPEG decoder writes RGBA as cheaply as RGB, the other formats come in
+    //their own channels and get filled up to RGBA below
+    const unsigned char* fileData = (const unsigned char*)file.data();
+    bool jpeg = file.size() >= 2 && fileData[0] == 0xFF && fileData[1] == 0xD8;
     int width, height, components;
-    unsigned char* imageData = stbi_load(filename.c_str(), &width, &height, &components, STBI_rgb_alpha);
+    unsigned char* imageData = stbi_load_from_memory(fileData, (int)file.size(), &width, &height, &components,
+        jpeg ? STBI_rgb_alpha : 0);
     if (imageData == NULL)
     {
         std::cerr << "Failed to load texture: " << filename << std::endl;
         return false;
     }
+    if (jpeg)
+        components = 4;
 
-    //invert image
-    int widthInBytes = width * 4;
-    unsigned char* top = NULL;
-    unsigned char* bottom = NULL;
-    unsigned char temp = 0;
-    int halfHeight = height / 2;
-    for (int row = 0; row < halfHeight; row++)
+    //invert image while copying it out of stb_image's buffer: the file's top row becomes the last one
+    size_t widthInBytes = (size_t)width * 4;
+    image.width = width;
+    image.height = height;
+    image.pixels.resize(widthInBytes * height);
+    if (components == 4)
     {
-        top = imageData + row * widthInBytes; // Pointer to the current row from the top
-        bottom = imageData + (height - row - 1) * widthInBytes; // Pointer to the current row from the bottom
-
-        // Swap the rows
-        for (int col = 0; col < widthInBytes; col++)
+        ImageKernels::copyRowsFlipped(imageData, image.pixels.data(), widthInBytes, height);
+    }
+    else if (components == 3)
+    {
+        for (int row = 0; row < height; row++)
         {
-            temp = *top;
-            *top = *bottom;
-            *bottom = temp;
-            top++;
-            bottom++;
+            const unsigned char* source = imageData + (size_t)row * width * 3;
+            ImageKernels::rgbToRgba(source, &image.pixels[(size_t)(height - row - 1) * widthInBytes], width);
+        }
+    }
+    else
+    {
+        //Grey, with or without alpha
+        for (int row = 0; row < height; row++)
+        {
+            const unsigned char* source = imageData + (size_t)row * width * components;
+            unsigned char* destination = &image.pixels[(size_t)(height - row - 1) * widthInBytes];
+            for (int x = 0; x < width; x++)
+            {
+                unsigned char grey = source[x * components];
+                destination[x * 4 + 0] = destination[x * 4 + 1] = destination[x * 4 + 2] = grey;
+                destination[x * 4 + 3] = components == 2 ? source[x * 2 + 1] : 255;
+            }
         }
     }
 
+    stbi_image_free(imageData);
+    return true;
+}
+
+bool Texture2D::createTexture(const Image& image, bool generateMipMaps)
+{
+    if (!generateMipMaps)
+        return upload(&image, 1);
+
+    MipChain chain(1, image);
+    buildMipChain(chain, MipSettings(), &ThreadPool::shared());
+    return createTexture(chain);
+}
+
+bool Texture2D::createTexture(const MipChain& chain)
+{
+    return !chain.empty() && upload(chain.data(), (int)chain.size());
+}
+
+bool Texture2D::upload(const Image* levels, int numLevels)
+{
+    if (levels[0].pixels.empty())
+        return false;
+
     //Create OpenGL texture
     glGenTextures(1,&mTexture);
-    glBindTexture(GL_TEXTURE_2D,mTexture); //We need to bind the texture we are using before setting parameters
+    GLState::bindTexture(0, GL_TEXTURE_2D, mTexture); //We need to bind the texture we are using before setting parameters
     glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_WRAP_S,GL_REPEAT); //left right direction
     glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_WRAP_T,GL_REPEAT); //up down direction
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR); //if texture is larger than the mapping area
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, numLevels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR); //if texture is larger than the mapping area, blending the two nearest mip levels
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR); //if texture is smaller than the mapping area
 
-    //Mapping the loaded image data to the texture
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, imageData);
-
-    //Setup mipmapping if requested
-    if (generateMipMaps)
+    //Mapping the loaded image data and its mip levels to the texture
+    if (GLEW_VERSION_4_2 || GLEW_ARB_texture_storage)
     {
-        glGenerateMipmap(GL_TEXTURE_2D);
+        //Immutable storage: size, format and level count are fixed in one call, so the driver never has to check
+        //the texture for completeness again
+        glTexStorage2D(GL_TEXTURE_2D, numLevels, GL_RGBA8, levels[0].width, levels[0].height);
+        for (int level = 0; level < numLevels; level++)
+            glTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, levels[level].width, levels[level].height, GL_RGBA, GL_UNSIGNED_BYTE,
+                levels[level].pixels.data());
     }
-    
-    //Free the image data and Unbind the texture after loaded into OpenGL
-    stbi_image_free(imageData);
-    glBindTexture(GL_TEXTURE_2D, 0);
-    
+    else
+    {
+        for (int level = 0; level < numLevels; level++)
+            glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA8, levels[level].width, levels[level].height, 0, GL_RGBA, GL_UNSIGNED_BYTE,
+                levels[level].pixels.data());
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, numLevels - 1); //complete with the levels given
+    }
+
+    //Unbind the texture after loaded into OpenGL
+    GLState::bindTexture(0, GL_TEXTURE_2D, 0);
+
     return true;
 }
 
 void Texture2D::bindTexture(GLuint textureUnit)
 {
-    glActiveTexture(GL_TEXTURE0 + textureUnit); 
-    glBindTexture(GL_TEXTURE_2D,mTexture);
+    GLState::bindTexture(textureUnit, GL_TEXTURE_2D, mTexture); // nothing happens when it is bound there already
 }
 
 void Texture2D::unbindTexture(GLuint textureUnit)
 {
-    glActiveTexture(GL_TEXTURE0 + textureUnit);
-    glBindTexture(GL_TEXTURE_2D,0);
+    //Optional, see GLState::setUnbindAfterDraw
+    if (GLState::unbindAfterDraw())
+        GLState::bindTexture(textureUnit, GL_TEXTURE_2D, 0);
 }
\ No newline at end of file
@@ -3,19 +3,43 @@
 
 #include <GL\glew.h>
 #include <string>
+#include <vector>
 using std::string;
 
+//Decoded RGBA8 pixels, bottom row first as OpenGL expects
+struct Image
+{
+    int width;
+    int height;
+    std::vector<unsigned char> pixels;
+};
+
+//An image and its mip levels, level 0 first. See MipChain.h
+typedef std::vector<Image> MipChain;
+
 class Texture2D
 {
 public:
     Texture2D();
     virtual ~Texture2D();
 
+    //Mip levels come from the image's mip cache, or are filtered on the CPU and cached (loadMipChain, MipChain.h)
     bool loadTexture(const string& filename, bool generateMipMaps = true);
+
+    //The two halves of loadTexture. Decoding (and loadMipChain) is safe on any thread, creating the texture needs the
+    //GL thread. See AssetLoader.h
+    static bool decodeImage(const string& filename, Image& image);
+    bool createTexture(const Image& image, bool generateMipMaps = true); // builds the levels on the calling thread
+    bool createTexture(const MipChain& chain);
     void bindTexture(GLuint textureUnit = 0);
     void unbindTexture(GLuint textureUnit = 0);
 
+    //0 until the texture is created
+    GLuint getTexture() const { return mTexture; }
+
 private:
+    bool upload(const Image* levels, int numLevels);
+
     //Create a handle
     GLuint mTexture;
 };
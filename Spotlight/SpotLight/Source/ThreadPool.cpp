@@ -0,0 +1,126 @@
+#include "ThreadPool.h"
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+ThreadPool::ThreadPool(unsigned int numWorkers)
+    :mStopping(false)
+{
+    for (unsigned int i = 0; i < numWorkers; i++)
+        mWorkers.push_back(std::thread(&ThreadPool::workerLoop, this));
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStopping = true;
+    }
+    mWakeUp.notify_all();
+
+    for (size_t i = 0; i < mWorkers.size(); i++)
+        mWorkers[i].join();
+}
+
+ThreadPool& ThreadPool::shared()
+{
+    static ThreadPool pool(std::max(std::thread::hardware_concurrency(), 1u) - 1);
+    return pool;
+}
+
+void ThreadPool::run(const std::function<void()>& task)
+{
+    if (mWorkers.empty())
+    {
+        task();
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mTasks.push_back(task);
+    }
+    mWakeUp.notify_one();
+}
+
+void ThreadPool::parallelFor(size_t count, const std::function<void(size_t)>& body)
+{
+    if (count == 0)
+        return;
+
+    //Indices are handed out through a shared counter, so whoever is free takes the next one
+    struct Job
+    {
+        std::atomic<size_t> next;
+        std::atomic<size_t> finished;
+        size_t count;
+        const std::function<void(size_t)>* body;
+        std::mutex mutex;
+        std::condition_variable done;
+    };
+    std::shared_ptr<Job> job = std::make_shared<Job>();
+    job->next = 0;
+    job->finished = 0;
+    job->count = count;
+    job->body = &body;
+
+    std::function<void()> work = [job]()
+    {
+        size_t index;
+        while ((index = job->next++) < job->count)
+        {
+            (*job->body)(index);
+            if (++job->finished == job->count)
+            {
+                std::lock_guard<std::mutex> lock(job->mutex);
+                job->done.notify_all();
+            }
+        }
+    };
+
+    size_t helpers = std::min(mWorkers.size(), count - 1);
+    for (size_t i = 0; i < helpers; i++)
+        run(work);
+    work();
+
+    //Wait for indices still running on other threads
+    std::unique_lock<std::mutex> lock(job->mutex);
+    job->done.wait(lock, [&job]() { return job->finished == job->count; });
+}
+
+void ThreadPool::parallelFor(ThreadPool* pool, size_t count, const std::function<void(size_t)>& body)
+{
+    if (pool == NULL || count == 1)
+    {
+        for (size_t i = 0; i < count; i++)
+            body(i);
+    }
+    else
+        pool->parallelFor(count, body);
+}
+
+size_t ThreadPool::numChunks(const ThreadPool* pool, size_t total, size_t minPerChunk)
+{
+    if (pool == NULL || pool->numWorkers() == 0)
+        return 1;
+    size_t threads = pool->numWorkers() + 1;
+    return std::max<size_t>(1, std::min<size_t>(threads * 4, total / minPerChunk));
+}
+
+void ThreadPool::workerLoop()
+{
+    while (true)
+    {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mWakeUp.wait(lock, [this]() { return mStopping || !mTasks.empty(); });
+            if (mStopping && mTasks.empty())
+                return;
+
+            task = mTasks.front();
+            mTasks.pop_front();
+        }
+        task();
+    }
+}
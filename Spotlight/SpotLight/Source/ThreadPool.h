@@ -0,0 +1,53 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//----------------------------------------------
+//Fixed set of worker threads pulling tasks from one queue
+//----------------------------------------------
+class ThreadPool
+{
+public:
+    //numWorkers = 0 creates a pool that runs everything on the calling thread
+    explicit ThreadPool(unsigned int numWorkers);
+    ~ThreadPool();
+
+    //One pool for the whole app: a worker per core, minus the calling thread
+    static ThreadPool& shared();
+
+    unsigned int numWorkers() const { return (unsigned int)mWorkers.size(); }
+
+    //Queue a task for any worker
+    void run(const std::function<void()>& task);
+
+    //Calls body(0) .. body(count - 1) across the workers and returns when all are done.
+    //The calling thread takes part, so this is safe to use from inside a pool task
+    void parallelFor(size_t count, const std::function<void(size_t)>& body);
+
+    //Same on pool, or a plain loop on the calling thread when pool is NULL or there is only one index
+    static void parallelFor(ThreadPool* pool, size_t count, const std::function<void(size_t)>& body);
+
+    //How many chunks to cut total units of work into for parallelFor: up to four per thread so they balance, none
+    //smaller than minPerChunk so handing them out stays noise next to the work. 1 without a pool or workers
+    static size_t numChunks(const ThreadPool* pool, size_t total, size_t minPerChunk);
+
+private:
+    ThreadPool(const ThreadPool&);
+    ThreadPool& operator=(const ThreadPool&);
+
+    void workerLoop();
+
+    std::vector<std::thread> mWorkers;
+    std::deque<std::function<void()>> mTasks;
+    std::mutex mMutex;
+    std::condition_variable mWakeUp;
+    bool mStopping;
+};
+
+#endif
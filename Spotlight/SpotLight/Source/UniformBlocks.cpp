@@ -0,0 +1,48 @@
+#include "UniformBlocks.h"
+#include "ShaderProgram.h"
+#include <cstring>
+
+namespace
+{
+    GLint uniformBufferAlignment()
+    {
+        GLint alignment = 256; // the largest any driver reports
+        glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+        return alignment;
+    }
+
+    size_t alignUp(size_t size, size_t alignment)
+    {
+        return (size + alignment - 1) / alignment * alignment;
+    }
+}
+
+FrameUniforms::FrameUniforms(int maxUpdatesPerFrame)
+    :mAlignment(uniformBufferAlignment()),
+    mStream(maxUpdatesPerFrame * (alignUp(sizeof(FrameBlock), mAlignment) + alignUp(sizeof(LightsBlock), mAlignment)))
+{
+}
+
+void FrameUniforms::bindBlocks(ShaderProgram& program)
+{
+    program.bindUniformBlock("Frame", FRAME_BLOCK_BINDING);
+    program.bindUniformBlock("Lights", LIGHTS_BLOCK_BINDING);
+}
+
+bool FrameUniforms::set(const FrameBlock& frame, const LightsBlock& lights)
+{
+    GLintptr frameOffset, lightsOffset;
+    void* frameData = mStream.allocate(sizeof(FrameBlock), mAlignment, frameOffset);
+    void* lightsData = mStream.allocate(sizeof(LightsBlock), mAlignment, lightsOffset);
+    if (frameData == NULL || lightsData == NULL)
+        return false;
+
+    std::memcpy(frameData, &frame, sizeof(FrameBlock));
+    std::memcpy(lightsData, &lights, sizeof(LightsBlock));
+    mStream.commit();
+
+    //Indexed bindings are context state, no program needs to be in use
+    glBindBufferRange(GL_UNIFORM_BUFFER, FRAME_BLOCK_BINDING, mStream.getBuffer(), frameOffset, sizeof(FrameBlock));
+    glBindBufferRange(GL_UNIFORM_BUFFER, LIGHTS_BLOCK_BINDING, mStream.getBuffer(), lightsOffset, sizeof(LightsBlock));
+    return true;
+}
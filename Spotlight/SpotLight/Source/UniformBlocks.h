@@ -0,0 +1,70 @@
+#ifndef UNIFORM_BLOCKS_H
+#define UNIFORM_BLOCKS_H
+
+#include <cstddef>
+
+#include "GL/glew.h"
+#include "glm/glm.hpp"
+#include "StreamBuffer.h"
+
+class ShaderProgram;
+
+//Binding points of the blocks every program shares. GLSL 3.30 has no layout(binding), ShaderProgram::bindUniformBlock
+//assigns them after linking
+const GLuint FRAME_BLOCK_BINDING = 0;
+const GLuint LIGHTS_BLOCK_BINDING = 1;
+
+//std140 mirror of "uniform Frame" in Frame.glsl, which the vertex and fragment shaders #include. A vec3 takes 16 bytes unless a float follows it
+struct FrameBlock
+{
+    glm::mat4 view;
+    glm::mat4 projection;
+    glm::vec3 viewPos;
+    float pad0;
+};
+
+//std140 mirror of "uniform Lights" in Lights.glsl, which the fragment shaders #include
+struct LightsBlock
+{
+    glm::vec3 spotLightPos;
+    float spotLightCutoff; // cosine of the inner cone angle
+    glm::vec3 spotLightDir;
+    float spotLightOuterCutoff;
+    glm::vec3 spotLightColor;
+    float spotLightRange;
+    glm::vec3 dirLightDirection;
+    float pad0;
+    glm::vec3 dirLightColor;
+    float pad1;
+};
+
+static_assert(offsetof(FrameBlock, viewPos) == 128 && sizeof(FrameBlock) == 144, "FrameBlock must match std140");
+static_assert(offsetof(LightsBlock, dirLightDirection) == 48 && offsetof(LightsBlock, dirLightColor) == 64 &&
+    sizeof(LightsBlock) == 80, "LightsBlock must match std140");
+
+//----------------------------------------------
+//The Frame and Lights blocks for every program at once. set() writes them into a StreamBuffer and binds the ranges to
+//FRAME_BLOCK_BINDING and LIGHTS_BLOCK_BINDING, so the camera and lights go to the GPU once per frame instead of as
+//loose uniforms per program. Programs only need bindBlocks once after loading
+//----------------------------------------------
+class FrameUniforms
+{
+public:
+    //Needs the GL context. maxUpdatesPerFrame: how often set() may be called between beginFrame and endFrame
+    explicit FrameUniforms(int maxUpdatesPerFrame = 4);
+
+    //Points the program's Frame and Lights blocks, where it has them, at the shared binding points
+    static void bindBlocks(ShaderProgram& program);
+
+    void beginFrame() { mStream.beginFrame(); }
+    void endFrame() { mStream.endFrame(); }
+
+    //Draws after this see the new values. Returns false when the frame is out of space, the old values stay bound
+    bool set(const FrameBlock& frame, const LightsBlock& lights);
+
+private:
+    GLint mAlignment; // GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT
+    StreamBuffer mStream;
+};
+
+#endif
@@ -0,0 +1,207 @@
+#include "VertexFormat.h"
+#include <cmath>
+#include <cstring>
+#include "glm/gtc/packing.hpp"
+
+namespace
+{
+    VertexAttribute makeAttribute(GLint size, GLenum type, GLboolean normalized, GLsizei offset)
+    {
+        VertexAttribute attribute = { size, type, normalized, offset };
+        return attribute;
+    }
+
+    inline float signNotZero(float v)
+    {
+        return v >= 0.0f ? 1.0f : -1.0f;
+    }
+
+    //Unit vector -> point in [-1, 1]^2. The lower hemisphere is folded over the diagonals
+    glm::vec2 octEncode(const glm::vec3& n)
+    {
+        float l1 = fabsf(n.x) + fabsf(n.y) + fabsf(n.z);
+        if (l1 == 0.0f)
+            return glm::vec2(0.0f);
+
+        glm::vec2 e(n.x / l1, n.y / l1);
+        if (n.z < 0.0f)
+            e = glm::vec2((1.0f - fabsf(e.y)) * signNotZero(e.x), (1.0f - fabsf(e.x)) * signNotZero(e.y));
+        return e;
+    }
+
+    //Same math as octDecode in the vertex shaders
+    glm::vec3 octDecode(const glm::vec2& e)
+    {
+        glm::vec3 n(e.x, e.y, 1.0f - fabsf(e.x) - fabsf(e.y));
+        if (n.z < 0.0f)
+            n = glm::vec3((1.0f - fabsf(e.y)) * signNotZero(e.x), (1.0f - fabsf(e.x)) * signNotZero(e.y), n.z);
+        return glm::normalize(n);
+    }
+
+    template<typename T>
+    inline void writeSnorm(unsigned char* out, const glm::vec2& v, float maxValue)
+    {
+        T q[2];
+        for (int i = 0; i < 2; i++)
+            q[i] = (T)roundf(glm::clamp(v[i], -1.0f, 1.0f) * maxValue);
+        memcpy(out, q, sizeof(q));
+    }
+
+    template<typename T>
+    inline glm::vec2 readSnorm(const unsigned char* in, float maxValue)
+    {
+        T q[2];
+        memcpy(q, in, sizeof(q));
+        return glm::vec2(glm::max(q[0] / maxValue, -1.0f), glm::max(q[1] / maxValue, -1.0f));
+    }
+}
+
+VertexLayout getVertexLayout(const VertexFormat& format)
+{
+    VertexLayout layout;
+    GLsizei offset = 0;
+
+    //Every attribute starts 4 byte aligned, some hardware fetches misaligned attributes slowly
+    switch (format.position)
+    {
+    case POSITION_FLOAT: layout.position = makeAttribute(3, GL_FLOAT, GL_FALSE, offset); offset += 12; break;
+    case POSITION_HALF: layout.position = makeAttribute(3, GL_HALF_FLOAT, GL_FALSE, offset); offset += 8; break;
+    case POSITION_UNORM16: layout.position = makeAttribute(3, GL_UNSIGNED_SHORT, GL_TRUE, offset); offset += 8; break;
+    }
+
+    switch (format.normal)
+    {
+    case NORMAL_FLOAT: layout.normal = makeAttribute(3, GL_FLOAT, GL_FALSE, offset); offset += 12; break;
+    case NORMAL_OCT8: layout.normal = makeAttribute(2, GL_BYTE, GL_TRUE, offset); offset += 4; break;
+    case NORMAL_OCT16: layout.normal = makeAttribute(2, GL_SHORT, GL_TRUE, offset); offset += 4; break;
+    }
+
+    switch (format.texCoords)
+    {
+    case TEXCOORD_FLOAT: layout.texCoords = makeAttribute(2, GL_FLOAT, GL_FALSE, offset); offset += 8; break;
+    case TEXCOORD_HALF: layout.texCoords = makeAttribute(2, GL_HALF_FLOAT, GL_FALSE, offset); offset += 4; break;
+    }
+
+    layout.stride = offset;
+    return layout;
+}
+
+void setVertexAttributes(const VertexLayout& layout)
+{
+    // Position attribute
+    glVertexAttribPointer(0, layout.position.size, layout.position.type, layout.position.normalized, layout.stride, (GLvoid*)(size_t)layout.position.offset);
+    glEnableVertexAttribArray(0);
+
+    //Normals attribute
+    glVertexAttribPointer(1, layout.normal.size, layout.normal.type, layout.normal.normalized, layout.stride, (GLvoid*)(size_t)layout.normal.offset);
+    glEnableVertexAttribArray(1);
+
+    //Texture coordinate attribute
+    glVertexAttribPointer(2, layout.texCoords.size, layout.texCoords.type, layout.texCoords.normalized, layout.stride, (GLvoid*)(size_t)layout.texCoords.offset);
+    glEnableVertexAttribArray(2);
+}
+
+void getDequantization(const VertexFormat& format, const glm::vec3& boundsMin, const glm::vec3& boundsMax,
+    glm::vec4& scale, glm::vec3& offset)
+{
+    bool octNormals = format.normal != NORMAL_FLOAT;
+    if (format.position == POSITION_UNORM16)
+    {
+        scale = glm::vec4(boundsMax - boundsMin, octNormals ? 1.0f : 0.0f);
+        offset = boundsMin;
+    }
+    else
+    {
+        scale = glm::vec4(1.0f, 1.0f, 1.0f, octNormals ? 1.0f : 0.0f);
+        offset = glm::vec3(0.0f);
+    }
+}
+
+void packVertices(const Vertex* vertices, size_t numVertices, const VertexFormat& format,
+    const glm::vec3& boundsMin, const glm::vec3& boundsMax, std::vector<unsigned char>& packed)
+{
+    VertexLayout layout = getVertexLayout(format);
+    packed.assign(numVertices * layout.stride, 0);
+
+    glm::vec3 extent = boundsMax - boundsMin;
+    glm::vec3 invExtent(extent.x > 0.0f ? 1.0f / extent.x : 0.0f, extent.y > 0.0f ? 1.0f / extent.y : 0.0f, extent.z > 0.0f ? 1.0f / extent.z : 0.0f);
+
+    for (size_t i = 0; i < numVertices; i++)
+    {
+        const Vertex& vertex = vertices[i];
+        unsigned char* out = &packed[i * layout.stride];
+
+        unsigned char* position = out + layout.position.offset;
+        if (format.position == POSITION_FLOAT)
+            memcpy(position, &vertex.position, sizeof(glm::vec3));
+        else if (format.position == POSITION_HALF)
+        {
+            glm::uint16 h[3] = { glm::packHalf1x16(vertex.position.x), glm::packHalf1x16(vertex.position.y), glm::packHalf1x16(vertex.position.z) };
+            memcpy(position, h, sizeof(h));
+        }
+        else
+        {
+            glm::vec3 t = glm::clamp((vertex.position - boundsMin) * invExtent, 0.0f, 1.0f);
+            glm::uint16 q[3] = { (glm::uint16)roundf(t.x * 65535.0f), (glm::uint16)roundf(t.y * 65535.0f), (glm::uint16)roundf(t.z * 65535.0f) };
+            memcpy(position, q, sizeof(q));
+        }
+
+        unsigned char* normal = out + layout.normal.offset;
+        if (format.normal == NORMAL_FLOAT)
+            memcpy(normal, &vertex.normal, sizeof(glm::vec3));
+        else if (format.normal == NORMAL_OCT8)
+            writeSnorm<signed char>(normal, octEncode(vertex.normal), 127.0f);
+        else
+            writeSnorm<short>(normal, octEncode(vertex.normal), 32767.0f);
+
+        unsigned char* texCoords = out + layout.texCoords.offset;
+        if (format.texCoords == TEXCOORD_FLOAT)
+            memcpy(texCoords, &vertex.texCoords, sizeof(glm::vec2));
+        else
+        {
+            glm::uint16 h[2] = { glm::packHalf1x16(vertex.texCoords.x), glm::packHalf1x16(vertex.texCoords.y) };
+            memcpy(texCoords, h, sizeof(h));
+        }
+    }
+}
+
+Vertex unpackVertex(const unsigned char* packed, const VertexFormat& format, const glm::vec3& boundsMin, const glm::vec3& boundsMax)
+{
+    VertexLayout layout = getVertexLayout(format);
+    Vertex vertex;
+
+    const unsigned char* position = packed + layout.position.offset;
+    if (format.position == POSITION_FLOAT)
+        memcpy(&vertex.position, position, sizeof(glm::vec3));
+    else if (format.position == POSITION_HALF)
+    {
+        glm::uint16 h[3];
+        memcpy(h, position, sizeof(h));
+        vertex.position = glm::vec3(glm::unpackHalf1x16(h[0]), glm::unpackHalf1x16(h[1]), glm::unpackHalf1x16(h[2]));
+    }
+    else
+    {
+        glm::uint16 q[3];
+        memcpy(q, position, sizeof(q));
+        vertex.position = boundsMin + glm::vec3(q[0], q[1], q[2]) / 65535.0f * (boundsMax - boundsMin);
+    }
+
+    const unsigned char* normal = packed + layout.normal.offset;
+    if (format.normal == NORMAL_FLOAT)
+        memcpy(&vertex.normal, normal, sizeof(glm::vec3));
+    else if (format.normal == NORMAL_OCT8)
+        vertex.normal = octDecode(readSnorm<signed char>(normal, 127.0f));
+    else
+        vertex.normal = octDecode(readSnorm<short>(normal, 32767.0f));
+
+    const unsigned char* texCoords = packed + layout.texCoords.offset;
+    if (format.texCoords == TEXCOORD_FLOAT)
+        memcpy(&vertex.texCoords, texCoords, sizeof(glm::vec2));
+    else
+    {
+        glm::uint16 h[2];
+        memcpy(h, texCoords, sizeof(h));
+        vertex.texCoords = glm::vec2(glm::unpackHalf1x16(h[0]), glm::unpackHalf1x16(h[1]));
+    }
+    return vertex;
+}
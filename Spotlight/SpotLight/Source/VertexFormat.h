@@ -0,0 +1,87 @@
+#ifndef VERTEX_FORMAT_H
+#define VERTEX_FORMAT_H
+
+#include <vector>
+
+#include "GL/glew.h"
+#include "glm/glm.hpp"
+
+struct Vertex
+{
+    glm::vec3 position; // Vertex position
+    glm::vec3 normal; //Normal
+    glm::vec2 texCoords; // Texture coordinates
+};
+
+//----------------------------------------------
+//Compact vertex layouts for the GPU copy of a mesh.
+//The CPU side and the mesh cache always keep the full float Vertex; packing happens at upload.
+//----------------------------------------------
+enum PositionFormat
+{
+    POSITION_FLOAT, // 3 x 32-bit float, 12 bytes
+    POSITION_HALF, // 3 x 16-bit float, 8 bytes with padding
+    POSITION_UNORM16 // 3 x 16-bit normalized against the mesh bounds, 8 bytes with padding
+};
+
+enum NormalFormat
+{
+    NORMAL_FLOAT, // 3 x 32-bit float, 12 bytes
+    NORMAL_OCT8, // octahedral encoded, 2 x 8-bit signed normalized, 4 bytes with padding
+    NORMAL_OCT16 // octahedral encoded, 2 x 16-bit signed normalized, 4 bytes
+};
+
+enum TexCoordFormat
+{
+    TEXCOORD_FLOAT, // 2 x 32-bit float, 8 bytes
+    TEXCOORD_HALF // 2 x 16-bit float, 4 bytes. Repeating UVs up to +-2048 keep at least 1/1024 precision
+};
+
+struct VertexFormat
+{
+    PositionFormat position;
+    NormalFormat normal;
+    TexCoordFormat texCoords;
+
+    VertexFormat(PositionFormat p = POSITION_FLOAT, NormalFormat n = NORMAL_FLOAT, TexCoordFormat t = TEXCOORD_FLOAT)
+        :position(p), normal(n), texCoords(t) {}
+
+    //Half the size of the float layout with no visible difference on the sample meshes: 16 bytes per vertex
+    static VertexFormat compact() { return VertexFormat(POSITION_UNORM16, NORMAL_OCT16, TEXCOORD_HALF); }
+
+    bool isFloat() const { return position == POSITION_FLOAT && normal == NORMAL_FLOAT && texCoords == TEXCOORD_FLOAT; }
+    bool operator==(const VertexFormat& other) const { return position == other.position && normal == other.normal && texCoords == other.texCoords; }
+};
+
+//How one attribute sits in the packed vertex, in glVertexAttribPointer terms
+struct VertexAttribute
+{
+    GLint size;
+    GLenum type;
+    GLboolean normalized;
+    GLsizei offset;
+};
+
+struct VertexLayout
+{
+    GLsizei stride;
+    VertexAttribute position, normal, texCoords;
+};
+
+VertexLayout getVertexLayout(const VertexFormat& format);
+
+//Points attributes 0 (position), 1 (normal) and 2 (uv) of the bound vertex array at the bound GL_ARRAY_BUFFER
+void setVertexAttributes(const VertexLayout& layout);
+
+//Constants the vertex shaders use to dequantize: position = packed * scale.xyz + offset.
+//scale.w is 1 when normals are octahedral encoded. Mesh::draw passes them as the constant attributes 3 and 4
+void getDequantization(const VertexFormat& format, const glm::vec3& boundsMin, const glm::vec3& boundsMax,
+    glm::vec4& scale, glm::vec3& offset);
+
+void packVertices(const Vertex* vertices, size_t numVertices, const VertexFormat& format,
+    const glm::vec3& boundsMin, const glm::vec3& boundsMax, std::vector<unsigned char>& packed);
+
+//CPU mirror of the shader side decode, for error metrics
+Vertex unpackVertex(const unsigned char* packed, const VertexFormat& format, const glm::vec3& boundsMin, const glm::vec3& boundsMax);
+
+#endif
@@ -2,6 +2,7 @@
 
 #include <iostream>
 #include <sstream>
+#include <algorithm>
 
 #define GLEW_STATIC
 #include "GL/glew.h"
@@ -9,9 +10,22 @@
 #include "glm/gtc/matrix_transform.hpp"
 
 #include "ShaderProgram.h"
+#include "ShaderLibrary.h"
+#include "ShaderVariants.h"
 #include "Texture2D.h"
 #include "Camera.h"
 #include "Mesh.h"
+#include "MeshBuilder.h"
+#include "MeshStreamer.h"
+#include "MipChain.h"
+#include "RenderQueue.h"
+#include "IndirectRenderer.h"
+#include "Benchmark.h"
+#include "AssetLoader.h"
+#include "ThreadPool.h"
+#include "InstanceBuffer.h"
+#include "UniformBlocks.h"
+#include "GLState.h"
 
 //Global variables
 const char* APP_Title = "OpenGL Application";
@@ -29,6 +43,14 @@ glm::vec2 groundUVScale =glm::vec2(20.0f,20.0f); // Texture UV scale
 bool flashlightEnabled = true; // Toggle for flashlight on/off
 bool flashlightKeyPressed = false; // To prevent key repeat
 
+// Instancing stress test, I cycles through the modes: 100k teapots in one drawInstanced call or one draw call each
+enum StressMode { STRESS_OFF, STRESS_INSTANCED, STRESS_PER_DRAW };
+StressMode stressMode = STRESS_OFF;
+const int STRESS_INSTANCES = 100000;
+
+// Models drawn with one multi-draw indirect call (IndirectRenderer.h), M switches back to a draw call per submesh
+bool indirectModels = true;
+
 //Custom Functions
 void glfw_OnKey(GLFWwindow* window, int key, int scancode, int action, int mods);
 void glfw_OnFrameBufferSize(GLFWwindow* window, int width, int height); //update the viewport when the window is resized
@@ -38,8 +60,31 @@ void update(double elapsedTime);
 void showFPS(GLFWwindow* window);
 bool InitOpenGL();
 
-int main()
+int main(int argc, char* argv[])
 {
+	// Command line benchmarks: SpotLight.exe --bench <name>
+	if (argc > 2 && std::string(argv[1]) == "--bench")
+	{
+		return runBenchmark(argv[2]) ? 0 : -1;
+	}
+
+	// Offline cooking: SpotLight.exe --cook <file.obj or image>... writes mesh caches and the mip caches of textures
+	if (argc > 2 && std::string(argv[1]) == "--cook")
+	{
+		bool cooked = true;
+		for (int i = 2; i < argc; i++)
+		{
+			std::string filename = argv[i];
+			bool obj = filename.find(".obj") != std::string::npos;
+			cooked = (obj ? cookOBJ(filename) : cookTexture(filename)) && cooked;
+		}
+		return cooked ? 0 : -1;
+	}
+
+	// Shader development: read bin's shader files instead of the copies built into the executable
+	if (argc > 1 && std::string(argv[1]) == "--shader-files")
+		ShaderProgram::setLoadFromFiles(true);
+
 	// Initialize OpenGL
 	if (!InitOpenGL())
 	{
@@ -50,198 +95,300 @@ int main()
 	// Disable VSync for uncapped FPS
 	glfwSwapInterval(0); 
 	
-	//for light bulb
-	ShaderProgram LightShader;
-	LightShader.loadShaders("Light.vert", "Light.frag"); 
-	
-	//for lighting objects
-	ShaderProgram LightingShader;
-	LightingShader.loadShaders("Lighting.vert", "Lighting.frag");
+	//Everything that owns GL objects lives in this block, so it is released while the context still exists
+	{
+		//All programs are started at once and compile while the assets load, see ShaderProgram::beginLoadShaders.
+		//Each draw below is skipped until its program is ready
+		double shaderStartTime = glfwGetTime();
+		ShaderProgram::enableParallelCompile();
+		ShaderVariantCache shaderVariants;
+
+		//for light bulb
+		ShaderProgram& LightShader = shaderVariants.get("Light.vert", "Light.frag");
+
+		//The lit programs come in two variants, [0] leaves the flashlight code out while it is off, [1] has it
+		ShaderDefines withSpotlight, withoutSpotlight;
+		withoutSpotlight.set("HAS_SPOTLIGHT", 0);
+
+		//for lighting objects
+		ShaderProgram* LightingShaders[2] = { &shaderVariants.get("Lighting.vert", "Lighting.frag", withoutSpotlight),
+			&shaderVariants.get("Lighting.vert", "Lighting.frag", withSpotlight) };
+
+		//for ground plane
+		ShaderProgram* GroundShaders[2] = {
+			&shaderVariants.get("Lighting.vert", "Lighting.frag", ShaderDefines(withoutSpotlight).set("GROUND_UV_SCALE")),
+			&shaderVariants.get("Lighting.vert", "Lighting.frag", ShaderDefines(withSpotlight).set("GROUND_UV_SCALE")) };
+
+		//for the instancing stress test, the model matrix comes from an instance attribute
+		ShaderProgram* LightingInstancedShaders[2] = {
+			&shaderVariants.get("Lighting.vert", "Lighting.frag", ShaderDefines(withoutSpotlight).set("INSTANCED")),
+			&shaderVariants.get("Lighting.vert", "Lighting.frag", ShaderDefines(withSpotlight).set("INSTANCED")) };
+
+		//for the models with multi-draw indirect, the per draw values come from IndirectRenderer's buffer texture
+		ShaderProgram* IndirectShaders[2] = { &shaderVariants.get("Indirect.vert", "Indirect.frag", withoutSpotlight),
+			&shaderVariants.get("Indirect.vert", "Indirect.frag", withSpotlight) };
+		bool shadersReady = false;
+
+		//Camera and lights are uniform blocks shared by all programs, written once per frame. See UniformBlocks.h
+		FrameUniforms frameUniforms;
+		FrameUniforms::bindBlocks(LightShader);
+		for (int i = 0; i < 2; i++)
+		{
+			FrameUniforms::bindBlocks(*LightingShaders[i]);
+			FrameUniforms::bindBlocks(*GroundShaders[i]);
+			FrameUniforms::bindBlocks(*LightingInstancedShaders[i]);
+			FrameUniforms::bindBlocks(*IndirectShaders[i]);
+		}
 
-	//for ground plane
-	ShaderProgram GroundShader;
-	GroundShader.loadShaders("Ground.vert", "Ground.frag");
+		//Saving a shader file rebuilds its programs in the background, they are swapped in between frames
+		shaderVariants.setHotReload(true);
 	
-	//Model Positions
-	glm::vec3 modelPos[] = {
-		glm::vec3(0.0f, 0.0f, 0.0f),  //RubberToy
-		glm::vec3(3.0f, 0.0f, 0.0f),  //Suzan
-		glm::vec3(-3.0f, 0.0f, 0.0f),  //Teapot
-	};
-
-	glm::vec3 modelScale[] = {
-		glm::vec3(1.0f, 1.0f, 1.0f),  //RubberToy
-		glm::vec3(1.0f, 1.0f, 1.0f),  //Suzan
-		glm::vec3(1.0f, 1.0f, 1.0f),  //Teapot
-	};
-
-	//Add ground plane
-	glm::vec3 GroundPos = glm::vec3(0.0f, 0.0f, 0.0f); // Position for the ground plane
-	glm::vec3 GroundScale = glm::vec3(5.0f, 5.0f, 5.0f);
-
-	//Add light
-	glm::vec3 lightPos(0.0f, 1.0f, 0.0f);
-	glm::vec3 lightColor(1.0f, 0.5f, 0.0f);
-	float lightIntensity = 1.0f;
-	float lightSpeed = 70.0f;
-	lightColor = lightColor * lightIntensity; 
-
-	glm::vec3 lightPos2(0.0f, 1.0f, 0.0f);
-	glm::vec3 lightColor2(1.0f, 1.0f, 1.0f);
-	float angle2 = 0.0f;
-	float lightSpeed2 = 50.0f;
-	//lightColor2 = lightColor2 * lightIntensity; 
+		//Model Positions
+		glm::vec3 modelPos[] = {
+			glm::vec3(0.0f, 0.0f, 0.0f),  //RubberToy
+			glm::vec3(3.0f, 0.0f, 0.0f),  //Suzan
+			glm::vec3(-3.0f, 0.0f, 0.0f),  //Teapot
+		};
+
+		glm::vec3 modelScale[] = {
+			glm::vec3(1.0f, 1.0f, 1.0f),  //RubberToy
+			glm::vec3(1.0f, 1.0f, 1.0f),  //Suzan
+			glm::vec3(1.0f, 1.0f, 1.0f),  //Teapot
+		};
+
+		//Add ground plane
+		glm::vec3 GroundPos = glm::vec3(0.0f, 0.0f, 0.0f); // Position for the ground plane
+		glm::vec3 GroundScale = glm::vec3(5.0f, 5.0f, 5.0f);
+
+		//Add light
+		glm::vec3 lightPos(0.0f, 1.0f, 0.0f);
+		glm::vec3 lightColor(1.0f, 0.5f, 0.0f);
+		float lightIntensity = 1.0f;
+		float lightSpeed = 70.0f;
+		lightColor = lightColor * lightIntensity; 
+
+		glm::vec3 lightPos2(0.0f, 1.0f, 0.0f);
+		glm::vec3 lightColor2(1.0f, 1.0f, 1.0f);
+		float angle2 = 0.0f;
+		float lightSpeed2 = 50.0f;
+		//lightColor2 = lightColor2 * lightIntensity; 
 	
-	//Load meshes and textures
-	//Use our custom Mesh and Texture class array
-	const int numModels = 3;
-	Mesh mesh[numModels];
-	Texture2D texture[numModels];
+		//Load meshes and textures
+		//Use our custom Mesh and Texture class array
+		//Startup time is printed so cold (no *.meshcache next to the OBJs) and warm runs can be compared
+		double loadStartTime = glfwGetTime();
+		const int numModels = 3;
+		GeometryArena geometryArena(64 * 1024, 512 * 1024, VertexFormat::compact()); // declared first, the meshes give their ranges back to it
+		Mesh mesh[numModels];
+		Texture2D texture[numModels];
+		Mesh groundMesh;
+		Texture2D textureGround;
+		Mesh lightMesh;
+
+		//Files are read, parsed and decoded on the thread pool, all at once. This thread only does the GL uploads,
+		//in assetLoader.update() every frame, and draws whatever has arrived so far. See AssetLoader.h
+		MeshStreamer meshStreamer;
+		AssetLoader assetLoader(ThreadPool::shared());
 	
-	mesh[0].loadOBJ("RubberToy.obj");
-	mesh[1].loadOBJ("Suzan.obj");
-	mesh[2].loadOBJ("Teapot.obj");
+		//The models go to the GPU in the 16 byte compact layout, see VertexFormat.h, all in one shared arena and VAO.
+		//Their buffers are filled a few milliseconds per frame, coarse levels first, see MeshStreamer.h
+		assetLoader.loadMesh(mesh[0], "RubberToy.obj", geometryArena, &meshStreamer);
+		assetLoader.loadMesh(mesh[1], "Suzan.obj", geometryArena, &meshStreamer);
+		assetLoader.loadMesh(mesh[2], "Teapot.obj", geometryArena, &meshStreamer);
 	
-	texture[0].loadTexture("Pattern1.jpg", true);
-	texture[1].loadTexture("Pattern2.jpg", true);
-	texture[2].loadTexture("Pattern3.jpg", true);
-
-	Mesh groundMesh;
-	groundMesh.loadOBJ("GroundPlane.obj");
-	Texture2D textureGround;
-	textureGround.loadTexture("Brick.jpg", true); 
-	
-	Mesh lightMesh;
-	lightMesh.loadOBJ("light.obj");
-	
-	double lastFrameTime = glfwGetTime();
+		assetLoader.loadTexture(texture[0], "Pattern1.jpg", true);
+		assetLoader.loadTexture(texture[1], "Pattern2.jpg", true);
+		assetLoader.loadTexture(texture[2], "Pattern3.jpg", true);
+
+		assetLoader.loadMesh(groundMesh, "GroundPlane.obj");
+		assetLoader.loadTexture(textureGround, "Brick.jpg", true); 
 	
-	//Main Loop
-	while (!glfwWindowShouldClose(gwindow))
-	{
-		showFPS(gwindow); // Show FPS in the console and window title
+		assetLoader.loadMesh(lightMesh, "light.obj");
+		bool assetsLoaded = false;
 
-		double currentTime = glfwGetTime();
-		double deltaTime = currentTime - lastFrameTime;
+		//The models are drawn material by material, grouped by texture. See RenderQueue.h
+		RenderQueue renderQueue;
 
-		glfwPollEvents(); // Poll for events (like keyboard and mouse input)
-		update(deltaTime); // Update the camera based on input
-		
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT); // Clear the screen
-		
-		/***
-		 *Model Matrix: local space to world space
-		 *View Matrix: world space to camera space
-		 *Projection Matrix: camera space to clip space
-		 ***/
-		glm::mat4 model, view, projection;
-		
-		//View Matrix
-		view = fpsCamera.getViewMatrix();
-		
-		//Projection Matrix
-		projection = glm::mat4(1.0f); 
-		projection = glm::perspective(glm::radians(fpsCamera.getFOV()), (float)gWindowWidth / (float)gWindowHeight, 0.1f, 100.0f);
+		//Everything in the arena goes out in one glMultiDrawElementsIndirect, told apart in the shader by gl_DrawID
+		IndirectRenderer indirectRenderer(geometryArena);
+		std::cout << "Multi-draw indirect " << (IndirectRenderer::isSupported() ? "supported" : "not supported, one draw call per submesh") << std::endl;
 
-		//Camera view position
-		glm::vec3 viewPos = fpsCamera.getPosition();
+		//Stress test teapots on a grid around the scene. The transforms never change, so they go to the GPU once
+		std::vector<glm::mat4> stressModels(STRESS_INSTANCES);
+		for (int i = 0; i < STRESS_INSTANCES; i++)
+		{
+			glm::vec3 stressPos((i % 317 - 158) * 0.6f, 0.0f, (i / 317 - 158) * 0.6f);
+			stressModels[i] = glm::scale(glm::translate(glm::mat4(1.0f), stressPos), glm::vec3(0.15f));
+		}
+		InstanceBuffer stressInstances;
+		stressInstances.update(stressModels);
+	
+		double lastFrameTime = glfwGetTime();
+	
+		//Main Loop
+		while (!glfwWindowShouldClose(gwindow))
+		{
+			showFPS(gwindow); // Show FPS in the console and window title
+
+			double currentTime = glfwGetTime();
+			double deltaTime = currentTime - lastFrameTime;
+
+			glfwPollEvents(); // Poll for events (like keyboard and mouse input)
+			update(deltaTime); // Update the camera based on input
+			assetLoader.update(); // GL side of the assets whose files are done
+			meshStreamer.update(); // Upload the next chunks of the streamed meshes, within the frame budget
+			if (!assetsLoaded && assetLoader.pending() == 0 && meshStreamer.isIdle())
+			{
+				std::cout << "Assets loaded in " << (glfwGetTime() - loadStartTime) * 1000.0 << " ms" << std::endl;
+				assetsLoaded = true;
+			}
+			shaderVariants.updateHotReload(); // the old programs stay in use until the new ones link
+			if (!shadersReady && shaderVariants.isReady())
+			{
+				std::cout << "Shaders ready in " << (glfwGetTime() - shaderStartTime) * 1000.0 << " ms" << std::endl;
+				shaderVariants.report(std::cout);
+				shadersReady = true;
+			}
 		
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT); // Clear the screen
 		
-		// Animate the first light (line-direction)
-		angle += (float)deltaTime * lightSpeed;
-		lightPos.x = 7.0f * sinf(glm::radians(angle2));
-		lightPos.z = 7.0f * cosf(glm::radians(angle2));
-
-		// Animate the second light (circle-direction)
-		angle2 += (float)deltaTime * lightSpeed2;
-		lightPos2.x = 5.0f * cosf(glm::radians(angle2));
-		lightPos2.z = 5.0f * sinf(glm::radians(angle2));
+			/***
+			 *Model Matrix: local space to world space
+			 *View Matrix: world space to camera space
+			 *Projection Matrix: camera space to clip space
+			 ***/
+			glm::mat4 model, view, projection;
 		
-		// --- Flashlight (spotlight) parameters ---
-		// Attach the flashlight to the camera position and direction
-		glm::vec3 spotLightPos = fpsCamera.getPosition();
-		glm::vec3 spotLightDir = fpsCamera.getLook();
-
-		// Flashlight properties - Lower spotlight intensity
-		float spotLightCutoff = glm::cos(glm::radians(20.0f));       // Wider inner cone (40 degree cone total)
-		float spotLightOuterCutoff = glm::cos(glm::radians(35.0f)); // Wider outer cone (70 degree cone total)
-		float spotLightRange = 40.0f;     // Much longer range for debugging
-		float spotLightIntensity = flashlightEnabled ? 20.0f : 0.0f; // Lower intensity
-		glm::vec3 spotLightColor = glm::vec3(1.0f, 0.95f, 0.8f) * spotLightIntensity; // Warm white color
-
-		// Pass spotlight uniforms to lighting shader
-		LightingShader.use();
-		LightingShader.setUniform("view", view);
-		LightingShader.setUniform("projection", projection);
-		LightingShader.setUniform("viewPos", viewPos);
-		LightingShader.setUniform("spotLightPos", spotLightPos);
-		LightingShader.setUniform("spotLightDir", spotLightDir);
-		LightingShader.setUniform("spotLightCutoff", spotLightCutoff);
-		LightingShader.setUniform("spotLightOuterCutoff", spotLightOuterCutoff);
-		LightingShader.setUniform("spotLightRange", spotLightRange);
-		LightingShader.setUniform("spotLightColor", spotLightColor);
-
+			//View Matrix
+			view = fpsCamera.getViewMatrix();
+		
+			//Projection Matrix
+			projection = glm::mat4(1.0f); 
+			projection = glm::perspective(glm::radians(fpsCamera.getFOV()), (float)gWindowWidth / (float)gWindowHeight, 0.1f, 100.0f);
 
+			//Camera view position
+			glm::vec3 viewPos = fpsCamera.getPosition();
 		
-		for (int i = 0; i < numModels; i++)
-		{
-			//Set the model matrix for each model
-			model = glm::mat4(1.0f);
-
-			model = glm::scale(glm::mat4(1.0f), modelScale[i]) * glm::translate(glm::mat4(1.0f), modelPos[i]);
-			LightingShader.setUniform("model", model); // Set the model matrix in the shader
-			
-			texture[i].bindTexture(0); // Bind the texture for this model
-			mesh[i].draw(); // Draw the mesh
-			texture[i].unbindTexture(0); // Unbind the texture after drawing
-		}
 		
-		//Render the ground plane
-		model =  glm::scale(glm::mat4(1.0f), GroundScale) * glm::translate(glm::mat4(1.0f), GroundPos);
-		GroundShader.use();
-		GroundShader.setUniform("model", model);
-		GroundShader.setUniform("view", view);
-		GroundShader.setUniform("projection", projection);
-		GroundShader.setUniform("viewPos", viewPos);
-		GroundShader.setUniform("groundUVScale", groundUVScale);
+			// Animate the first light (line-direction)
+			angle += (float)deltaTime * lightSpeed;
+			lightPos.x = 7.0f * sinf(glm::radians(angle2));
+			lightPos.z = 7.0f * cosf(glm::radians(angle2));
+
+			// Animate the second light (circle-direction)
+			angle2 += (float)deltaTime * lightSpeed2;
+			lightPos2.x = 5.0f * cosf(glm::radians(angle2));
+			lightPos2.z = 5.0f * sinf(glm::radians(angle2));
 		
-		// Pass spotlight uniforms to ground shader as well
-		GroundShader.setUniform("spotLightPos", spotLightPos);
-		GroundShader.setUniform("spotLightDir", spotLightDir);
-		GroundShader.setUniform("spotLightCutoff", spotLightCutoff);
-		GroundShader.setUniform("spotLightOuterCutoff", spotLightOuterCutoff);
-		GroundShader.setUniform("spotLightRange", spotLightRange);
-		GroundShader.setUniform("spotLightColor", spotLightColor);
+			// --- Flashlight (spotlight) parameters ---
+			// Attach the flashlight to the camera position and direction
+			glm::vec3 spotLightPos = fpsCamera.getPosition();
+			glm::vec3 spotLightDir = fpsCamera.getLook();
+
+			// Flashlight properties - Lower spotlight intensity
+			float spotLightCutoff = glm::cos(glm::radians(20.0f));       // Wider inner cone (40 degree cone total)
+			float spotLightOuterCutoff = glm::cos(glm::radians(35.0f)); // Wider outer cone (70 degree cone total)
+			float spotLightRange = 40.0f;     // Much longer range for debugging
+			float spotLightIntensity = flashlightEnabled ? 20.0f : 0.0f; // Lower intensity
+			glm::vec3 spotLightColor = glm::vec3(1.0f, 0.95f, 0.8f) * spotLightIntensity; // Warm white color
+
+			// --- Directional light parameters ---
+			glm::vec3 dirLightDirection = glm::normalize(glm::vec3(-0.3f, -1.0f, -0.5f)); // Down and to the side
+			glm::vec3 dirLightColor = glm::vec3(0.0f, 0.0f, 0.0f); // Lower directional light intensity
+
+			// Camera and lights for every shader at once
+			FrameBlock frameBlock = {};
+			frameBlock.view = view;
+			frameBlock.projection = projection;
+			frameBlock.viewPos = viewPos;
+
+			LightsBlock lightsBlock = {};
+			lightsBlock.spotLightPos = spotLightPos;
+			lightsBlock.spotLightDir = spotLightDir;
+			lightsBlock.spotLightCutoff = spotLightCutoff;
+			lightsBlock.spotLightOuterCutoff = spotLightOuterCutoff;
+			lightsBlock.spotLightRange = spotLightRange;
+			lightsBlock.spotLightColor = spotLightColor;
+			lightsBlock.dirLightDirection = dirLightDirection;
+			lightsBlock.dirLightColor = dirLightColor;
+
+			frameUniforms.beginFrame();
+			frameUniforms.set(frameBlock, lightsBlock);
+
+			//The variants for this frame
+			ShaderProgram& LightingShader = *LightingShaders[flashlightEnabled ? 1 : 0];
+			ShaderProgram& GroundShader = *GroundShaders[flashlightEnabled ? 1 : 0];
+			ShaderProgram& LightingInstancedShader = *LightingInstancedShaders[flashlightEnabled ? 1 : 0];
+			ShaderProgram& IndirectShader = *IndirectShaders[flashlightEnabled ? 1 : 0];
+
+			if (indirectModels ? IndirectShader.use() : LightingShader.use())
+			{
+				for (int i = 0; i < numModels; i++)
+				{
+					//Set the model matrix for each model
+					model = glm::mat4(1.0f);
+
+					model = glm::scale(glm::mat4(1.0f), modelScale[i]) * glm::translate(glm::mat4(1.0f), modelPos[i]);
+					renderQueue.submit(mesh[i], model, &texture[i]); // Materials without their own map_Kd use this model's texture
+				}
+				//Each mesh at the detail its distance needs
+				if (indirectModels)
+					renderQueue.flush(indirectRenderer, IndirectShader, view, projection, viewPos, (float)gWindowHeight);
+				else
+					renderQueue.flush(LightingShader, view, projection, viewPos, (float)gWindowHeight);
+			}
+
+			//Stress test: the Teapot's coarsest level, both ways with the same lighting
+			if (stressMode != STRESS_OFF && mesh[2].isDrawable())
+			{
+				int stressLod = (int)mesh[2].getLods().size() - 1;
+				texture[2].bindTexture(0);
+				if (stressMode == STRESS_INSTANCED)
+				{
+					if (LightingInstancedShader.use())
+						mesh[2].drawInstanced(stressInstances, stressLod); // One draw call for all of them
+				}
+				else if (LightingShader.use())
+				{
+					UniformHandle modelUniform = LightingShader.getUniformHandle(ShaderUniforms::model); // looked up once, not per teapot
+					for (int i = 0; i < STRESS_INSTANCES; i++)
+					{
+						LightingShader.setUniform(modelUniform, stressModels[i]);
+						for (size_t m = 0; m < mesh[2].getMaterials().size(); m++)
+							mesh[2].drawSubmesh(m, stressLod, stressModels[i], view, projection, viewPos);
+					}
+				}
+				texture[2].unbindTexture(0);
+			}
 		
-		// --- Directional light parameters ---
-        glm::vec3 dirLightDirection = glm::normalize(glm::vec3(-0.3f, -1.0f, -0.5f)); // Down and to the side
-        glm::vec3 dirLightColor = glm::vec3(0.0f, 0.0f, 0.0f); // Lower directional light intensity
-
-        // Pass directional light uniforms to lighting shader
-        LightingShader.use();
-        LightingShader.setUniform("dirLightDirection", dirLightDirection);
-        LightingShader.setUniform("dirLightColor", dirLightColor);
-
-
-		textureGround.bindTexture(0);
-		groundMesh.draw();
-		textureGround.unbindTexture(0); 
+			//Render the ground plane
+			model =  glm::scale(glm::mat4(1.0f), GroundScale) * glm::translate(glm::mat4(1.0f), GroundPos);
+			if (GroundShader.use())
+			{
+				GroundShader.setUniform(ShaderUniforms::model, model);
+				GroundShader.setUniform(ShaderUniforms::groundUVScale, groundUVScale);
+
+				textureGround.bindTexture(0);
+				groundMesh.draw();
+				textureGround.unbindTexture(0); 
+			}
 
 		
-		// --- Debug: Render a sphere at the spotlight position ---
-        // model = glm::translate(glm::mat4(1.0f), spotLightPos);
-        // LightShader.use();
-        // LightShader.setUniform("model", model);
-        // LightShader.setUniform("view", view);
-        // LightShader.setUniform("projection", projection);
-        // LightShader.setUniform("lightColor", glm::vec3(1.0f, 1.0f, 1.0f)); // White color for debug sphere
-        // lightMesh.draw();
+			// --- Debug: Render a sphere at the spotlight position ---
+	        // model = glm::translate(glm::mat4(1.0f), spotLightPos);
+	        // LightShader.use();
+	        // LightShader.setUniform("model", model);
+	        // LightShader.setUniform("lightColor", glm::vec3(1.0f, 1.0f, 1.0f)); // White color for debug sphere
+	        // lightMesh.draw();
 		
-		// Swap buffers. The order is very important
-		glfwSwapBuffers(gwindow); // Swap buffers to display the rendered content
+			frameUniforms.endFrame(); // The GPU gets this frame's part of the uniform ring back once it is done with the frame
+
+			// Swap buffers. The order is very important
+			glfwSwapBuffers(gwindow); // Swap buffers to display the rendered content
 
-		//update the time
-		lastFrameTime = currentTime;
+			//update the time
+			lastFrameTime = currentTime;
+		}
 	}
 
 	
@@ -292,6 +439,9 @@ bool InitOpenGL()
 	glClearColor(0.25f, 0.38f, 0.47f, 1.0f); // Set the clear shaderProgram.setUniform("vertColor", glm::vec4(0.0f, 0.0f, blueColor, 1.0f));shaderProgram.setUniform("vertColor", glm::vec4(0.0f, 0.0f, blueColor, 1.0f));color (background color)
 	glViewport(0, 0, gWindowWidth, gWindowHeight); // Set the viewport to the window size
 	glEnable(GL_DEPTH_TEST);
+
+	//Leave VAOs and textures bound between draws, GLState skips rebinding the ones the next draw uses again
+	GLState::setUnbindAfterDraw(false);
 	
 	return true; // Return true if OpenGL initialization is successful
 }
@@ -309,6 +459,21 @@ void glfw_OnKey(GLFWwindow* window, int key, int scancode, int action, int mods)
 		flashlightEnabled = !flashlightEnabled;
 		std::cout << "Flashlight " << (flashlightEnabled ? "ON" : "OFF") << std::endl;
 	}
+
+	// Cycle the instancing stress test with I, compare the frame times in the window title
+	if (key == GLFW_KEY_I && action == GLFW_PRESS)
+	{
+		stressMode = (StressMode)((stressMode + 1) % 3);
+		const char* stressNames[] = { "off", "100k instances, one drawInstanced call", "100k instances, one draw call each" };
+		std::cout << "Stress test " << stressNames[stressMode] << std::endl;
+	}
+
+	// Switch the models between one multi-draw indirect call and a draw call per submesh
+	if (key == GLFW_KEY_M && action == GLFW_PRESS)
+	{
+		indirectModels = !indirectModels;
+		std::cout << "Models drawn " << (indirectModels ? "with multi-draw indirect" : "one draw call per submesh") << std::endl;
+	}
 }
 
 void glfw_OnFrameBufferSize(GLFWwindow* window, int width, int height)
@@ -378,6 +543,14 @@ void showFPS(GLFWwindow* window)
 			<< APP_Title << " "
 			<< "FPS: " << fps << " "
 			<< "Frame Time" << msPerframe << " (ms)";
+
+		//GL binds per frame, issued and skipped by GLState because the object was already bound
+		const GLStateStats& stats = GLState::getStats();
+		size_t binds = stats.programBinds + stats.textureBinds + stats.vertexArrayBinds + stats.bufferBinds;
+		size_t skips = stats.programSkips + stats.textureSkips + stats.vertexArraySkips + stats.bufferSkips;
+		outs.precision(0);
+		outs << " Binds " << binds / (double)std::max(frameCount, 1) << " Skipped " << skips / (double)std::max(frameCount, 1);
+		GLState::resetStats();
 		glfwSetWindowTitle(window, outs.str().c_str());
 
 		frameCount = 0;
@@ -0,0 +1,7 @@
+//Camera, written once per frame and shared by every program (see UniformBlocks.h)
+layout(std140) uniform Frame
+{
+   mat4 view;  //View matrix for camera
+   mat4 projection; //Projection matrix for camera
+   vec3 viewPos;
+};
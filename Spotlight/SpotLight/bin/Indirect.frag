@@ -0,0 +1,22 @@
+#version 330 core
+//Lighting.frag for IndirectRenderer: the texture is a layer of one array, the material comes from the vertex shader
+
+in vec2 TexCoord;
+in vec3 Normal;
+in vec3 FragPos;
+flat in vec4 MaterialLayer; // color in xyz, texture array layer in w
+
+//We modify the value and pass it out
+out vec4 frag_color;
+
+uniform sampler2DArray textures;
+
+#include "Frame.glsl"
+#include "Lights.glsl"
+
+void main()
+{
+	vec3 lighting = computeLighting(normalize(Normal), FragPos);
+	vec4 texel = texture(textures, vec3(TexCoord, MaterialLayer.w));
+	frag_color = vec4(lighting, 1.0f) * texel * vec4(MaterialLayer.xyz, 1.0f);
+}
@@ -0,0 +1,41 @@
+#version 330 core
+//Lighting.vert for IndirectRenderer: the per draw values come from a buffer texture instead of uniforms and
+//constant attributes, indexed by the draw's position in the glMultiDrawElementsIndirect call
+#extension GL_ARB_shader_draw_parameters : enable
+
+layout(location = 0) in vec3 pos;
+layout(location = 1) in vec3 normal;
+layout(location = 2) in vec2 texCoord;
+
+//7 texels per draw: the model matrix columns, (material color, texture layer), dequantization scale and offset
+uniform samplerBuffer drawData;
+uniform int drawOffset; // added to gl_DrawID, which is 0 for single draws. The only per draw value without the extension
+
+#include "Frame.glsl"
+
+out vec2 TexCoord;
+out vec3 Normal;
+out vec3 FragPos;
+flat out vec4 MaterialLayer; // color in xyz, texture array layer in w
+
+#include "VertexDecode.glsl"
+
+void main()
+{
+#ifdef GL_ARB_shader_draw_parameters
+   int draw = gl_DrawIDARB + drawOffset;
+#else
+   int draw = drawOffset;
+#endif
+   int base = draw * 7;
+   mat4 model = mat4(texelFetch(drawData, base), texelFetch(drawData, base + 1), texelFetch(drawData, base + 2), texelFetch(drawData, base + 3));
+   MaterialLayer = texelFetch(drawData, base + 4);
+   vec4 posScale = texelFetch(drawData, base + 5);
+   vec3 posOffset = texelFetch(drawData, base + 6).xyz;
+
+   vec3 position = pos * posScale.xyz + posOffset;
+   Normal = posScale.w > 0.5 ? octDecode(normal.xy) : normal;
+   FragPos = vec3(model * vec4(position, 1.0)); //Transform position to world space
+   gl_Position = projection * view * model * vec4(position, 1.0); // Transform position to clip space
+   TexCoord = texCoord*2;
+}
@@ -10,14 +10,20 @@ layout(location = 1) in vec3 normal;
 //The UV data is stored inside the second vertex attribute array slot(1)
 layout(location = 2) in vec2 texCoord;
 
+//Dequantization constants, the same for every vertex of a mesh (see VertexFormat.h)
+//posScale.w is 1 when the normal is octahedral encoded in normal.xy
+layout(location = 3) in vec4 posScale;
+layout(location = 4) in vec3 posOffset;
+
 uniform mat4 model; //Model matrix for object
-uniform mat4 view;  //View matrix for camera
-uniform mat4 projection; //Projection matrix for camera
+
+#include "Frame.glsl"
 
 out vec2 TexCoord;
 
 void main()
 {
-   gl_Position = projection * view * model * vec4(pos, 1.0);
+   vec3 position = pos * posScale.xyz + posOffset;
+   gl_Position = projection * view * model * vec4(position, 1.0);
    TexCoord = texCoord;
 }
\ No newline at end of file
@@ -1,4 +1,13 @@
 #version 330 core
+//Every lit mesh, the ground plane included. Variants (ShaderDefines in ShaderVariants.h):
+//INSTANCED 1: the model matrix is a per instance attribute instead of a uniform
+//GROUND_UV_SCALE 1: the texture coordinates are scaled by groundUVScale instead of doubled
+#ifndef INSTANCED
+#define INSTANCED 0
+#endif
+#ifndef GROUND_UV_SCALE
+#define GROUND_UV_SCALE 0
+#endif
 
 //Pass the data in. Then we modify it
 //The position data is stored inside the first vertex attribute array slot(0)
@@ -7,12 +16,26 @@ layout(location = 0) in vec3 pos;
 //Normal data
 layout(location = 1) in vec3 normal;
 
-//The UV data is stored inside the second vertex attribute array slot(2)
+//The UV data is stored inside the second vertex attribute array slot(1)
 layout(location = 2) in vec2 texCoord;
 
+//Dequantization constants, the same for every vertex of a mesh (see VertexFormat.h)
+//posScale.w is 1 when the normal is octahedral encoded in normal.xy
+layout(location = 3) in vec4 posScale;
+layout(location = 4) in vec3 posOffset;
+
+#if INSTANCED
+//Model matrix of the instance, columns in locations 5 to 8. Advances once per instance (see InstanceBuffer.h)
+layout(location = 5) in mat4 model;
+#else
 uniform mat4 model; //Model matrix for object
-uniform mat4 view;  //View matrix for camera
-uniform mat4 projection; //Projection matrix for camera
+#endif
+
+#if GROUND_UV_SCALE
+uniform vec2 groundUVScale; // set ground plane texture UV scale
+#endif
+
+#include "Frame.glsl"
 
 
 out vec2 TexCoord;
@@ -20,10 +43,17 @@ out vec3 Normal;
 out vec3 FragPos;
 
 
+#include "VertexDecode.glsl"
+
 void main()
 {
-   Normal = normal; 
-   FragPos = vec3(model * vec4(pos, 1.0)); //Transform position to world space
-   gl_Position = projection * view * model * vec4(pos, 1.0); // Transform position to clip space
+   vec3 position = pos * posScale.xyz + posOffset;
+   Normal = posScale.w > 0.5 ? octDecode(normal.xy) : normal; 
+   FragPos = vec3(model * vec4(position, 1.0)); //Transform position to world space
+   gl_Position = projection * view * model * vec4(position, 1.0); // Transform position to clip space
+#if GROUND_UV_SCALE
+   TexCoord = texCoord * groundUVScale;// Scale the UV coordinates for the ground plane texture
+#else
    TexCoord = texCoord*2;
-}
\ No newline at end of file
+#endif
+}
@@ -0,0 +1,13 @@
+vec2 signNotZero(vec2 v)
+{
+   return vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+}
+
+//Octahedral normal -> unit vector. The lower hemisphere was folded over the diagonals
+vec3 octDecode(vec2 e)
+{
+   vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+   if (n.z < 0.0)
+      n.xy = (1.0 - abs(n.yx)) * signNotZero(n.xy);
+   return normalize(n);
+}